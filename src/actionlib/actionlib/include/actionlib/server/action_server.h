@@ -165,12 +165,28 @@ private:
    */
   void publishStatus(const ros::TimerEvent & e);
 
+  /**
+   * @brief  Publish every tracked goal on the status topic
+   */
+  void publishFullStatus();
+
+  /**
+   * @brief  Publish only the goals whose status changed since they were last published
+   */
+  void publishStatusDelta();
+
   ros::NodeHandle node_;
 
   ros::Subscriber goal_sub_, cancel_sub_;
-  ros::Publisher status_pub_, result_pub_, feedback_pub_;
+  ros::Publisher status_pub_, status_delta_pub_, result_pub_, feedback_pub_;
 
   ros::Timer status_timer_;
+
+  // when set, changes go out on the status_delta topic as they happen, and the full status
+  // list only every status_full_period_ unless a stock client is subscribed to it
+  bool status_delta_;
+  ros::Duration status_full_period_;
+  ros::Time last_full_status_;
 };
 }  // namespace actionlib
 
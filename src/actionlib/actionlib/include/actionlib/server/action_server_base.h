@@ -51,8 +51,14 @@
 #include <actionlib/server/handle_tracker_deleter.h>
 #include <actionlib/server/server_goal_handle.h>
 #include <actionlib/destruction_guard.h>
+#include <boost/unordered_map.hpp>
 
+#include <functional>
 #include <list>
+#include <queue>
+#include <string>
+#include <utility>
+#include <vector>
 
 namespace actionlib
 {
@@ -145,10 +151,57 @@ protected:
    */
   virtual void publishStatus() = 0;
 
+  typedef typename std::list<StatusTracker<ActionSpec> >::iterator StatusIterator;
+
+  /**
+   * @brief  Look up the status of a goal by its id
+   * @return An iterator into status_list_, or status_list_.end() if the goal isn't tracked
+   */
+  StatusIterator findStatus(const std::string & goal_id);
+
+  /**
+   * @brief  Append a status to status_list_ and index it by goal id
+   */
+  StatusIterator addStatus(const StatusTracker<ActionSpec> & tracker);
+
+  /**
+   * @brief  Set the status code of a goal and queue it for the next status delta
+   */
+  void setStatus(StatusIterator it, uint8_t status);
+
+  /**
+   * @brief  Hand out the goals whose status changed or which were added since the last call
+   * @param changed Filled with the goals, each listed once
+   */
+  void takeChangedStatus(std::vector<StatusIterator> & changed);
+
+  /**
+   * @brief  Set the time after which a goal with no handles left starts its status_list_timeout_
+   * @param time The destruction time, or ros::Time() to keep the goal around indefinitely
+   */
+  void setDestructionTime(StatusIterator it, const ros::Time & time);
+
+  /**
+   * @brief  Drop every status whose destruction time is more than status_list_timeout_ before now
+   */
+  void removeExpiredStatus(const ros::Time & now);
+
   boost::recursive_mutex lock_;
 
   std::list<StatusTracker<ActionSpec> > status_list_;
 
+  // goal id -> entry in status_list_, so goal and cancel lookups don't scan the list
+  boost::unordered_map<std::string, StatusIterator> status_index_;
+
+  // (destruction time, goal id) pairs, earliest first. Entries whose time no longer
+  // matches the tracker's handle_destruction_time_ are stale and skipped on removal.
+  typedef std::pair<ros::Time, std::string> ExpiryEntry;
+  std::priority_queue<ExpiryEntry, std::vector<ExpiryEntry>, std::greater<ExpiryEntry> > expiry_queue_;
+
+  // ids of the goals whose status_changed_ is set, so a status delta doesn't scan status_list_.
+  // Goals removed since they were queued are skipped.
+  std::vector<std::string> changed_status_;
+
   boost::function<void(GoalHandle)> goal_callback_;
   boost::function<void(GoalHandle)> cancel_callback_;
 
@@ -200,6 +253,79 @@ void ActionServerBase<ActionSpec>::start()
 }
 
 
+template<class ActionSpec>
+typename ActionServerBase<ActionSpec>::StatusIterator ActionServerBase<ActionSpec>::findStatus(
+  const std::string & goal_id)
+{
+  typename boost::unordered_map<std::string, StatusIterator>::iterator index_it =
+    status_index_.find(goal_id);
+  if (index_it == status_index_.end()) {
+    return status_list_.end();
+  }
+  return index_it->second;
+}
+
+template<class ActionSpec>
+typename ActionServerBase<ActionSpec>::StatusIterator ActionServerBase<ActionSpec>::addStatus(
+  const StatusTracker<ActionSpec> & tracker)
+{
+  StatusIterator it = status_list_.insert(status_list_.end(), tracker);
+  status_index_[(*it).status_.goal_id.id] = it;
+  (*it).status_changed_ = true;
+  changed_status_.push_back((*it).status_.goal_id.id);
+  return it;
+}
+
+template<class ActionSpec>
+void ActionServerBase<ActionSpec>::setStatus(StatusIterator it, uint8_t status)
+{
+  (*it).status_.status = status;
+  if (!(*it).status_changed_) {
+    (*it).status_changed_ = true;
+    changed_status_.push_back((*it).status_.goal_id.id);
+  }
+}
+
+template<class ActionSpec>
+void ActionServerBase<ActionSpec>::takeChangedStatus(std::vector<StatusIterator> & changed)
+{
+  changed.clear();
+  for (size_t i = 0; i < changed_status_.size(); ++i) {
+    StatusIterator it = findStatus(changed_status_[i]);
+    // a goal that was removed and added again under the same id is queued twice
+    if (it != status_list_.end() && (*it).status_changed_) {
+      (*it).status_changed_ = false;
+      changed.push_back(it);
+    }
+  }
+  changed_status_.clear();
+}
+
+template<class ActionSpec>
+void ActionServerBase<ActionSpec>::setDestructionTime(StatusIterator it, const ros::Time & time)
+{
+  (*it).handle_destruction_time_ = time;
+  if (time != ros::Time()) {
+    expiry_queue_.push(ExpiryEntry(time, (*it).status_.goal_id.id));
+  }
+}
+
+template<class ActionSpec>
+void ActionServerBase<ActionSpec>::removeExpiredStatus(const ros::Time & now)
+{
+  while (!expiry_queue_.empty() && expiry_queue_.top().first + status_list_timeout_ < now) {
+    ExpiryEntry entry = expiry_queue_.top();
+    expiry_queue_.pop();
+
+    StatusIterator it = findStatus(entry.second);
+    // the goal may have been picked up again (time reset) or bumped to a later time since
+    if (it != status_list_.end() && (*it).handle_destruction_time_ == entry.first) {
+      status_index_.erase(entry.second);
+      status_list_.erase(it);
+    }
+  }
+}
+
 template<class ActionSpec>
 void ActionServerBase<ActionSpec>::goalCallback(const boost::shared_ptr<const ActionGoal> & goal)
 {
@@ -213,30 +339,26 @@ void ActionServerBase<ActionSpec>::goalCallback(const boost::shared_ptr<const Ac
   ROS_DEBUG_NAMED("actionlib", "The action server has received a new goal request");
 
   // we need to check if this goal already lives in the status list
-  for (typename std::list<StatusTracker<ActionSpec> >::iterator it = status_list_.begin();
-    it != status_list_.end(); ++it)
-  {
-    if (goal->goal_id.id == (*it).status_.goal_id.id) {
-      // The goal could already be in a recalling state if a cancel came in before the goal
-      if ( (*it).status_.status == actionlib_msgs::GoalStatus::RECALLING) {
-        (*it).status_.status = actionlib_msgs::GoalStatus::RECALLED;
-        publishResult((*it).status_, Result());
-      }
-
-      // if this is a request for a goal that has no active handles left,
-      // we'll bump how long it stays in the list
-      if ((*it).handle_tracker_.expired()) {
-        (*it).handle_destruction_time_ = goal->goal_id.stamp;
-      }
+  StatusIterator existing = findStatus(goal->goal_id.id);
+  if (existing != status_list_.end()) {
+    // The goal could already be in a recalling state if a cancel came in before the goal
+    if ( (*existing).status_.status == actionlib_msgs::GoalStatus::RECALLING) {
+      setStatus(existing, actionlib_msgs::GoalStatus::RECALLED);
+      publishResult((*existing).status_, Result());
+    }
 
-      // make sure not to call any user callbacks or add duplicate status onto the list
-      return;
+    // if this is a request for a goal that has no active handles left,
+    // we'll bump how long it stays in the list
+    if ((*existing).handle_tracker_.expired()) {
+      setDestructionTime(existing, goal->goal_id.stamp);
     }
+
+    // make sure not to call any user callbacks or add duplicate status onto the list
+    return;
   }
 
   // if the goal is not in our list, we need to create a StatusTracker associated with this goal and push it on
-  typename std::list<StatusTracker<ActionSpec> >::iterator it = status_list_.insert(
-    status_list_.end(), StatusTracker<ActionSpec>(goal));
+  StatusIterator it = addStatus(StatusTracker<ActionSpec>(goal));
 
   // we need to create a handle tracker for the incoming goal and update the StatusTracker
   HandleTrackerDeleter<ActionSpec> d(this, it, guard_);
@@ -275,9 +397,13 @@ void ActionServerBase<ActionSpec>::cancelCallback(
   // we need to handle a cancel for the user
   ROS_DEBUG_NAMED("actionlib", "The action server has received a new cancel request");
   bool goal_id_found = false;
-  for (typename std::list<StatusTracker<ActionSpec> >::iterator it = status_list_.begin();
-    it != status_list_.end(); ++it)
-  {
+
+  // a cancel for a single id without a stamp only ever touches that goal, so look it up
+  // directly; cancelling everything or everything before a stamp still needs the full list
+  bool single_goal = goal_id->id != "" && goal_id->stamp == ros::Time();
+  StatusIterator begin = single_goal ? findStatus(goal_id->id) : status_list_.begin();
+
+  for (StatusIterator it = begin; it != status_list_.end(); ++it) {
     // check if the goal id is zero or if it is equal to the goal id of
     // the iterator or if the time of the iterator warrants a cancel
     if (
@@ -301,7 +427,7 @@ void ActionServerBase<ActionSpec>::cancelCallback(
         (*it).handle_tracker_ = handle_tracker;
 
         // we also need to reset the time that the status is supposed to be removed from the list
-        (*it).handle_destruction_time_ = ros::Time();
+        setDestructionTime(it, ros::Time());
       }
 
       // set the status of the goal to PREEMPTING or RECALLING as appropriate
@@ -315,15 +441,18 @@ void ActionServerBase<ActionSpec>::cancelCallback(
         cancel_callback_(gh);
       }
     }
+
+    if (single_goal) {
+      break;
+    }
   }
 
   // if the requested goal_id was not found, and it is non-zero, then we need to store the cancel request
   if (goal_id->id != "" && !goal_id_found) {
-    typename std::list<StatusTracker<ActionSpec> >::iterator it = status_list_.insert(
-      status_list_.end(),
+    StatusIterator it = addStatus(
       StatusTracker<ActionSpec>(*goal_id, actionlib_msgs::GoalStatus::RECALLING));
     // start the timer for how long the status will live in the list without a goal handle to it
-    (*it).handle_destruction_time_ = goal_id->stamp;
+    setDestructionTime(it, goal_id->stamp);
   }
 
   // make sure to set last_cancel_ based on the stamp associated with this cancel request
@@ -50,7 +50,8 @@ ActionServer<ActionSpec>::ActionServer(
   bool auto_start)
 : ActionServerBase<ActionSpec>(
     boost::function<void(GoalHandle)>(), boost::function<void(GoalHandle)>(), auto_start),
-  node_(n, name)
+  node_(n, name),
+  status_delta_(false)
 {
   // if we're to autostart... then we'll initialize things
   if (this->started_) {
@@ -64,7 +65,8 @@ template<class ActionSpec>
 ActionServer<ActionSpec>::ActionServer(ros::NodeHandle n, std::string name)
 : ActionServerBase<ActionSpec>(
     boost::function<void(GoalHandle)>(), boost::function<void(GoalHandle)>(), true),
-  node_(n, name)
+  node_(n, name),
+  status_delta_(false)
 {
   // if we're to autostart... then we'll initialize things
   if (this->started_) {
@@ -82,7 +84,8 @@ ActionServer<ActionSpec>::ActionServer(ros::NodeHandle n, std::string name,
   boost::function<void(GoalHandle)> cancel_cb,
   bool auto_start)
 : ActionServerBase<ActionSpec>(goal_cb, cancel_cb, auto_start),
-  node_(n, name)
+  node_(n, name),
+  status_delta_(false)
 {
   // if we're to autostart... then we'll initialize things
   if (this->started_) {
@@ -99,7 +102,8 @@ ActionServer<ActionSpec>::ActionServer(ros::NodeHandle n, std::string name,
   boost::function<void(GoalHandle)> goal_cb,
   boost::function<void(GoalHandle)> cancel_cb)
 : ActionServerBase<ActionSpec>(goal_cb, cancel_cb, true),
-  node_(n, name)
+  node_(n, name),
+  status_delta_(false)
 {
   // if we're to autostart... then we'll initialize things
   if (this->started_) {
@@ -116,7 +120,8 @@ ActionServer<ActionSpec>::ActionServer(ros::NodeHandle n, std::string name,
   boost::function<void(GoalHandle)> goal_cb,
   bool auto_start)
 : ActionServerBase<ActionSpec>(goal_cb, boost::function<void(GoalHandle)>(), auto_start),
-  node_(n, name)
+  node_(n, name),
+  status_delta_(false)
 {
   // if we're to autostart... then we'll initialize things
   if (this->started_) {
@@ -170,6 +175,18 @@ void ActionServer<ActionSpec>::initialize()
 
   this->status_list_timeout_ = ros::Duration(status_list_timeout);
 
+  // with many goals alive at once the full status list gets large, so optionally only
+  // send it every status_full_period and publish what changed on status_delta
+  double status_full_period;
+  node_.param("status_delta", status_delta_, false);
+  node_.param("status_full_period", status_full_period, 5.0);
+  status_full_period_ = ros::Duration(status_full_period);
+  if (status_delta_) {
+    status_delta_pub_ =
+      node_.advertise<actionlib_msgs::GoalStatusArray>("status_delta",
+        static_cast<uint32_t>(pub_queue_size));
+  }
+
   if (status_frequency > 0) {
     status_timer_ = node_.createTimer(ros::Duration(1.0 / status_frequency),
         boost::bind(&ActionServer::publishStatus, this, _1));
@@ -228,34 +245,75 @@ void ActionServer<ActionSpec>::publishStatus(const ros::TimerEvent &)
 
 template<class ActionSpec>
 void ActionServer<ActionSpec>::publishStatus()
+{
+  boost::recursive_mutex::scoped_lock lock(this->lock_);
+  if (!status_delta_) {
+    publishFullStatus();
+    return;
+  }
+
+  publishStatusDelta();
+
+  // stock clients only follow the status topic, so while any are connected it is kept
+  // as current as without deltas; otherwise it only goes out every status_full_period_
+  if (status_pub_.getNumSubscribers() > 0 || last_full_status_ == ros::Time() ||
+    ros::Time::now() >= last_full_status_ + status_full_period_)
+  {
+    publishFullStatus();
+  }
+}
+
+template<class ActionSpec>
+void ActionServer<ActionSpec>::publishFullStatus()
 {
   boost::recursive_mutex::scoped_lock lock(this->lock_);
   // build a status array
   actionlib_msgs::GoalStatusArray status_array;
 
-  status_array.header.stamp = ros::Time::now();
+  ros::Time now = ros::Time::now();
+  status_array.header.stamp = now;
 
   status_array.status_list.resize(this->status_list_.size());
 
   unsigned int i = 0;
   for (typename std::list<StatusTracker<ActionSpec> >::iterator it = this->status_list_.begin();
-    it != this->status_list_.end(); )
+    it != this->status_list_.end(); ++it)
   {
     status_array.status_list[i] = (*it).status_;
-
-    // check if the item is due for deletion from the status list
-    if ((*it).handle_destruction_time_ != ros::Time() &&
-      (*it).handle_destruction_time_ + this->status_list_timeout_ < ros::Time::now())
-    {
-      it = this->status_list_.erase(it);
-    } else {
-      ++it;
-    }
     ++i;
   }
 
+  // every change goes out with the full list, so none are left for the next delta
+  std::vector<typename ActionServerBase<ActionSpec>::StatusIterator> changed;
+  this->takeChangedStatus(changed);
+
+  // goals due for deletion go out one last time above before being dropped
+  this->removeExpiredStatus(now);
+  last_full_status_ = now;
+
   status_pub_.publish(status_array);
 }
 
+template<class ActionSpec>
+void ActionServer<ActionSpec>::publishStatusDelta()
+{
+  boost::recursive_mutex::scoped_lock lock(this->lock_);
+  std::vector<typename ActionServerBase<ActionSpec>::StatusIterator> changed;
+  this->takeChangedStatus(changed);
+
+  ros::Time now = ros::Time::now();
+  if (!changed.empty()) {
+    actionlib_msgs::GoalStatusArray status_array;
+    status_array.header.stamp = now;
+    status_array.status_list.reserve(changed.size());
+    for (size_t i = 0; i < changed.size(); ++i) {
+      status_array.status_list.push_back((*changed[i]).status_);
+    }
+    status_delta_pub_.publish(status_array);
+  }
+
+  this->removeExpiredStatus(now);
+}
+
 }  // namespace actionlib
 #endif  // ACTIONLIB__SERVER__ACTION_SERVER_IMP_H_
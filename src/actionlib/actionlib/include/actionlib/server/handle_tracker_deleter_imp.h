@@ -56,7 +56,7 @@ void HandleTrackerDeleter<ActionSpec>::operator()(void *)
     if (protector.isProtected()) {
       // make sure to lock while we erase status for this goal from the list
       boost::recursive_mutex::scoped_lock lock(as_->lock_);
-      (*status_it_).handle_destruction_time_ = ros::Time::now();
+      as_->setDestructionTime(status_it_, ros::Time::now());
       // as_->status_list_.erase(status_it_);
     }
   }
@@ -78,12 +78,12 @@ void ServerGoalHandle<ActionSpec>::setAccepted(const std::string & text)
 
     // if we were pending before, then we'll go active
     if (status == actionlib_msgs::GoalStatus::PENDING) {
-      (*status_it_).status_.status = actionlib_msgs::GoalStatus::ACTIVE;
+      as_->setStatus(status_it_, actionlib_msgs::GoalStatus::ACTIVE);
       (*status_it_).status_.text = text;
       as_->publishStatus();
     } else if (status == actionlib_msgs::GoalStatus::RECALLING) {
       // if we were recalling before, now we'll go to preempting
-      (*status_it_).status_.status = actionlib_msgs::GoalStatus::PREEMPTING;
+      as_->setStatus(status_it_, actionlib_msgs::GoalStatus::PREEMPTING);
       (*status_it_).status_.text = text;
       as_->publishStatus();
     } else {
@@ -121,12 +121,12 @@ void ServerGoalHandle<ActionSpec>::setCanceled(const Result & result, const std:
     if (status == actionlib_msgs::GoalStatus::PENDING ||
       status == actionlib_msgs::GoalStatus::RECALLING)
     {
-      (*status_it_).status_.status = actionlib_msgs::GoalStatus::RECALLED;
+      as_->setStatus(status_it_, actionlib_msgs::GoalStatus::RECALLED);
       (*status_it_).status_.text = text;
       as_->publishResult((*status_it_).status_, result);
     } else if (status == actionlib_msgs::GoalStatus::ACTIVE ||
       status == actionlib_msgs::GoalStatus::PREEMPTING) {
-      (*status_it_).status_.status = actionlib_msgs::GoalStatus::PREEMPTED;
+      as_->setStatus(status_it_, actionlib_msgs::GoalStatus::PREEMPTED);
       (*status_it_).status_.text = text;
       as_->publishResult((*status_it_).status_, result);
     } else {
@@ -164,7 +164,7 @@ void ServerGoalHandle<ActionSpec>::setRejected(const Result & result, const std:
     if (status == actionlib_msgs::GoalStatus::PENDING ||
       status == actionlib_msgs::GoalStatus::RECALLING)
     {
-      (*status_it_).status_.status = actionlib_msgs::GoalStatus::REJECTED;
+      as_->setStatus(status_it_, actionlib_msgs::GoalStatus::REJECTED);
       (*status_it_).status_.text = text;
       as_->publishResult((*status_it_).status_, result);
     } else {
@@ -202,7 +202,7 @@ void ServerGoalHandle<ActionSpec>::setAborted(const Result & result, const std::
     if (status == actionlib_msgs::GoalStatus::PREEMPTING ||
       status == actionlib_msgs::GoalStatus::ACTIVE)
     {
-      (*status_it_).status_.status = actionlib_msgs::GoalStatus::ABORTED;
+      as_->setStatus(status_it_, actionlib_msgs::GoalStatus::ABORTED);
       (*status_it_).status_.text = text;
       as_->publishResult((*status_it_).status_, result);
     } else {
@@ -240,7 +240,7 @@ void ServerGoalHandle<ActionSpec>::setSucceeded(const Result & result, const std
     if (status == actionlib_msgs::GoalStatus::PREEMPTING ||
       status == actionlib_msgs::GoalStatus::ACTIVE)
     {
-      (*status_it_).status_.status = actionlib_msgs::GoalStatus::SUCCEEDED;
+      as_->setStatus(status_it_, actionlib_msgs::GoalStatus::SUCCEEDED);
       (*status_it_).status_.text = text;
       as_->publishResult((*status_it_).status_, result);
     } else {
@@ -401,13 +401,13 @@ bool ServerGoalHandle<ActionSpec>::setCancelRequested()
     boost::recursive_mutex::scoped_lock lock(as_->lock_);
     unsigned int status = (*status_it_).status_.status;
     if (status == actionlib_msgs::GoalStatus::PENDING) {
-      (*status_it_).status_.status = actionlib_msgs::GoalStatus::RECALLING;
+      as_->setStatus(status_it_, actionlib_msgs::GoalStatus::RECALLING);
       as_->publishStatus();
       return true;
     }
 
     if (status == actionlib_msgs::GoalStatus::ACTIVE) {
-      (*status_it_).status_.status = actionlib_msgs::GoalStatus::PREEMPTING;
+      as_->setStatus(status_it_, actionlib_msgs::GoalStatus::PREEMPTING);
       as_->publishStatus();
       return true;
     }
@@ -68,6 +68,9 @@ public:
   actionlib_msgs::GoalStatus status_;
   ros::Time handle_destruction_time_;
 
+  // whether the goal is queued in the server's list of changed statuses, used for delta status updates
+  bool status_changed_;
+
 private:
   GoalIDGenerator id_generator_;
 };
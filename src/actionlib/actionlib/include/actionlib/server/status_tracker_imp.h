@@ -41,6 +41,7 @@ namespace actionlib
 template<class ActionSpec>
 StatusTracker<ActionSpec>::StatusTracker(const actionlib_msgs::GoalID & goal_id,
   unsigned int status)
+: status_changed_(false)
 {
   // set the goal id and status appropriately
   status_.goal_id = goal_id;
@@ -49,7 +50,7 @@ StatusTracker<ActionSpec>::StatusTracker(const actionlib_msgs::GoalID & goal_id,
 
 template<class ActionSpec>
 StatusTracker<ActionSpec>::StatusTracker(const boost::shared_ptr<const ActionGoal> & goal)
-: goal_(goal)
+: goal_(goal), status_changed_(false)
 {
   // set the goal_id from the message
   status_.goal_id = goal_->goal_id;
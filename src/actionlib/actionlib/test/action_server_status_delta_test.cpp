@@ -0,0 +1,301 @@
+/*********************************************************************
+* Software License Agreement (BSD License)
+*
+*  Copyright (c) 2008, Willow Garage, Inc.
+*  All rights reserved.
+*
+*  Redistribution and use in source and binary forms, with or without
+*  modification, are permitted provided that the following conditions
+*  are met:
+*
+*   * Redistributions of source code must retain the above copyright
+*     notice, this list of conditions and the following disclaimer.
+*   * Redistributions in binary form must reproduce the above
+*     copyright notice, this list of conditions and the following
+*     disclaimer in the documentation and/or other materials provided
+*     with the distribution.
+*   * Neither the name of the Willow Garage nor the names of its
+*     contributors may be used to endorse or promote products derived
+*     from this software without specific prior written permission.
+*
+*  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+*  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+*  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+*  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+*  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+*  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+*  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+*  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+*  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+*  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+*  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+*  POSSIBILITY OF SUCH DAMAGE.
+*********************************************************************/
+
+// Checks the status_delta topic of an ActionServer, and that the status topic
+// stays as current as without deltas while stock clients are connected.
+
+#include <actionlib/server/action_server.h>
+#include <actionlib/client/simple_action_client.h>
+#include <actionlib/TestAction.h>
+#include <ros/ros.h>
+#include <gtest/gtest.h>
+
+#include <map>
+#include <string>
+#include <vector>
+
+using namespace actionlib;
+
+typedef ActionServer<TestAction> Server;
+typedef std::map<std::string, uint8_t> StatusMap;
+
+namespace
+{
+
+// Records the messages of a status topic
+class StatusRecorder
+{
+public:
+  StatusRecorder(ros::NodeHandle & n, const std::string & topic)
+  {
+    sub_ = n.subscribe(topic, 100, &StatusRecorder::callback, this);
+  }
+
+  void callback(const actionlib_msgs::GoalStatusArrayConstPtr & msg)
+  {
+    boost::mutex::scoped_lock lock(mutex_);
+    msgs_.push_back(*msg);
+  }
+
+  std::vector<actionlib_msgs::GoalStatusArray> msgs()
+  {
+    boost::mutex::scoped_lock lock(mutex_);
+    return msgs_;
+  }
+
+  // The status of a goal in the latest message mentioning it, or 255 if there is none
+  uint8_t latest(const std::string & id)
+  {
+    boost::mutex::scoped_lock lock(mutex_);
+    for (size_t i = msgs_.size(); i > 0; --i) {
+      for (size_t j = 0; j < msgs_[i - 1].status_list.size(); ++j) {
+        if (msgs_[i - 1].status_list[j].goal_id.id == id) {
+          return msgs_[i - 1].status_list[j].status;
+        }
+      }
+    }
+    return 255;
+  }
+
+  ros::Subscriber sub_;
+
+private:
+  boost::mutex mutex_;
+  std::vector<actionlib_msgs::GoalStatusArray> msgs_;
+};
+
+// Accepts every goal and keeps its handle, so the test decides when goals finish
+class GoalKeeper
+{
+public:
+  void goalCallback(Server::GoalHandle gh)
+  {
+    gh.setAccepted();
+    boost::mutex::scoped_lock lock(mutex_);
+    handles_[gh.getGoalID().id] = gh;
+  }
+
+  void succeed(const std::string & id)
+  {
+    Server::GoalHandle gh;
+    {
+      boost::mutex::scoped_lock lock(mutex_);
+      gh = handles_[id];
+    }
+    gh.setSucceeded();
+  }
+
+private:
+  boost::mutex mutex_;
+  std::map<std::string, Server::GoalHandle> handles_;
+};
+
+bool waitFor(boost::function<bool()> condition, double timeout = 5.0)
+{
+  ros::WallTime end = ros::WallTime::now() + ros::WallDuration(timeout);
+  while (!condition()) {
+    if (ros::WallTime::now() > end) {
+      return false;
+    }
+    ros::WallDuration(0.01).sleep();
+  }
+  return true;
+}
+
+bool hasStatus(StatusRecorder * recorder, const std::string & id, uint8_t status)
+{
+  return recorder->latest(id) == status;
+}
+
+bool hasMessages(StatusRecorder * recorder)
+{
+  return !recorder->msgs().empty();
+}
+
+bool hasSubscribers(ros::Publisher * pub)
+{
+  return pub->getNumSubscribers() > 0;
+}
+
+bool hasPublishers(ros::Subscriber * sub)
+{
+  return sub->getNumPublishers() > 0;
+}
+
+void sendGoal(ros::Publisher & goal_pub, const std::string & id)
+{
+  TestActionGoal goal;
+  goal.goal_id.id = id;
+  goal.goal_id.stamp = ros::Time::now();
+  goal_pub.publish(goal);
+}
+
+void setDeltaParams(const std::string & name, double status_full_period)
+{
+  ros::param::set(name + "/status_delta", true);
+  ros::param::set(name + "/status_full_period", status_full_period);
+}
+
+// Applies status arrays in order to a map of goal id to status
+void apply(StatusMap & statuses, const actionlib_msgs::GoalStatusArray & msg)
+{
+  for (size_t i = 0; i < msg.status_list.size(); ++i) {
+    statuses[msg.status_list[i].goal_id.id] = msg.status_list[i].status;
+  }
+}
+
+}  // namespace
+
+TEST(ActionServerStatusDelta, deltaCarriesOnlyChanges) {
+  ros::NodeHandle n;
+  setDeltaParams("delta_only", 100.0);
+  GoalKeeper keeper;
+  Server server(n, "delta_only", boost::bind(&GoalKeeper::goalCallback, &keeper, _1), false);
+  server.start();
+
+  StatusRecorder delta(n, "delta_only/status_delta");
+  ros::Publisher goal_pub = n.advertise<TestActionGoal>("delta_only/goal", 10);
+  ASSERT_TRUE(waitFor(boost::bind(hasSubscribers, &goal_pub)));
+  ASSERT_TRUE(waitFor(boost::bind(hasPublishers, &delta.sub_)));
+
+  sendGoal(goal_pub, "a");
+  ASSERT_TRUE(waitFor(boost::bind(hasStatus, &delta, "a", actionlib_msgs::GoalStatus::ACTIVE)));
+  sendGoal(goal_pub, "b");
+  ASSERT_TRUE(waitFor(boost::bind(hasStatus, &delta, "b", actionlib_msgs::GoalStatus::ACTIVE)));
+  keeper.succeed("a");
+  ASSERT_TRUE(waitFor(boost::bind(hasStatus, &delta, "a", actionlib_msgs::GoalStatus::SUCCEEDED)));
+
+  // several status timer periods without a change publish nothing
+  size_t published = delta.msgs().size();
+  ros::WallDuration(0.5).sleep();
+  std::vector<actionlib_msgs::GoalStatusArray> msgs = delta.msgs();
+  EXPECT_EQ(published, msgs.size());
+
+  // every delta holds just the goals that changed, each once
+  for (size_t i = 0; i < msgs.size(); ++i) {
+    ASSERT_EQ(1u, msgs[i].status_list.size());
+  }
+  EXPECT_EQ("a", msgs.front().status_list[0].goal_id.id);
+  EXPECT_EQ("a", msgs.back().status_list[0].goal_id.id);
+  EXPECT_EQ(actionlib_msgs::GoalStatus::ACTIVE, delta.latest("b"));
+}
+
+TEST(ActionServerStatusDelta, fullStatusInterleaving) {
+  ros::NodeHandle n;
+  setDeltaParams("interleaved", 100.0);
+  GoalKeeper keeper;
+  Server server(n, "interleaved", boost::bind(&GoalKeeper::goalCallback, &keeper, _1), false);
+  server.start();
+
+  StatusRecorder delta(n, "interleaved/status_delta");
+  StatusRecorder full(n, "interleaved/status");
+  ros::Publisher goal_pub = n.advertise<TestActionGoal>("interleaved/goal", 10);
+  ASSERT_TRUE(waitFor(boost::bind(hasSubscribers, &goal_pub)));
+  ASSERT_TRUE(waitFor(boost::bind(hasPublishers, &delta.sub_)));
+  // the status topic is latched, so its first message is the one from start()
+  ASSERT_TRUE(waitFor(boost::bind(hasMessages, &full)));
+
+  // with a subscriber on status, it follows every change despite the long status_full_period
+  sendGoal(goal_pub, "a");
+  ASSERT_TRUE(waitFor(boost::bind(hasStatus, &full, "a", actionlib_msgs::GoalStatus::ACTIVE)));
+  sendGoal(goal_pub, "b");
+  keeper.succeed("a");
+  ASSERT_TRUE(waitFor(boost::bind(hasStatus, &full, "a", actionlib_msgs::GoalStatus::SUCCEEDED)));
+  ASSERT_TRUE(waitFor(boost::bind(hasStatus, &full, "b", actionlib_msgs::GoalStatus::ACTIVE)));
+  ASSERT_TRUE(waitFor(boost::bind(hasStatus, &delta, "a", actionlib_msgs::GoalStatus::SUCCEEDED)));
+  ASSERT_TRUE(waitFor(boost::bind(hasStatus, &delta, "b", actionlib_msgs::GoalStatus::ACTIVE)));
+
+  // the deltas applied to the first full status give the latest full status
+  std::vector<actionlib_msgs::GoalStatusArray> full_msgs = full.msgs();
+  std::vector<actionlib_msgs::GoalStatusArray> delta_msgs = delta.msgs();
+  StatusMap from_deltas, from_full;
+  apply(from_deltas, full_msgs.front());
+  for (size_t i = 0; i < delta_msgs.size(); ++i) {
+    EXPECT_FALSE(delta_msgs[i].status_list.empty());
+    apply(from_deltas, delta_msgs[i]);
+  }
+  apply(from_full, full_msgs.back());
+  EXPECT_EQ(from_full, from_deltas);
+  EXPECT_EQ(2u, from_full.size());
+}
+
+TEST(ActionServerStatusDelta, periodicFullStatus) {
+  ros::NodeHandle n;
+  setDeltaParams("periodic", 0.5);
+  GoalKeeper keeper;
+  Server server(n, "periodic", boost::bind(&GoalKeeper::goalCallback, &keeper, _1), false);
+  server.start();
+
+  StatusRecorder delta(n, "periodic/status_delta");
+  ros::Publisher goal_pub = n.advertise<TestActionGoal>("periodic/goal", 10);
+  ASSERT_TRUE(waitFor(boost::bind(hasSubscribers, &goal_pub)));
+  sendGoal(goal_pub, "a");
+  ASSERT_TRUE(waitFor(boost::bind(hasStatus, &delta, "a", actionlib_msgs::GoalStatus::ACTIVE)));
+
+  // without subscribers the full status still goes out every status_full_period,
+  // which a late subscriber gets from the latched status topic
+  ros::WallDuration(1.0).sleep();
+  StatusRecorder full(n, "periodic/status");
+  ASSERT_TRUE(waitFor(boost::bind(hasStatus, &full, "a", actionlib_msgs::GoalStatus::ACTIVE)));
+}
+
+TEST(ActionServerStatusDelta, stockClient) {
+  ros::NodeHandle n;
+  setDeltaParams("stock", 100.0);
+  GoalKeeper keeper;
+  Server server(n, "stock", boost::bind(&GoalKeeper::goalCallback, &keeper, _1), false);
+  server.start();
+
+  SimpleActionClient<TestAction> client("stock", false);
+  ASSERT_TRUE(client.waitForServer(ros::Duration(5.0)));
+
+  // the client only follows the status topic, so it must not wait for status_full_period
+  client.sendGoal(TestGoal());
+  ros::WallTime end = ros::WallTime::now() + ros::WallDuration(5.0);
+  while (client.getState() != SimpleClientGoalState::ACTIVE && ros::WallTime::now() < end) {
+    ros::WallDuration(0.01).sleep();
+  }
+  EXPECT_EQ(SimpleClientGoalState::ACTIVE, client.getState().state_);
+}
+
+int main(int argc, char ** argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+
+  ros::init(argc, argv, "action_server_status_delta_test");
+  ros::AsyncSpinner spinner(1);
+  spinner.start();
+
+  return RUN_ALL_TESTS();
+}
@@ -192,9 +192,7 @@ public:
   template<class Base>
   bool isClassAvailable(const std::string & class_name)
   {
-    std::vector<std::string> available_classes = getAvailableClasses<Base>();
-    return std::find(
-      available_classes.begin(), available_classes.end(), class_name) != available_classes.end();
+    return class_loader::impl::isClassAvailable<Base>(class_name, this);
   }
 
   /**
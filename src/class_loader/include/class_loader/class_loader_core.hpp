@@ -316,6 +316,23 @@ std::vector<std::string> getAvailableClasses(ClassLoader * loader)
   return classes;
 }
 
+/**
+ * @brief Indicates if a plugin class derived from Base is available within scope of the passed ClassLoader, without listing all available classes as getAvailableClasses() does.
+ * @param class_name - The name of the derived class (unmangled)
+ * @param loader - The pointer to the ClassLoader whose scope we are within
+ * @return true if class_name is one of the classes getAvailableClasses() would return, else false
+ */
+template<typename Base>
+bool isClassAvailable(const std::string & class_name, ClassLoader * loader)
+{
+  boost::recursive_mutex::scoped_lock lock(getPluginBaseToFactoryMapMapMutex());
+
+  FactoryMap & factory_map = getFactoryMapForBaseClass<Base>();
+  FactoryMap::const_iterator it = factory_map.find(class_name);
+  return it != factory_map.end() &&
+         (it->second->isOwnedBy(loader) || it->second->isOwnedBy(nullptr));
+}
+
 /**
  * @brief This function returns the names of all libraries in use by a given class loader.
  * @param loader - The ClassLoader whose scope we are within
@@ -341,6 +358,14 @@ bool isLibraryLoaded(const std::string & library_path, ClassLoader * loader);
 CLASS_LOADER_PUBLIC
 bool isLibraryLoadedByAnybody(const std::string & library_path);
 
+/**
+ * @brief Gets how long it took to load a library, including the registration of its factories by its static initializers. Libraries which were already in memory when loadLibrary() was called are not timed again.
+ * @param library_path - The name of the library
+ * @return The duration of the last load of the library in seconds, or a negative value if class_loader never loaded it
+ */
+CLASS_LOADER_PUBLIC
+double getLibraryLoadDuration(const std::string & library_path);
+
 /**
  * @brief Loads a library into memory if it has not already been done so. Attempting to load an already loaded library has no effect.
  * @param library_path - The name of the library to open
@@ -48,6 +48,7 @@ namespace class_loader
 typedef std::string LibraryPath;
 typedef std::map<LibraryPath, class_loader::ClassLoader *> LibraryToClassLoaderMap;
 typedef std::vector<ClassLoader *> ClassLoaderVector;
+typedef std::map<std::string, LibraryPath> ClassToLibraryMap;
 
 /**
 * @class MultiLibraryClassLoader
@@ -244,9 +245,16 @@ public:
   template<class Base>
   bool isClassAvailable(const std::string & class_name)
   {
-    std::vector<std::string> available_classes = getAvailableClasses<Base>();
-    return available_classes.end() != std::find(
-      available_classes.begin(), available_classes.end(), class_name);
+    ClassLoader * declared_loader = getClassLoaderForDeclaredClass(class_name, false);
+    if (nullptr != declared_loader && declared_loader->isClassAvailable<Base>(class_name)) {
+      return true;
+    }
+    for (auto & loader : getAllAvailableClassLoaders()) {
+      if (loader->isClassAvailable<Base>(class_name)) {
+        return true;
+      }
+    }
+    return false;
   }
 
   /**
@@ -303,6 +311,17 @@ public:
    */
   void loadLibrary(const std::string & library_path);
 
+  /**
+   * @brief Declares the library providing a class, e.g. as listed in a plugin manifest
+   * Instances of the class are then created from that library without searching the other ones,
+   * and in on-demand mode the library is only loaded when the first instance is created.
+   * Classes found by searching are declared automatically, and declarations are dropped when
+   * their library is unloaded through unloadLibrary().
+   * @param class_name - the name of the concrete plugin class
+   * @param library_path - the fully qualified path to the runtime library providing the class
+   */
+  void declareClass(const std::string & class_name, const std::string & library_path);
+
   /**
    * @brief Unloads a library for this class loader
    * @param library_path - the fully qualified path to the runtime library
@@ -330,18 +349,37 @@ private:
   template<typename Base>
   ClassLoader * getClassLoaderForClass(const std::string & class_name)
   {
+    ClassLoader * declared_loader = getClassLoaderForDeclaredClass(class_name, true);
+    if (nullptr != declared_loader) {
+      if (!declared_loader->isLibraryLoaded()) {
+        declared_loader->loadLibrary();
+      }
+      if (declared_loader->isClassAvailable<Base>(class_name)) {
+        return declared_loader;
+      }
+    }
+
     ClassLoaderVector loaders = getAllAvailableClassLoaders();
     for (ClassLoaderVector::iterator i = loaders.begin(); i != loaders.end(); ++i) {
       if (!(*i)->isLibraryLoaded()) {
         (*i)->loadLibrary();
       }
       if ((*i)->isClassAvailable<Base>(class_name)) {
+        declareClass(class_name, (*i)->getLibraryPath());
         return *i;
       }
     }
     return nullptr;
   }
 
+  /**
+   * @brief Gets a handle to the class loader bound to the library declared for a class
+   * @param class_name - name of class for which we want to create instance
+   * @param create - create the class loader if the declared library was not loaded yet
+   * @return A pointer to the ClassLoader*, == nullptr if no library was declared for the class
+   */
+  ClassLoader * getClassLoaderForDeclaredClass(const std::string & class_name, bool create);
+
   /**
    * @brief Gets all class loaders loaded within scope
    */
@@ -355,6 +393,7 @@ private:
 private:
   bool enable_ondemand_loadunload_;
   LibraryToClassLoaderMap active_class_loaders_;
+  ClassToLibraryMap declared_classes_;
   boost::mutex loader_mutex_;
 };
 
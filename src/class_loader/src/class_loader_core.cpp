@@ -33,7 +33,9 @@
 #include <Poco/SharedLibrary.h>
 
 #include <cassert>
+#include <chrono>
 #include <cstddef>
+#include <map>
 #include <string>
 #include <vector>
 
@@ -86,6 +88,12 @@ LibraryVector & getLoadedLibraryVector()
   return instance;
 }
 
+std::map<LibraryPath, double> & getLibraryLoadDurationMap()
+{
+  static std::map<LibraryPath, double> instance;
+  return instance;
+}
+
 std::string & getCurrentlyLoadingLibraryNameReference()
 {
   static std::string library_name;
@@ -445,6 +453,7 @@ void loadLibrary(const std::string & library_path, ClassLoader * loader)
   }
 
   Poco::SharedLibrary * library_handle = nullptr;
+  std::chrono::steady_clock::time_point load_start = std::chrono::steady_clock::now();
 
   {
     try {
@@ -498,11 +507,27 @@ void loadLibrary(const std::string & library_path, ClassLoader * loader)
     purgeGraveyardOfMetaobjects(library_path, loader, true);
   }
 
+  double load_duration = std::chrono::duration<double>(
+    std::chrono::steady_clock::now() - load_start).count();
+  CONSOLE_BRIDGE_logDebug(
+    "class_loader.impl: "
+    "Loading library %s and registering its factory metaobjects took %.3f ms.",
+    library_path.c_str(), load_duration * 1000.0);
+
   // Insert library into global loaded library vector
   boost::recursive_mutex::scoped_lock llv_lock(getLoadedLibraryVectorMutex());
   LibraryVector & open_libraries = getLoadedLibraryVector();
   // Note: Poco::SharedLibrary automatically calls load() when library passed to constructor
   open_libraries.push_back(LibraryPair(library_path, library_handle));
+  getLibraryLoadDurationMap()[library_path] = load_duration;
+}
+
+double getLibraryLoadDuration(const std::string & library_path)
+{
+  boost::recursive_mutex::scoped_lock lock(getLoadedLibraryVectorMutex());
+  std::map<LibraryPath, double> & durations = getLibraryLoadDurationMap();
+  std::map<LibraryPath, double>::const_iterator itr = durations.find(library_path);
+  return itr != durations.end() ? itr->second : -1.0;
 }
 
 void unloadLibrary(const std::string & library_path, ClassLoader * loader)
@@ -576,8 +601,9 @@ void printDebugInfoToScreen()
   LibraryVector libs = getLoadedLibraryVector();
   for (size_t c = 0; c < libs.size(); c++) {
     printf(
-      "Open library %zu = %s (Poco SharedLibrary handle = %p)\n",
-      c, (libs.at(c)).first.c_str(), reinterpret_cast<void *>((libs.at(c)).second));
+      "Open library %zu = %s (Poco SharedLibrary handle = %p, loaded in %.3f ms)\n",
+      c, (libs.at(c)).first.c_str(), reinterpret_cast<void *>((libs.at(c)).second),
+      getLibraryLoadDuration((libs.at(c)).first) * 1000.0);
   }
 
   printf("METAOBJECTS (i.e. FACTORIES) IN MEMORY:\n");
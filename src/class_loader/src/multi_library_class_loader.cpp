@@ -87,6 +87,25 @@ void MultiLibraryClassLoader::loadLibrary(const std::string & library_path)
   }
 }
 
+void MultiLibraryClassLoader::declareClass(
+  const std::string & class_name, const std::string & library_path)
+{
+  declared_classes_[class_name] = library_path;
+}
+
+ClassLoader * MultiLibraryClassLoader::getClassLoaderForDeclaredClass(
+  const std::string & class_name, bool create)
+{
+  ClassToLibraryMap::iterator itr = declared_classes_.find(class_name);
+  if (itr == declared_classes_.end()) {
+    return nullptr;
+  }
+  if (create) {
+    loadLibrary(itr->second);
+  }
+  return getClassLoaderForLibrary(itr->second);
+}
+
 void MultiLibraryClassLoader::shutdownAllClassLoaders()
 {
   std::vector<std::string> available_libraries = getRegisteredLibraries();
@@ -104,6 +123,15 @@ int MultiLibraryClassLoader::unloadLibrary(const std::string & library_path)
     ClassLoader * loader = itr->second;
     if (0 == (remaining_unloads = loader->unloadLibrary())) {
       delete (loader);
+      for (ClassToLibraryMap::iterator class_itr = declared_classes_.begin();
+        class_itr != declared_classes_.end(); )
+      {
+        if (class_itr->second == library_path) {
+          class_itr = declared_classes_.erase(class_itr);
+        } else {
+          ++class_itr;
+        }
+      }
       active_class_loaders_.erase(itr);
     }
   }
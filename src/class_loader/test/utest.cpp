@@ -318,6 +318,44 @@ TEST(MultiClassLoaderTest, noWarningOnLazyLoad) {
   SUCCEED();
 }
 
+TEST(MultiClassLoaderTest, declaredClassLoadsOnlyItsLibrary) {
+  try {
+    class_loader::MultiLibraryClassLoader loader(true);
+    loader.loadLibrary(LIBRARY_1);
+    loader.declareClass("Robot", LIBRARY_2);
+    ASSERT_FALSE(class_loader::impl::isLibraryLoadedByAnybody(LIBRARY_2));
+
+    boost::shared_ptr<Base> robot = loader.createInstance<Base>("Robot");
+    robot->saySomething();
+    ASSERT_TRUE(class_loader::impl::isLibraryLoadedByAnybody(LIBRARY_2));
+    ASSERT_FALSE(class_loader::impl::isLibraryLoadedByAnybody(LIBRARY_1));
+    ASSERT_TRUE(loader.isClassAvailable<Base>("Robot"));
+    ASSERT_FALSE(loader.isClassAvailable<Base>("Cat"));
+  } catch (class_loader::ClassLoaderException & e) {
+    FAIL() << "ClassLoaderException: " << e.what() << "\n";
+  }
+}
+
+TEST(MultiClassLoaderTest, declaredClassLoadsOnFirstInstance) {
+  try {
+    class_loader::MultiLibraryClassLoader loader(false);
+    loader.declareClass("Cat", LIBRARY_1);
+    ASSERT_TRUE(loader.getRegisteredLibraries().empty());
+
+    loader.createInstance<Base>("Cat")->saySomething();
+    ASSERT_EQ(1u, loader.getRegisteredLibraries().size());
+    ASSERT_TRUE(loader.isClassAvailable<Base>("Cat"));
+    ASSERT_GE(class_loader::impl::getLibraryLoadDuration(LIBRARY_1), 0.0);
+
+    // Unloading the library drops its declarations
+    loader.unloadLibrary(LIBRARY_1);
+    ASSERT_THROW(loader.createInstance<Base>("Cat"), class_loader::CreateClassException);
+  } catch (class_loader::ClassLoaderException & e) {
+    FAIL() << "ClassLoaderException: " << e.what() << "\n";
+  }
+  ASSERT_LT(class_loader::impl::getLibraryLoadDuration("libclass_loader_NotALibrary.so"), 0.0);
+}
+
 // Run all the tests that were declared with TEST()
 int main(int argc, char ** argv)
 {
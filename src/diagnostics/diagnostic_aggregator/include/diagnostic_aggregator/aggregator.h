@@ -46,6 +46,7 @@
 #include <set>
 #include <boost/shared_ptr.hpp>
 #include <boost/thread/mutex.hpp>
+#include <boost/unordered_map.hpp>
 #include <bondcpp/bond.h>
 #include <diagnostic_msgs/DiagnosticArray.h>
 #include <diagnostic_msgs/DiagnosticStatus.h>
@@ -87,6 +88,8 @@ Output:
 base_path: My Robot
 pub_rate: 1.0
 other_as_errors: false
+delta_publish: false
+full_snapshot_interval: 10
 analyzers:
   sensors:
     type: GenericAnalyzer
@@ -101,6 +104,12 @@ analyzers:
  * Any other parameters in the namespace can by used to specify the analyzer. If
  * any analyzer is not properly specified, or returns false on initialization,
  * the aggregator will report the error and publish it in the aggregated output.
+ *
+ * With delta_publish set, the full aggregated array is only published on
+ * /diagnostics_agg every full_snapshot_interval publishes. In between, the
+ * statuses that changed since they were last published go out on
+ * /diagnostics_agg_delta. Nothing is sent on /diagnostics_agg_delta when no
+ * status changed.
  */
 class Aggregator
 { 
@@ -132,10 +141,22 @@ private:
   ros::ServiceServer add_srv_; /**< AddDiagnostics, /diagnostics_agg/add_diagnostics */
   ros::Subscriber diag_sub_; /**< DiagnosticArray, /diagnostics */
   ros::Publisher agg_pub_;  /**< DiagnosticArray, /diagnostics_agg */
+  ros::Publisher delta_pub_;  /**< DiagnosticArray, /diagnostics_agg_delta */
   ros::Publisher toplevel_state_pub_;  /**< DiagnosticStatus, /diagnostics_toplevel_state */
   boost::mutex mutex_;
   double pub_rate_;
 
+  bool delta_publish_; /**< \brief Publish changed statuses between full snapshots. */
+  int full_snapshot_interval_; /**< \brief Number of publishes per full snapshot when delta_publish_ is set. */
+  unsigned int publish_count_;
+  boost::unordered_map<std::string, diagnostic_msgs::DiagnosticStatus> last_published_; /**< \brief Last status sent for each name. */
+
+  /*!
+   *\brief True if current differs from the last published status of the same name
+   */
+  static bool statusChanged(const diagnostic_msgs::DiagnosticStatus &last,
+                            const diagnostic_msgs::DiagnosticStatus &current);
+
   /*!
    *\brief Callback for incoming "/diagnostics"
    */
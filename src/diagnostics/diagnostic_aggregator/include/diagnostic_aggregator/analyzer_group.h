@@ -48,6 +48,7 @@
 #include <diagnostic_msgs/KeyValue.h>
 #include "diagnostic_aggregator/status_item.h"
 #include <boost/shared_ptr.hpp>
+#include <boost/unordered_map.hpp>
 #include "XmlRpcValue.h"
 #include "diagnostic_aggregator/analyzer.h"
 #include "diagnostic_aggregator/status_item.h"
@@ -143,6 +144,9 @@ public:
 
   /*!
    *\brief Analyze returns true if any sub-analyzers will analyze an item
+   *
+   * Items whose name hasn't been matched yet are matched first, so callers
+   * don't need to call match() before every analyze().
    */
   virtual bool analyze(const boost::shared_ptr<StatusItem> item);
 
@@ -171,9 +175,16 @@ private:
   std::vector<boost::shared_ptr<Analyzer> > analyzers_;
 
   /*
-   *\brief The map of names to matchings is stored internally.
+   *\brief Indices into analyzers_ of the analyzers matching each name seen so far.
+   *
+   * Computed once per new name, cleared whenever analyzers are added or removed.
+   */
+  boost::unordered_map<std::string, std::vector<size_t> > matched_;
+
+  /*
+   *\brief Returns the cached matches for a name, matching it against all analyzers if it is new
    */
-  std::map<const std::string, std::vector<bool> > matched_;
+  const std::vector<size_t> &getMatches(const std::string &name);
 
 };
 
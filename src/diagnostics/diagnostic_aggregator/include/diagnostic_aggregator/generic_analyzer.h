@@ -46,6 +46,7 @@
 #include <sstream>
 #include <boost/shared_ptr.hpp>
 #include <boost/regex.hpp>
+#include <boost/unordered_set.hpp>
 #include <pluginlib/class_list_macros.hpp>
 #include "diagnostic_msgs/DiagnosticStatus.h"
 #include "diagnostic_msgs/KeyValue.h"
@@ -236,6 +237,15 @@ private:
   std::vector<std::string> name_;
   std::vector<boost::regex> regex_; /**< Regular expressions to check against diagnostics names. */
 
+  boost::unordered_set<std::string> exact_names_; /**< All of name_ and expected_, for a single lookup. */
+  boost::regex combined_regex_; /**< All of regex_ as one alternation, if it could be built. */
+  bool has_combined_regex_;
+
+  /*!
+   *\brief Builds exact_names_ and combined_regex_ from the configured patterns.
+   */
+  void compilePatterns(const std::vector<std::string> &regex_strs);
+
 };
 
 }
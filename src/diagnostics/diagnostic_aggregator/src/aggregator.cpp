@@ -41,6 +41,9 @@ using namespace diagnostic_aggregator;
 
 Aggregator::Aggregator() :
   pub_rate_(1.0),
+  delta_publish_(false),
+  full_snapshot_interval_(10),
+  publish_count_(0),
   analyzer_group_(NULL),
   other_analyzer_(NULL),
   base_path_("")
@@ -55,6 +58,11 @@ Aggregator::Aggregator() :
   bool other_as_errors = false;
   nh.param("other_as_errors", other_as_errors, false);
 
+  nh.param("delta_publish", delta_publish_, delta_publish_);
+  nh.param("full_snapshot_interval", full_snapshot_interval_, full_snapshot_interval_);
+  if (full_snapshot_interval_ < 1)
+    full_snapshot_interval_ = 1;
+
   analyzer_group_ = new AnalyzerGroup();
 
   if (!analyzer_group_->init(base_path_, nh))
@@ -68,6 +76,8 @@ Aggregator::Aggregator() :
   add_srv_ = n_.advertiseService("/diagnostics_agg/add_diagnostics", &Aggregator::addDiagnostics, this);
   diag_sub_ = n_.subscribe("/diagnostics", 1000, &Aggregator::diagCallback, this);
   agg_pub_ = n_.advertise<diagnostic_msgs::DiagnosticArray>("/diagnostics_agg", 1);
+  if (delta_publish_)
+    delta_pub_ = n_.advertise<diagnostic_msgs::DiagnosticArray>("/diagnostics_agg_delta", 1);
   toplevel_state_pub_ = n_.advertise<diagnostic_msgs::DiagnosticStatus>("/diagnostics_toplevel_state", 1);
 }
 
@@ -92,6 +102,22 @@ void Aggregator::checkTimestamp(const diagnostic_msgs::DiagnosticArray::ConstPtr
   }
 }
 
+bool Aggregator::statusChanged(const diagnostic_msgs::DiagnosticStatus &last,
+                               const diagnostic_msgs::DiagnosticStatus &current)
+{
+  if (last.level != current.level || last.message != current.message ||
+      last.hardware_id != current.hardware_id || last.name != current.name ||
+      last.values.size() != current.values.size())
+    return true;
+
+  for (unsigned int i = 0; i < current.values.size(); ++i)
+  {
+    if (last.values[i].key != current.values[i].key || last.values[i].value != current.values[i].value)
+      return true;
+  }
+  return false;
+}
+
 void Aggregator::diagCallback(const diagnostic_msgs::DiagnosticArray::ConstPtr& diag_msg)
 {
   checkTimestamp(diag_msg);
@@ -102,11 +128,10 @@ void Aggregator::diagCallback(const diagnostic_msgs::DiagnosticArray::ConstPtr&
     boost::mutex::scoped_lock lock(mutex_);
     for (unsigned int j = 0; j < diag_msg->status.size(); ++j)
     {
-      analyzed = false;
       boost::shared_ptr<StatusItem> item(new StatusItem(&diag_msg->status[j]));
 
-      if (analyzer_group_->match(item->getName()))
-	analyzed = analyzer_group_->analyze(item);
+      // The group matches each new name once and routes known names from its cache
+      analyzed = analyzer_group_->analyze(item);
 
       if (!analyzed)
 	other_analyzer_->analyze(item);
@@ -240,7 +265,33 @@ void Aggregator::publishData()
 
   diag_array.header.stamp = ros::Time::now();
 
-  agg_pub_.publish(diag_array);
+  // Between full snapshots, only send the statuses that changed since they were last sent
+  if (delta_publish_ && publish_count_++ % full_snapshot_interval_ != 0)
+  {
+    diagnostic_msgs::DiagnosticArray delta_array;
+    delta_array.header = diag_array.header;
+    for (unsigned int i = 0; i < diag_array.status.size(); ++i)
+    {
+      diagnostic_msgs::DiagnosticStatus &last = last_published_[diag_array.status[i].name];
+      if (statusChanged(last, diag_array.status[i]))
+      {
+        delta_array.status.push_back(diag_array.status[i]);
+        last = diag_array.status[i];
+      }
+    }
+    if (!delta_array.status.empty())
+      delta_pub_.publish(delta_array);
+  }
+  else
+  {
+    if (delta_publish_)
+    {
+      last_published_.clear();
+      for (unsigned int i = 0; i < diag_array.status.size(); ++i)
+        last_published_[diag_array.status[i].name] = diag_array.status[i];
+    }
+    agg_pub_.publish(diag_array);
+  }
 
   // Top level is error if we have stale items, unless all stale
   if (diag_toplevel_state.level > int(DiagnosticLevel::Level_Error) && min_level <= int(DiagnosticLevel::Level_Error))
@@ -169,6 +169,7 @@ AnalyzerGroup::~AnalyzerGroup()
 bool AnalyzerGroup::addAnalyzer(boost::shared_ptr<Analyzer>& analyzer)
 {
   analyzers_.push_back(analyzer);
+  resetMatches();
   return true;
 }
 
@@ -178,37 +179,33 @@ bool AnalyzerGroup::removeAnalyzer(boost::shared_ptr<Analyzer>& analyzer)
   if (it != analyzers_.end())
   {
     analyzers_.erase(it);
+    resetMatches();
     return true;
   }
   return false;
 }
 
-bool AnalyzerGroup::match(const string name)
+const vector<size_t> &AnalyzerGroup::getMatches(const string &name)
 {
-  if (analyzers_.size() == 0)
-    return false;
+  boost::unordered_map<string, vector<size_t> >::iterator it = matched_.find(name);
+  if (it != matched_.end())
+    return it->second;
 
-  bool match_name = false;
-  if (matched_.count(name))
-  {
-    vector<bool> &mtch_vec = matched_[name];
-    for (unsigned int i = 0; i < mtch_vec.size(); ++i)
-    {
-      if (mtch_vec[i])
-        return true;
-    }
-    return false;
-  }
-  
-  matched_[name].resize(analyzers_.size());
-  for (unsigned int i = 0; i < analyzers_.size(); ++i)
+  vector<size_t> &matches = matched_[name];
+  for (size_t i = 0; i < analyzers_.size(); ++i)
   {
-    bool mtch = analyzers_[i]->match(name);
-    match_name = mtch || match_name;
-    matched_[name].at(i) = mtch;
+    if (analyzers_[i]->match(name))
+      matches.push_back(i);
   }
+  return matches;
+}
 
-  return match_name;
+bool AnalyzerGroup::match(const string name)
+{
+  if (analyzers_.size() == 0)
+    return false;
+
+  return !getMatches(name).empty();
 }
 
 void AnalyzerGroup::resetMatches()
@@ -219,16 +216,11 @@ void AnalyzerGroup::resetMatches()
 
 bool AnalyzerGroup::analyze(const boost::shared_ptr<StatusItem> item)
 {
-  ROS_ASSERT_MSG(matched_.count(item->getName()), "AnalyzerGroup was asked to analyze an item it hadn't matched.");
-
   bool analyzed = false;
-  vector<bool> &mtch_vec = matched_[item->getName()];
-  for (unsigned int i = 0; i < mtch_vec.size(); ++i)
-  {
-    if (mtch_vec[i])
-      analyzed = analyzers_[i]->analyze(item) || analyzed;
-  }
-  
+  const vector<size_t> &matches = getMatches(item->getName());
+  for (size_t i = 0; i < matches.size(); ++i)
+    analyzed = analyzers_[matches[i]]->analyze(item) || analyzed;
+
   return analyzed;
 }
 
@@ -43,7 +43,7 @@ PLUGINLIB_EXPORT_CLASS(diagnostic_aggregator::GenericAnalyzer,
                        diagnostic_aggregator::Analyzer)
 
 
-GenericAnalyzer::GenericAnalyzer() { }
+GenericAnalyzer::GenericAnalyzer() : has_combined_regex_(false) { }
 
 bool GenericAnalyzer::init(const string base_path, const ros::NodeHandle &n)
 { 
@@ -92,6 +92,7 @@ bool GenericAnalyzer::init(const string base_path, const ros::NodeHandle &n)
  }
  
   XmlRpc::XmlRpcValue regexes;
+  vector<string> valid_regex_strs;
   if (n.getParam("regex", regexes))
   {
     vector<string> regex_strs;
@@ -103,6 +104,7 @@ bool GenericAnalyzer::init(const string base_path, const ros::NodeHandle &n)
       {
         boost::regex re(regex_strs[i]);
         regex_.push_back(re);
+        valid_regex_strs.push_back(regex_strs[i]);
       }
       catch (boost::regex_error& e)
       {
@@ -111,6 +113,7 @@ bool GenericAnalyzer::init(const string base_path, const ros::NodeHandle &n)
       }
     }
   }
+  compilePatterns(valid_regex_strs);
 
   if (startswith_.size() == 0 && name_.size() == 0 && 
       contains_.size() == 0 && expected_.size() == 0 && regex_.size() == 0)
@@ -147,26 +150,60 @@ bool GenericAnalyzer::init(const string base_path, const ros::NodeHandle &n)
 GenericAnalyzer::~GenericAnalyzer() { }
 
 
-bool GenericAnalyzer::match(const string name)
+void GenericAnalyzer::compilePatterns(const vector<string> &regex_strs)
 {
-  boost::cmatch what;
-  for (unsigned int i = 0; i < regex_.size(); ++i)
+  exact_names_.clear();
+  exact_names_.insert(expected_.begin(), expected_.end());
+  exact_names_.insert(name_.begin(), name_.end());
+
+  // Wrapping each expression in a non-capturing group keeps regex_match semantics
+  // for the alternation, but would renumber back-references, so leave those alone.
+  has_combined_regex_ = false;
+  if (regex_strs.size() < 2)
+    return;
+
+  static const boost::regex backref("\\\\(?:[1-9]|g|k)");
+  string combined;
+  for (size_t i = 0; i < regex_strs.size(); ++i)
   {
-    if (boost::regex_match(name.c_str(), what, regex_[i]))
-      return true;
+    if (boost::regex_search(regex_strs[i], backref))
+      return;
+    if (i > 0)
+      combined += "|";
+    combined += "(?:" + regex_strs[i] + ")";
   }
-  
-  for (unsigned int i = 0; i < expected_.size(); ++i)
+
+  try
   {
-    if (name == expected_[i])
-      return true;
+    combined_regex_.assign(combined, boost::regex::optimize);
+    has_combined_regex_ = true;
   }
-  
-  for (unsigned int i = 0; i < name_.size(); ++i)
+  catch (boost::regex_error& e)
   {
-    if (name == name_[i])
+    ROS_DEBUG("Unable to combine regexes into %s, matching them one at a time. Exception: %s",
+              combined.c_str(), e.what());
+  }
+}
+
+bool GenericAnalyzer::match(const string name)
+{
+  if (has_combined_regex_)
+  {
+    if (boost::regex_match(name, combined_regex_))
       return true;
   }
+  else
+  {
+    boost::cmatch what;
+    for (unsigned int i = 0; i < regex_.size(); ++i)
+    {
+      if (boost::regex_match(name.c_str(), what, regex_[i]))
+        return true;
+    }
+  }
+
+  if (exact_names_.count(name))
+    return true;
   
   for (unsigned int i = 0; i < startswith_.size(); ++i)
   {
@@ -0,0 +1,102 @@
+#!/usr/bin/env python
+# Software License Agreement (BSD License)
+#
+# Copyright (c) 2009, Willow Garage, Inc.
+# All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above
+#    copyright notice, this list of conditions and the following
+#    disclaimer in the documentation and/or other materials provided
+#    with the distribution.
+#  * Neither the name of the Willow Garage nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+# "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+# LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+# FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+# COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+# INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+# BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+# LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+# CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+# LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+# ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+# POSSIBILITY OF SUCH DAMAGE.
+#
+
+
+##\brief Tests that the aggregator only publishes non-empty deltas
+
+import rospy, rostest, unittest
+from diagnostic_msgs.msg import DiagnosticArray, DiagnosticStatus
+from time import sleep
+import sys
+import threading
+
+
+class TestDeltaPublish(unittest.TestCase):
+    def __init__(self, *args):
+        super(TestDeltaPublish, self).__init__(*args)
+
+        self._mutex = threading.Lock()
+
+        self._full_count = 0
+        self._deltas = []
+        self._changing_warned = False
+
+        rospy.init_node('test_delta_publish')
+        self._diag_agg_sub = rospy.Subscriber("/diagnostics_agg",
+                                              DiagnosticArray,
+                                              self.diag_agg_cb)
+        self._diag_delta_sub = rospy.Subscriber("/diagnostics_agg_delta",
+                                                DiagnosticArray,
+                                                self.diag_delta_cb)
+        self._start_time = rospy.get_time()
+
+    def diag_agg_cb(self, msg):
+        with self._mutex:
+            self._full_count += 1
+            self.check_changing(msg)
+
+    def diag_delta_cb(self, msg):
+        with self._mutex:
+            self._deltas.append(msg)
+            self.check_changing(msg)
+
+    def check_changing(self, msg):
+        for stat in msg.status:
+            if stat.name == '/Changing/changing' and stat.level == DiagnosticStatus.WARN:
+                self._changing_warned = True
+
+    def test_delta_publish(self):
+        duration = 12
+        while not rospy.is_shutdown():
+            sleep(1.0)
+            if rospy.get_time() - self._start_time > duration:
+                break
+
+        self.assert_(not rospy.is_shutdown(), "Rospy shutdown!")
+
+        with self._mutex:
+            self.assert_(self._full_count > 0, "No full snapshot received on /diagnostics_agg")
+            self.assert_(self._changing_warned, "The change of 'changing' to WARN was never published")
+
+            for delta in self._deltas:
+                self.assert_(len(delta.status) > 0, "Received an empty delta on /diagnostics_agg_delta")
+
+            # Items showing up at startup and the OK->WARN change are the
+            # only deltas; every other publish in between has nothing to send
+            self.assert_(len(self._deltas) <= 4,
+                         "Expected at most 4 delta messages, got {}".format(len(self._deltas)))
+
+
+if __name__ == '__main__':
+    rostest.run('diagnostic_aggregator', sys.argv[0], TestDeltaPublish, sys.argv)
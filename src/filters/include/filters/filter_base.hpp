@@ -96,6 +96,20 @@ public:
    */
   virtual bool update(const T& data_in, T& data_out)=0;
 
+  /** \brief Update the filter on the data where it is
+   * The default copies the data and calls update(). Filters which can work on their input directly override
+   * this together with supportsInPlace(), which lets a FilterChain run them without intermediate copies.
+   * \param data A reference to the data to be filtered, replaced by the output
+   */
+  virtual bool updateInPlace(T& data)
+  {
+    T data_in = data;
+    return update(data_in, data);
+  }
+
+  /** \brief Whether updateInPlace() filters the data without copying it */
+  virtual bool supportsInPlace() const {return false;};
+
   /** \brief Get the type of the filter as a string */
   std::string getType() {return filter_type_;};
 
@@ -35,6 +35,7 @@
 #include <pluginlib/class_loader.h>
 #include <memory>
 #include <sstream>
+#include <utility>
 #include <vector>
 
 namespace filters
@@ -88,49 +89,102 @@ public:
     return this->configure(config, node.getNamespace());
   }
 
-  /** \brief process data through each of the filters added sequentially */
+  /** \brief process data through each of the filters added sequentially
+   * Filters supporting in place updates work straight on data_out, so a chain of only such filters copies
+   * data_in once; other filters write into the next free intermediate buffer.
+   */
   bool update(const T& data_in, T& data_out)
   {
-    unsigned int list_size = reference_pointers_.size();
-    bool result;
-    if (list_size == 0)
-    {
-      data_out = data_in;
-      result = true;
-    }
-    else if (list_size == 1)
-      result = reference_pointers_[0]->update(data_in, data_out);
-    else if (list_size == 2)
-    {
-      result = reference_pointers_[0]->update(data_in, buffer0_);
-      if (result == false) {return false; };//don't keep processing on failure
-      result = result && reference_pointers_[1]->update(buffer0_, data_out);
-    }
-    else
+    const T* current = &data_in;                                      // the latest result
+    T* writable = (&data_in == &data_out) ? &data_out : nullptr;     // the latest result, if we may modify it
+    for (unsigned int i = 0; i < reference_pointers_.size(); i++)
     {
-      result = reference_pointers_[0]->update(data_in, buffer0_);  //first copy in
-      for (unsigned int i = 1; i <  reference_pointers_.size() - 1; i++) // all but first and last (never called if size=2)
+      filters::FilterBase<T>& filter = *reference_pointers_[i];
+      ros::WallTime start;
+      if (profiling_)
+        start = ros::WallTime::now();
+
+      bool result;
+      if (filter.supportsInPlace())
       {
-        if (i %2 == 1)
-          result = result && reference_pointers_[i]->update(buffer0_, buffer1_);
+        if (writable == nullptr)
+        {
+          data_out = *current;  // the only copy of a chain of in place filters
+          writable = &data_out;
+        }
+        result = filter.updateInPlace(*writable);
+      }
+      else
+      {
+        // Write to the output directly if this is the last filter, otherwise to a buffer not being read
+        T* target;
+        if (i + 1 == reference_pointers_.size() && current != &data_out)
+          target = &data_out;
         else
-          result = result && reference_pointers_[i]->update(buffer1_, buffer0_);
-        
-        if (result == false) {return false; }; //don't keep processing on failure
+          target = (current == &buffer0_) ? &buffer1_ : &buffer0_;
+        result = filter.update(*current, *target);
+        writable = target;
       }
-      if (list_size % 2 == 1) // odd number last deposit was in buffer1
-        result = result && reference_pointers_.back()->update(buffer1_, data_out);
+      current = writable;
+
+      if (profiling_)
+      {
+        ros::WallDuration elapsed = ros::WallTime::now() - start;
+        timings_[i].calls++;
+        timings_[i].last = elapsed;
+        timings_[i].total += elapsed;
+      }
+      if (result == false) {return false; }; //don't keep processing on failure
+    }
+
+    if (current != &data_out)
+    {
+      if (writable == nullptr)
+        data_out = data_in;                  // empty chain
       else
-        result = result && reference_pointers_.back()->update(buffer0_, data_out);
+        std::swap(data_out, *writable);     // the result ended up in an intermediate buffer
     }
-    return result;
-    
+    return true;
   };
+
+  /** \brief Time spent in one filter of the chain, collected while profiling is enabled */
+  struct FilterTiming
+  {
+    std::string name;           ///<! The name of the filter
+    unsigned long calls = 0;    ///<! The number of updates timed
+    ros::WallDuration last;     ///<! The duration of the latest update
+    ros::WallDuration total;    ///<! The total duration of all timed updates
+  };
+
+  /** \brief Enable or disable timing each filter of the chain. Enabling it resets the timings */
+  void setProfiling(bool profiling)
+  {
+    profiling_ = profiling;
+    if (profiling_)
+      resetTimings();
+  }
+
+  /** \brief Return the timings of each filter of the chain, in chain order */
+  std::vector<FilterTiming> getFilterTimings() const
+  {
+    return timings_;
+  }
+
+  /** \brief Whether every filter of the chain supports in place updates, so update() copies the data only once */
+  bool isInPlace() const
+  {
+    for (unsigned int i = 0; i < reference_pointers_.size(); i++)
+      if (!reference_pointers_[i]->supportsInPlace())
+        return false;
+    return true;
+  }
+
   /** \brief Clear all filters from this chain */
   bool clear() 
   {
     configured_ = false;
     reference_pointers_.clear();
+    timings_.clear();
     return true;
   };
   
@@ -243,6 +297,8 @@ public:
       ROS_DEBUG("%s: Configured %s:%s filter at %p\n", filter_ns.c_str(), type.c_str(),
                 name.c_str(),  p);
     }
+    resetTimings();
+    ROS_DEBUG("%s: Filter chain runs %s", filter_ns.c_str(), isInPlace() ? "in place" : "through intermediate buffers");
     
     if (result == true)
     {
@@ -260,11 +316,21 @@ public:
 
 private:
 
+  /** \brief Start the timings of the configured filters from zero */
+  void resetTimings()
+  {
+    timings_.assign(reference_pointers_.size(), FilterTiming());
+    for (unsigned int i = 0; i < reference_pointers_.size(); i++)
+      timings_[i].name = reference_pointers_[i]->getName();
+  }
+
   std::vector<std::shared_ptr<filters::FilterBase<T>>> reference_pointers_;   ///<! A vector of pointers to currently constructed filters
 
   T buffer0_; ///<! A temporary intermediate buffer
   T buffer1_; ///<! A temporary intermediate buffer
   bool configured_; ///<! whether the system is configured  
+  bool profiling_ = false; ///<! whether each filter update is timed
+  std::vector<FilterTiming> timings_; ///<! per filter timings, in chain order
 
 };
 
@@ -60,19 +60,33 @@ public:
    * \param data_out T array with length width
    */
   virtual bool update( const T & data_in, T& data_out);
-  
+
+  /** \brief Update the filter on the data where it is
+   * \param data T to increment
+   */
+  virtual bool updateInPlace(T& data);
+
+  /** \brief Whether to run in place, false if the optional parameter in_place is set to false */
+  virtual bool supportsInPlace() const {return in_place_;};
+
+private:
+  bool in_place_;                                ///< Whether to offer updateInPlace() to a FilterChain
 };
 
 
 template <typename T>
-IncrementFilter<T>::IncrementFilter()
+IncrementFilter<T>::IncrementFilter():
+  in_place_(true)
 {
 }
 
 template <typename T>
 bool IncrementFilter<T>::configure()
 {
-    
+  // Optional, lets a chain be made to go through its intermediate buffers
+  if (!FilterBase<T>::getParam(std::string("in_place"), in_place_))
+    in_place_ = true;
+
   return true;
 }
 
@@ -90,6 +104,14 @@ bool IncrementFilter<T>::update(const T & data_in, T& data_out)
   return true;
 }
 
+template <typename T>
+bool IncrementFilter<T>::updateInPlace(T& data)
+{
+  data = data + 1;
+
+  return true;
+}
+
 /** \brief A increment filter which works on arrays.
  *
  */
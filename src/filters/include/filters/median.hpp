@@ -34,6 +34,7 @@
 #include <sstream>
 #include <cstdio>
 
+#include <algorithm>
 #include <memory>
 
 #include "filters/filter_base.hpp"
@@ -89,6 +90,60 @@ elem_type kth_smallest(elem_type a[], int n, int k)
 #define median(a,n) kth_smallest(a,n,(((n)&1)?((n)/2):(((n)/2)-1)))
 #undef ELEM_SWAP
 
+/*---------------------------------------------------------------------------
+  Sliding window order statistics.
+  The filters below keep the contents of their window sorted in a contiguous
+  array. A new sample is placed with a binary search and the elements between
+  the outgoing and incoming positions are moved by one, so the median is read
+  off directly instead of being selected from a copy of the window. For the
+  window sizes filters use, this beats heaps or skiplists, which chase
+  pointers for the same O(log w) comparisons.
+  ---------------------------------------------------------------------------*/
+
+/** \brief Strict weak ordering used by the windows: NaNs sort after everything else */
+template <typename elem_type>
+inline bool window_less(const elem_type& a, const elem_type& b)
+{
+  return a < b || (b != b && a == a);
+}
+
+/** \brief Insert value into the sorted array of length elements, which must have room for one more */
+template <typename elem_type>
+void window_insert(elem_type sorted[], unsigned int length, const elem_type& value)
+{
+  elem_type* pos = std::upper_bound(sorted, sorted + length, value, window_less<elem_type>);
+  std::copy_backward(pos, sorted + length, sorted + length + 1);
+  *pos = value;
+}
+
+/** \brief Replace outgoing, which must be in the sorted array of length elements, by incoming */
+template <typename elem_type>
+void window_replace(elem_type sorted[], unsigned int length, const elem_type& outgoing, const elem_type& incoming)
+{
+  elem_type* out = std::lower_bound(sorted, sorted + length, outgoing, window_less<elem_type>);
+  if (window_less(incoming, outgoing))
+  {
+    // Shift the elements in [incoming, outgoing) up by one
+    elem_type* pos = std::upper_bound(sorted, out, incoming, window_less<elem_type>);
+    std::copy_backward(pos, out, out + 1);
+    *pos = incoming;
+  }
+  else
+  {
+    // Shift the elements in (outgoing, incoming] down by one
+    elem_type* pos = std::upper_bound(out + 1, sorted + length, incoming, window_less<elem_type>);
+    std::copy(out + 1, pos, out);
+    *(pos - 1) = incoming;
+  }
+}
+
+/** \brief The median of a sorted array, the lower one for an even length as median() returns */
+template <typename elem_type>
+inline const elem_type& window_median(const elem_type sorted[], unsigned int length)
+{
+  return sorted[(length & 1) ? (length / 2) : (length / 2 - 1)];
+}
+
 
 /** \brief A median filter which works on arrays.
  *
@@ -113,7 +168,7 @@ public:
   virtual bool update(const T& data_in, T& data_out);
   
 protected:
-  std::vector<T> temp_storage_;                       ///< Preallocated storage for the list to sort
+  std::vector<T> temp_storage_;                       ///< The contents of the window, kept sorted
   std::unique_ptr<RealtimeCircularBuffer<T > > data_storage_;                       ///< Storage for data between updates
   
   T temp;  //used for preallocation and copying from non vector source
@@ -159,18 +214,19 @@ bool MedianFilter<T>::update(const T& data_in, T& data_out)
   if (!FilterBase<T>::configured_)
     return false;
 
-  data_storage_->push_back(data_in);
-
+  if (number_of_observations_ == 0)
+    return false;
 
   unsigned int length = data_storage_->size();
- 
+  if (length == number_of_observations_)
+    window_replace(&temp_storage_[0], length, (*data_storage_)[0], data_in);  // the oldest sample drops out
+  else
+    window_insert(&temp_storage_[0], length++, data_in);
 
-  for (uint32_t row = 0; row < length; row ++)
-  {
-    temp_storage_[row] = (*data_storage_)[row];
-  }
-  data_out = median(&temp_storage_[0], length);
-  
+  // Only now, as this overwrites the oldest sample
+  data_storage_->push_back(data_in);
+
+  data_out = window_median(&temp_storage_[0], length);
 
   return true;
 }
@@ -197,7 +253,7 @@ public:
   virtual bool update(const std::vector<T>& data_in, std::vector<T>& data_out);
   
 protected:
-  std::vector<T> temp_storage_;                       ///< Preallocated storage for the list to sort
+  std::vector<T> temp_storage_;                       ///< The contents of the window of each channel in turn, kept sorted
   std::unique_ptr<RealtimeCircularBuffer<std::vector<T> > > data_storage_;                       ///< Storage for data between updates
   
   std::vector<T> temp;  //used for preallocation and copying from non vector source
@@ -233,7 +289,7 @@ bool MultiChannelMedianFilter<T>::configure()
     
   temp.resize(this->number_of_channels_);
   data_storage_.reset( new RealtimeCircularBuffer<std::vector<T> >(number_of_observations_, temp));
-  temp_storage_.resize(number_of_observations_);
+  temp_storage_.resize(number_of_observations_ * this->number_of_channels_);
   
   return true;
 }
@@ -247,20 +303,28 @@ bool MultiChannelMedianFilter<T>::update(const std::vector<T>& data_in, std::vec
   if (!FilterBase<T>::configured_)
     return false;
 
-  data_storage_->push_back(data_in);
-
+  if (number_of_observations_ == 0)
+    return false;
 
   unsigned int length = data_storage_->size();
- 
+  bool full = length == number_of_observations_;
 
   for (uint32_t i = 0; i < this->number_of_channels_; i++)
   {
-    for (uint32_t row = 0; row < length; row ++)
-    {
-      temp_storage_[row] = (*data_storage_)[row][i];
-    }
-    data_out[i] = median(&temp_storage_[0], length);
+    T* sorted = &temp_storage_[i * number_of_observations_];
+    if (full)
+      window_replace(sorted, length, (*data_storage_)[0][i], data_in[i]);  // the oldest sample drops out
+    else
+      window_insert(sorted, length, data_in[i]);
   }
+  if (!full)
+    length++;
+
+  // Only now, as this overwrites the oldest sample
+  data_storage_->push_back(data_in);
+
+  for (uint32_t i = 0; i < this->number_of_channels_; i++)
+    data_out[i] = window_median(&temp_storage_[i * number_of_observations_], length);
 
   return true;
 }
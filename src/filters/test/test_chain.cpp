@@ -283,6 +283,68 @@ TEST(FilterChain, TenIncrementChains){
     
 }
 
+TEST(FilterChain, InPlaceIncrementChains){
+  filters::FilterChain<int> chain("int");
+  int v1 = 1;
+  int v1a = 9;
+
+  EXPECT_TRUE(chain.configure("ThreeIncrements"));
+  EXPECT_TRUE(chain.isInPlace());
+  chain.setProfiling(true);
+  EXPECT_TRUE(chain.update(v1, v1a));
+  EXPECT_EQ(4, v1a);
+  EXPECT_EQ(1, v1);
+
+  // Input and output may be the same object
+  EXPECT_TRUE(chain.update(v1a, v1a));
+  EXPECT_EQ(7, v1a);
+
+  auto timings = chain.getFilterTimings();
+  ASSERT_EQ(3u, timings.size());
+  EXPECT_EQ("increment1", timings[0].name);
+  EXPECT_EQ("increment3", timings[2].name);
+  for (unsigned int i = 0; i < timings.size(); i++)
+  {
+    EXPECT_EQ(2u, timings[i].calls);
+    EXPECT_GE(timings[i].total, timings[i].last);
+  }
+  chain.clear();
+  EXPECT_EQ(0u, chain.getFilterTimings().size());
+}
+
+/** \brief Run a chain over changing inputs, separately and in place, and check every result */
+void checkIncrementChain(const std::string& name, int length, bool in_place)
+{
+  filters::FilterChain<int> chain("int");
+  ASSERT_TRUE(chain.configure(name));
+  EXPECT_EQ(in_place, chain.isInPlace());
+
+  for (int v1 = 0; v1 < 5; v1++)
+  {
+    int v1a = -1;
+    EXPECT_TRUE(chain.update(v1, v1a));
+    EXPECT_EQ(v1 + length, v1a);
+
+    // Input and output may be the same object
+    v1a = 10 * v1;
+    EXPECT_TRUE(chain.update(v1a, v1a));
+    EXPECT_EQ(10 * v1 + length, v1a);
+  }
+}
+
+TEST(FilterChain, CopyIncrementChains){
+  checkIncrementChain("TwoCopyIncrements", 2, false);
+  checkIncrementChain("ThreeCopyIncrements", 3, false);
+  checkIncrementChain("FourCopyIncrements", 4, false);
+}
+
+TEST(FilterChain, MixedIncrementChains){
+  checkIncrementChain("CopyThenInPlaceIncrements", 3, false);
+  checkIncrementChain("InPlaceThenCopyIncrements", 3, false);
+  checkIncrementChain("AlternatingIncrements", 5, false);
+  checkIncrementChain("TenIncrements", 10, true);
+}
+
 TEST(MultiChannelFilterChain, TenMultiChannelIncrementChains){
   filters::MultiChannelFilterChain<int> chain("int");  
   std::vector<int> v1;
@@ -29,6 +29,8 @@
 
 #include <gtest/gtest.h>
 #include <sys/time.h>
+#include <algorithm>
+#include <cstdlib>
 
 #include "filters/median.hpp"
 
@@ -147,6 +149,37 @@ TEST(MultiChannelMedianFilterFloat, ThreeRows)
 
 }
 
+TEST(MultiChannelMedianFilterDouble, SlidingWindowMatchesFullSort)
+{
+  int rows = 3;
+  int window = 5;
+
+  MultiChannelFilterBase<double > * filter = new MultiChannelMedianFilter<double>();
+  EXPECT_TRUE(filter->configure(rows, "MultiChannelMedianFilterDouble5"));
+
+  std::vector<std::vector<double> > history(rows);
+  std::vector<double> in(rows), out(rows);
+  unsigned int seed = 42;
+  for (int step = 0; step < 200; step++)
+  {
+    for (int i = 0; i < rows; i++)
+    {
+      in[i] = rand_r(&seed) % 20;  // plenty of repeated values
+      history[i].push_back(in[i]);
+    }
+    EXPECT_TRUE(filter->update(in, out));
+
+    for (int i = 0; i < rows; i++)
+    {
+      // Lower median of the last (up to) window samples
+      std::vector<double> last(history[i].end() - std::min<int>(window, history[i].size()), history[i].end());
+      std::sort(last.begin(), last.end());
+      EXPECT_EQ(last[(last.size() - 1) / 2], out[i]);
+    }
+  }
+
+  delete filter;
+}
 
 int main(int argc, char **argv){
   testing::InitGoogleTest(&argc, argv);
@@ -37,6 +37,7 @@
 
 #include "ros/ros.h"
 #include "geometry_msgs/TransformStamped.h"
+#include "tf2_msgs/TFMessage.h"
 namespace tf2_ros
 {
 
@@ -66,6 +67,11 @@ public:
    * The stamped data structure includes frame_id, and time, and parent_id already.  */
   void sendTransform(const std::vector<geometry_msgs::TransformStamped> & transforms);
 
+  /** \brief Send a TFMessage as is
+   * The message is published without copying its transforms, so callers which
+   * publish the same set of frames repeatedly can reuse one message.  */
+  void sendTransform(const tf2_msgs::TFMessage & message);
+
 private:
   /// Internal reference to ros::Node
   ros::NodeHandle node_;
@@ -60,6 +60,11 @@ void TransformBroadcaster::sendTransform(const std::vector<geometry_msgs::Transf
   publisher_.publish(message);
 }
 
+void TransformBroadcaster::sendTransform(const tf2_msgs::TFMessage & message)
+{
+  publisher_.publish(message);
+}
+
 
 }
 
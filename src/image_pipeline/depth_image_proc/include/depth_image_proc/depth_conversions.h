@@ -38,8 +38,11 @@
 #include <sensor_msgs/point_cloud2_iterator.h>
 #include <image_geometry/pinhole_camera_model.h>
 #include <depth_image_proc/depth_traits.h>
+#include <depth_image_proc/ray_cache.h>
 
 #include <limits>
+#include <stdexcept>
+#include <string>
 
 namespace depth_image_proc {
 
@@ -96,6 +99,98 @@ void convert(
   }
 }
 
+// Byte offset of a field within each point of cloud_msg
+inline int fieldOffset(const PointCloud& cloud_msg, const std::string& name)
+{
+  for (size_t i = 0; i < cloud_msg.fields.size(); ++i)
+  {
+    if (cloud_msg.fields[i].name == name)
+      return cloud_msg.fields[i].offset;
+  }
+  throw std::runtime_error("Field " + name + " does not exist");
+}
+
+// Handles float or uint16 depths, reusing the rays cached for the depth camera. x, y and z must
+// be consecutive float fields, as laid out by PointCloud2Modifier.
+template<typename T>
+void convert(
+    const sensor_msgs::ImageConstPtr& depth_msg,
+    PointCloud::Ptr& cloud_msg,
+    const RayCache& rays,
+    double range_max = 0.0)
+{
+  // Missing points become NaNs, or points at range_max if given
+  float missing_depth = std::numeric_limits<float>::quiet_NaN();
+  if (range_max != 0.0)
+    missing_depth = DepthTraits<T>::toMeters(DepthTraits<T>::fromMeters(range_max));
+
+  const int point_step = cloud_msg->point_step;
+  uint8_t* cloud_row = &cloud_msg->data[0] + fieldOffset(*cloud_msg, "x");
+  const T* depth_row = reinterpret_cast<const T*>(&depth_msg->data[0]);
+  int row_step = depth_msg->step / sizeof(T);
+  for (int v = 0; v < (int)cloud_msg->height; ++v, depth_row += row_step, cloud_row += cloud_msg->row_step)
+  {
+    const float* ray_x = rays.x(v);
+    const float* ray_y = rays.y(v);
+    const float* ray_z = rays.z(v);
+    uint8_t* point = cloud_row;
+    for (int u = 0; u < (int)cloud_msg->width; ++u, point += point_step)
+    {
+      T raw_depth = depth_row[u];
+      float depth = DepthTraits<T>::valid(raw_depth) ? DepthTraits<T>::toMeters(raw_depth) : missing_depth;
+
+      // Fill in XYZ; a NaN depth makes all three NaN
+      float* xyz = reinterpret_cast<float*>(point);
+      xyz[0] = ray_x[u] * depth;
+      xyz[1] = ray_y[u] * depth;
+      xyz[2] = ray_z[u] * depth;
+    }
+  }
+}
+
+// Fills the rgb field of cloud_msg from an 8-bit image, given the byte offsets of each channel
+// within a pixel of color_step bytes
+inline void convertRgb(
+    const sensor_msgs::ImageConstPtr& rgb_msg,
+    PointCloud::Ptr& cloud_msg,
+    int red_offset, int green_offset, int blue_offset, int color_step)
+{
+  const int point_step = cloud_msg->point_step;
+  uint8_t* cloud_row = &cloud_msg->data[0] + fieldOffset(*cloud_msg, "rgb");
+  const uint8_t* rgb_row = &rgb_msg->data[0];
+  for (int v = 0; v < (int)cloud_msg->height; ++v, rgb_row += rgb_msg->step, cloud_row += cloud_msg->row_step)
+  {
+    const uint8_t* rgb = rgb_row;
+    uint8_t* point = cloud_row;
+    for (int u = 0; u < (int)cloud_msg->width; ++u, rgb += color_step, point += point_step)
+    {
+      // Little-endian packing, as PointCloud2Iterator does for is_bigendian = false
+      point[0] = rgb[blue_offset];
+      point[1] = rgb[green_offset];
+      point[2] = rgb[red_offset];
+      point[3] = 255;
+    }
+  }
+}
+
+// Fills the float intensity field of cloud_msg from an intensity image
+template<typename T>
+void convertIntensity(
+    const sensor_msgs::ImageConstPtr& intensity_msg,
+    PointCloud::Ptr& cloud_msg)
+{
+  const int point_step = cloud_msg->point_step;
+  uint8_t* cloud_row = &cloud_msg->data[0] + fieldOffset(*cloud_msg, "intensity");
+  const T* inten_row = reinterpret_cast<const T*>(&intensity_msg->data[0]);
+  int row_step = intensity_msg->step / sizeof(T);
+  for (int v = 0; v < (int)cloud_msg->height; ++v, inten_row += row_step, cloud_row += cloud_msg->row_step)
+  {
+    uint8_t* point = cloud_row;
+    for (int u = 0; u < (int)cloud_msg->width; ++u, point += point_step)
+      *reinterpret_cast<float*>(point) = inten_row[u];
+  }
+}
+
 } // namespace depth_image_proc
 
 #endif
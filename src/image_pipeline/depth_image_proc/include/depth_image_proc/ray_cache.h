@@ -0,0 +1,151 @@
+/*********************************************************************
+* Software License Agreement (BSD License)
+* 
+*  Copyright (c) 2008, Willow Garage, Inc.
+*  All rights reserved.
+* 
+*  Redistribution and use in source and binary forms, with or without
+*  modification, are permitted provided that the following conditions
+*  are met:
+* 
+*   * Redistributions of source code must retain the above copyright
+*     notice, this list of conditions and the following disclaimer.
+*   * Redistributions in binary form must reproduce the above
+*     copyright notice, this list of conditions and the following
+*     disclaimer in the documentation and/or other materials provided
+*     with the distribution.
+*   * Neither the name of the Willow Garage nor the names of its
+*     contributors may be used to endorse or promote products derived
+*     from this software without specific prior written permission.
+* 
+*  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+*  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+*  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+*  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+*  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+*  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+*  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+*  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+*  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+*  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+*  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+*  POSSIBILITY OF SUCH DAMAGE.
+*********************************************************************/
+#ifndef DEPTH_IMAGE_PROC_RAY_CACHE
+#define DEPTH_IMAGE_PROC_RAY_CACHE
+
+#include <image_geometry/pinhole_camera_model.h>
+#include <opencv2/calib3d/calib3d.hpp>
+#include <boost/array.hpp>
+
+#include <cmath>
+#include <vector>
+
+namespace depth_image_proc {
+
+// Per-pixel rays of a depth camera, kept across frames and rebuilt only when the camera
+// calibration changes. The point at pixel (u,v) with depth d is d * (x(v)[u], y(v)[u], z(v)[u]),
+// where d is Z for rays through a rectified image and the range for unit-length rays.
+class RayCache
+{
+public:
+  RayCache()
+    : mode_(NONE), width_(0), height_(0), fx_(0.0), fy_(0.0), cx_(0.0), cy_(0.0)
+  {
+    K_.assign(0.0);
+  }
+
+  // Rays with z = 1 through a width x height rectified image of model, ignoring its Tx/Ty
+  // projection offset. Returns true if the tables were rebuilt.
+  bool update(const image_geometry::PinholeCameraModel& model, int width, int height)
+  {
+    if (mode_ == RECTIFIED && width == width_ && height == height_ &&
+        model.fx() == fx_ && model.fy() == fy_ && model.cx() == cx_ && model.cy() == cy_)
+      return false;
+
+    mode_ = RECTIFIED;
+    resize(width, height);
+    fx_ = model.fx();
+    fy_ = model.fy();
+    cx_ = model.cx();
+    cy_ = model.cy();
+
+    double inv_fx = 1.0 / fx_, inv_fy = 1.0 / fy_;
+    for (int v = 0; v < height; ++v)
+    {
+      float ray_y = (v - cy_) * inv_fy;
+      size_t row = static_cast<size_t>(v) * width;
+      for (int u = 0; u < width; ++u)
+      {
+        x_[row + u] = (u - cx_) * inv_fx;
+        y_[row + u] = ray_y;
+        z_[row + u] = 1.0f;
+      }
+    }
+    return true;
+  }
+
+  // Unit-length rays through a width x height raw image with camera matrix K and distortion D.
+  // Returns true if the tables were rebuilt.
+  bool update(const boost::array<double, 9>& K, const std::vector<double>& D, int width, int height)
+  {
+    if (mode_ == DISTORTED && width == width_ && height == height_ && K == K_ && D == D_)
+      return false;
+
+    mode_ = DISTORTED;
+    resize(width, height);
+    K_ = K;
+    D_ = D;
+    if (x_.empty())
+      return true;
+
+    cv::Mat pixels(1, width * height, CV_32FC2), undistorted;
+    cv::Vec2f* pixel = pixels.ptr<cv::Vec2f>();
+    for (int v = 0; v < height; ++v)
+      for (int u = 0; u < width; ++u, ++pixel)
+        *pixel = cv::Vec2f(u, v);
+    cv::undistortPoints(pixels, undistorted, cv::Mat_<double>(3, 3, &K_[0]), cv::Mat(D_));
+
+    const cv::Vec2f* ray = undistorted.ptr<cv::Vec2f>();
+    for (size_t i = 0; i < x_.size(); ++i)
+    {
+      float scale = 1.0f / std::sqrt(ray[i][0] * ray[i][0] + ray[i][1] * ray[i][1] + 1.0f);
+      x_[i] = ray[i][0] * scale;
+      y_[i] = ray[i][1] * scale;
+      z_[i] = scale;
+    }
+    return true;
+  }
+
+  int width() const { return width_; }
+  int height() const { return height_; }
+
+  // Ray components for each pixel of row v
+  const float* x(int v) const { return &x_[static_cast<size_t>(v) * width_]; }
+  const float* y(int v) const { return &y_[static_cast<size_t>(v) * width_]; }
+  const float* z(int v) const { return &z_[static_cast<size_t>(v) * width_]; }
+
+private:
+  enum Mode { NONE, RECTIFIED, DISTORTED };
+
+  void resize(int width, int height)
+  {
+    width_ = width;
+    height_ = height;
+    x_.resize(static_cast<size_t>(width) * height);
+    y_.resize(x_.size());
+    z_.resize(x_.size());
+  }
+
+  Mode mode_;
+  int width_, height_;
+  // Calibration the tables were built from
+  double fx_, fy_, cx_, cy_;
+  boost::array<double, 9> K_;
+  std::vector<double> D_;
+  std::vector<float> x_, y_, z_;
+};
+
+} // namespace depth_image_proc
+
+#endif
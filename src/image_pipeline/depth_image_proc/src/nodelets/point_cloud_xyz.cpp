@@ -58,6 +58,7 @@ class PointCloudXyzNodelet : public nodelet::Nodelet
   ros::Publisher pub_point_cloud_;
 
   image_geometry::PinholeCameraModel model_;
+  RayCache rays_;
 
   virtual void onInit();
 
@@ -113,14 +114,15 @@ void PointCloudXyzNodelet::depthCb(const sensor_msgs::ImageConstPtr& depth_msg,
 
   // Update camera model
   model_.fromCameraInfo(info_msg);
+  rays_.update(model_, depth_msg->width, depth_msg->height);
 
   if (depth_msg->encoding == enc::TYPE_16UC1 || depth_msg->encoding == enc::MONO16)
   {
-    convert<uint16_t>(depth_msg, cloud_msg, model_);
+    convert<uint16_t>(depth_msg, cloud_msg, rays_);
   }
   else if (depth_msg->encoding == enc::TYPE_32FC1)
   {
-    convert<float>(depth_msg, cloud_msg, model_);
+    convert<float>(depth_msg, cloud_msg, rays_);
   }
   else
   {
@@ -47,7 +47,7 @@
 #include <sensor_msgs/point_cloud2_iterator.h>
 #include <sensor_msgs/PointCloud2.h>
 #include <image_geometry/pinhole_camera_model.h>
-#include <depth_image_proc/depth_traits.h>
+#include <depth_image_proc/depth_conversions.h>
 #include <cv_bridge/cv_bridge.h>
 #include <opencv2/imgproc/imgproc.hpp>
 
@@ -74,6 +74,7 @@ class PointCloudXyziNodelet : public nodelet::Nodelet
   ros::Publisher pub_point_cloud_;
 
   image_geometry::PinholeCameraModel model_;
+  RayCache rays_;
 
   virtual void onInit();
 
@@ -86,7 +87,7 @@ class PointCloudXyziNodelet : public nodelet::Nodelet
   template<typename T, typename T2>
   void convert(const sensor_msgs::ImageConstPtr& depth_msg,
                const sensor_msgs::ImageConstPtr& intensity_msg,
-               const PointCloud::Ptr& cloud_msg);
+               PointCloud::Ptr& cloud_msg);
 };
 
 void PointCloudXyziNodelet::onInit()
@@ -271,52 +272,11 @@ void PointCloudXyziNodelet::imageCb(const sensor_msgs::ImageConstPtr& depth_msg,
 template<typename T, typename T2>
 void PointCloudXyziNodelet::convert(const sensor_msgs::ImageConstPtr& depth_msg,
                                       const sensor_msgs::ImageConstPtr& intensity_msg,
-                                      const PointCloud::Ptr& cloud_msg)
+                                      PointCloud::Ptr& cloud_msg)
 {
-  // Use correct principal point from calibration
-  float center_x = model_.cx();
-  float center_y = model_.cy();
-
-  // Combine unit conversion (if necessary) with scaling by focal length for computing (X,Y)
-  double unit_scaling = DepthTraits<T>::toMeters( T(1) );
-  float constant_x = unit_scaling / model_.fx();
-  float constant_y = unit_scaling / model_.fy();
-  float bad_point = std::numeric_limits<float>::quiet_NaN ();
-  
-  const T* depth_row = reinterpret_cast<const T*>(&depth_msg->data[0]);
-  int row_step = depth_msg->step / sizeof(T);
-
-  const T2* inten_row = reinterpret_cast<const T2*>(&intensity_msg->data[0]);
-  int inten_row_step  = intensity_msg->step / sizeof(T2);
-
-  sensor_msgs::PointCloud2Iterator<float> iter_x(*cloud_msg, "x");
-  sensor_msgs::PointCloud2Iterator<float> iter_y(*cloud_msg, "y");
-  sensor_msgs::PointCloud2Iterator<float> iter_z(*cloud_msg, "z");
-  sensor_msgs::PointCloud2Iterator<float> iter_i(*cloud_msg, "intensity");
-
-  for (int v = 0; v < int(cloud_msg->height); ++v, depth_row += row_step, inten_row += inten_row_step)
-  {
-    for (int u = 0; u < int(cloud_msg->width); ++u, ++iter_x, ++iter_y, ++iter_z, ++iter_i)
-    {
-      T depth = depth_row[u];
-      T2 inten = inten_row[u];
-      // Check for invalid measurements
-      if (!DepthTraits<T>::valid(depth))
-      {
-        *iter_x = *iter_y = *iter_z = bad_point;
-      }
-      else
-      {
-        // Fill in XYZ
-        *iter_x = (u - center_x) * depth * constant_x;
-        *iter_y = (v - center_y) * depth * constant_y;
-        *iter_z = DepthTraits<T>::toMeters(depth);
-      }
-
-      // Fill in intensity
-      *iter_i = inten;
-    }
-  }
+  rays_.update(model_, depth_msg->width, depth_msg->height);
+  depth_image_proc::convert<T>(depth_msg, cloud_msg, rays_);
+  convertIntensity<T2>(intensity_msg, cloud_msg);
 }
 
 } // namespace depth_image_proc
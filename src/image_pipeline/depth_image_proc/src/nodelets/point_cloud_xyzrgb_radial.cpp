@@ -42,9 +42,8 @@
 #include <message_filters/sync_policies/exact_time.h>
 #include <message_filters/sync_policies/approximate_time.h>
 #include <image_geometry/pinhole_camera_model.h>
-#include <opencv2/calib3d/calib3d.hpp>
 #include <boost/thread.hpp>
-#include <depth_image_proc/depth_traits.h>
+#include <depth_image_proc/depth_conversions.h>
 
 #include <sensor_msgs/point_cloud2_iterator.h>
 
@@ -77,13 +76,7 @@ namespace depth_image_proc {
 	boost::shared_ptr<Synchronizer> sync_;
 	boost::shared_ptr<ExactSynchronizer> exact_sync_;
 
-	std::vector<double> D_;
-	boost::array<double, 9> K_;
-  
-	int width_;
-	int height_;
-
-	cv::Mat transform_;
+	RayCache rays_;
         image_geometry::PinholeCameraModel model_;
 	
 	virtual void onInit();
@@ -93,60 +86,8 @@ namespace depth_image_proc {
 	void imageCb(const sensor_msgs::ImageConstPtr& depth_msg,
 		     const sensor_msgs::ImageConstPtr& rgb_msg_in,
 		     const sensor_msgs::CameraInfoConstPtr& info_msg);
-
-	// Handles float or uint16 depths
-	template<typename T>
-	void convert_depth(const sensor_msgs::ImageConstPtr& depth_msg, PointCloud::Ptr& cloud_msg);
-
-	void convert_rgb(const sensor_msgs::ImageConstPtr &rgb_msg, PointCloud::Ptr& cloud_msg,
-	  int red_offset, int green_offset, int blue_offset, int color_step);
-
-	cv::Mat initMatrix(cv::Mat cameraMatrix, cv::Mat distCoeffs, int width, int height, bool radial);
-
     };
 
-    cv::Mat PointCloudXyzRgbRadialNodelet::initMatrix(cv::Mat cameraMatrix, cv::Mat distCoeffs, int width, int height, bool radial)
-    {
-	int i,j;
-	int totalsize = width*height;
-	cv::Mat pixelVectors(1,totalsize,CV_32FC3);
-	cv::Mat dst(1,totalsize,CV_32FC3);
-
-	cv::Mat sensorPoints(cv::Size(height,width), CV_32FC2);
-	cv::Mat undistortedSensorPoints(1,totalsize, CV_32FC2);
-
-	std::vector<cv::Mat> ch;
-	for(j = 0; j < height; j++)
-	{
-	    for(i = 0; i < width; i++)
-	    {
-		cv::Vec2f &p = sensorPoints.at<cv::Vec2f>(i,j);
-		p[0] = i;
-		p[1] = j;
-	    }
-	}
-
-	sensorPoints = sensorPoints.reshape(2,1);
-
-	cv::undistortPoints(sensorPoints, undistortedSensorPoints, cameraMatrix, distCoeffs);
-
-	ch.push_back(undistortedSensorPoints);
-	ch.push_back(cv::Mat::ones(1,totalsize,CV_32FC1));
-	cv::merge(ch,pixelVectors);
-
-	if(radial)
-	{
-	    for(i = 0; i < totalsize; i++)
-	    {
-		normalize(pixelVectors.at<cv::Vec3f>(i),
-			  dst.at<cv::Vec3f>(i));
-	    }
-	    pixelVectors = dst;
-	}
-	return pixelVectors.reshape(3,width);
-    }
-  
-
     void PointCloudXyzRgbRadialNodelet::onInit()
     {
 	NODELET_INFO("INIT XYZRGB RADIAL");
@@ -290,23 +231,15 @@ namespace depth_image_proc {
   }
 
 
-	if(info_msg->D != D_ || info_msg->K != K_ || width_ != info_msg->width ||
-	   height_ != info_msg->height)
-	{
-	    D_ = info_msg->D;
-	    K_ = info_msg->K;
-	    width_ = info_msg->width;
-	    height_ = info_msg->height;
-	    transform_ = initMatrix(cv::Mat_<double>(3, 3, &K_[0]),cv::Mat(D_),width_,height_,true);
-	}
+	rays_.update(info_msg->K, info_msg->D, depth_msg->width, depth_msg->height);
 
 	if (depth_msg->encoding == enc::TYPE_16UC1)
 	{
-	    convert_depth<uint16_t>(depth_msg, cloud_msg);
+	    convert<uint16_t>(depth_msg, cloud_msg, rays_);
 	}
 	else if (depth_msg->encoding == enc::TYPE_32FC1)
 	{
-	    convert_depth<float>(depth_msg, cloud_msg);
+	    convert<float>(depth_msg, cloud_msg, rays_);
 	}
 	else
 	{
@@ -321,7 +254,7 @@ namespace depth_image_proc {
 		green_offset = 1;
 		blue_offset = 2;
 		color_step = 3;
-	    convert_rgb(rgb_msg, cloud_msg, red_offset, green_offset, blue_offset, color_step);
+	    convertRgb(rgb_msg, cloud_msg, red_offset, green_offset, blue_offset, color_step);
 
 	}
 	if(rgb_msg->encoding == enc::RGBA8)
@@ -330,7 +263,7 @@ namespace depth_image_proc {
 		green_offset = 1;
 		blue_offset = 2;
 		color_step = 4;
-	    convert_rgb(rgb_msg, cloud_msg, red_offset, green_offset, blue_offset, color_step);
+	    convertRgb(rgb_msg, cloud_msg, red_offset, green_offset, blue_offset, color_step);
 	}
 	else if(rgb_msg->encoding == enc::BGR8)
 	{
@@ -338,7 +271,7 @@ namespace depth_image_proc {
 		green_offset = 1;
 		blue_offset = 0;
 		color_step = 3;
-	    convert_rgb(rgb_msg, cloud_msg, red_offset, green_offset, blue_offset, color_step);
+	    convertRgb(rgb_msg, cloud_msg, red_offset, green_offset, blue_offset, color_step);
 	}
 	else if(rgb_msg->encoding == enc::BGRA8)
 	{
@@ -346,7 +279,7 @@ namespace depth_image_proc {
 		green_offset = 1;
 		blue_offset = 0;
 		color_step = 4;
-	    convert_rgb(rgb_msg, cloud_msg, red_offset, green_offset, blue_offset, color_step);
+	    convertRgb(rgb_msg, cloud_msg, red_offset, green_offset, blue_offset, color_step);
 	}
 	else if(rgb_msg->encoding == enc::MONO8)
 	{
@@ -354,7 +287,7 @@ namespace depth_image_proc {
 		green_offset = 0;
 		blue_offset = 0;
 		color_step = 1;
-	    convert_rgb(rgb_msg, cloud_msg, red_offset, green_offset, blue_offset, color_step);
+	    convertRgb(rgb_msg, cloud_msg, red_offset, green_offset, blue_offset, color_step);
 	}
 	else
 	{
@@ -365,63 +298,6 @@ namespace depth_image_proc {
 	pub_point_cloud_.publish (cloud_msg);
     }
 
-    template<typename T>
-    void PointCloudXyzRgbRadialNodelet::convert_depth(const sensor_msgs::ImageConstPtr& depth_msg,
-						    PointCloud::Ptr& cloud_msg)
-    {
-	// Combine unit conversion (if necessary) with scaling by focal length for computing (X,Y)
-	double unit_scaling = DepthTraits<T>::toMeters( T(1) );
-	float bad_point = std::numeric_limits<float>::quiet_NaN();
-
-	sensor_msgs::PointCloud2Iterator<float> iter_x(*cloud_msg, "x");
-	sensor_msgs::PointCloud2Iterator<float> iter_y(*cloud_msg, "y");
-	sensor_msgs::PointCloud2Iterator<float> iter_z(*cloud_msg, "z");
-	const T* depth_row = reinterpret_cast<const T*>(&depth_msg->data[0]);
-    
-	int row_step   = depth_msg->step / sizeof(T);
-	for (int v = 0; v < (int)cloud_msg->height; ++v, depth_row += row_step)
-	{
-	    for (int u = 0; u < (int)cloud_msg->width; ++u, ++iter_x, ++iter_y, ++iter_z)
-	    {
-		T depth = depth_row[u];
-
-		// Missing points denoted by NaNs
-		if (!DepthTraits<T>::valid(depth))
-		{
-		    *iter_x = *iter_y = *iter_z = bad_point;
-		    continue;
-		}
-		const cv::Vec3f &cvPoint = transform_.at<cv::Vec3f>(u,v) * DepthTraits<T>::toMeters(depth);
-		// Fill in XYZ
-		*iter_x = cvPoint(0);
-		*iter_y = cvPoint(1);
-		*iter_z = cvPoint(2);
-	    }
-	}
-    }
-
-    void PointCloudXyzRgbRadialNodelet::convert_rgb(const sensor_msgs::ImageConstPtr& rgb_msg,
-							PointCloud::Ptr& cloud_msg,
-							int red_offset, int green_offset, int blue_offset, int color_step)
-    {
-	sensor_msgs::PointCloud2Iterator<uint8_t> iter_r(*cloud_msg, "r");
-	sensor_msgs::PointCloud2Iterator<uint8_t> iter_g(*cloud_msg, "g");
-        sensor_msgs::PointCloud2Iterator<uint8_t> iter_b(*cloud_msg, "b");
-
-	const uint8_t* rgb = &rgb_msg->data[0];
-	int rgb_skip = rgb_msg->step - rgb_msg->width * color_step;
-	
-	for (int v = 0; v < (int)cloud_msg->height; ++v, rgb += rgb_skip)
-	{
-	    for (int u = 0; u < (int)cloud_msg->width; ++u, rgb += color_step, ++iter_r, ++iter_g, ++iter_b)
-	    {
-		*iter_r = rgb[red_offset];
-		*iter_g = rgb[green_offset];
-		*iter_b = rgb[blue_offset];
-	    }
-	}
-    }
-
 } // namespace depth_image_proc
 
 // Register as nodelet
@@ -45,6 +45,12 @@
 #include <Eigen/Geometry>
 #include <eigen_conversions/eigen_msg.h>
 #include <depth_image_proc/depth_traits.h>
+#include <depth_image_proc/ray_cache.h>
+#include <opencv2/core/core.hpp>
+
+#include <atomic>
+#include <limits>
+#include <memory>
 
 namespace depth_image_proc {
 
@@ -71,6 +77,12 @@ class RegisterNodelet : public nodelet::Nodelet
 
   image_geometry::PinholeCameraModel depth_model_, rgb_model_;
 
+  // Reprojection state reused across frames
+  boost::mutex convert_mutex_;
+  RayCache depth_rays_;
+  std::unique_ptr<std::atomic<float>[]> zbuffer_;
+  size_t zbuffer_size_;
+
   // Parameters
   bool fill_upsampling_holes_;	// fills holes which occur due to upsampling by scaling each pixel to the target image scale (only takes effect on upsampling)
 
@@ -86,6 +98,9 @@ class RegisterNodelet : public nodelet::Nodelet
   void convert(const sensor_msgs::ImageConstPtr& depth_msg,
                const sensor_msgs::ImagePtr& registered_msg,
                const Eigen::Affine3d& depth_to_rgb);
+
+public:
+  RegisterNodelet() : zbuffer_size_(0) {}
 };
 
 void RegisterNodelet::onInit()
@@ -141,6 +156,8 @@ void RegisterNodelet::imageCb(const sensor_msgs::ImageConstPtr& depth_image_msg,
                               const sensor_msgs::CameraInfoConstPtr& depth_info_msg,
                               const sensor_msgs::CameraInfoConstPtr& rgb_info_msg)
 {
+  boost::lock_guard<boost::mutex> lock(convert_mutex_);
+
   // Update camera models - these take binning & ROI into account
   depth_model_.fromCameraInfo(depth_info_msg);
   rgb_model_  .fromCameraInfo(rgb_info_msg);
@@ -195,113 +212,200 @@ void RegisterNodelet::imageCb(const sensor_msgs::ImageConstPtr& depth_image_msg,
   pub_registered_.publish(registered_msg, registered_info_msg);
 }
 
+namespace {
+
+// Lower *slot to z if z is nearer; bands running in parallel may hit the same pixel.
+inline void zbufferMin(std::atomic<float>& slot, float z)
+{
+  float current = slot.load(std::memory_order_relaxed);
+  while (z < current && !slot.compare_exchange_weak(current, z, std::memory_order_relaxed))
+    ;
+}
+
+// Reprojects bands of depth rows into the z-buffer of the RGB image. Each depth row is
+// transformed as whole float arrays, so the arithmetic vectorizes; only the z-buffer scatter is
+// done per pixel.
 template<typename T>
-void RegisterNodelet::convert(const sensor_msgs::ImageConstPtr& depth_msg,
-                              const sensor_msgs::ImagePtr& registered_msg,
-                              const Eigen::Affine3d& depth_to_rgb)
+class ReprojectRows : public cv::ParallelLoopBody
 {
-  // Allocate memory for registered depth image
-  registered_msg->step = registered_msg->width * sizeof(T);
-  registered_msg->data.resize( registered_msg->height * registered_msg->step );
-  // data is already zero-filled in the uint16 case, but for floats we want to initialize everything to NaN.
-  DepthTraits<T>::initializeBuffer(registered_msg->data);
+public:
+  ReprojectRows(const sensor_msgs::Image& depth, const RayCache& rays,
+                const image_geometry::PinholeCameraModel& depth_model,
+                const image_geometry::PinholeCameraModel& rgb_model,
+                const Eigen::Affine3d& depth_to_rgb, bool fill_holes,
+                std::atomic<float>* zbuffer, int rgb_width, int rgb_height)
+    : depth_(depth), rays_(rays), fill_holes_(fill_holes),
+      zbuffer_(zbuffer), rgb_width_(rgb_width), rgb_height_(rgb_height)
+  {
+    // A depth pixel with ray r and depth d lands at d * R * (r, 1) + R * (-Tx/fx, -Ty/fy, 0) + t
+    // in the RGB camera frame.
+    Eigen::Matrix3d R = depth_to_rgb.linear();
+    Eigen::Vector3d offset(-depth_model.Tx() / depth_model.fx(), -depth_model.Ty() / depth_model.fy(), 0.0);
+    R_ = R.cast<float>();
+    t_ = (R * offset + depth_to_rgb.translation()).cast<float>();
+    // Ray change from the pixel center to its corners, for fill_upsampling_holes
+    half_pixel_ = (R * Eigen::Vector3d(0.5 / depth_model.fx(), 0.5 / depth_model.fy(), 0.0)).cast<float>();
+
+    rgb_fx_ = rgb_model.fx();
+    rgb_fy_ = rgb_model.fy();
+    rgb_Tx_ = rgb_model.Tx();
+    rgb_Ty_ = rgb_model.Ty();
+    // The 0.5 rounds to the nearest pixel when truncating
+    rgb_cx_ = rgb_model.cx() + 0.5;
+    rgb_cy_ = rgb_model.cy() + 0.5;
+  }
 
-  // Extract all the parameters we need
-  double inv_depth_fx = 1.0 / depth_model_.fx();
-  double inv_depth_fy = 1.0 / depth_model_.fy();
-  double depth_cx = depth_model_.cx(), depth_cy = depth_model_.cy();
-  double depth_Tx = depth_model_.Tx(), depth_Ty = depth_model_.Ty();
-  double rgb_fx = rgb_model_.fx(), rgb_fy = rgb_model_.fy();
-  double rgb_cx = rgb_model_.cx(), rgb_cy = rgb_model_.cy();
-  double rgb_Tx = rgb_model_.Tx(), rgb_Ty = rgb_model_.Ty();
-  
-  // Transform the depth values into the RGB frame
-  /// @todo When RGB is higher res, interpolate by rasterizing depth triangles onto the registered image  
-  const T* depth_row = reinterpret_cast<const T*>(&depth_msg->data[0]);
-  int row_step = depth_msg->step / sizeof(T);
-  T* registered_data = reinterpret_cast<T*>(&registered_msg->data[0]);
-  int raw_index = 0;
-  for (unsigned v = 0; v < depth_msg->height; ++v, depth_row += row_step)
+  virtual void operator()(const cv::Range& range) const
   {
-    for (unsigned u = 0; u < depth_msg->width; ++u, ++raw_index)
+    const int width = depth_.width;
+    Eigen::ArrayXf d(width), x(width), y(width), z(width), u_rgb(width), v_rgb(width);
+    Eigen::ArrayXf z_1, z_2, u_rgb_2, v_rgb_2;
+    if (fill_holes_)
+    {
+      z_1.resize(width);
+      z_2.resize(width);
+      u_rgb_2.resize(width);
+      v_rgb_2.resize(width);
+    }
+
+    for (int v = range.start; v < range.end; ++v)
     {
-      T raw_depth = depth_row[u];
-      if (!DepthTraits<T>::valid(raw_depth))
-        continue;
-      
-      double depth = DepthTraits<T>::toMeters(raw_depth);
+      const T* depth_row = reinterpret_cast<const T*>(&depth_.data[v * depth_.step]);
+      for (int u = 0; u < width; ++u)
+      {
+        T raw_depth = depth_row[u];
+        d[u] = DepthTraits<T>::valid(raw_depth) ? DepthTraits<T>::toMeters(raw_depth)
+                                                : std::numeric_limits<float>::quiet_NaN();
+      }
+
+      Eigen::Map<const Eigen::ArrayXf> ray_x(rays_.x(v), width), ray_y(rays_.y(v), width);
+      x = d * (R_(0,0) * ray_x + R_(0,1) * ray_y + R_(0,2)) + t_.x();
+      y = d * (R_(1,0) * ray_x + R_(1,1) * ray_y + R_(1,2)) + t_.y();
+      z = d * (R_(2,0) * ray_x + R_(2,1) * ray_y + R_(2,2)) + t_.z();
 
-      if (fill_upsampling_holes_ == false)
+      if (!fill_holes_)
       {
-        /// @todo Combine all operations into one matrix multiply on (u,v,d)
-        // Reproject (u,v,Z) to (X,Y,Z,1) in depth camera frame
-        Eigen::Vector4d xyz_depth;
-        xyz_depth << ((u - depth_cx)*depth - depth_Tx) * inv_depth_fx,
-                     ((v - depth_cy)*depth - depth_Ty) * inv_depth_fy,
-                     depth,
-                     1;
-
-        // Transform to RGB camera frame
-        Eigen::Vector4d xyz_rgb = depth_to_rgb * xyz_depth;
-
-        // Project to (u,v) in RGB image
-        double inv_Z = 1.0 / xyz_rgb.z();
-        int u_rgb = (rgb_fx*xyz_rgb.x() + rgb_Tx)*inv_Z + rgb_cx + 0.5;
-        int v_rgb = (rgb_fy*xyz_rgb.y() + rgb_Ty)*inv_Z + rgb_cy + 0.5;
-      
-        if (u_rgb < 0 || u_rgb >= (int)registered_msg->width ||
-            v_rgb < 0 || v_rgb >= (int)registered_msg->height)
-          continue;
-      
-        T& reg_depth = registered_data[v_rgb*registered_msg->width + u_rgb];
-        T  new_depth = DepthTraits<T>::fromMeters(xyz_rgb.z());
-        // Validity and Z-buffer checks
-        if (!DepthTraits<T>::valid(reg_depth) || reg_depth > new_depth)
-          reg_depth = new_depth;
+        u_rgb = (rgb_fx_ * x + rgb_Tx_) / z + rgb_cx_;
+        v_rgb = (rgb_fy_ * y + rgb_Ty_) / z + rgb_cy_;
+
+        for (int u = 0; u < width; ++u)
+        {
+          // Also rejects invalid depths, which are NaN throughout
+          if (!(z[u] > 0.0f && inImage(u_rgb[u], v_rgb[u])))
+            continue;
+          zbufferMin(zbuffer_[(int)v_rgb[u] * rgb_width_ + (int)u_rgb[u]], z[u]);
+        }
       }
       else
       {
-        // Reproject (u,v,Z) to (X,Y,Z,1) in depth camera frame
-        Eigen::Vector4d xyz_depth_1, xyz_depth_2;
-        xyz_depth_1 << ((u-0.5f - depth_cx)*depth - depth_Tx) * inv_depth_fx,
-                       ((v-0.5f - depth_cy)*depth - depth_Ty) * inv_depth_fy,
-                       depth,
-                       1;
-        xyz_depth_2 << ((u+0.5f - depth_cx)*depth - depth_Tx) * inv_depth_fx,
-                       ((v+0.5f - depth_cy)*depth - depth_Ty) * inv_depth_fy,
-                       depth,
-                       1;
-
-        // Transform to RGB camera frame
-        Eigen::Vector4d xyz_rgb_1 = depth_to_rgb * xyz_depth_1;
-        Eigen::Vector4d xyz_rgb_2 = depth_to_rgb * xyz_depth_2;
-
-        // Project to (u,v) in RGB image
-        double inv_Z = 1.0 / xyz_rgb_1.z();
-        int u_rgb_1 = (rgb_fx*xyz_rgb_1.x() + rgb_Tx)*inv_Z + rgb_cx + 0.5;
-        int v_rgb_1 = (rgb_fy*xyz_rgb_1.y() + rgb_Ty)*inv_Z + rgb_cy + 0.5;
-        inv_Z = 1.0 / xyz_rgb_2.z();
-        int u_rgb_2 = (rgb_fx*xyz_rgb_2.x() + rgb_Tx)*inv_Z + rgb_cx + 0.5;
-        int v_rgb_2 = (rgb_fy*xyz_rgb_2.y() + rgb_Ty)*inv_Z + rgb_cy + 0.5;
-
-        if (u_rgb_1 < 0 || u_rgb_2 >= (int)registered_msg->width ||
-            v_rgb_1 < 0 || v_rgb_2 >= (int)registered_msg->height)
-          continue;
-
-        for (int nv=v_rgb_1; nv<=v_rgb_2; ++nv)
+        // Project the top-left and bottom-right corners of each depth pixel, and splat its
+        // depth over the RGB pixels between them.
+        z_1 = z - d * half_pixel_.z();
+        u_rgb = (rgb_fx_ * (x - d * half_pixel_.x()) + rgb_Tx_) / z_1 + rgb_cx_;
+        v_rgb = (rgb_fy_ * (y - d * half_pixel_.y()) + rgb_Ty_) / z_1 + rgb_cy_;
+        z_2 = z + d * half_pixel_.z();
+        u_rgb_2 = (rgb_fx_ * (x + d * half_pixel_.x()) + rgb_Tx_) / z_2 + rgb_cx_;
+        v_rgb_2 = (rgb_fy_ * (y + d * half_pixel_.y()) + rgb_Ty_) / z_2 + rgb_cy_;
+
+        for (int u = 0; u < width; ++u)
         {
-          for (int nu=u_rgb_1; nu<=u_rgb_2; ++nu)
+          if (!(z[u] > 0.0f && inImage(u_rgb[u], v_rgb[u]) && inImage(u_rgb_2[u], v_rgb_2[u])))
+            continue;
+          for (int nv = (int)v_rgb[u]; nv <= (int)v_rgb_2[u]; ++nv)
           {
-            T& reg_depth = registered_data[nv*registered_msg->width + nu];
-            T  new_depth = DepthTraits<T>::fromMeters(0.5*(xyz_rgb_1.z()+xyz_rgb_2.z()));
-            // Validity and Z-buffer checks
-            if (!DepthTraits<T>::valid(reg_depth) || reg_depth > new_depth)
-              reg_depth = new_depth;
+            std::atomic<float>* zbuffer_row = zbuffer_ + nv * rgb_width_;
+            for (int nu = (int)u_rgb[u]; nu <= (int)u_rgb_2[u]; ++nu)
+              zbufferMin(zbuffer_row[nu], z[u]);
           }
         }
       }
     }
   }
+
+private:
+  // Whether (u,v) truncates to a pixel of the RGB image; false for NaN
+  bool inImage(float u, float v) const
+  {
+    return u > -1.0f && u < rgb_width_ && v > -1.0f && v < rgb_height_;
+  }
+
+  const sensor_msgs::Image& depth_;
+  const RayCache& rays_;
+  bool fill_holes_;
+  std::atomic<float>* zbuffer_;
+  int rgb_width_, rgb_height_;
+  Eigen::Matrix3f R_;
+  Eigen::Vector3f t_, half_pixel_;
+  float rgb_fx_, rgb_fy_, rgb_cx_, rgb_cy_, rgb_Tx_, rgb_Ty_;
+};
+
+// Copies the z-buffer into the registered image and clears it for the next frame.
+template<typename T>
+class ResolveRows : public cv::ParallelLoopBody
+{
+public:
+  ResolveRows(std::atomic<float>* zbuffer, sensor_msgs::Image& registered)
+    : zbuffer_(zbuffer), registered_(registered)
+  {
+  }
+
+  virtual void operator()(const cv::Range& range) const
+  {
+    const float empty = std::numeric_limits<float>::infinity();
+    const int width = registered_.width;
+    for (int v = range.start; v < range.end; ++v)
+    {
+      std::atomic<float>* zbuffer_row = zbuffer_ + v * width;
+      T* registered_row = reinterpret_cast<T*>(&registered_.data[v * registered_.step]);
+      for (int u = 0; u < width; ++u)
+      {
+        float z = zbuffer_row[u].load(std::memory_order_relaxed);
+        if (z != empty)
+        {
+          registered_row[u] = DepthTraits<T>::fromMeters(z);
+          zbuffer_row[u].store(empty, std::memory_order_relaxed);
+        }
+      }
+    }
+  }
+
+private:
+  std::atomic<float>* zbuffer_;
+  sensor_msgs::Image& registered_;
+};
+
+} // namespace
+
+template<typename T>
+void RegisterNodelet::convert(const sensor_msgs::ImageConstPtr& depth_msg,
+                              const sensor_msgs::ImagePtr& registered_msg,
+                              const Eigen::Affine3d& depth_to_rgb)
+{
+  // Allocate memory for registered depth image
+  registered_msg->step = registered_msg->width * sizeof(T);
+  registered_msg->data.resize( registered_msg->height * registered_msg->step );
+  // data is already zero-filled in the uint16 case, but for floats we want to initialize everything to NaN.
+  DepthTraits<T>::initializeBuffer(registered_msg->data);
+
+  // Z-buffer of depths in meters, +inf where nothing has landed. ResolveRows leaves it cleared.
+  size_t zbuffer_size = registered_msg->width * registered_msg->height;
+  if (zbuffer_size != zbuffer_size_)
+  {
+    zbuffer_.reset(new std::atomic<float>[zbuffer_size]);
+    zbuffer_size_ = zbuffer_size;
+    for (size_t i = 0; i < zbuffer_size; ++i)
+      zbuffer_[i].store(std::numeric_limits<float>::infinity(), std::memory_order_relaxed);
+  }
+
+  depth_rays_.update(depth_model_, depth_msg->width, depth_msg->height);
+
+  /// @todo When RGB is higher res, interpolate by rasterizing depth triangles onto the registered image
+  cv::parallel_for_(cv::Range(0, depth_msg->height),
+                    ReprojectRows<T>(*depth_msg, depth_rays_, depth_model_, rgb_model_, depth_to_rgb,
+                                     fill_upsampling_holes_, zbuffer_.get(),
+                                     registered_msg->width, registered_msg->height));
+  cv::parallel_for_(cv::Range(0, registered_msg->height),
+                    ResolveRows<T>(zbuffer_.get(), *registered_msg));
 }
 
 } // namespace depth_image_proc
@@ -0,0 +1,309 @@
+#include <gtest/gtest.h>
+#include <opencv2/core/core.hpp>
+#include <opencv2/calib3d/calib3d.hpp>
+#include <sensor_msgs/CameraInfo.h>
+#include <sensor_msgs/image_encodings.h>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <string>
+#include <vector>
+
+#include "depth_image_proc/depth_conversions.h"
+
+// Checks the point clouds built from a RayCache against the per-pixel computations the nodelets
+// used before the rays were cached.
+
+using namespace depth_image_proc;
+namespace enc = sensor_msgs::image_encodings;
+
+namespace
+{
+
+const int WIDTH = 32;
+const int HEIGHT = 24;
+
+sensor_msgs::CameraInfo makeInfo(int width, int height, double fx, double fy, double cx, double cy,
+                                 const std::vector<double>& D)
+{
+  sensor_msgs::CameraInfo info;
+  info.width = width;
+  info.height = height;
+  info.distortion_model = "plumb_bob";
+  info.D = D;
+  double K[9] = { fx, 0.0, cx, 0.0, fy, cy, 0.0, 0.0, 1.0 };
+  double R[9] = { 1.0, 0.0, 0.0, 0.0, 1.0, 0.0, 0.0, 0.0, 1.0 };
+  double P[12] = { fx, 0.0, cx, 0.0, 0.0, fy, cy, 0.0, 0.0, 0.0, 1.0, 0.0 };
+  std::copy(K, K + 9, info.K.begin());
+  std::copy(R, R + 9, info.R.begin());
+  std::copy(P, P + 12, info.P.begin());
+  return info;
+}
+
+std::vector<double> noDistortion()
+{
+  return std::vector<double>(5, 0.0);
+}
+
+std::vector<double> barrelDistortion()
+{
+  double D[5] = { -0.25, 0.08, 0.001, -0.002, 0.0 };
+  return std::vector<double>(D, D + 5);
+}
+
+image_geometry::PinholeCameraModel makeModel(const sensor_msgs::CameraInfo& info)
+{
+  image_geometry::PinholeCameraModel model;
+  model.fromCameraInfo(info);
+  return model;
+}
+
+// Depths between 0.5m and 4.5m, with missing ones (0 or NaN) scattered through the image and
+// along the whole first row
+template<typename T>
+sensor_msgs::ImagePtr makeDepth(int width, int height, const std::string& encoding)
+{
+  sensor_msgs::ImagePtr image(new sensor_msgs::Image);
+  image->width = width;
+  image->height = height;
+  image->encoding = encoding;
+  // Padded rows, as the nodelets only rely on step
+  image->step = (width + 3) * sizeof(T);
+  image->data.resize(image->step * height);
+
+  uint32_t state = 11;
+  for (int v = 0; v < height; ++v)
+  {
+    T* row = reinterpret_cast<T*>(&image->data[v * image->step]);
+    for (int u = 0; u < width; ++u)
+    {
+      state = state * 1664525u + 1013904223u;
+      float meters = 0.5f + (state >> 8) * (4.0f / (1 << 24));
+      if (v == 0 || (state >> 4) % 7 == 0)
+        row[u] = std::numeric_limits<T>::has_quiet_NaN ? std::numeric_limits<T>::quiet_NaN() : T(0);
+      else
+        row[u] = DepthTraits<T>::fromMeters(meters);
+    }
+  }
+  return image;
+}
+
+PointCloud::Ptr makeCloud(int width, int height)
+{
+  PointCloud::Ptr cloud(new PointCloud);
+  cloud->height = height;
+  cloud->width = width;
+  cloud->is_dense = false;
+  cloud->is_bigendian = false;
+  sensor_msgs::PointCloud2Modifier pcd_modifier(*cloud);
+  pcd_modifier.setPointCloud2FieldsByString(1, "xyz");
+  return cloud;
+}
+
+// The unit-length ray through pixel (u,v), as initMatrix() of the radial nodelets computed it
+cv::Vec3f radialRay(const boost::array<double, 9>& K, const std::vector<double>& D, int u, int v)
+{
+  cv::Mat pixel(1, 1, CV_32FC2, cv::Scalar(u, v)), undistorted;
+  cv::undistortPoints(pixel, undistorted, cv::Mat_<double>(3, 3, const_cast<double*>(&K[0])), cv::Mat(D));
+  const cv::Vec2f& p = undistorted.at<cv::Vec2f>(0);
+  cv::Vec3f ray(p[0], p[1], 1.0f), unit;
+  cv::normalize(ray, unit);
+  return unit;
+}
+
+// Per-pixel radial conversion of the original nodelets, with the rays of K and D
+template<typename T>
+void convertRadial(const sensor_msgs::ImageConstPtr& depth_msg, PointCloud::Ptr& cloud_msg,
+                   const boost::array<double, 9>& K, const std::vector<double>& D)
+{
+  float bad_point = std::numeric_limits<float>::quiet_NaN();
+  sensor_msgs::PointCloud2Iterator<float> iter_x(*cloud_msg, "x");
+  sensor_msgs::PointCloud2Iterator<float> iter_y(*cloud_msg, "y");
+  sensor_msgs::PointCloud2Iterator<float> iter_z(*cloud_msg, "z");
+  const T* depth_row = reinterpret_cast<const T*>(&depth_msg->data[0]);
+  int row_step = depth_msg->step / sizeof(T);
+  for (int v = 0; v < (int)cloud_msg->height; ++v, depth_row += row_step)
+  {
+    for (int u = 0; u < (int)cloud_msg->width; ++u, ++iter_x, ++iter_y, ++iter_z)
+    {
+      T depth = depth_row[u];
+      if (!DepthTraits<T>::valid(depth))
+      {
+        *iter_x = *iter_y = *iter_z = bad_point;
+        continue;
+      }
+      cv::Vec3f point = radialRay(K, D, u, v) * DepthTraits<T>::toMeters(depth);
+      *iter_x = point(0);
+      *iter_y = point(1);
+      *iter_z = point(2);
+    }
+  }
+}
+
+void expectSameCloud(const PointCloud& expected, const PointCloud& actual)
+{
+  ASSERT_EQ(expected.width, actual.width);
+  ASSERT_EQ(expected.height, actual.height);
+  sensor_msgs::PointCloud2ConstIterator<float> expected_xyz(expected, "x");
+  sensor_msgs::PointCloud2ConstIterator<float> actual_xyz(actual, "x");
+  for (size_t i = 0; i < expected.width * expected.height; ++i, ++expected_xyz, ++actual_xyz)
+  {
+    for (int c = 0; c < 3; ++c)
+    {
+      if (std::isnan(expected_xyz[c]))
+      {
+        EXPECT_TRUE(std::isnan(actual_xyz[c])) << "point " << i << " component " << c;
+      }
+      else
+      {
+        EXPECT_NEAR(expected_xyz[c], actual_xyz[c], 1e-5 + 1e-5 * std::abs(expected_xyz[c]))
+          << "point " << i << " component " << c;
+      }
+    }
+  }
+}
+
+template<typename T>
+void checkRectified(const std::string& encoding, double range_max)
+{
+  sensor_msgs::CameraInfo info = makeInfo(WIDTH, HEIGHT, 40.0, 42.0, 15.5, 11.5, noDistortion());
+  image_geometry::PinholeCameraModel model = makeModel(info);
+  sensor_msgs::ImagePtr depth = makeDepth<T>(WIDTH, HEIGHT, encoding);
+
+  PointCloud::Ptr expected = makeCloud(WIDTH, HEIGHT);
+  convert<T>(depth, expected, model, range_max);
+
+  RayCache rays;
+  EXPECT_TRUE(rays.update(model, WIDTH, HEIGHT));
+  PointCloud::Ptr actual = makeCloud(WIDTH, HEIGHT);
+  convert<T>(depth, actual, rays, range_max);
+  expectSameCloud(*expected, *actual);
+}
+
+template<typename T>
+void checkRadial(const std::string& encoding)
+{
+  sensor_msgs::CameraInfo info = makeInfo(WIDTH, HEIGHT, 40.0, 42.0, 15.5, 11.5, barrelDistortion());
+  sensor_msgs::ImagePtr depth = makeDepth<T>(WIDTH, HEIGHT, encoding);
+
+  PointCloud::Ptr expected = makeCloud(WIDTH, HEIGHT);
+  convertRadial<T>(depth, expected, info.K, info.D);
+
+  RayCache rays;
+  EXPECT_TRUE(rays.update(info.K, info.D, WIDTH, HEIGHT));
+  PointCloud::Ptr actual = makeCloud(WIDTH, HEIGHT);
+  convert<T>(depth, actual, rays);
+  expectSameCloud(*expected, *actual);
+}
+
+} // namespace
+
+TEST(DepthConversions, rectified)
+{
+  checkRectified<uint16_t>(enc::TYPE_16UC1, 0.0);
+  checkRectified<float>(enc::TYPE_32FC1, 0.0);
+}
+
+TEST(DepthConversions, rectifiedRangeMax)
+{
+  checkRectified<uint16_t>(enc::TYPE_16UC1, 5.0);
+  checkRectified<float>(enc::TYPE_32FC1, 5.0);
+}
+
+TEST(DepthConversions, radial)
+{
+  checkRadial<uint16_t>(enc::TYPE_16UC1);
+  checkRadial<float>(enc::TYPE_32FC1);
+}
+
+TEST(DepthConversions, radialRaysHaveUnitLength)
+{
+  sensor_msgs::CameraInfo info = makeInfo(WIDTH, HEIGHT, 40.0, 42.0, 15.5, 11.5, barrelDistortion());
+  RayCache rays;
+  rays.update(info.K, info.D, WIDTH, HEIGHT);
+  for (int v = 0; v < HEIGHT; ++v)
+  {
+    for (int u = 0; u < WIDTH; ++u)
+    {
+      float x = rays.x(v)[u], y = rays.y(v)[u], z = rays.z(v)[u];
+      EXPECT_NEAR(1.0f, std::sqrt(x * x + y * y + z * z), 1e-6);
+    }
+  }
+}
+
+TEST(DepthConversions, rectifiedCalibrationChange)
+{
+  sensor_msgs::ImagePtr depth = makeDepth<float>(WIDTH, HEIGHT, enc::TYPE_32FC1);
+  image_geometry::PinholeCameraModel model =
+    makeModel(makeInfo(WIDTH, HEIGHT, 40.0, 42.0, 15.5, 11.5, noDistortion()));
+
+  RayCache rays;
+  EXPECT_TRUE(rays.update(model, WIDTH, HEIGHT));
+  EXPECT_FALSE(rays.update(model, WIDTH, HEIGHT));
+  EXPECT_FALSE(rays.update(makeModel(makeInfo(WIDTH, HEIGHT, 40.0, 42.0, 15.5, 11.5, noDistortion())),
+                           WIDTH, HEIGHT));
+
+  // A new focal length and principal point rebuild the rays
+  image_geometry::PinholeCameraModel changed =
+    makeModel(makeInfo(WIDTH, HEIGHT, 55.0, 50.0, 16.0, 12.0, noDistortion()));
+  EXPECT_TRUE(rays.update(changed, WIDTH, HEIGHT));
+  PointCloud::Ptr expected = makeCloud(WIDTH, HEIGHT);
+  convert<float>(depth, expected, changed);
+  PointCloud::Ptr actual = makeCloud(WIDTH, HEIGHT);
+  convert<float>(depth, actual, rays);
+  expectSameCloud(*expected, *actual);
+
+  // So does a new image size
+  sensor_msgs::ImagePtr binned = makeDepth<float>(WIDTH / 2, HEIGHT / 2, enc::TYPE_32FC1);
+  EXPECT_TRUE(rays.update(changed, WIDTH / 2, HEIGHT / 2));
+  EXPECT_EQ(WIDTH / 2, rays.width());
+  EXPECT_EQ(HEIGHT / 2, rays.height());
+  expected = makeCloud(WIDTH / 2, HEIGHT / 2);
+  convert<float>(binned, expected, changed);
+  actual = makeCloud(WIDTH / 2, HEIGHT / 2);
+  convert<float>(binned, actual, rays);
+  expectSameCloud(*expected, *actual);
+}
+
+TEST(DepthConversions, radialCalibrationChange)
+{
+  sensor_msgs::ImagePtr depth = makeDepth<uint16_t>(WIDTH, HEIGHT, enc::TYPE_16UC1);
+  sensor_msgs::CameraInfo info = makeInfo(WIDTH, HEIGHT, 40.0, 42.0, 15.5, 11.5, barrelDistortion());
+
+  RayCache rays;
+  EXPECT_TRUE(rays.update(info.K, info.D, WIDTH, HEIGHT));
+  EXPECT_FALSE(rays.update(info.K, info.D, WIDTH, HEIGHT));
+
+  // New distortion coefficients rebuild the rays
+  sensor_msgs::CameraInfo changed = info;
+  changed.D[0] = -0.1;
+  changed.D[1] = 0.02;
+  EXPECT_TRUE(rays.update(changed.K, changed.D, WIDTH, HEIGHT));
+  PointCloud::Ptr expected = makeCloud(WIDTH, HEIGHT);
+  convertRadial<uint16_t>(depth, expected, changed.K, changed.D);
+  PointCloud::Ptr actual = makeCloud(WIDTH, HEIGHT);
+  convert<uint16_t>(depth, actual, rays);
+  expectSameCloud(*expected, *actual);
+
+  // So does a new camera matrix
+  changed.K[0] = 60.0;
+  changed.K[2] = 14.0;
+  EXPECT_TRUE(rays.update(changed.K, changed.D, WIDTH, HEIGHT));
+  expected = makeCloud(WIDTH, HEIGHT);
+  convertRadial<uint16_t>(depth, expected, changed.K, changed.D);
+  actual = makeCloud(WIDTH, HEIGHT);
+  convert<uint16_t>(depth, actual, rays);
+  expectSameCloud(*expected, *actual);
+
+  // Switching between rectified and radial rays of the same size rebuilds them too
+  image_geometry::PinholeCameraModel model = makeModel(changed);
+  EXPECT_TRUE(rays.update(model, WIDTH, HEIGHT));
+  EXPECT_TRUE(rays.update(changed.K, changed.D, WIDTH, HEIGHT));
+}
+
+int main(int argc, char** argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -1,13 +1,13 @@
 /*********************************************************************
 * Software License Agreement (BSD License)
-* 
+*
 *  Copyright (c) 2008, Willow Garage, Inc.
 *  All rights reserved.
-* 
+*
 *  Redistribution and use in source and binary forms, with or without
 *  modification, are permitted provided that the following conditions
 *  are met:
-* 
+*
 *   * Redistributions of source code must retain the above copyright
 *     notice, this list of conditions and the following disclaimer.
 *   * Redistributions in binary form must reproduce the above
@@ -17,7 +17,7 @@
 *   * Neither the name of the Willow Garage nor the names of its
 *     contributors may be used to endorse or promote products derived
 *     from this software without specific prior written permission.
-* 
+*
 *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
 *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
 *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
@@ -31,8 +31,20 @@
 *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
 *  POSSIBILITY OF SUCH DAMAGE.
 *********************************************************************/
+
 #include "edge_aware.h"
 
+#include <algorithm>
+#include <cstdlib>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSSE3__)
+#include <tmmintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
 #define AVG(a,b) (((int)(a) + (int)(b)) >> 1)
 #define AVG3(a,b,c) (((int)(a) + (int)(b) + (int)(c)) / 3)
 #define AVG4(a,b,c,d) (((int)(a) + (int)(b) + (int)(c) + (int)(d)) >> 2)
@@ -41,20 +53,23 @@ using namespace std;
 
 namespace image_proc {
 
-void debayerEdgeAware(const cv::Mat& bayer, cv::Mat& color)
+namespace {
+
+// The image is split into the first two rows, pairs of interior rows (a GRGR row followed by
+// a BGBG row) and the last two rows. Interior row pairs only write their own two output rows,
+// so they are debayered in parallel; their inner pixels use SIMD where the compiler targets it.
+
+// First two rows, which have no row above them
+void debayerTopRows(const cv::Mat& bayer, cv::Mat& color)
 {
   unsigned width = bayer.cols;
-  unsigned height = bayer.rows;
   unsigned rgb_line_step = color.step[0];
-  unsigned rgb_line_skip = rgb_line_step - width * 3;
   int bayer_line_step = bayer.step[0];
   int bayer_line_step2 = bayer_line_step * 2;
 
   unsigned char* rgb_buffer = color.data;
   unsigned char* bayer_pixel = bayer.data;
-  unsigned yIdx, xIdx;
-
-  int dh, dv;
+  unsigned xIdx;
 
   // first two pixel values for first two lines
   // Bayer         0 1 2
@@ -165,297 +180,34 @@ void debayerEdgeAware(const cv::Mat& bayer, cv::Mat& color)
   rgb_buffer[rgb_line_step + 3] = AVG (bayer_pixel[1], bayer_pixel[bayer_line_step2 + 1]);
   rgb_buffer[rgb_line_step + 4] = bayer_pixel[bayer_line_step + 1];
   //rgb_pixel[rgb_line_step + 5] = bayer_pixel[line_step];
-
-  bayer_pixel += bayer_line_step + 2;
-  rgb_buffer += rgb_line_step + 6 + rgb_line_skip;
-  // main processing
-  for (yIdx = 2; yIdx < height - 2; yIdx += 2)
-  {
-    // first two pixel values
-    // Bayer         0 1 2
-    //        -1     b g b
-    //         0     G r g
-    // line_step     b g b
-    // line_step2    g r g
-    
-    rgb_buffer[3] = rgb_buffer[0] = bayer_pixel[1]; // red pixel
-    rgb_buffer[1] = bayer_pixel[0]; // green pixel
-    rgb_buffer[2] = AVG (bayer_pixel[bayer_line_step], bayer_pixel[-bayer_line_step]); // blue;
-    
-    // Bayer         0 1 2
-    //        -1     b g b
-    //         0     g R g
-    // line_step     b g b
-    // line_step2    g r g
-    //rgb_pixel[3] = bayer_pixel[1];
-    rgb_buffer[4] = AVG4 (bayer_pixel[0], bayer_pixel[2], bayer_pixel[bayer_line_step + 1], bayer_pixel[1 - bayer_line_step]);
-    rgb_buffer[5] = AVG4 (bayer_pixel[bayer_line_step], bayer_pixel[bayer_line_step + 2], bayer_pixel[-bayer_line_step], bayer_pixel[2 - bayer_line_step]);
-    
-    // BGBG line
-    // Bayer         0 1 2
-    //         0     g r g
-    // line_step     B g b
-    // line_step2    g r g
-    rgb_buffer[rgb_line_step + 3] = rgb_buffer[rgb_line_step ] = AVG (bayer_pixel[1], bayer_pixel[bayer_line_step2 + 1]);
-    rgb_buffer[rgb_line_step + 1] = AVG3 (bayer_pixel[0], bayer_pixel[bayer_line_step + 1], bayer_pixel[bayer_line_step2]);
-    rgb_buffer[rgb_line_step + 2] = bayer_pixel[bayer_line_step];
-    
-    // pixel (1, 1)  0 1 2
-    //         0     g r g
-    // line_step     b G b
-    // line_step2    g r g
-    //rgb_pixel[rgb_line_step + 3] = AVG( bayer_pixel[1] , bayer_pixel[line_step2+1] );
-    rgb_buffer[rgb_line_step + 4] = bayer_pixel[bayer_line_step + 1];
-    rgb_buffer[rgb_line_step + 5] = AVG (bayer_pixel[bayer_line_step], bayer_pixel[bayer_line_step + 2]);
-    
-    rgb_buffer += 6;
-    bayer_pixel += 2;
-    // continue with rest of the line
-    for (xIdx = 2; xIdx < width - 2; xIdx += 2, rgb_buffer += 6, bayer_pixel += 2)
-    {
-      // GRGR line
-      // Bayer        -1 0 1 2
-      //          -1   g b g b
-      //           0   r G r g
-      //   line_step   g b g b
-      // line_step2    r g r g
-      rgb_buffer[0] = AVG (bayer_pixel[1], bayer_pixel[-1]);
-      rgb_buffer[1] = bayer_pixel[0];
-      rgb_buffer[2] = AVG (bayer_pixel[bayer_line_step], bayer_pixel[-bayer_line_step]);
-      
-      // Bayer        -1 0 1 2
-      //          -1   g b g b
-      //          0    r g R g
-      //  line_step    g b g b
-      // line_step2    r g r g
-      
-      dh = abs (bayer_pixel[0] - bayer_pixel[2]);
-      dv = abs (bayer_pixel[-bayer_line_step + 1] - bayer_pixel[bayer_line_step + 1]);
-      
-      if (dh > dv)
-        rgb_buffer[4] = AVG (bayer_pixel[-bayer_line_step + 1], bayer_pixel[bayer_line_step + 1]);
-      else if (dv > dh)
-        rgb_buffer[4] = AVG (bayer_pixel[0], bayer_pixel[2]);
-      else
-        rgb_buffer[4] = AVG4 (bayer_pixel[-bayer_line_step + 1], bayer_pixel[bayer_line_step + 1], bayer_pixel[0], bayer_pixel[2]);
-      
-      rgb_buffer[3] = bayer_pixel[1];
-      rgb_buffer[5] = AVG4 (bayer_pixel[-bayer_line_step], bayer_pixel[2 - bayer_line_step], bayer_pixel[bayer_line_step], bayer_pixel[bayer_line_step + 2]);
-      
-      // BGBG line
-      // Bayer         -1 0 1 2
-      //         -1     g b g b
-      //          0     r g r g
-      // line_step      g B g b
-      // line_step2     r g r g
-      rgb_buffer[rgb_line_step ] = AVG4 (bayer_pixel[1], bayer_pixel[bayer_line_step2 + 1], bayer_pixel[-1], bayer_pixel[bayer_line_step2 - 1]);
-      rgb_buffer[rgb_line_step + 2] = bayer_pixel[bayer_line_step];
-      
-      dv = abs (bayer_pixel[0] - bayer_pixel[bayer_line_step2]);
-      dh = abs (bayer_pixel[bayer_line_step - 1] - bayer_pixel[bayer_line_step + 1]);
-      
-      if (dv > dh)
-        rgb_buffer[rgb_line_step + 1] = AVG (bayer_pixel[bayer_line_step - 1], bayer_pixel[bayer_line_step + 1]);
-      else if (dh > dv)
-        rgb_buffer[rgb_line_step + 1] = AVG (bayer_pixel[0], bayer_pixel[bayer_line_step2]);
-      else
-        rgb_buffer[rgb_line_step + 1] = AVG4 (bayer_pixel[0], bayer_pixel[bayer_line_step2], bayer_pixel[bayer_line_step - 1], bayer_pixel[bayer_line_step + 1]);
-      
-      // Bayer         -1 0 1 2
-      //         -1     g b g b
-      //          0     r g r g
-      // line_step      g b G b
-      // line_step2     r g r g
-      rgb_buffer[rgb_line_step + 3] = AVG (bayer_pixel[1], bayer_pixel[bayer_line_step2 + 1]);
-      rgb_buffer[rgb_line_step + 4] = bayer_pixel[bayer_line_step + 1];
-      rgb_buffer[rgb_line_step + 5] = AVG (bayer_pixel[bayer_line_step], bayer_pixel[bayer_line_step + 2]);
-    }
-    
-    // last two pixels of the line
-    // last two pixel values for first two lines
-    // GRGR line
-    // Bayer        -1 0 1
-    //           0   r G r
-    //   line_step   g b g
-    // line_step2    r g r
-    rgb_buffer[0] = AVG (bayer_pixel[1], bayer_pixel[-1]);
-    rgb_buffer[1] = bayer_pixel[0];
-    rgb_buffer[rgb_line_step + 5] = rgb_buffer[rgb_line_step + 2] = rgb_buffer[5] = rgb_buffer[2] = bayer_pixel[bayer_line_step];
-    
-    // Bayer        -1 0 1
-    //          0    r g R
-    //  line_step    g b g
-    // line_step2    r g r
-    rgb_buffer[3] = bayer_pixel[1];
-    rgb_buffer[4] = AVG (bayer_pixel[0], bayer_pixel[bayer_line_step + 1]);
-    //rgb_pixel[5] = bayer_pixel[line_step];
-    
-    // BGBG line
-    // Bayer        -1 0 1
-    //          0    r g r
-    //  line_step    g B g
-    // line_step2    r g r
-    rgb_buffer[rgb_line_step ] = AVG4 (bayer_pixel[1], bayer_pixel[bayer_line_step2 + 1], bayer_pixel[-1], bayer_pixel[bayer_line_step2 - 1]);
-    rgb_buffer[rgb_line_step + 1] = AVG4 (bayer_pixel[0], bayer_pixel[bayer_line_step2], bayer_pixel[bayer_line_step - 1], bayer_pixel[bayer_line_step + 1]);
-    //rgb_pixel[rgb_line_step + 2] = bayer_pixel[line_step];
-    
-    // Bayer         -1 0 1
-    //         0      r g r
-    // line_step      g b G
-    // line_step2     r g r
-    rgb_buffer[rgb_line_step + 3] = AVG (bayer_pixel[1], bayer_pixel[bayer_line_step2 + 1]);
-    rgb_buffer[rgb_line_step + 4] = bayer_pixel[bayer_line_step + 1];
-    //rgb_pixel[rgb_line_step + 5] = bayer_pixel[line_step];
-    
-    bayer_pixel += bayer_line_step + 2;
-    rgb_buffer += rgb_line_step + 6 + rgb_line_skip;
-  }
-  
-  //last two lines
-  // Bayer         0 1 2
-  //        -1     b g b
-  //         0     G r g
-  // line_step     b g b
-  
-  rgb_buffer[rgb_line_step + 3] = rgb_buffer[rgb_line_step ] = rgb_buffer[3] = rgb_buffer[0] = bayer_pixel[1]; // red pixel
-  rgb_buffer[1] = bayer_pixel[0]; // green pixel
-  rgb_buffer[rgb_line_step + 2] = rgb_buffer[2] = bayer_pixel[bayer_line_step]; // blue;
-  
-  // Bayer         0 1 2
-  //        -1     b g b
-  //         0     g R g
-  // line_step     b g b
-  //rgb_pixel[3] = bayer_pixel[1];
-  rgb_buffer[4] = AVG4 (bayer_pixel[0], bayer_pixel[2], bayer_pixel[bayer_line_step + 1], bayer_pixel[1 - bayer_line_step]);
-  rgb_buffer[5] = AVG4 (bayer_pixel[bayer_line_step], bayer_pixel[bayer_line_step + 2], bayer_pixel[-bayer_line_step], bayer_pixel[2 - bayer_line_step]);
-  
-  // BGBG line
-  // Bayer         0 1 2
-  //        -1     b g b
-  //         0     g r g
-  // line_step     B g b
-  //rgb_pixel[rgb_line_step    ] = bayer_pixel[1];
-  rgb_buffer[rgb_line_step + 1] = AVG (bayer_pixel[0], bayer_pixel[bayer_line_step + 1]);
-  rgb_buffer[rgb_line_step + 2] = bayer_pixel[bayer_line_step];
-  
-  // Bayer         0 1 2
-  //        -1     b g b
-  //         0     g r g
-  // line_step     b G b
-  //rgb_pixel[rgb_line_step + 3] = AVG( bayer_pixel[1] , bayer_pixel[line_step2+1] );
-  rgb_buffer[rgb_line_step + 4] = bayer_pixel[bayer_line_step + 1];
-  rgb_buffer[rgb_line_step + 5] = AVG (bayer_pixel[bayer_line_step], bayer_pixel[bayer_line_step + 2]);
-  
-  rgb_buffer += 6;
-  bayer_pixel += 2;
-  // rest of the last two lines
-  for (xIdx = 2; xIdx < width - 2; xIdx += 2, rgb_buffer += 6, bayer_pixel += 2)
-  {
-    // GRGR line
-    // Bayer       -1 0 1 2
-    //        -1    g b g b
-    //         0    r G r g
-    // line_step    g b g b
-    rgb_buffer[0] = AVG (bayer_pixel[1], bayer_pixel[-1]);
-    rgb_buffer[1] = bayer_pixel[0];
-    rgb_buffer[2] = AVG (bayer_pixel[bayer_line_step], bayer_pixel[-bayer_line_step]);
-    
-    // Bayer       -1 0 1 2
-    //        -1    g b g b
-    //         0    r g R g
-    // line_step    g b g b
-    rgb_buffer[rgb_line_step + 3] = rgb_buffer[3] = bayer_pixel[1];
-    rgb_buffer[4] = AVG4 (bayer_pixel[0], bayer_pixel[2], bayer_pixel[bayer_line_step + 1], bayer_pixel[1 - bayer_line_step]);
-    rgb_buffer[5] = AVG4 (bayer_pixel[bayer_line_step], bayer_pixel[bayer_line_step + 2], bayer_pixel[-bayer_line_step], bayer_pixel[-bayer_line_step + 2]);
-    
-    // BGBG line
-    // Bayer       -1 0 1 2
-    //        -1    g b g b
-    //         0    r g r g
-    // line_step    g B g b
-    rgb_buffer[rgb_line_step ] = AVG (bayer_pixel[-1], bayer_pixel[1]);
-    rgb_buffer[rgb_line_step + 1] = AVG3 (bayer_pixel[0], bayer_pixel[bayer_line_step - 1], bayer_pixel[bayer_line_step + 1]);
-    rgb_buffer[rgb_line_step + 2] = bayer_pixel[bayer_line_step];
-    
-    
-    // Bayer       -1 0 1 2
-    //        -1    g b g b
-    //         0    r g r g
-    // line_step    g b G b
-    //rgb_pixel[rgb_line_step + 3] = bayer_pixel[1];
-    rgb_buffer[rgb_line_step + 4] = bayer_pixel[bayer_line_step + 1];
-    rgb_buffer[rgb_line_step + 5] = AVG (bayer_pixel[bayer_line_step], bayer_pixel[bayer_line_step + 2]);
-  }
-  
-  // last two pixel values for first two lines
-  // GRGR line
-  // Bayer       -1 0 1
-  //        -1    g b g
-  //         0    r G r
-  // line_step    g b g
-  rgb_buffer[rgb_line_step ] = rgb_buffer[0] = AVG (bayer_pixel[1], bayer_pixel[-1]);
-  rgb_buffer[1] = bayer_pixel[0];
-  rgb_buffer[5] = rgb_buffer[2] = AVG (bayer_pixel[bayer_line_step], bayer_pixel[-bayer_line_step]);
-  
-  // Bayer       -1 0 1
-  //        -1    g b g
-  //         0    r g R
-  // line_step    g b g
-  rgb_buffer[rgb_line_step + 3] = rgb_buffer[3] = bayer_pixel[1];
-  rgb_buffer[4] = AVG3 (bayer_pixel[0], bayer_pixel[bayer_line_step + 1], bayer_pixel[-bayer_line_step + 1]);
-  //rgb_pixel[5] = AVG( bayer_pixel[line_step], bayer_pixel[-line_step] );
-  
-  // BGBG line
-  // Bayer       -1 0 1
-  //        -1    g b g
-  //         0    r g r
-  // line_step    g B g
-  //rgb_pixel[rgb_line_step    ] = AVG2( bayer_pixel[-1], bayer_pixel[1] );
-  rgb_buffer[rgb_line_step + 1] = AVG3 (bayer_pixel[0], bayer_pixel[bayer_line_step - 1], bayer_pixel[bayer_line_step + 1]);
-  rgb_buffer[rgb_line_step + 5] = rgb_buffer[rgb_line_step + 2] = bayer_pixel[bayer_line_step];
-  
-  // Bayer       -1 0 1
-  //        -1    g b g
-  //         0    r g r
-  // line_step    g b G
-  //rgb_pixel[rgb_line_step + 3] = bayer_pixel[1];
-  rgb_buffer[rgb_line_step + 4] = bayer_pixel[bayer_line_step + 1];
-  //rgb_pixel[rgb_line_step + 5] = bayer_pixel[line_step];
 }
 
-void debayerEdgeAwareWeighted(const cv::Mat& bayer, cv::Mat& color)
+// Leftmost two pixels of an interior row pair, bayer_pixel pointing at its GRGR row
+inline void debayerRowPairLeft(const unsigned char* bayer_pixel, unsigned char* rgb_buffer,
+                               int bayer_line_step, unsigned rgb_line_step)
 {
-  unsigned width = bayer.cols;
-  unsigned height = bayer.rows;
-  unsigned rgb_line_step = color.step[0];
-  unsigned rgb_line_skip = rgb_line_step - width * 3;
-  int bayer_line_step = bayer.step[0];
   int bayer_line_step2 = bayer_line_step * 2;
 
-  unsigned char* rgb_buffer = color.data;
-  unsigned char* bayer_pixel = bayer.data;
-  unsigned yIdx, xIdx;
-
-  int dh, dv;
-
-  // first two pixel values for first two lines
+  // first two pixel values
   // Bayer         0 1 2
+  //        -1     b g b
   //         0     G r g
   // line_step     b g b
   // line_step2    g r g
 
   rgb_buffer[3] = rgb_buffer[0] = bayer_pixel[1]; // red pixel
   rgb_buffer[1] = bayer_pixel[0]; // green pixel
-  rgb_buffer[rgb_line_step + 2] = rgb_buffer[2] = bayer_pixel[bayer_line_step]; // blue;
-  
+  rgb_buffer[2] = AVG (bayer_pixel[bayer_line_step], bayer_pixel[-bayer_line_step]); // blue;
+
   // Bayer         0 1 2
+  //        -1     b g b
   //         0     g R g
   // line_step     b g b
   // line_step2    g r g
   //rgb_pixel[3] = bayer_pixel[1];
-  rgb_buffer[4] = AVG3 (bayer_pixel[0], bayer_pixel[2], bayer_pixel[bayer_line_step + 1]);
-  rgb_buffer[rgb_line_step + 5] = rgb_buffer[5] = AVG (bayer_pixel[bayer_line_step], bayer_pixel[bayer_line_step + 2]);
-  
+  rgb_buffer[4] = AVG4 (bayer_pixel[0], bayer_pixel[2], bayer_pixel[bayer_line_step + 1], bayer_pixel[1 - bayer_line_step]);
+  rgb_buffer[5] = AVG4 (bayer_pixel[bayer_line_step], bayer_pixel[bayer_line_step + 2], bayer_pixel[-bayer_line_step], bayer_pixel[2 - bayer_line_step]);
+
   // BGBG line
   // Bayer         0 1 2
   //         0     g r g
@@ -463,56 +215,24 @@ void debayerEdgeAwareWeighted(const cv::Mat& bayer, cv::Mat& color)
   // line_step2    g r g
   rgb_buffer[rgb_line_step + 3] = rgb_buffer[rgb_line_step ] = AVG (bayer_pixel[1], bayer_pixel[bayer_line_step2 + 1]);
   rgb_buffer[rgb_line_step + 1] = AVG3 (bayer_pixel[0], bayer_pixel[bayer_line_step + 1], bayer_pixel[bayer_line_step2]);
-  //rgb_pixel[rgb_line_step + 2] = bayer_pixel[line_step];
-  
+  rgb_buffer[rgb_line_step + 2] = bayer_pixel[bayer_line_step];
+
   // pixel (1, 1)  0 1 2
   //         0     g r g
   // line_step     b G b
   // line_step2    g r g
   //rgb_pixel[rgb_line_step + 3] = AVG( bayer_pixel[1] , bayer_pixel[line_step2+1] );
   rgb_buffer[rgb_line_step + 4] = bayer_pixel[bayer_line_step + 1];
-  //rgb_pixel[rgb_line_step + 5] = AVG( bayer_pixel[line_step] , bayer_pixel[line_step+2] );
-  
-  rgb_buffer += 6;
-  bayer_pixel += 2;
-  // rest of the first two lines
-  for (xIdx = 2; xIdx < width - 2; xIdx += 2, rgb_buffer += 6, bayer_pixel += 2)
-  {
-    // GRGR line
-    // Bayer        -1 0 1 2
-    //           0   r G r g
-    //   line_step   g b g b
-    // line_step2    r g r g
-    rgb_buffer[0] = AVG (bayer_pixel[1], bayer_pixel[-1]);
-    rgb_buffer[1] = bayer_pixel[0];
-    rgb_buffer[2] = bayer_pixel[bayer_line_step + 1];
-    
-    // Bayer        -1 0 1 2
-    //          0    r g R g
-    //  line_step    g b g b
-    // line_step2    r g r g
-    rgb_buffer[3] = bayer_pixel[1];
-    rgb_buffer[4] = AVG3 (bayer_pixel[0], bayer_pixel[2], bayer_pixel[bayer_line_step + 1]);
-    rgb_buffer[rgb_line_step + 5] = rgb_buffer[5] = AVG (bayer_pixel[bayer_line_step], bayer_pixel[bayer_line_step + 2]);
-    
-    // BGBG line
-    // Bayer         -1 0 1 2
-    //         0      r g r g
-    // line_step      g B g b
-    // line_step2     r g r g
-    rgb_buffer[rgb_line_step ] = AVG4 (bayer_pixel[1], bayer_pixel[bayer_line_step2 + 1], bayer_pixel[-1], bayer_pixel[bayer_line_step2 - 1]);
-    rgb_buffer[rgb_line_step + 1] = AVG4 (bayer_pixel[0], bayer_pixel[bayer_line_step2], bayer_pixel[bayer_line_step - 1], bayer_pixel[bayer_line_step + 1]);
-    rgb_buffer[rgb_line_step + 2] = bayer_pixel[bayer_line_step];
-    
-    // Bayer         -1 0 1 2
-    //         0      r g r g
-    // line_step      g b G b
-    // line_step2     r g r g
-    rgb_buffer[rgb_line_step + 3] = AVG (bayer_pixel[1], bayer_pixel[bayer_line_step2 + 1]);
-    rgb_buffer[rgb_line_step + 4] = bayer_pixel[bayer_line_step + 1];
-    //rgb_pixel[rgb_line_step + 5] = AVG( bayer_pixel[line_step] , bayer_pixel[line_step+2] );
-  }
-  
+  rgb_buffer[rgb_line_step + 5] = AVG (bayer_pixel[bayer_line_step], bayer_pixel[bayer_line_step + 2]);
+}
+
+// Rightmost two pixels of an interior row pair
+inline void debayerRowPairRight(const unsigned char* bayer_pixel, unsigned char* rgb_buffer,
+                                int bayer_line_step, unsigned rgb_line_step)
+{
+  int bayer_line_step2 = bayer_line_step * 2;
+
+  // last two pixels of the line
   // last two pixel values for first two lines
   // GRGR line
   // Bayer        -1 0 1
@@ -522,7 +242,7 @@ void debayerEdgeAwareWeighted(const cv::Mat& bayer, cv::Mat& color)
   rgb_buffer[0] = AVG (bayer_pixel[1], bayer_pixel[-1]);
   rgb_buffer[1] = bayer_pixel[0];
   rgb_buffer[rgb_line_step + 5] = rgb_buffer[rgb_line_step + 2] = rgb_buffer[5] = rgb_buffer[2] = bayer_pixel[bayer_line_step];
-  
+
   // Bayer        -1 0 1
   //          0    r g R
   //  line_step    g b g
@@ -530,7 +250,7 @@ void debayerEdgeAwareWeighted(const cv::Mat& bayer, cv::Mat& color)
   rgb_buffer[3] = bayer_pixel[1];
   rgb_buffer[4] = AVG (bayer_pixel[0], bayer_pixel[bayer_line_step + 1]);
   //rgb_pixel[5] = bayer_pixel[line_step];
-  
+
   // BGBG line
   // Bayer        -1 0 1
   //          0    r g r
@@ -539,7 +259,7 @@ void debayerEdgeAwareWeighted(const cv::Mat& bayer, cv::Mat& color)
   rgb_buffer[rgb_line_step ] = AVG4 (bayer_pixel[1], bayer_pixel[bayer_line_step2 + 1], bayer_pixel[-1], bayer_pixel[bayer_line_step2 - 1]);
   rgb_buffer[rgb_line_step + 1] = AVG4 (bayer_pixel[0], bayer_pixel[bayer_line_step2], bayer_pixel[bayer_line_step - 1], bayer_pixel[bayer_line_step + 1]);
   //rgb_pixel[rgb_line_step + 2] = bayer_pixel[line_step];
-  
+
   // Bayer         -1 0 1
   //         0      r g r
   // line_step      g b G
@@ -547,157 +267,281 @@ void debayerEdgeAwareWeighted(const cv::Mat& bayer, cv::Mat& color)
   rgb_buffer[rgb_line_step + 3] = AVG (bayer_pixel[1], bayer_pixel[bayer_line_step2 + 1]);
   rgb_buffer[rgb_line_step + 4] = bayer_pixel[bayer_line_step + 1];
   //rgb_pixel[rgb_line_step + 5] = bayer_pixel[line_step];
-  
-  bayer_pixel += bayer_line_step + 2;
-  rgb_buffer += rgb_line_step + 6 + rgb_line_skip;
-  // main processing
-  for (yIdx = 2; yIdx < height - 2; yIdx += 2)
+}
+
+// Green at a red or blue pixel, from its vertical (v0, v1) and horizontal (h0, h1) neighbours
+template <bool Weighted>
+inline int interpolateGreen(int v0, int v1, int h0, int h1)
+{
+  int dh = abs (h0 - h1);
+  int dv = abs (v0 - v1);
+
+  if (Weighted)
   {
-    // first two pixel values
-    // Bayer         0 1 2
-    //        -1     b g b
-    //         0     G r g
-    // line_step     b g b
-    // line_step2    g r g
-    
-    rgb_buffer[3] = rgb_buffer[0] = bayer_pixel[1]; // red pixel
-    rgb_buffer[1] = bayer_pixel[0]; // green pixel
-    rgb_buffer[2] = AVG (bayer_pixel[bayer_line_step], bayer_pixel[-bayer_line_step]); // blue;
-    
-    // Bayer         0 1 2
-    //        -1     b g b
-    //         0     g R g
-    // line_step     b g b
-    // line_step2    g r g
-    //rgb_pixel[3] = bayer_pixel[1];
-    rgb_buffer[4] = AVG4 (bayer_pixel[0], bayer_pixel[2], bayer_pixel[bayer_line_step + 1], bayer_pixel[1 - bayer_line_step]);
-    rgb_buffer[5] = AVG4 (bayer_pixel[bayer_line_step], bayer_pixel[bayer_line_step + 2], bayer_pixel[-bayer_line_step], bayer_pixel[2 - bayer_line_step]);
-    
+    if (dv == 0 && dh == 0)
+      return AVG4 (v0, v1, h0, h1);
+    return WAVG4 (v0, v1, h0, h1, dh, dv);
+  }
+
+  if (dh > dv)
+    return AVG (v0, v1);
+  else if (dv > dh)
+    return AVG (h0, h1);
+  return AVG4 (v0, v1, h0, h1);
+}
+
+// Inner pixels [xIdx, x_end) of an interior row pair. u, c, d and dd are the bayer rows above,
+// at, below and two below the GRGR row; rgb0 and rgb1 are the two output rows.
+template <bool Weighted>
+void debayerRowPairInner(const unsigned char* u, const unsigned char* c, const unsigned char* d,
+                         const unsigned char* dd, unsigned char* rgb0, unsigned char* rgb1,
+                         unsigned xIdx, unsigned x_end)
+{
+  for (; xIdx < x_end; xIdx += 2)
+  {
+    const unsigned x = xIdx;
+    unsigned char* rgb_pixel = rgb0 + 3 * x;
+
+    // GRGR line
+    rgb_pixel[0] = AVG (c[x + 1], c[x - 1]);
+    rgb_pixel[1] = c[x];
+    rgb_pixel[2] = AVG (d[x], u[x]);
+
+    rgb_pixel[3] = c[x + 1];
+    rgb_pixel[4] = interpolateGreen<Weighted>(u[x + 1], d[x + 1], c[x], c[x + 2]);
+    rgb_pixel[5] = AVG4 (u[x], u[x + 2], d[x], d[x + 2]);
+
     // BGBG line
-    // Bayer         0 1 2
-    //         0     g r g
-    // line_step     B g b
-    // line_step2    g r g
-    rgb_buffer[rgb_line_step + 3] = rgb_buffer[rgb_line_step ] = AVG (bayer_pixel[1], bayer_pixel[bayer_line_step2 + 1]);
-    rgb_buffer[rgb_line_step + 1] = AVG3 (bayer_pixel[0], bayer_pixel[bayer_line_step + 1], bayer_pixel[bayer_line_step2]);
-    rgb_buffer[rgb_line_step + 2] = bayer_pixel[bayer_line_step];
-    
-    // pixel (1, 1)  0 1 2
-    //         0     g r g
-    // line_step     b G b
-    // line_step2    g r g
-    //rgb_pixel[rgb_line_step + 3] = AVG( bayer_pixel[1] , bayer_pixel[line_step2+1] );
-    rgb_buffer[rgb_line_step + 4] = bayer_pixel[bayer_line_step + 1];
-    rgb_buffer[rgb_line_step + 5] = AVG (bayer_pixel[bayer_line_step], bayer_pixel[bayer_line_step + 2]);
-    
-    rgb_buffer += 6;
-    bayer_pixel += 2;
-    // continue with rest of the line
-    for (xIdx = 2; xIdx < width - 2; xIdx += 2, rgb_buffer += 6, bayer_pixel += 2)
+    rgb_pixel = rgb1 + 3 * x;
+    rgb_pixel[0] = AVG4 (c[x + 1], dd[x + 1], c[x - 1], dd[x - 1]);
+    rgb_pixel[1] = interpolateGreen<Weighted>(c[x], dd[x], d[x - 1], d[x + 1]);
+    rgb_pixel[2] = d[x];
+
+    rgb_pixel[3] = AVG (c[x + 1], dd[x + 1]);
+    rgb_pixel[4] = d[x + 1];
+    rgb_pixel[5] = AVG (d[x], d[x + 2]);
+  }
+}
+
+#if defined(__SSE2__)
+#define IMAGE_PROC_EDGE_AWARE_SIMD
+
+// SIMD operations on unsigned 8 bit pixels widened to 16 bit lanes. Loading a run of bayer
+// pixels and splitting it into even and odd columns gives one lane per pixel pair.
+struct Sse2
+{
+  typedef __m128i V;
+  enum { WIDTH = 16 };
+
+  static V load(const unsigned char* p) { return _mm_loadu_si128((const __m128i*)p); }
+  static V even(V v) { return _mm_and_si128(v, _mm_set1_epi16(0xff)); }
+  static V odd(V v) { return _mm_srli_epi16(v, 8); }
+  static V add(V a, V b) { return _mm_add_epi16(a, b); }
+  static V avg(V a, V b) { return _mm_srli_epi16(_mm_add_epi16(a, b), 1); }
+  static V absdiff(V a, V b) { return _mm_or_si128(_mm_subs_epu16(a, b), _mm_subs_epu16(b, a)); }
+  static V greater(V a, V b) { return _mm_cmpgt_epi16(a, b); }
+  static V isZero(V a) { return _mm_cmpeq_epi16(a, _mm_setzero_si128()); }
+  static V orBits(V a, V b) { return _mm_or_si128(a, b); }
+  static V select(V mask, V a, V b) { return _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b)); }
+  template <int N> static V shift(V a) { return _mm_srli_epi16(a, N); }
+
+  // (sv * x + sh * y) / (2 * (x + y)) truncated, as WAVG4. Operands are below 2^24, so the
+  // float products and sums are exact, and the quotient can't round up across an integer.
+  static __m128i wavg32(__m128i sv, __m128i sh, __m128i x, __m128i y)
+  {
+    __m128 num = _mm_add_ps(_mm_mul_ps(_mm_cvtepi32_ps(sv), _mm_cvtepi32_ps(x)),
+                            _mm_mul_ps(_mm_cvtepi32_ps(sh), _mm_cvtepi32_ps(y)));
+    __m128 den = _mm_cvtepi32_ps(_mm_slli_epi32(_mm_add_epi32(x, y), 1));
+    return _mm_cvttps_epi32(_mm_div_ps(num, den));
+  }
+
+  static V wavg(V sv, V sh, V x, V y)
+  {
+    const V zero = _mm_setzero_si128();
+    V lo = wavg32(_mm_unpacklo_epi16(sv, zero), _mm_unpacklo_epi16(sh, zero),
+                  _mm_unpacklo_epi16(x, zero), _mm_unpacklo_epi16(y, zero));
+    V hi = wavg32(_mm_unpackhi_epi16(sv, zero), _mm_unpackhi_epi16(sh, zero),
+                  _mm_unpackhi_epi16(x, zero), _mm_unpackhi_epi16(y, zero));
+    return _mm_packs_epi32(lo, hi);
+  }
+
+  // Back to 8 bit pixels in column order
+  static V merge(V even, V odd) { return _mm_or_si128(even, _mm_slli_epi16(odd, 8)); }
+
+  // Interleaves three planes of 16 pixels into 48 bytes of rgb
+  static void store3(unsigned char* dst, V r, V g, V b)
+  {
+#if defined(__SSSE3__)
+    const V r0 = _mm_setr_epi8(0, -1, -1, 1, -1, -1, 2, -1, -1, 3, -1, -1, 4, -1, -1, 5);
+    const V r1 = _mm_setr_epi8(-1, -1, 6, -1, -1, 7, -1, -1, 8, -1, -1, 9, -1, -1, 10, -1);
+    const V r2 = _mm_setr_epi8(-1, 11, -1, -1, 12, -1, -1, 13, -1, -1, 14, -1, -1, 15, -1, -1);
+    const V g0 = _mm_setr_epi8(-1, 0, -1, -1, 1, -1, -1, 2, -1, -1, 3, -1, -1, 4, -1, -1);
+    const V g1 = _mm_setr_epi8(5, -1, -1, 6, -1, -1, 7, -1, -1, 8, -1, -1, 9, -1, -1, 10);
+    const V g2 = _mm_setr_epi8(-1, -1, 11, -1, -1, 12, -1, -1, 13, -1, -1, 14, -1, -1, 15, -1);
+    const V b0 = _mm_setr_epi8(-1, -1, 0, -1, -1, 1, -1, -1, 2, -1, -1, 3, -1, -1, 4, -1);
+    const V b1 = _mm_setr_epi8(-1, 5, -1, -1, 6, -1, -1, 7, -1, -1, 8, -1, -1, 9, -1, -1);
+    const V b2 = _mm_setr_epi8(10, -1, -1, 11, -1, -1, 12, -1, -1, 13, -1, -1, 14, -1, -1, 15);
+
+    _mm_storeu_si128((__m128i*)dst, _mm_or_si128(_mm_or_si128(_mm_shuffle_epi8(r, r0), _mm_shuffle_epi8(g, g0)),
+                                                 _mm_shuffle_epi8(b, b0)));
+    _mm_storeu_si128((__m128i*)(dst + 16), _mm_or_si128(_mm_or_si128(_mm_shuffle_epi8(r, r1), _mm_shuffle_epi8(g, g1)),
+                                                        _mm_shuffle_epi8(b, b1)));
+    _mm_storeu_si128((__m128i*)(dst + 32), _mm_or_si128(_mm_or_si128(_mm_shuffle_epi8(r, r2), _mm_shuffle_epi8(g, g2)),
+                                                        _mm_shuffle_epi8(b, b2)));
+#else
+    unsigned char planes[3][16];
+    _mm_storeu_si128((__m128i*)planes[0], r);
+    _mm_storeu_si128((__m128i*)planes[1], g);
+    _mm_storeu_si128((__m128i*)planes[2], b);
+    for (int i = 0; i < 16; ++i)
     {
-      // GRGR line
-      // Bayer        -1 0 1 2
-      //          -1   g b g b
-      //           0   r G r g
-      //   line_step   g b g b
-      // line_step2    r g r g
-      rgb_buffer[0] = AVG (bayer_pixel[1], bayer_pixel[-1]);
-      rgb_buffer[1] = bayer_pixel[0];
-      rgb_buffer[2] = AVG (bayer_pixel[bayer_line_step], bayer_pixel[-bayer_line_step]);
-      
-      // Bayer        -1 0 1 2
-      //          -1   g b g b
-      //          0    r g R g
-      //  line_step    g b g b
-      // line_step2    r g r g
-      
-      dh = abs (bayer_pixel[0] - bayer_pixel[2]);
-      dv = abs (bayer_pixel[-bayer_line_step + 1] - bayer_pixel[bayer_line_step + 1]);
-      
-      if (dv == 0 && dh == 0)
-        rgb_buffer[4] = AVG4 (bayer_pixel[1 - bayer_line_step], bayer_pixel[1 + bayer_line_step], bayer_pixel[0], bayer_pixel[2]);
-      else
-        rgb_buffer[4] = WAVG4 (bayer_pixel[1 - bayer_line_step], bayer_pixel[1 + bayer_line_step], bayer_pixel[0], bayer_pixel[2], dh, dv);
-      rgb_buffer[3] = bayer_pixel[1];
-      rgb_buffer[5] = AVG4 (bayer_pixel[-bayer_line_step], bayer_pixel[2 - bayer_line_step], bayer_pixel[bayer_line_step], bayer_pixel[bayer_line_step + 2]);
-      
-      // BGBG line
-      // Bayer         -1 0 1 2
-      //         -1     g b g b
-      //          0     r g r g
-      // line_step      g B g b
-      // line_step2     r g r g
-      rgb_buffer[rgb_line_step ] = AVG4 (bayer_pixel[1], bayer_pixel[bayer_line_step2 + 1], bayer_pixel[-1], bayer_pixel[bayer_line_step2 - 1]);
-      rgb_buffer[rgb_line_step + 2] = bayer_pixel[bayer_line_step];
-      
-      dv = abs (bayer_pixel[0] - bayer_pixel[bayer_line_step2]);
-      dh = abs (bayer_pixel[bayer_line_step - 1] - bayer_pixel[bayer_line_step + 1]);
-      
-      if (dv == 0 && dh == 0)
-        rgb_buffer[rgb_line_step + 1] = AVG4 (bayer_pixel[0], bayer_pixel[bayer_line_step2], bayer_pixel[bayer_line_step - 1], bayer_pixel[bayer_line_step + 1]);
-      else
-        rgb_buffer[rgb_line_step + 1] = WAVG4 (bayer_pixel[0], bayer_pixel[bayer_line_step2], bayer_pixel[bayer_line_step - 1], bayer_pixel[bayer_line_step + 1], dh, dv);
-      
-      // Bayer         -1 0 1 2
-      //         -1     g b g b
-      //          0     r g r g
-      // line_step      g b G b
-      // line_step2     r g r g
-      rgb_buffer[rgb_line_step + 3] = AVG (bayer_pixel[1], bayer_pixel[bayer_line_step2 + 1]);
-      rgb_buffer[rgb_line_step + 4] = bayer_pixel[bayer_line_step + 1];
-      rgb_buffer[rgb_line_step + 5] = AVG (bayer_pixel[bayer_line_step], bayer_pixel[bayer_line_step + 2]);
+      dst[3 * i] = planes[0][i];
+      dst[3 * i + 1] = planes[1][i];
+      dst[3 * i + 2] = planes[2][i];
     }
-    
-    // last two pixels of the line
-    // last two pixel values for first two lines
+#endif
+  }
+};
+
+#if defined(__AVX2__)
+struct Avx2
+{
+  typedef __m256i V;
+  enum { WIDTH = 32 };
+
+  static V load(const unsigned char* p) { return _mm256_loadu_si256((const __m256i*)p); }
+  static V even(V v) { return _mm256_and_si256(v, _mm256_set1_epi16(0xff)); }
+  static V odd(V v) { return _mm256_srli_epi16(v, 8); }
+  static V add(V a, V b) { return _mm256_add_epi16(a, b); }
+  static V avg(V a, V b) { return _mm256_srli_epi16(_mm256_add_epi16(a, b), 1); }
+  static V absdiff(V a, V b) { return _mm256_or_si256(_mm256_subs_epu16(a, b), _mm256_subs_epu16(b, a)); }
+  static V greater(V a, V b) { return _mm256_cmpgt_epi16(a, b); }
+  static V isZero(V a) { return _mm256_cmpeq_epi16(a, _mm256_setzero_si256()); }
+  static V orBits(V a, V b) { return _mm256_or_si256(a, b); }
+  static V select(V mask, V a, V b) { return _mm256_blendv_epi8(b, a, mask); }
+  template <int N> static V shift(V a) { return _mm256_srli_epi16(a, N); }
+
+  // See Sse2::wavg32
+  static __m256i wavg32(__m256i sv, __m256i sh, __m256i x, __m256i y)
+  {
+    __m256 num = _mm256_add_ps(_mm256_mul_ps(_mm256_cvtepi32_ps(sv), _mm256_cvtepi32_ps(x)),
+                               _mm256_mul_ps(_mm256_cvtepi32_ps(sh), _mm256_cvtepi32_ps(y)));
+    __m256 den = _mm256_cvtepi32_ps(_mm256_slli_epi32(_mm256_add_epi32(x, y), 1));
+    return _mm256_cvttps_epi32(_mm256_div_ps(num, den));
+  }
+
+  // Unpacking and packing both work within 128 bit lanes, so the lane order is preserved
+  static V wavg(V sv, V sh, V x, V y)
+  {
+    const V zero = _mm256_setzero_si256();
+    V lo = wavg32(_mm256_unpacklo_epi16(sv, zero), _mm256_unpacklo_epi16(sh, zero),
+                  _mm256_unpacklo_epi16(x, zero), _mm256_unpacklo_epi16(y, zero));
+    V hi = wavg32(_mm256_unpackhi_epi16(sv, zero), _mm256_unpackhi_epi16(sh, zero),
+                  _mm256_unpackhi_epi16(x, zero), _mm256_unpackhi_epi16(y, zero));
+    return _mm256_packs_epi32(lo, hi);
+  }
+
+  static V merge(V even, V odd) { return _mm256_or_si256(even, _mm256_slli_epi16(odd, 8)); }
+
+  static void store3(unsigned char* dst, V r, V g, V b)
+  {
+    Sse2::store3(dst, _mm256_castsi256_si128(r), _mm256_castsi256_si128(g), _mm256_castsi256_si128(b));
+    Sse2::store3(dst + 48, _mm256_extracti128_si256(r, 1), _mm256_extracti128_si256(g, 1),
+                 _mm256_extracti128_si256(b, 1));
+  }
+};
+
+typedef Avx2 Simd;
+#else
+typedef Sse2 Simd;
+#endif
+
+// Vector version of interpolateGreen
+template <class S, bool Weighted>
+inline typename S::V interpolateGreen(typename S::V v0, typename S::V v1, typename S::V h0, typename S::V h1)
+{
+  typedef typename S::V V;
+  const V dh = S::absdiff(h0, h1);
+  const V dv = S::absdiff(v0, v1);
+  const V sv = S::add(v0, v1);
+  const V sh = S::add(h0, h1);
+  const V avg4 = S::template shift<2>(S::add(sv, sh));
+
+  if (Weighted)
+    return S::select(S::isZero(S::orBits(dh, dv)), avg4, S::wavg(sv, sh, dh, dv));
+
+  return S::select(S::greater(dh, dv), S::template shift<1>(sv),
+                   S::select(S::greater(dv, dh), S::template shift<1>(sh), avg4));
+}
+
+// Vector version of debayerRowPairInner. Returns the column where the scalar code has to take
+// over, either at x_end or where a full vector would read past the end of the row.
+template <class S, bool Weighted>
+unsigned debayerRowPairInnerSimd(const unsigned char* u, const unsigned char* c, const unsigned char* d,
+                                 const unsigned char* dd, unsigned char* rgb0, unsigned char* rgb1,
+                                 unsigned xIdx, unsigned x_end, unsigned width)
+{
+  typedef typename S::V V;
+  for (; xIdx + S::WIDTH <= x_end && xIdx + S::WIDTH + 2 <= width; xIdx += S::WIDTH)
+  {
+    const unsigned x = xIdx;
+
+    // Pixels of each row at even and odd columns, named after the column offset from x
+    const V c_l = S::odd(S::load(c + x - 2));       // c[x - 1]
+    const V c_r0 = S::load(c + x);
+    const V c_0 = S::even(c_r0), c_1 = S::odd(c_r0);
+    const V c_2 = S::even(S::load(c + x + 2));
+
+    const V u_r0 = S::load(u + x);
+    const V u_0 = S::even(u_r0), u_1 = S::odd(u_r0);
+    const V u_2 = S::even(S::load(u + x + 2));
+
+    const V d_l = S::odd(S::load(d + x - 2));
+    const V d_r0 = S::load(d + x);
+    const V d_0 = S::even(d_r0), d_1 = S::odd(d_r0);
+    const V d_2 = S::even(S::load(d + x + 2));
+
+    const V dd_l = S::odd(S::load(dd + x - 2));
+    const V dd_r0 = S::load(dd + x);
+    const V dd_0 = S::even(dd_r0), dd_1 = S::odd(dd_r0);
+
     // GRGR line
-    // Bayer        -1 0 1
-    //           0   r G r
-    //   line_step   g b g
-    // line_step2    r g r
-    rgb_buffer[0] = AVG (bayer_pixel[1], bayer_pixel[-1]);
-    rgb_buffer[1] = bayer_pixel[0];
-    rgb_buffer[rgb_line_step + 5] = rgb_buffer[rgb_line_step + 2] = rgb_buffer[5] = rgb_buffer[2] = bayer_pixel[bayer_line_step];
-    
-    // Bayer        -1 0 1
-    //          0    r g R
-    //  line_step    g b g
-    // line_step2    r g r
-    rgb_buffer[3] = bayer_pixel[1];
-    rgb_buffer[4] = AVG (bayer_pixel[0], bayer_pixel[bayer_line_step + 1]);
-    //rgb_pixel[5] = bayer_pixel[line_step];
-    
+    S::store3(rgb0 + 3 * x,
+              S::merge(S::avg(c_1, c_l), c_1),
+              S::merge(c_0, interpolateGreen<S, Weighted>(u_1, d_1, c_0, c_2)),
+              S::merge(S::avg(d_0, u_0), S::template shift<2>(S::add(S::add(u_0, u_2), S::add(d_0, d_2)))));
+
     // BGBG line
-    // Bayer        -1 0 1
-    //          0    r g r
-    //  line_step    g B g
-    // line_step2    r g r
-    rgb_buffer[rgb_line_step ] = AVG4 (bayer_pixel[1], bayer_pixel[bayer_line_step2 + 1], bayer_pixel[-1], bayer_pixel[bayer_line_step2 - 1]);
-    rgb_buffer[rgb_line_step + 1] = AVG4 (bayer_pixel[0], bayer_pixel[bayer_line_step2], bayer_pixel[bayer_line_step - 1], bayer_pixel[bayer_line_step + 1]);
-    //rgb_pixel[rgb_line_step + 2] = bayer_pixel[line_step];
-    
-    // Bayer         -1 0 1
-    //         0      r g r
-    // line_step      g b G
-    // line_step2     r g r
-    rgb_buffer[rgb_line_step + 3] = AVG (bayer_pixel[1], bayer_pixel[bayer_line_step2 + 1]);
-    rgb_buffer[rgb_line_step + 4] = bayer_pixel[bayer_line_step + 1];
-    //rgb_pixel[rgb_line_step + 5] = bayer_pixel[line_step];
-    
-    bayer_pixel += bayer_line_step + 2;
-    rgb_buffer += rgb_line_step + 6 + rgb_line_skip;
+    S::store3(rgb1 + 3 * x,
+              S::merge(S::template shift<2>(S::add(S::add(c_1, dd_1), S::add(c_l, dd_l))), S::avg(c_1, dd_1)),
+              S::merge(interpolateGreen<S, Weighted>(c_0, dd_0, d_l, d_1), d_1),
+              S::merge(d_0, S::avg(d_0, d_2)));
   }
-  
+  return xIdx;
+}
+#endif
+
+// Last two rows starting at row yIdx, which have no row below them
+void debayerBottomRows(const cv::Mat& bayer, cv::Mat& color, unsigned yIdx)
+{
+  unsigned width = bayer.cols;
+  unsigned rgb_line_step = color.step[0];
+  int bayer_line_step = bayer.step[0];
+
+  unsigned char* rgb_buffer = color.data + yIdx * rgb_line_step;
+  unsigned char* bayer_pixel = bayer.data + yIdx * bayer_line_step;
+  unsigned xIdx;
+
   //last two lines
   // Bayer         0 1 2
   //        -1     b g b
   //         0     G r g
   // line_step     b g b
-  
+
   rgb_buffer[rgb_line_step + 3] = rgb_buffer[rgb_line_step ] = rgb_buffer[3] = rgb_buffer[0] = bayer_pixel[1]; // red pixel
   rgb_buffer[1] = bayer_pixel[0]; // green pixel
   rgb_buffer[rgb_line_step + 2] = rgb_buffer[2] = bayer_pixel[bayer_line_step]; // blue;
-  
+
   // Bayer         0 1 2
   //        -1     b g b
   //         0     g R g
@@ -705,7 +549,7 @@ void debayerEdgeAwareWeighted(const cv::Mat& bayer, cv::Mat& color)
   //rgb_pixel[3] = bayer_pixel[1];
   rgb_buffer[4] = AVG4 (bayer_pixel[0], bayer_pixel[2], bayer_pixel[bayer_line_step + 1], bayer_pixel[1 - bayer_line_step]);
   rgb_buffer[5] = AVG4 (bayer_pixel[bayer_line_step], bayer_pixel[bayer_line_step + 2], bayer_pixel[-bayer_line_step], bayer_pixel[2 - bayer_line_step]);
-  
+
   // BGBG line
   // Bayer         0 1 2
   //        -1     b g b
@@ -722,7 +566,7 @@ void debayerEdgeAwareWeighted(const cv::Mat& bayer, cv::Mat& color)
   //rgb_pixel[rgb_line_step + 3] = AVG( bayer_pixel[1] , bayer_pixel[line_step2+1] );
   rgb_buffer[rgb_line_step + 4] = bayer_pixel[bayer_line_step + 1];
   rgb_buffer[rgb_line_step + 5] = AVG (bayer_pixel[bayer_line_step], bayer_pixel[bayer_line_step + 2]);
-  
+
   rgb_buffer += 6;
   bayer_pixel += 2;
   // rest of the last two lines
@@ -736,7 +580,7 @@ void debayerEdgeAwareWeighted(const cv::Mat& bayer, cv::Mat& color)
     rgb_buffer[0] = AVG (bayer_pixel[1], bayer_pixel[-1]);
     rgb_buffer[1] = bayer_pixel[0];
     rgb_buffer[2] = AVG (bayer_pixel[bayer_line_step], bayer_pixel[-bayer_line_step]);
-    
+
     // Bayer       -1 0 1 2
     //        -1    g b g b
     //         0    r g R g
@@ -753,8 +597,8 @@ void debayerEdgeAwareWeighted(const cv::Mat& bayer, cv::Mat& color)
     rgb_buffer[rgb_line_step ] = AVG (bayer_pixel[-1], bayer_pixel[1]);
     rgb_buffer[rgb_line_step + 1] = AVG3 (bayer_pixel[0], bayer_pixel[bayer_line_step - 1], bayer_pixel[bayer_line_step + 1]);
     rgb_buffer[rgb_line_step + 2] = bayer_pixel[bayer_line_step];
-    
-    
+
+
     // Bayer       -1 0 1 2
     //        -1    g b g b
     //         0    r g r g
@@ -763,7 +607,7 @@ void debayerEdgeAwareWeighted(const cv::Mat& bayer, cv::Mat& color)
     rgb_buffer[rgb_line_step + 4] = bayer_pixel[bayer_line_step + 1];
     rgb_buffer[rgb_line_step + 5] = AVG (bayer_pixel[bayer_line_step], bayer_pixel[bayer_line_step + 2]);
   }
-  
+
   // last two pixel values for first two lines
   // GRGR line
   // Bayer       -1 0 1
@@ -773,7 +617,7 @@ void debayerEdgeAwareWeighted(const cv::Mat& bayer, cv::Mat& color)
   rgb_buffer[rgb_line_step ] = rgb_buffer[0] = AVG (bayer_pixel[1], bayer_pixel[-1]);
   rgb_buffer[1] = bayer_pixel[0];
   rgb_buffer[5] = rgb_buffer[2] = AVG (bayer_pixel[bayer_line_step], bayer_pixel[-bayer_line_step]);
-  
+
   // Bayer       -1 0 1
   //        -1    g b g
   //         0    r g R
@@ -781,7 +625,7 @@ void debayerEdgeAwareWeighted(const cv::Mat& bayer, cv::Mat& color)
   rgb_buffer[rgb_line_step + 3] = rgb_buffer[3] = bayer_pixel[1];
   rgb_buffer[4] = AVG3 (bayer_pixel[0], bayer_pixel[bayer_line_step + 1], bayer_pixel[-bayer_line_step + 1]);
   //rgb_pixel[5] = AVG( bayer_pixel[line_step], bayer_pixel[-line_step] );
-  
+
   // BGBG line
   // Bayer       -1 0 1
   //        -1    g b g
@@ -790,7 +634,7 @@ void debayerEdgeAwareWeighted(const cv::Mat& bayer, cv::Mat& color)
   //rgb_pixel[rgb_line_step    ] = AVG2( bayer_pixel[-1], bayer_pixel[1] );
   rgb_buffer[rgb_line_step + 1] = AVG3 (bayer_pixel[0], bayer_pixel[bayer_line_step - 1], bayer_pixel[bayer_line_step + 1]);
   rgb_buffer[rgb_line_step + 5] = rgb_buffer[rgb_line_step + 2] = bayer_pixel[bayer_line_step];
-  
+
   // Bayer       -1 0 1
   //        -1    g b g
   //         0    r g r
@@ -798,7 +642,77 @@ void debayerEdgeAwareWeighted(const cv::Mat& bayer, cv::Mat& color)
   //rgb_pixel[rgb_line_step + 3] = bayer_pixel[1];
   rgb_buffer[rgb_line_step + 4] = bayer_pixel[bayer_line_step + 1];
   //rgb_pixel[rgb_line_step + 5] = bayer_pixel[line_step];
+}
+
+// Debayers the interior row pairs in a range
+template <bool Weighted>
+class RowPairDebayer : public cv::ParallelLoopBody
+{
+public:
+  RowPairDebayer(const cv::Mat& bayer, cv::Mat& color, unsigned x_end)
+    : bayer_(bayer), color_(color), x_end_(x_end)
+  {
+  }
+
+  virtual void operator()(const cv::Range& range) const
+  {
+    unsigned rgb_line_step = color_.step[0];
+    int bayer_line_step = bayer_.step[0];
+
+    for (int pair = range.start; pair < range.end; ++pair)
+    {
+      unsigned yIdx = 2 + 2 * pair;
+      const unsigned char* bayer_pixel = bayer_.data + yIdx * bayer_line_step;
+      unsigned char* rgb_buffer = color_.data + yIdx * rgb_line_step;
+
+      debayerRowPairLeft(bayer_pixel, rgb_buffer, bayer_line_step, rgb_line_step);
 
+      const unsigned char* d = bayer_pixel + bayer_line_step;
+      unsigned xIdx = 2;
+#ifdef IMAGE_PROC_EDGE_AWARE_SIMD
+      xIdx = debayerRowPairInnerSimd<Simd, Weighted>(bayer_pixel - bayer_line_step, bayer_pixel, d,
+                                                     d + bayer_line_step, rgb_buffer,
+                                                     rgb_buffer + rgb_line_step, xIdx, x_end_, bayer_.cols);
+#endif
+      debayerRowPairInner<Weighted>(bayer_pixel - bayer_line_step, bayer_pixel, d, d + bayer_line_step,
+                                    rgb_buffer, rgb_buffer + rgb_line_step, xIdx, x_end_);
+
+      debayerRowPairRight(bayer_pixel + x_end_, rgb_buffer + 3 * x_end_, bayer_line_step, rgb_line_step);
+    }
+  }
+
+private:
+  const cv::Mat& bayer_;
+  cv::Mat& color_;
+  unsigned x_end_;
+};
+
+template <bool Weighted>
+void debayer(const cv::Mat& bayer, cv::Mat& color)
+{
+  unsigned width = bayer.cols;
+  unsigned height = bayer.rows;
+
+  // Where stepping by two from 2 stops being below width - 2 (height - 2): the right edge
+  // pixels and the last two rows start there.
+  unsigned x_end = std::max(2u, (width - 1) & ~1u);
+  unsigned y_end = std::max(2u, (height - 1) & ~1u);
+
+  debayerTopRows(bayer, color);
+  cv::parallel_for_(cv::Range(0, (y_end - 2) / 2), RowPairDebayer<Weighted>(bayer, color, x_end));
+  debayerBottomRows(bayer, color, y_end);
+}
+
+} // namespace
+
+void debayerEdgeAware(const cv::Mat& bayer, cv::Mat& color)
+{
+  debayer<false>(bayer, color);
+}
+
+void debayerEdgeAwareWeighted(const cv::Mat& bayer, cv::Mat& color)
+{
+  debayer<true>(bayer, color);
 }
 
 } // namespace image_proc
@@ -37,6 +37,7 @@
 #include <opencv2/core/core.hpp>
 
 // Edge-aware debayering algorithms, intended for eventual inclusion in OpenCV.
+// Both take GRBG8 input and run the interior rows on OpenCV's parallel_for_ pool.
 
 namespace image_proc {
 
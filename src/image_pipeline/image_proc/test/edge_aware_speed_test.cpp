@@ -0,0 +1,44 @@
+// Throughput of the edge-aware debayering kernels on a 5 MP frame, in ms per megapixel.
+//   rosrun image_proc image_proc_edge_aware_speed_test [iterations]
+
+#include <ros/time.h>
+#include <ros/console.h>
+#include <opencv2/core/core.hpp>
+
+#include <boost/lexical_cast.hpp>
+
+#include "../src/nodelets/edge_aware.h"
+
+int main(int argc, char** argv)
+{
+  int iterations = 50;
+  if (argc > 1)
+  {
+    iterations = boost::lexical_cast<int>(argv[1]);
+  }
+
+  cv::Mat bayer(2048, 2448, CV_8UC1);
+  cv::randu(bayer, cv::Scalar(0), cv::Scalar(256));
+  cv::Mat color(bayer.rows, bayer.cols, CV_8UC3);
+  const double megapixels = bayer.rows * bayer.cols * 1.0e-6;
+
+  ROS_INFO("%d threads", cv::getNumThreads());
+
+  for (int weighted = 0; weighted < 2; ++weighted)
+  {
+    ros::WallTime start = ros::WallTime::now();
+    for (int i = 0; i < iterations; ++i)
+    {
+      if (weighted)
+        image_proc::debayerEdgeAwareWeighted(bayer, color);
+      else
+        image_proc::debayerEdgeAware(bayer, color);
+    }
+    ros::WallDuration dur = ros::WallTime::now() - start;
+    double ms = dur.toSec() * 1.0e3 / iterations;
+    ROS_INFO("%s: %.3f ms per frame, %.3f ms per megapixel",
+             weighted ? "debayerEdgeAwareWeighted" : "debayerEdgeAware", ms, ms / megapixels);
+  }
+
+  return 0;
+}
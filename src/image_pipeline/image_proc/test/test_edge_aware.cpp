@@ -0,0 +1,82 @@
+#include <gtest/gtest.h>
+#include <opencv2/core/core.hpp>
+
+#include "../src/nodelets/edge_aware.h"
+
+// Output hashes of the original scalar implementation. The SIMD and row-parallel kernels have
+// to reproduce them exactly.
+
+namespace
+{
+
+cv::Mat makeBayer(int width, int height)
+{
+  cv::Mat bayer(height, width, CV_8UC1);
+  uint32_t state = 42;
+  for (int y = 0; y < height; ++y)
+  {
+    for (int x = 0; x < width; ++x)
+    {
+      state = state * 1664525u + 1013904223u;
+      // Flat blocks exercise the equal gradient cases, noise the rest
+      bayer.at<uint8_t>(y, x) = ((x / 8 + y / 8) % 3 == 0) ? 128 : (state >> 24);
+    }
+  }
+  return bayer;
+}
+
+uint64_t hash(const cv::Mat& color)
+{
+  uint64_t h = 14695981039346656037ull;
+  for (int y = 0; y < color.rows; ++y)
+  {
+    const uint8_t* row = color.ptr<uint8_t>(y);
+    for (int i = 0; i < color.cols * 3; ++i)
+    {
+      h ^= row[i];
+      h *= 1099511628211ull;
+    }
+  }
+  return h;
+}
+
+uint64_t debayerHash(int width, int height, bool weighted)
+{
+  cv::Mat bayer = makeBayer(width, height);
+  cv::Mat color(height, width, CV_8UC3);
+  if (weighted)
+    image_proc::debayerEdgeAwareWeighted(bayer, color);
+  else
+    image_proc::debayerEdgeAware(bayer, color);
+  return hash(color);
+}
+
+} // namespace
+
+TEST(EdgeAware, matchesReference)
+{
+  EXPECT_EQ(0x90574905437faa89ull, debayerHash(640, 480, false));
+  EXPECT_EQ(0x8e1ee72284739d90ull, debayerHash(640, 480, true));
+}
+
+// Width that leaves inner pixels after the last full vector
+TEST(EdgeAware, matchesReferenceOddSize)
+{
+  EXPECT_EQ(0xe02a5a80d988fa81ull, debayerHash(98, 34, false));
+  EXPECT_EQ(0xa72d8851fe7eb639ull, debayerHash(98, 34, true));
+}
+
+TEST(EdgeAware, independentOfThreadCount)
+{
+  int threads = cv::getNumThreads();
+  cv::setNumThreads(1);
+  uint64_t single = debayerHash(640, 480, true);
+  cv::setNumThreads(threads);
+  EXPECT_EQ(single, debayerHash(640, 480, true));
+}
+
+int main(int argc, char** argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
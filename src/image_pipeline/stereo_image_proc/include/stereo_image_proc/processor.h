@@ -181,6 +181,18 @@ private:
   mutable cv::Mat_<cv::Vec3f> dense_points_;
 };
 
+// Fused disparity -> PointCloud2 projection. Fills x,y,z (FLOAT32 at offsets 0, 4, 8) and the
+// packed rgb at rgb_offset of an organized cloud whose layout and data size are already set to
+// match the disparity image, so a reused message keeps its storage. Disparities that OpenCV
+// would treat as missing become NaN points, and their rgb is NaN too if nan_invalid_rgb.
+// Rows are split across threads with cv::parallel_for_. Returns false if the color encoding is
+// not supported, in which case rgb is zeroed.
+bool projectDisparityToPointCloud2(const cv::Mat_<float>& disparity,
+                                   const cv::Mat& color, const std::string& encoding,
+                                   const image_geometry::StereoCameraModel& model,
+                                   uint32_t rgb_offset, bool nan_invalid_rgb,
+                                   sensor_msgs::PointCloud2& points);
+
 
 inline int StereoProcessor::getInterpolation() const
 {
@@ -34,7 +34,9 @@
 #include <ros/assert.h>
 #include "stereo_image_proc/processor.h"
 #include <sensor_msgs/image_encodings.h>
+#include <cfloat>
 #include <cmath>
+#include <cstring>
 #include <limits>
 
 namespace stereo_image_proc {
@@ -237,14 +239,10 @@ void StereoProcessor::processPoints2(const stereo_msgs::DisparityImage& disparit
                                      const image_geometry::StereoCameraModel& model,
                                      sensor_msgs::PointCloud2& points) const
 {
-  // Calculate dense point cloud
-  const sensor_msgs::Image& dimage = disparity.image;
-  const cv::Mat_<float> dmat(dimage.height, dimage.width, (float*)&dimage.data[0], dimage.step);
-  model.projectDisparityImageTo3d(dmat, dense_points_, true);
-
   // Fill in sparse point cloud message
-  points.height = dense_points_.rows;
-  points.width  = dense_points_.cols;
+  const sensor_msgs::Image& dimage = disparity.image;
+  points.height = dimage.height;
+  points.width  = dimage.width;
   points.fields.resize (4);
   points.fields[0].name = "x";
   points.fields[0].offset = 0;
@@ -267,101 +265,169 @@ void StereoProcessor::processPoints2(const stereo_msgs::DisparityImage& disparit
   points.row_step = points.point_step * points.width;
   points.data.resize (points.row_step * points.height);
   points.is_dense = false; // there may be invalid points
- 
-  float bad_point = std::numeric_limits<float>::quiet_NaN ();
-  int i = 0;
-  for (int32_t u = 0; u < dense_points_.rows; ++u) {
-    for (int32_t v = 0; v < dense_points_.cols; ++v, ++i) {
-      if (isValidPoint(dense_points_(u,v))) {
-        // x,y,z,rgba
-        memcpy (&points.data[i * points.point_step + 0], &dense_points_(u,v)[0], sizeof (float));
-        memcpy (&points.data[i * points.point_step + 4], &dense_points_(u,v)[1], sizeof (float));
-        memcpy (&points.data[i * points.point_step + 8], &dense_points_(u,v)[2], sizeof (float));
-      }
-      else {
-        memcpy (&points.data[i * points.point_step + 0], &bad_point, sizeof (float));
-        memcpy (&points.data[i * points.point_step + 4], &bad_point, sizeof (float));
-        memcpy (&points.data[i * points.point_step + 8], &bad_point, sizeof (float));
-      }
-    }
-  }
 
-  // Fill in color
+  // Project straight into the message, every byte of which is overwritten
+  const cv::Mat_<float> dmat(dimage.height, dimage.width, (float*)&dimage.data[0], dimage.step);
+  if (!projectDisparityToPointCloud2(dmat, color, encoding, model, 12, true, points))
+    ROS_WARN("Could not fill color channel of the point cloud, unrecognized encoding '%s'", encoding.c_str());
+}
+
+namespace {
+
+enum ColorLayout
+{
+  COLOR_NONE, COLOR_MONO8, COLOR_RGB8, COLOR_RGBA8, COLOR_BGR8, COLOR_BGRA8
+};
+
+ColorLayout colorLayout(const std::string& encoding)
+{
   namespace enc = sensor_msgs::image_encodings;
-  i = 0;
-  if (encoding == enc::MONO8) {
-    for (int32_t u = 0; u < dense_points_.rows; ++u) {
-      for (int32_t v = 0; v < dense_points_.cols; ++v, ++i) {
-        if (isValidPoint(dense_points_(u,v))) {
-          uint8_t g = color.at<uint8_t>(u,v);
-          int32_t rgb = (g << 16) | (g << 8) | g;
-          memcpy (&points.data[i * points.point_step + 12], &rgb, sizeof (int32_t));
-        }
-        else {
-          memcpy (&points.data[i * points.point_step + 12], &bad_point, sizeof (float));
-        }
-      }
-    }
+  if (encoding == enc::MONO8)
+    return COLOR_MONO8;
+  if (encoding == enc::RGB8)
+    return COLOR_RGB8;
+  if (encoding == enc::RGBA8)
+    return COLOR_RGBA8;
+  if (encoding == enc::BGR8)
+    return COLOR_BGR8;
+  if (encoding == enc::BGRA8)
+    return COLOR_BGRA8;
+  return COLOR_NONE;
+}
+
+// Packed 0x00RRGGBB color of pixel u in a row of the color image
+inline uint32_t packColor(const uint8_t* row, int u, ColorLayout layout)
+{
+  const uint8_t* p;
+  switch (layout) {
+    case COLOR_MONO8:
+      return (uint32_t(row[u]) << 16) | (uint32_t(row[u]) << 8) | row[u];
+    case COLOR_RGB8:
+      p = row + 3 * u;
+      return (uint32_t(p[0]) << 16) | (uint32_t(p[1]) << 8) | p[2];
+    case COLOR_RGBA8:
+      p = row + 4 * u;
+      return (uint32_t(p[0]) << 16) | (uint32_t(p[1]) << 8) | p[2];
+    case COLOR_BGR8:
+      p = row + 3 * u;
+      return (uint32_t(p[2]) << 16) | (uint32_t(p[1]) << 8) | p[0];
+    case COLOR_BGRA8:
+      p = row + 4 * u;
+      return (uint32_t(p[2]) << 16) | (uint32_t(p[1]) << 8) | p[0];
+    default:
+      return 0;
   }
-  else if (encoding == enc::RGB8) {
-    for (int32_t u = 0; u < dense_points_.rows; ++u) {
-      for (int32_t v = 0; v < dense_points_.cols; ++v, ++i) {
-        if (isValidPoint(dense_points_(u,v))) {
-          const cv::Vec3b& rgb = color.at<cv::Vec3b>(u,v);
-          int32_t rgb_packed = (rgb[0] << 16) | (rgb[1] << 8) | rgb[2];
-          memcpy (&points.data[i * points.point_step + 12], &rgb_packed, sizeof (int32_t));
-        }
-        else {
-          memcpy (&points.data[i * points.point_step + 12], &bad_point, sizeof (float));
-        }
-      }
-    }
+}
+
+// Row body of projectDisparityToPointCloud2. Evaluates [X Y Z W]^T = Q * [u v d 1]^T with the
+// u, v and constant terms hoisted out of the inner loop, and writes runs of missing disparities
+// as NaN without projecting them.
+class DisparityToPointCloud2 : public cv::ParallelLoopBody
+{
+public:
+  DisparityToPointCloud2(const cv::Mat_<float>& disparity, const cv::Mat& color, ColorLayout layout,
+                         const cv::Matx44d& Q, double missing_disparity,
+                         uint32_t rgb_offset, bool nan_invalid_rgb, sensor_msgs::PointCloud2& points)
+    : disparity_(disparity), color_(color), layout_(layout), Q_(Q),
+      missing_disparity_(missing_disparity), rgb_offset_(rgb_offset),
+      nan_invalid_rgb_(nan_invalid_rgb), points_(points)
+  {
   }
-  else if (encoding == enc::RGBA8) {
-    for (int32_t u = 0; u < dense_points_.rows; ++u) {
-      for (int32_t v = 0; v < dense_points_.cols; ++v, ++i) {
-        if (isValidPoint(dense_points_(u,v))) {
-          const cv::Vec4b& rgba = color.at<cv::Vec4b>(u,v);
-          int32_t rgb_packed = (rgba[0] << 16) | (rgba[1] << 8) | rgba[2];
-          memcpy (&points.data[i * points.point_step + 12], &rgb_packed, sizeof (int32_t));
-        }
-        else {
-          memcpy (&points.data[i * points.point_step + 12], &bad_point, sizeof (float));
+
+  virtual void operator()(const cv::Range& rows) const
+  {
+    const float bad_point = std::numeric_limits<float>::quiet_NaN();
+    const uint32_t step = points_.point_step;
+    const int width = disparity_.cols;
+
+    for (int v = rows.start; v < rows.end; ++v) {
+      const float* d = disparity_[v];
+      const uint8_t* color = layout_ == COLOR_NONE ? NULL : color_.ptr<uint8_t>(v);
+      uint8_t* out = &points_.data[v * points_.row_step];
+
+      // Per-row constants of the reprojection
+      const double bx = Q_(0,1) * v + Q_(0,3), by = Q_(1,1) * v + Q_(1,3);
+      const double bz = Q_(2,1) * v + Q_(2,3), bw = Q_(3,1) * v + Q_(3,3);
+
+      int u = 0;
+      while (u < width) {
+        // Skip the run of missing disparities in one go
+        int end = u;
+        while (end < width && std::fabs(d[end] - missing_disparity_) <= FLT_EPSILON)
+          ++end;
+        for (; u < end; ++u)
+          writeInvalid(out + u * step, color, u, bad_point);
+
+        // Project the run of present disparities
+        for (; u < width && std::fabs(d[u] - missing_disparity_) > FLT_EPSILON; ++u) {
+          const double du = u, dd = d[u];
+          const double w = 1.0 / (Q_(3,0) * du + Q_(3,2) * dd + bw);
+          float xyz[3] = { float((Q_(0,0) * du + Q_(0,2) * dd + bx) * w),
+                           float((Q_(1,0) * du + Q_(1,2) * dd + by) * w),
+                           float((Q_(2,0) * du + Q_(2,2) * dd + bz) * w) };
+          uint8_t* p = out + u * step;
+          // Zero disparity maps the point to infinity
+          if (std::isinf(xyz[2])) {
+            writeInvalid(p, color, u, bad_point);
+            continue;
+          }
+          memcpy(p, xyz, sizeof(xyz));
+          uint32_t rgb = color ? packColor(color, u, layout_) : 0;
+          memcpy(p + rgb_offset_, &rgb, sizeof(uint32_t));
         }
       }
     }
   }
-  else if (encoding == enc::BGR8) {
-    for (int32_t u = 0; u < dense_points_.rows; ++u) {
-      for (int32_t v = 0; v < dense_points_.cols; ++v, ++i) {
-        if (isValidPoint(dense_points_(u,v))) {
-          const cv::Vec3b& bgr = color.at<cv::Vec3b>(u,v);
-          int32_t rgb_packed = (bgr[2] << 16) | (bgr[1] << 8) | bgr[0];
-          memcpy (&points.data[i * points.point_step + 12], &rgb_packed, sizeof (int32_t));
-        }
-        else {
-          memcpy (&points.data[i * points.point_step + 12], &bad_point, sizeof (float));
-        }
-      }
+
+private:
+  inline void writeInvalid(uint8_t* p, const uint8_t* color, int u, float bad_point) const
+  {
+    const float xyz[3] = { bad_point, bad_point, bad_point };
+    memcpy(p, xyz, sizeof(xyz));
+    if (nan_invalid_rgb_ && color) {
+      memcpy(p + rgb_offset_, &bad_point, sizeof(float));
     }
-  }
-  else if (encoding == enc::BGRA8) {
-    for (int32_t u = 0; u < dense_points_.rows; ++u) {
-      for (int32_t v = 0; v < dense_points_.cols; ++v, ++i) {
-        if (isValidPoint(dense_points_(u,v))) {
-          const cv::Vec4b& bgra = color.at<cv::Vec4b>(u,v);
-          int32_t rgb_packed = (bgra[2] << 16) | (bgra[1] << 8) | bgra[0];
-          memcpy (&points.data[i * points.point_step + 12], &rgb_packed, sizeof (int32_t));
-        }
-        else {
-          memcpy (&points.data[i * points.point_step + 12], &bad_point, sizeof (float));
-        }
-      }
+    else {
+      uint32_t rgb = color ? packColor(color, u, layout_) : 0;
+      memcpy(p + rgb_offset_, &rgb, sizeof(uint32_t));
     }
   }
-  else {
-    ROS_WARN("Could not fill color channel of the point cloud, unrecognized encoding '%s'", encoding.c_str());
-  }
+
+  const cv::Mat_<float>& disparity_;
+  const cv::Mat& color_;
+  ColorLayout layout_;
+  cv::Matx44d Q_;
+  double missing_disparity_;
+  uint32_t rgb_offset_;
+  bool nan_invalid_rgb_;
+  sensor_msgs::PointCloud2& points_;
+};
+
+} // namespace
+
+bool projectDisparityToPointCloud2(const cv::Mat_<float>& disparity,
+                                   const cv::Mat& color, const std::string& encoding,
+                                   const image_geometry::StereoCameraModel& model,
+                                   uint32_t rgb_offset, bool nan_invalid_rgb,
+                                   sensor_msgs::PointCloud2& points)
+{
+  ROS_ASSERT(points.height == (uint32_t)disparity.rows && points.width == (uint32_t)disparity.cols);
+  ROS_ASSERT(points.data.size() >= (size_t)points.row_step * points.height);
+
+  ColorLayout layout = colorLayout(encoding);
+  if (color.rows != disparity.rows || color.cols != disparity.cols)
+    layout = COLOR_NONE;
+
+  // Like cv::reprojectImageTo3D with handleMissingValues, the smallest disparity in the image
+  // marks the pixels the block matcher could not match.
+  double missing_disparity = 0.0;
+  if (!disparity.empty())
+    cv::minMaxIdx(disparity, &missing_disparity, NULL);
+
+  cv::parallel_for_(cv::Range(0, disparity.rows),
+                    DisparityToPointCloud2(disparity, color, layout, model.reprojectionMatrix(),
+                                           missing_disparity, rgb_offset, nan_invalid_rgb, points));
+  return layout != COLOR_NONE;
 }
 
 } //namespace stereo_image_proc
@@ -90,6 +90,8 @@ class DisparityNodelet : public nodelet::Nodelet
   // Processing state (note: only safe because we're single-threaded!)
   image_geometry::StereoCameraModel model_;
   stereo_image_proc::StereoProcessor block_matcher_; // contains scratch buffers for block matching
+  DisparityImagePtr disp_msg_; // last published disparity, reused once no one else holds it
+  cv::Mat blurred_image_, l_sub_image_, r_sub_image_, disp_upsampled_image_; // scratch buffers
 
   virtual void onInit();
 
@@ -169,10 +171,10 @@ void DisparityNodelet::connectCb()
   }
 }
 
-cv::Mat subsampleTheImage(
+void subsampleTheImage(
     const cv::Mat& input_image,
-    const uint32_t downsample_factor_per_dimension) {
-  cv::Mat blurred_image;
+    const uint32_t downsample_factor_per_dimension,
+    cv::Mat& blurred_image, cv::Mat& downsampled_image) {
   const int32_t kernel_size = 2 * downsample_factor_per_dimension + 1;
   cv::GaussianBlur(
       input_image, blurred_image, cv::Size(kernel_size, kernel_size),
@@ -186,7 +188,7 @@ cv::Mat subsampleTheImage(
   uint32_t downsampled_width = std::ceil(
       input_image.size().width /
       static_cast<double>(downsample_factor_per_dimension));
-  cv::Mat downsampled_image(
+  downsampled_image.create(
       downsampled_height, downsampled_width, input_image.type());
 
   for (uint32_t destination_row = 0u;
@@ -199,13 +201,14 @@ cv::Mat subsampleTheImage(
               destination_col * downsample_factor_per_dimension);
     }
   }
-  return downsampled_image;
 }
 
-cv::Mat upsampleTheDisparityImageWithoutInterpolation(
+void upsampleTheDisparityImageWithoutInterpolation(
     const cv::Mat& disparity, const cv::Size& destination_size,
-    const uint32_t upsample_factor_per_dimension) {
-  cv::Mat upsampled_disparity(destination_size, disparity.type(), -1.);
+    const uint32_t upsample_factor_per_dimension,
+    cv::Mat& upsampled_disparity) {
+  // Every pixel is written below, so a reused buffer needs no initialization
+  upsampled_disparity.create(destination_size, disparity.type());
 
   for (uint32_t destination_row = 0u;
        destination_row < upsampled_disparity.size().height; destination_row++) {
@@ -219,7 +222,6 @@ cv::Mat upsampleTheDisparityImageWithoutInterpolation(
               destination_col / upsample_factor_per_dimension);
     }
   }
-  return upsampled_disparity;
 }
 
 void DisparityNodelet::imageCb(const ImageConstPtr& l_image_msg,
@@ -230,8 +232,10 @@ void DisparityNodelet::imageCb(const ImageConstPtr& l_image_msg,
   // Update the camera model
   model_.fromCameraInfo(l_info_msg, r_info_msg);
 
-  // Allocate new disparity image message
-  DisparityImagePtr disp_msg = boost::make_shared<DisparityImage>();
+  // Reuse the last message's storage unless a subscriber in this process still holds it
+  if (!disp_msg_ || !disp_msg_.unique())
+    disp_msg_ = boost::make_shared<DisparityImage>();
+  DisparityImagePtr disp_msg = disp_msg_;
   disp_msg->header         = l_info_msg->header;
   disp_msg->image.header   = l_info_msg->header;
 
@@ -251,32 +255,27 @@ void DisparityNodelet::imageCb(const ImageConstPtr& l_image_msg,
   const cv::Mat_<uint8_t> l_image = cv_bridge::toCvShare(l_image_msg, sensor_msgs::image_encodings::MONO8)->image;
   const cv::Mat_<uint8_t> r_image = cv_bridge::toCvShare(r_image_msg, sensor_msgs::image_encodings::MONO8)->image;
 
-  cv::Mat_<uint8_t> l_sub_image;
-  cv::Mat_<uint8_t> r_sub_image;
-
+  // Perform block matching to find the disparities
   if (downsampling_factor_ != 1) {
-    l_sub_image = subsampleTheImage(l_image, downsampling_factor_);
-    r_sub_image = subsampleTheImage(r_image, downsampling_factor_);
+    subsampleTheImage(l_image, downsampling_factor_, blurred_image_, l_sub_image_);
+    subsampleTheImage(r_image, downsampling_factor_, blurred_image_, r_sub_image_);
+    block_matcher_.processDisparity(l_sub_image_, r_sub_image_, model_, *disp_msg);
   } else {
-    l_sub_image = l_image;
-    r_sub_image = r_image;
+    block_matcher_.processDisparity(l_image, r_image, model_, *disp_msg);
   }
 
-  // Perform block matching to find the disparities
-  block_matcher_.processDisparity(l_sub_image, r_sub_image, model_, *disp_msg);
-
   // Upsampling
   if (downsampling_factor_ != 1) {
     const cv::Mat disp_subsampled_image =
         cv_bridge::toCvShare(
             disp_msg->image, disp_msg, sensor_msgs::image_encodings::TYPE_32FC1)
             ->image;
-    const cv::Mat disp_upsampled_image =
-        upsampleTheDisparityImageWithoutInterpolation(
-            disp_subsampled_image, l_image.size(), downsampling_factor_);
+    upsampleTheDisparityImageWithoutInterpolation(
+        disp_subsampled_image, l_image.size(), downsampling_factor_,
+        disp_upsampled_image_);
     const cv_bridge::CvImage disp_image_container = cv_bridge::CvImage(
         disp_msg->header, sensor_msgs::image_encodings::TYPE_32FC1,
-        disp_upsampled_image);
+        disp_upsampled_image_);
     disp_image_container.toImageMsg(disp_msg->image);
   }
 
@@ -51,6 +51,8 @@
 #include <sensor_msgs/image_encodings.h>
 #include <sensor_msgs/point_cloud2_iterator.h>
 
+#include <stereo_image_proc/processor.h>
+
 namespace stereo_image_proc {
 
 using namespace sensor_msgs;
@@ -78,7 +80,7 @@ class PointCloud2Nodelet : public nodelet::Nodelet
 
   // Processing state (note: only safe because we're single-threaded!)
   image_geometry::StereoCameraModel model_;
-  cv::Mat_<cv::Vec3f> points_mat_; // scratch buffer
+  PointCloud2Ptr points_msg_; // last published cloud, reused once no one else holds it
   
   virtual void onInit();
 
@@ -149,13 +151,6 @@ void PointCloud2Nodelet::connectCb()
   }
 }
 
-inline bool isValidPoint(const cv::Vec3f& pt)
-{
-  // Check both for disparities explicitly marked as invalid (where OpenCV maps pt.z to MISSING_Z)
-  // and zero disparities (point mapped to infinity).
-  return pt[2] != image_geometry::StereoCameraModel::MISSING_Z && !std::isinf(pt[2]);
-}
-
 void PointCloud2Nodelet::imageCb(const ImageConstPtr& l_image_msg,
                                  const CameraInfoConstPtr& l_info_msg,
                                  const CameraInfoConstPtr& r_info_msg,
@@ -164,134 +159,33 @@ void PointCloud2Nodelet::imageCb(const ImageConstPtr& l_image_msg,
   // Update the camera model
   model_.fromCameraInfo(l_info_msg, r_info_msg);
 
-  // Calculate point cloud
-  const Image& dimage = disp_msg->image;
-  const cv::Mat_<float> dmat(dimage.height, dimage.width, (float*)&dimage.data[0], dimage.step);
-  model_.projectDisparityImageTo3d(dmat, points_mat_, true);
-  cv::Mat_<cv::Vec3f> mat = points_mat_;
+  // Reuse the last message's storage unless a subscriber in this process still holds it
+  if (!points_msg_ || !points_msg_.unique())
+    points_msg_ = boost::make_shared<PointCloud2>();
+  PointCloud2Ptr points_msg = points_msg_;
 
-  // Fill in new PointCloud2 message (2D image-like layout)
-  PointCloud2Ptr points_msg = boost::make_shared<PointCloud2>();
+  // Fill in PointCloud2 message (2D image-like layout)
+  const Image& dimage = disp_msg->image;
   points_msg->header = disp_msg->header;
-  points_msg->height = mat.rows;
-  points_msg->width  = mat.cols;
+  points_msg->height = dimage.height;
+  points_msg->width  = dimage.width;
   points_msg->is_bigendian = false;
   points_msg->is_dense = false; // there may be invalid points
 
   sensor_msgs::PointCloud2Modifier pcd_modifier(*points_msg);
   pcd_modifier.setPointCloud2FieldsByString(2, "xyz", "rgb");
+  uint32_t rgb_offset = points_msg->fields[3].offset;
 
-  sensor_msgs::PointCloud2Iterator<float> iter_x(*points_msg, "x");
-  sensor_msgs::PointCloud2Iterator<float> iter_y(*points_msg, "y");
-  sensor_msgs::PointCloud2Iterator<float> iter_z(*points_msg, "z");
-  sensor_msgs::PointCloud2Iterator<uint8_t> iter_r(*points_msg, "r");
-  sensor_msgs::PointCloud2Iterator<uint8_t> iter_g(*points_msg, "g");
-  sensor_msgs::PointCloud2Iterator<uint8_t> iter_b(*points_msg, "b");
-
-  float bad_point = std::numeric_limits<float>::quiet_NaN ();
-  for (int v = 0; v < mat.rows; ++v)
-  {
-    for (int u = 0; u < mat.cols; ++u, ++iter_x, ++iter_y, ++iter_z)
-    {
-      if (isValidPoint(mat(v,u)))
-      {
-        // x,y,z
-        *iter_x = mat(v, u)[0];
-        *iter_y = mat(v, u)[1];
-        *iter_z = mat(v, u)[2];
-      }
-      else
-      {
-        *iter_x = *iter_y = *iter_z = bad_point;
-      }
-    }
-  }
-
-  // Fill in color
-  namespace enc = sensor_msgs::image_encodings;
-  const std::string& encoding = l_image_msg->encoding;
-  if (encoding == enc::MONO8)
-  {
-    const cv::Mat_<uint8_t> color(l_image_msg->height, l_image_msg->width,
-                                  (uint8_t*)&l_image_msg->data[0],
-                                  l_image_msg->step);
-    for (int v = 0; v < mat.rows; ++v)
-    {
-      for (int u = 0; u < mat.cols; ++u, ++iter_r, ++iter_g, ++iter_b)
-      {
-        uint8_t g = color(v,u);
-        *iter_r = *iter_g = *iter_b = g;
-      }
-    }
-  }
-  else if (encoding == enc::RGB8)
-  {
-    const cv::Mat_<cv::Vec3b> color(l_image_msg->height, l_image_msg->width,
-                                    (cv::Vec3b*)&l_image_msg->data[0],
-                                    l_image_msg->step);
-    for (int v = 0; v < mat.rows; ++v)
-    {
-      for (int u = 0; u < mat.cols; ++u, ++iter_r, ++iter_g, ++iter_b)
-      {
-        const cv::Vec3b& rgb = color(v,u);
-        *iter_r = rgb[0];
-        *iter_g = rgb[1];
-        *iter_b = rgb[2];
-      }
-    }
-  }
-  else if (encoding == enc::RGBA8)
-  {
-    const cv::Mat_<cv::Vec4b> color(l_image_msg->height, l_image_msg->width,
-                                    (cv::Vec4b*)&l_image_msg->data[0],
-                                    l_image_msg->step);
-    for (int v = 0; v < mat.rows; ++v)
-    {
-      for (int u = 0; u < mat.cols; ++u, ++iter_r, ++iter_g, ++iter_b)
-      {
-        const cv::Vec4b& rgba = color(v,u);
-        *iter_r = rgba[0];
-        *iter_g = rgba[1];
-        *iter_b = rgba[2];
-      }
-    }
-  }
-  else if (encoding == enc::BGR8)
-  {
-    const cv::Mat_<cv::Vec3b> color(l_image_msg->height, l_image_msg->width,
-                                    (cv::Vec3b*)&l_image_msg->data[0],
-                                    l_image_msg->step);
-    for (int v = 0; v < mat.rows; ++v)
-    {
-      for (int u = 0; u < mat.cols; ++u, ++iter_r, ++iter_g, ++iter_b)
-      {
-        const cv::Vec3b& bgr = color(v,u);
-        *iter_r = bgr[2];
-        *iter_g = bgr[1];
-        *iter_b = bgr[0];
-      }
-    }
-  }
-  else if (encoding == enc::BGRA8)
-  {
-    const cv::Mat_<cv::Vec4b> color(l_image_msg->height, l_image_msg->width,
-                                    (cv::Vec4b*)&l_image_msg->data[0],
-                                    l_image_msg->step);
-    for (int v = 0; v < mat.rows; ++v)
-    {
-      for (int u = 0; u < mat.cols; ++u, ++iter_r, ++iter_g, ++iter_b)
-      {
-        const cv::Vec4b& bgra = color(v,u);
-        *iter_r = bgra[2];
-        *iter_g = bgra[1];
-        *iter_b = bgra[0];
-      }
-    }
-  }
-  else
+  // Project the disparities and fill in color in a single pass
+  const cv::Mat_<float> dmat(dimage.height, dimage.width, (float*)&dimage.data[0], dimage.step);
+  // Byte view of the color rows; pixels are unpacked according to the encoding
+  const cv::Mat color(l_image_msg->height, l_image_msg->width, CV_8UC1,
+                      const_cast<uint8_t*>(&l_image_msg->data[0]), l_image_msg->step);
+  if (!projectDisparityToPointCloud2(dmat, color, l_image_msg->encoding, model_,
+                                     rgb_offset, false, *points_msg))
   {
     NODELET_WARN_THROTTLE(30, "Could not fill color channel of the point cloud, "
-                          "unsupported encoding '%s'", encoding.c_str());
+                          "unsupported encoding '%s'", l_image_msg->encoding.c_str());
   }
 
   pub_points2_.publish(points_msg);
@@ -0,0 +1,217 @@
+#include <gtest/gtest.h>
+#include <opencv2/core/core.hpp>
+#include <opencv2/calib3d/calib3d.hpp>
+#include <sensor_msgs/image_encodings.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#include "stereo_image_proc/processor.h"
+
+// Checks projectDisparityToPointCloud2 against cv::reprojectImageTo3D, which the point cloud
+// nodelet used before the projection was fused into the message.
+
+namespace
+{
+
+const int WIDTH = 40;
+const int HEIGHT = 30;
+const float MISSING = -1.0f;
+
+sensor_msgs::CameraInfo makeInfo(double Tx)
+{
+  sensor_msgs::CameraInfo info;
+  info.width = WIDTH;
+  info.height = HEIGHT;
+  info.distortion_model = "plumb_bob";
+  info.D.resize(5, 0.0);
+  double K[9] = { 50.0, 0.0, 19.5, 0.0, 52.0, 14.5, 0.0, 0.0, 1.0 };
+  double R[9] = { 1.0, 0.0, 0.0, 0.0, 1.0, 0.0, 0.0, 0.0, 1.0 };
+  double P[12] = { 50.0, 0.0, 19.5, Tx, 0.0, 52.0, 14.5, 0.0, 0.0, 0.0, 1.0, 0.0 };
+  std::copy(K, K + 9, info.K.begin());
+  std::copy(R, R + 9, info.R.begin());
+  std::copy(P, P + 12, info.P.begin());
+  return info;
+}
+
+image_geometry::StereoCameraModel makeModel()
+{
+  image_geometry::StereoCameraModel model;
+  model.fromCameraInfo(makeInfo(0.0), makeInfo(-50.0 * 0.1));
+  return model;
+}
+
+// Mostly valid disparities, with runs of missing ones (the smallest value in the image) at row
+// starts, row ends and in between, a fully missing row, zero disparities that project to infinity
+// and out of range disparities that are negative or far too large.
+cv::Mat_<float> makeDisparity()
+{
+  cv::Mat_<float> disparity(HEIGHT, WIDTH);
+  uint32_t state = 7;
+  for (int v = 0; v < HEIGHT; ++v)
+  {
+    for (int u = 0; u < WIDTH; ++u)
+    {
+      state = state * 1664525u + 1013904223u;
+      disparity(v, u) = 1.0f + (state >> 8) * (40.0f / (1 << 24));
+    }
+  }
+  for (int v = 0; v < HEIGHT; ++v)
+  {
+    disparity(v, 0) = MISSING;
+    disparity(v, WIDTH - 1) = MISSING;
+    for (int u = 10; u < 10 + v % 5; ++u)
+      disparity(v, u) = MISSING;
+  }
+  for (int u = 0; u < WIDTH; ++u)
+    disparity(5, u) = MISSING;
+  disparity(3, 20) = 0.0f;
+  disparity(17, 7) = 0.0f;
+  disparity(8, 30) = -0.5f;
+  disparity(12, 2) = 1e6f;
+  disparity(20, 25) = 1e-6f;
+  return disparity;
+}
+
+cv::Mat makeColor()
+{
+  cv::Mat color(HEIGHT, WIDTH, CV_8UC3);
+  for (int v = 0; v < HEIGHT; ++v)
+  {
+    for (int u = 0; u < WIDTH; ++u)
+      color.at<cv::Vec3b>(v, u) = cv::Vec3b(u * 6, v * 8, (u + v) * 3);
+  }
+  return color;
+}
+
+sensor_msgs::PointCloud2 makeCloud()
+{
+  sensor_msgs::PointCloud2 points;
+  points.height = HEIGHT;
+  points.width = WIDTH;
+  points.point_step = 16;
+  points.row_step = points.point_step * points.width;
+  // Garbage that every point has to overwrite
+  points.data.assign(points.row_step * points.height, 0xab);
+  return points;
+}
+
+// The validity check the point cloud nodelet applied to the output of cv::reprojectImageTo3D
+bool isValidPoint(const cv::Vec3f& pt)
+{
+  return pt[2] != image_geometry::StereoCameraModel::MISSING_Z && !std::isinf(pt[2]);
+}
+
+const float* pointAt(const sensor_msgs::PointCloud2& points, int v, int u)
+{
+  return reinterpret_cast<const float*>(&points.data[v * points.row_step + u * points.point_step]);
+}
+
+uint32_t rgbAt(const sensor_msgs::PointCloud2& points, int v, int u)
+{
+  uint32_t rgb;
+  memcpy(&rgb, &points.data[v * points.row_step + u * points.point_step + 12], sizeof(rgb));
+  return rgb;
+}
+
+uint32_t packBgr(const cv::Vec3b& bgr)
+{
+  return (uint32_t(bgr[2]) << 16) | (uint32_t(bgr[1]) << 8) | bgr[0];
+}
+
+void expectMatchesReference(const cv::Mat_<float>& disparity, const cv::Mat& color, bool nan_invalid_rgb,
+                            const sensor_msgs::PointCloud2& points)
+{
+  image_geometry::StereoCameraModel model = makeModel();
+  cv::Mat_<cv::Vec3f> reference;
+  cv::reprojectImageTo3D(disparity, reference, model.reprojectionMatrix(), true);
+
+  int valid = 0, invalid = 0;
+  for (int v = 0; v < HEIGHT; ++v)
+  {
+    for (int u = 0; u < WIDTH; ++u)
+    {
+      const cv::Vec3f& expected = reference(v, u);
+      const float* xyz = pointAt(points, v, u);
+      uint32_t rgb = rgbAt(points, v, u);
+      uint32_t expected_rgb = color.empty() ? 0 : packBgr(color.at<cv::Vec3b>(v, u));
+
+      if (isValidPoint(expected))
+      {
+        ++valid;
+        for (int i = 0; i < 3; ++i)
+          EXPECT_NEAR(expected[i], xyz[i], 1e-4 * std::max(1.0f, std::fabs(expected[i]))) << "at " << u << "," << v;
+        EXPECT_EQ(expected_rgb, rgb) << "at " << u << "," << v;
+      }
+      else
+      {
+        ++invalid;
+        EXPECT_TRUE(std::isnan(xyz[0]) && std::isnan(xyz[1]) && std::isnan(xyz[2])) << "at " << u << "," << v;
+        if (nan_invalid_rgb && !color.empty())
+        {
+          float rgb_float;
+          memcpy(&rgb_float, &rgb, sizeof(rgb_float));
+          EXPECT_TRUE(std::isnan(rgb_float)) << "at " << u << "," << v;
+        }
+        else
+        {
+          EXPECT_EQ(expected_rgb, rgb) << "at " << u << "," << v;
+        }
+      }
+    }
+  }
+  // Both kinds of points have to be there for the comparison to mean anything
+  EXPECT_GT(valid, WIDTH * HEIGHT / 2);
+  EXPECT_GT(invalid, 2 * HEIGHT + WIDTH);
+}
+
+} // namespace
+
+TEST(Projection, matchesReprojectImageTo3D)
+{
+  cv::Mat_<float> disparity = makeDisparity();
+  cv::Mat color = makeColor();
+  sensor_msgs::PointCloud2 points = makeCloud();
+  EXPECT_TRUE(stereo_image_proc::projectDisparityToPointCloud2(disparity, color, sensor_msgs::image_encodings::BGR8,
+                                                               makeModel(), 12, true, points));
+  expectMatchesReference(disparity, color, true, points);
+}
+
+TEST(Projection, keepsColorOfInvalidPoints)
+{
+  cv::Mat_<float> disparity = makeDisparity();
+  cv::Mat color = makeColor();
+  sensor_msgs::PointCloud2 points = makeCloud();
+  EXPECT_TRUE(stereo_image_proc::projectDisparityToPointCloud2(disparity, color, sensor_msgs::image_encodings::BGR8,
+                                                               makeModel(), 12, false, points));
+  expectMatchesReference(disparity, color, false, points);
+}
+
+TEST(Projection, unsupportedEncoding)
+{
+  cv::Mat_<float> disparity = makeDisparity();
+  sensor_msgs::PointCloud2 points = makeCloud();
+  EXPECT_FALSE(stereo_image_proc::projectDisparityToPointCloud2(disparity, cv::Mat(), sensor_msgs::image_encodings::MONO16,
+                                                                makeModel(), 12, true, points));
+  // rgb is zeroed, also for invalid points
+  expectMatchesReference(disparity, cv::Mat(), true, points);
+}
+
+TEST(Projection, allMissing)
+{
+  cv::Mat_<float> disparity(HEIGHT, WIDTH, MISSING);
+  sensor_msgs::PointCloud2 points = makeCloud();
+  stereo_image_proc::projectDisparityToPointCloud2(disparity, cv::Mat(), "", makeModel(), 12, true, points);
+  for (int v = 0; v < HEIGHT; ++v)
+  {
+    for (int u = 0; u < WIDTH; ++u)
+      EXPECT_TRUE(std::isnan(pointAt(points, v, u)[2]));
+  }
+}
+
+int main(int argc, char** argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -47,11 +47,14 @@ namespace compressed_depth_image_transport
 sensor_msgs::Image::Ptr decodeCompressedDepthImage(const sensor_msgs::CompressedImage& compressed_image);
 
 // Compress a depth image. Returns a null pointer on bad input.
+// With num_strips > 1 the image is split into row strips that are quantized
+// and compressed in parallel; decoding such images needs this version or later.
 sensor_msgs::CompressedImage::Ptr encodeCompressedDepthImage(
     const sensor_msgs::Image& message,
     const std::string& compression_format,
     double depth_max,
     double depth_quantization,
-    int png_level);
+    int png_level,
+    int num_strips = 1);
 
 }  // namespace compressed_depth_image_transport
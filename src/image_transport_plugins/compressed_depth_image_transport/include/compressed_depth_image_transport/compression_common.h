@@ -35,13 +35,17 @@
 #ifndef COMPRESSED_DEPTH_IMAGE_TRANSPORT_COMPRESSION_COMMON
 #define COMPRESSED_DEPTH_IMAGE_TRANSPORT_COMPRESSION_COMMON
 
+#include <stdint.h>
+
 namespace compressed_depth_image_transport
 {
 
 // Compression formats
 enum compressionFormat
 {
-  UNDEFINED = -1, INV_DEPTH
+  UNDEFINED = -1, INV_DEPTH,
+  // Image split into row strips that are compressed independently, see StripHeader
+  STRIPED
 };
 
 // Compression configuration
@@ -53,6 +57,16 @@ struct ConfigHeader
   float depthParam[2];
 };
 
+// Follows the ConfigHeader of STRIPED images, and is itself followed by the
+// compressed size of each strip (uint32_t) and then the strips in order.
+// Strip i holds rows [i * rows / numStrips, (i + 1) * rows / numStrips).
+struct StripHeader
+{
+  uint32_t cols;
+  uint32_t rows;
+  uint32_t numStrips;
+};
+
 } //namespace compressed_depth_image_transport
 
 #endif
@@ -33,6 +33,7 @@
 *  POSSIBILITY OF SUCH DAMAGE.
 *********************************************************************/
 
+#include <algorithm>
 #include <limits>
 #include <string>
 #include <vector>
@@ -62,6 +63,255 @@ using namespace cv;
 namespace compressed_depth_image_transport
 {
 
+namespace
+{
+
+// Rows covered by one strip, as documented for StripHeader
+Range stripRows(int strip, int num_strips, int rows)
+{
+  return Range(static_cast<int>(static_cast<int64_t>(strip) * rows / num_strips),
+               static_cast<int>(static_cast<int64_t>(strip + 1) * rows / num_strips));
+}
+
+// The per-pixel loops below are kept branch-free so the compiler can vectorize them.
+
+void quantizeInvDepth(const Mat& depth, Mat& inv_depth, float depthQuantA, float depthQuantB, float depthMax)
+{
+  for (int row = 0; row < depth.rows; ++row)
+  {
+    const float* src = depth.ptr<float>(row);
+    unsigned short* dst = inv_depth.ptr<unsigned short>(row);
+    for (int col = 0; col < depth.cols; ++col)
+    {
+      // NaN & max depth are coded as 0
+      const float z = src[col];
+      const float inv = (z < depthMax) ? depthQuantA / z + depthQuantB : 0.0f;
+      dst[col] = static_cast<unsigned short>(inv);
+    }
+  }
+}
+
+void dequantizeInvDepth(const Mat& inv_depth, Mat& depth, float depthQuantA, float depthQuantB)
+{
+  const float nan = std::numeric_limits<float>::quiet_NaN();
+  for (int row = 0; row < inv_depth.rows; ++row)
+  {
+    const unsigned short* src = inv_depth.ptr<unsigned short>(row);
+    float* dst = depth.ptr<float>(row);
+    for (int col = 0; col < inv_depth.cols; ++col)
+    {
+      const float z = depthQuantA / ((float)src[col] - depthQuantB);
+      dst[col] = src[col] ? z : nan;
+    }
+  }
+}
+
+void filterMaxDepth(const Mat& depth, Mat& filtered, unsigned short depthMax)
+{
+  for (int row = 0; row < depth.rows; ++row)
+  {
+    const unsigned short* src = depth.ptr<unsigned short>(row);
+    unsigned short* dst = filtered.ptr<unsigned short>(row);
+    for (int col = 0; col < depth.cols; ++col)
+      dst[col] = (src[col] > depthMax) ? 0 : src[col];
+  }
+}
+
+bool compressStrip(const Mat& image, const std::string& compression_format, const std::vector<int>& params,
+                   std::vector<uint8_t>& output)
+{
+  if (compression_format == "png")
+  {
+    try
+    {
+      if (!cv::imencode(".png", image, output, params))
+      {
+        ROS_ERROR("cv::imencode (png) failed on input image");
+        return false;
+      }
+    }
+    catch (cv::Exception& e)
+    {
+      ROS_ERROR("%s", e.what());
+      return false;
+    }
+    return true;
+  }
+  else if (compression_format == "rvl")
+  {
+    int numPixels = image.rows * image.cols;
+    // In the worst case, RVL compression results in ~1.5x larger data.
+    output.resize(3 * numPixels + 12);
+    RvlCodec rvl;
+    int compressedSize = rvl.CompressRVL(image.ptr<unsigned short>(), &output[0], numPixels);
+    output.resize(compressedSize);
+    return true;
+  }
+  return false;
+}
+
+// Decompresses one strip into image, which must be continuous and already sized
+bool decompressStrip(const uint8_t* data, size_t size, const std::string& compression_format, Mat& image)
+{
+  if (compression_format == "png")
+  {
+    Mat decoded;
+    try
+    {
+      decoded = cv::imdecode(Mat(1, static_cast<int>(size), CV_8UC1, const_cast<uint8_t*>(data)), cv::IMREAD_UNCHANGED);
+    }
+    catch (cv::Exception& e)
+    {
+      ROS_ERROR("%s", e.what());
+      return false;
+    }
+    if (decoded.type() != CV_16UC1 || decoded.size() != image.size())
+    {
+      ROS_ERROR("Compressed depth image strip does not match the image size");
+      return false;
+    }
+    decoded.copyTo(image);
+    return true;
+  }
+  else if (compression_format == "rvl")
+  {
+    RvlCodec rvl;
+    rvl.DecompressRVL(data, image.ptr<unsigned short>(), image.rows * image.cols);
+    return true;
+  }
+  return false;
+}
+
+// Quantizes and compresses a range of strips of a depth image
+class StripEncoder : public ParallelLoopBody
+{
+public:
+  StripEncoder(const Mat& depth, bool inverse_depth, float depthQuantA, float depthQuantB, float depthMax,
+               unsigned short depthMaxUShort, const std::string& compression_format, const std::vector<int>& params,
+               std::vector<std::vector<uint8_t> >& strips, std::vector<uint8_t>& success)
+    : depth_(depth), inverse_depth_(inverse_depth), depthQuantA_(depthQuantA), depthQuantB_(depthQuantB),
+      depthMax_(depthMax), depthMaxUShort_(depthMaxUShort), compression_format_(compression_format),
+      params_(params), strips_(strips), success_(success)
+  {
+  }
+
+  virtual void operator()(const Range& range) const
+  {
+    const int numStrips = strips_.size();
+    for (int strip = range.start; strip < range.end; ++strip)
+    {
+      const Mat band = depth_.rowRange(stripRows(strip, numStrips, depth_.rows));
+      Mat quantized(band.rows, band.cols, CV_16UC1);
+      if (inverse_depth_)
+        quantizeInvDepth(band, quantized, depthQuantA_, depthQuantB_, depthMax_);
+      else
+        filterMaxDepth(band, quantized, depthMaxUShort_);
+
+      success_[strip] = compressStrip(quantized, compression_format_, params_, strips_[strip]);
+    }
+  }
+
+private:
+  const Mat& depth_;
+  bool inverse_depth_;
+  float depthQuantA_, depthQuantB_, depthMax_;
+  unsigned short depthMaxUShort_;
+  const std::string& compression_format_;
+  const std::vector<int>& params_;
+  std::vector<std::vector<uint8_t> >& strips_;
+  std::vector<uint8_t>& success_;
+};
+
+// Decompresses a range of strips, converting them back to depth if inverse depth coded
+class StripDecoder : public ParallelLoopBody
+{
+public:
+  StripDecoder(const std::vector<const uint8_t*>& strips, const std::vector<uint32_t>& sizes,
+               const std::string& compression_format, float depthQuantA, float depthQuantB,
+               Mat& decompressed, Mat& depth, std::vector<uint8_t>& success)
+    : strips_(strips), sizes_(sizes), compression_format_(compression_format),
+      depthQuantA_(depthQuantA), depthQuantB_(depthQuantB), decompressed_(decompressed), depth_(depth),
+      success_(success)
+  {
+  }
+
+  virtual void operator()(const Range& range) const
+  {
+    const int numStrips = strips_.size();
+    for (int strip = range.start; strip < range.end; ++strip)
+    {
+      const Range rows = stripRows(strip, numStrips, decompressed_.rows);
+      Mat band = decompressed_.rowRange(rows);
+      success_[strip] = decompressStrip(strips_[strip], sizes_[strip], compression_format_, band);
+      if (success_[strip] && !depth_.empty())
+      {
+        Mat depthBand = depth_.rowRange(rows);
+        dequantizeInvDepth(band, depthBand, depthQuantA_, depthQuantB_);
+      }
+    }
+  }
+
+private:
+  const std::vector<const uint8_t*>& strips_;
+  const std::vector<uint32_t>& sizes_;
+  const std::string& compression_format_;
+  float depthQuantA_, depthQuantB_;
+  Mat& decompressed_;
+  Mat& depth_;
+  std::vector<uint8_t>& success_;
+};
+
+// Decodes the payload of a STRIPED image. depth is only filled in for inverse depth coding.
+bool decodeStrips(const uint8_t* data, size_t size, const std::string& compression_format, bool inverse_depth,
+                  float depthQuantA, float depthQuantB, Mat& decompressed, Mat& depth)
+{
+  StripHeader stripHeader;
+  if (size < sizeof(stripHeader))
+  {
+    ROS_ERROR("Compressed depth image is truncated");
+    return false;
+  }
+  memcpy(&stripHeader, data, sizeof(stripHeader));
+  data += sizeof(stripHeader);
+  size -= sizeof(stripHeader);
+
+  const size_t numStrips = stripHeader.numStrips;
+  if (numStrips == 0 || numStrips > stripHeader.rows || size < numStrips * sizeof(uint32_t))
+  {
+    ROS_ERROR("Invalid compressed depth image strip header");
+    return false;
+  }
+
+  std::vector<uint32_t> sizes(numStrips);
+  memcpy(&sizes[0], data, numStrips * sizeof(uint32_t));
+  data += numStrips * sizeof(uint32_t);
+  size -= numStrips * sizeof(uint32_t);
+
+  std::vector<const uint8_t*> strips(numStrips);
+  for (size_t i = 0; i < numStrips; ++i)
+  {
+    if (sizes[i] > size)
+    {
+      ROS_ERROR("Compressed depth image is truncated");
+      return false;
+    }
+    strips[i] = data;
+    data += sizes[i];
+    size -= sizes[i];
+  }
+
+  decompressed.create(stripHeader.rows, stripHeader.cols, CV_16UC1);
+  if (inverse_depth)
+    depth.create(stripHeader.rows, stripHeader.cols, CV_32FC1);
+
+  std::vector<uint8_t> success(numStrips, false);
+  parallel_for_(Range(0, numStrips),
+                StripDecoder(strips, sizes, compression_format, depthQuantA, depthQuantB, decompressed, depth, success));
+  return std::find(success.begin(), success.end(), false) == success.end();
+}
+
+}  // namespace
+
 sensor_msgs::Image::Ptr decodeCompressedDepthImage(const sensor_msgs::CompressedImage& message)
 {
   cv_bridge::CvImagePtr cv_ptr(new cv_bridge::CvImage);
@@ -100,8 +350,9 @@ sensor_msgs::Image::Ptr decodeCompressedDepthImage(const sensor_msgs::Compressed
     ConfigHeader compressionConfig;
     memcpy(&compressionConfig, &message.data[0], sizeof(compressionConfig));
 
-    // Get compressed image data
-    const std::vector<uint8_t> imageData(message.data.begin() + sizeof(compressionConfig), message.data.end());
+    // Get compressed image data, without copying it out of the message
+    const uint8_t* imageData = &message.data[sizeof(compressionConfig)];
+    const size_t imageDataSize = message.data.size() - sizeof(compressionConfig);
 
     // Depth map decoding
     float depthQuantA, depthQuantB;
@@ -110,95 +361,79 @@ sensor_msgs::Image::Ptr decodeCompressedDepthImage(const sensor_msgs::Compressed
     depthQuantA = compressionConfig.depthParam[0];
     depthQuantB = compressionConfig.depthParam[1];
 
-    if (enc::bitDepth(image_encoding) == 32)
+    const bool inverseDepth = (enc::bitDepth(image_encoding) == 32);
+
+    // Quantized (or raw 16 bit) depth, and the converted depth for inverse depth coding
+    Mat decompressed;
+    Mat depth;
+
+    if (compressionConfig.format == STRIPED)
     {
-      cv::Mat decompressed;
-      if (compression_format == "png") {
-        try
-        {
-          // Decode image data
-          decompressed = cv::imdecode(imageData, cv::IMREAD_UNCHANGED);
-        }
-        catch (cv::Exception& e)
-        {
-          ROS_ERROR("%s", e.what());
-          return sensor_msgs::Image::Ptr();
-        }
-      } else if (compression_format == "rvl") {
-        const unsigned char *buffer = imageData.data();
-        uint32_t cols, rows;
-        memcpy(&cols, &buffer[0], 4);
-        memcpy(&rows, &buffer[4], 4);
-        decompressed = Mat(rows, cols, CV_16UC1);
-        RvlCodec rvl;
-        rvl.DecompressRVL(&buffer[8], decompressed.ptr<unsigned short>(), cols * rows);
-      } else {
+      // Strips are decoded and converted back to depth in parallel
+      if (!decodeStrips(imageData, imageDataSize, compression_format, inverseDepth, depthQuantA, depthQuantB,
+                        decompressed, depth))
+      {
         return sensor_msgs::Image::Ptr();
       }
-
-      size_t rows = decompressed.rows;
-      size_t cols = decompressed.cols;
-
-      if ((rows > 0) && (cols > 0))
+    }
+    else if (compression_format == "png")
+    {
+      try
       {
-        cv_ptr->image = Mat(rows, cols, CV_32FC1);
-
-        // Depth conversion
-        MatIterator_<float> itDepthImg = cv_ptr->image.begin<float>(),
-                            itDepthImg_end = cv_ptr->image.end<float>();
-        MatConstIterator_<unsigned short> itInvDepthImg = decompressed.begin<unsigned short>(),
-                                          itInvDepthImg_end = decompressed.end<unsigned short>();
-
-        for (; (itDepthImg != itDepthImg_end) && (itInvDepthImg != itInvDepthImg_end); ++itDepthImg, ++itInvDepthImg)
-        {
-          // check for NaN & max depth
-          if (*itInvDepthImg)
-          {
-            *itDepthImg = depthQuantA / ((float)*itInvDepthImg - depthQuantB);
-          }
-          else
-          {
-            *itDepthImg = std::numeric_limits<float>::quiet_NaN();
-          }
-        }
-
-        // Publish message to user callback
-        return cv_ptr->toImageMsg();
+        // Decode image data
+        decompressed = cv::imdecode(Mat(1, static_cast<int>(imageDataSize), CV_8UC1, const_cast<uint8_t*>(imageData)),
+                                    cv::IMREAD_UNCHANGED);
+      }
+      catch (cv::Exception& e)
+      {
+        ROS_ERROR("%s", e.what());
+        return sensor_msgs::Image::Ptr();
       }
     }
-    else
+    else if (compression_format == "rvl")
     {
-      // Decode raw image
-      if (compression_format == "png") {
-        try
-        {
-          cv_ptr->image = cv::imdecode(imageData, CV_LOAD_IMAGE_UNCHANGED);
-        }
-        catch (cv::Exception& e)
-        {
-          ROS_ERROR("%s", e.what());
-          return sensor_msgs::Image::Ptr();
-        }
-      } else if (compression_format == "rvl") {
-        const unsigned char *buffer = imageData.data();
-        uint32_t cols, rows;
-        memcpy(&cols, &buffer[0], 4);
-        memcpy(&rows, &buffer[4], 4);
-        cv_ptr->image = Mat(rows, cols, CV_16UC1);
-        RvlCodec rvl;
-        rvl.DecompressRVL(&buffer[8], cv_ptr->image.ptr<unsigned short>(), cols * rows);
-      } else {
+      if (imageDataSize < 8)
+      {
+        ROS_ERROR("Compressed depth image is truncated");
         return sensor_msgs::Image::Ptr();
       }
+      uint32_t cols, rows;
+      memcpy(&cols, &imageData[0], 4);
+      memcpy(&rows, &imageData[4], 4);
+      decompressed = Mat(rows, cols, CV_16UC1);
+      RvlCodec rvl;
+      rvl.DecompressRVL(&imageData[8], decompressed.ptr<unsigned short>(), cols * rows);
+    }
+    else
+    {
+      return sensor_msgs::Image::Ptr();
+    }
 
-      size_t rows = cv_ptr->image.rows;
-      size_t cols = cv_ptr->image.cols;
+    if ((decompressed.rows > 0) && (decompressed.cols > 0))
+    {
+      if (inverseDepth)
+      {
+        if (depth.empty())
+        {
+          if (decompressed.type() != CV_16UC1)
+          {
+            ROS_ERROR("Compressed depth image does not hold 16 bit inverse depth");
+            return sensor_msgs::Image::Ptr();
+          }
 
-      if ((rows > 0) && (cols > 0))
+          // Depth conversion
+          depth.create(decompressed.rows, decompressed.cols, CV_32FC1);
+          dequantizeInvDepth(decompressed, depth, depthQuantA, depthQuantB);
+        }
+        cv_ptr->image = depth;
+      }
+      else
       {
-        // Publish message to user callback
-        return cv_ptr->toImageMsg();
+        cv_ptr->image = decompressed;
       }
+
+      // Publish message to user callback
+      return cv_ptr->toImageMsg();
     }
   }
   return sensor_msgs::Image::Ptr();
@@ -207,7 +442,7 @@ sensor_msgs::Image::Ptr decodeCompressedDepthImage(const sensor_msgs::Compressed
 sensor_msgs::CompressedImage::Ptr encodeCompressedDepthImage(
     const sensor_msgs::Image& message,
     const std::string& compression_format,
-    double depth_max, double depth_quantization, int png_level)
+    double depth_max, double depth_quantization, int png_level, int num_strips)
 {
 
   // Compressed image message
@@ -226,9 +461,6 @@ sensor_msgs::CompressedImage::Ptr encodeCompressedDepthImage(
   ConfigHeader compressionConfig {};
   compressionConfig.format = INV_DEPTH;
 
-  // Compressed image data
-  std::vector<uint8_t> compressedImage;
-
   // Update ros message format header
   compressed->format += "; compressedDepth " + compression_format;
 
@@ -237,175 +469,123 @@ sensor_msgs::CompressedImage::Ptr encodeCompressedDepthImage(
   params.emplace_back(cv::IMWRITE_PNG_COMPRESSION);
   params.emplace_back(png_level);
 
-  if ((bitDepth == 32) && (numChannels == 1))
+  // 32 bit depth is coded as quantized inverse depth, 16 bit raw depth is only max depth filtered
+  const bool inverseDepth = (bitDepth == 32) && (numChannels == 1);
+  if (!inverseDepth && !((bitDepth == 16) && (numChannels == 1)))
   {
-    float depthZ0 = depth_quantization;
-    float depthMax = depth_max;
+    ROS_ERROR("Compressed Depth Image Transport - Compression requires single-channel 32bit-floating point or 16bit raw depth images (input format is: %s).", message.encoding.c_str());
+    return sensor_msgs::CompressedImage::Ptr();
+  }
 
-    // OpenCV-ROS bridge
-    cv_bridge::CvImagePtr cv_ptr;
-    try
-    {
-      cv_ptr = cv_bridge::toCvCopy(message);
-    }
-    catch (cv_bridge::Exception& e)
-    {
-      ROS_ERROR("%s", e.what());
-      return sensor_msgs::CompressedImage::Ptr();
-    }
+  // OpenCV-ROS bridge, shares the message data unless it has to be byte swapped
+  cv_bridge::CvImageConstPtr cv_ptr;
+  try
+  {
+    cv_ptr = cv_bridge::toCvShare(message, boost::shared_ptr<void const>());
+  }
+  catch (cv_bridge::Exception& e)
+  {
+    ROS_ERROR("%s", e.what());
+    return sensor_msgs::CompressedImage::Ptr();
+  }
 
-    const Mat& depthImg = cv_ptr->image;
-    size_t rows = depthImg.rows;
-    size_t cols = depthImg.cols;
+  const Mat& depthImg = cv_ptr->image;
+  const int rows = depthImg.rows;
+  const int cols = depthImg.cols;
 
-    if ((rows > 0) && (cols > 0))
-    {
-      // Allocate matrix for inverse depth (disparity) coding
-      Mat invDepthImg(rows, cols, CV_16UC1);
+  if ((rows <= 0) || (cols <= 0))
+  {
+    return sensor_msgs::CompressedImage::Ptr();
+  }
 
-      // Inverse depth quantization parameters
-      float depthQuantA = depthZ0 * (depthZ0 + 1.0f);
-      float depthQuantB = 1.0f - depthQuantA / depthMax;
+  float depthZ0 = depth_quantization;
+  float depthMax = depth_max;
 
-      // Matrix iterators
-      MatConstIterator_<float> itDepthImg = depthImg.begin<float>(),
-                               itDepthImg_end = depthImg.end<float>();
-      MatIterator_<unsigned short> itInvDepthImg = invDepthImg.begin<unsigned short>(),
-                                   itInvDepthImg_end = invDepthImg.end<unsigned short>();
+  // Inverse depth quantization parameters
+  float depthQuantA = depthZ0 * (depthZ0 + 1.0f);
+  float depthQuantB = 1.0f - depthQuantA / depthMax;
 
-      // Quantization
-      for (; (itDepthImg != itDepthImg_end) && (itInvDepthImg != itInvDepthImg_end); ++itDepthImg, ++itInvDepthImg)
-      {
-        // check for NaN & max depth
-        if (*itDepthImg < depthMax)
-        {
-          *itInvDepthImg = depthQuantA / *itDepthImg + depthQuantB;
-        }
-        else
-        {
-          *itInvDepthImg = 0;
-        }
-      }
+  if (inverseDepth)
+  {
+    // Add coding parameters to header
+    compressionConfig.depthParam[0] = depthQuantA;
+    compressionConfig.depthParam[1] = depthQuantB;
+  }
 
-      // Add coding parameters to header
-      compressionConfig.depthParam[0] = depthQuantA;
-      compressionConfig.depthParam[1] = depthQuantB;
+  unsigned short depthMaxUShort = static_cast<unsigned short>(depth_max * 1000.0f);
 
-      // Compress quantized disparity image
-      if (compression_format == "png") {
-        try
-        {
-          if (cv::imencode(".png", invDepthImg, compressedImage, params))
-          {
-            float cRatio = (float)(cv_ptr->image.rows * cv_ptr->image.cols * cv_ptr->image.elemSize())
-                / (float)compressedImage.size();
-            ROS_DEBUG("Compressed Depth Image Transport - Compression: 1:%.2f (%lu bytes)", cRatio, compressedImage.size());
-          }
-          else
-          {
-            ROS_ERROR("cv::imencode (png) failed on input image");
-            return sensor_msgs::CompressedImage::Ptr();
-          }
-        }
-        catch (cv::Exception& e)
-        {
-          ROS_ERROR("%s", e.msg.c_str());
-          return sensor_msgs::CompressedImage::Ptr();
-        }
-      } else if (compression_format == "rvl") {
-        int numPixels = invDepthImg.rows * invDepthImg.cols;
-        // In the worst case, RVL compression results in ~1.5x larger data.
-        compressedImage.resize(3 * numPixels + 12);
-        uint32_t cols = invDepthImg.cols;
-        uint32_t rows = invDepthImg.rows;
-        memcpy(&compressedImage[0], &cols, 4);
-        memcpy(&compressedImage[4], &rows, 4);
-        RvlCodec rvl;
-        int compressedSize = rvl.CompressRVL(invDepthImg.ptr<unsigned short>(), &compressedImage[8], numPixels);
-        compressedImage.resize(8 + compressedSize);
-      }
-    }
+  // Quantize and compress each strip; a single strip keeps the original format
+  const int numStrips = std::max(1, std::min(num_strips, rows));
+  std::vector<std::vector<uint8_t> > strips(numStrips);
+  std::vector<uint8_t> success(numStrips, false);
+  StripEncoder encoder(depthImg, inverseDepth, depthQuantA, depthQuantB, depthMax, depthMaxUShort,
+                       compression_format, params, strips, success);
+  if (numStrips > 1)
+    parallel_for_(Range(0, numStrips), encoder);
+  else
+    encoder(Range(0, 1));
+
+  if (std::find(success.begin(), success.end(), false) != success.end())
+  {
+    return sensor_msgs::CompressedImage::Ptr();
   }
-  // Raw depth map compression
-  else if ((bitDepth == 16) && (numChannels == 1))
+
+  size_t compressedSize = 0;
+  for (int i = 0; i < numStrips; ++i)
+    compressedSize += strips[i].size();
+
+  float cRatio = (float)(rows * cols * depthImg.elemSize()) / (float)compressedSize;
+  ROS_DEBUG("Compressed Depth Image Transport - Compression: 1:%.2f (%lu bytes)", cRatio, compressedSize);
+
+  // Write configuration and compressed binary data straight into the message
+  std::vector<uint8_t>& data = compressed->data;
+  if (numStrips > 1)
   {
-    // OpenCV-ROS bridge
-    cv_bridge::CvImagePtr cv_ptr;
-    try
+    compressionConfig.format = STRIPED;
+
+    StripHeader stripHeader;
+    stripHeader.cols = cols;
+    stripHeader.rows = rows;
+    stripHeader.numStrips = numStrips;
+
+    data.resize(sizeof(ConfigHeader) + sizeof(StripHeader) + numStrips * sizeof(uint32_t) + compressedSize);
+    uint8_t* out = &data[0];
+    memcpy(out, &compressionConfig, sizeof(ConfigHeader));
+    out += sizeof(ConfigHeader);
+    memcpy(out, &stripHeader, sizeof(StripHeader));
+    out += sizeof(StripHeader);
+    for (int i = 0; i < numStrips; ++i)
     {
-      cv_ptr = cv_bridge::toCvCopy(message);
+      uint32_t stripSize = strips[i].size();
+      memcpy(out, &stripSize, sizeof(stripSize));
+      out += sizeof(stripSize);
     }
-    catch (Exception& e)
+    for (int i = 0; i < numStrips; ++i)
     {
-      ROS_ERROR("%s", e.msg.c_str());
-      return sensor_msgs::CompressedImage::Ptr();
-    }
-
-    const Mat& depthImg = cv_ptr->image;
-    size_t rows = depthImg.rows;
-    size_t cols = depthImg.cols;
-
-    if ((rows > 0) && (cols > 0))
-    {
-      unsigned short depthMaxUShort = static_cast<unsigned short>(depth_max * 1000.0f);
-
-      // Matrix iterators
-      MatIterator_<unsigned short> itDepthImg = cv_ptr->image.begin<unsigned short>(),
-                                    itDepthImg_end = cv_ptr->image.end<unsigned short>();
-
-      // Max depth filter
-      for (; itDepthImg != itDepthImg_end; ++itDepthImg)
-      {
-        if (*itDepthImg > depthMaxUShort)
-          *itDepthImg = 0;
-      }
-
-      // Compress raw depth image
-      if (compression_format == "png") {
-        if (cv::imencode(".png", cv_ptr->image, compressedImage, params))
-        {
-          float cRatio = (float)(cv_ptr->image.rows * cv_ptr->image.cols * cv_ptr->image.elemSize())
-              / (float)compressedImage.size();
-          ROS_DEBUG("Compressed Depth Image Transport - Compression: 1:%.2f (%lu bytes)", cRatio, compressedImage.size());
-        }
-        else
-        {
-          ROS_ERROR("cv::imencode (png) failed on input image");
-          return sensor_msgs::CompressedImage::Ptr();
-        }
-      } else if (compression_format == "rvl") {
-        int numPixels = cv_ptr->image.rows * cv_ptr->image.cols;
-        // In the worst case, RVL compression results in ~1.5x larger data.
-        compressedImage.resize(3 * numPixels + 12);
-        uint32_t cols = cv_ptr->image.cols;
-        uint32_t rows = cv_ptr->image.rows;
-        memcpy(&compressedImage[0], &cols, 4);
-        memcpy(&compressedImage[4], &rows, 4);
-        RvlCodec rvl;
-        int compressedSize = rvl.CompressRVL(cv_ptr->image.ptr<unsigned short>(), &compressedImage[8], numPixels);
-        compressedImage.resize(8 + compressedSize);
-      }
+      memcpy(out, strips[i].data(), strips[i].size());
+      out += strips[i].size();
     }
   }
   else
   {
-    ROS_ERROR("Compressed Depth Image Transport - Compression requires single-channel 32bit-floating point or 16bit raw depth images (input format is: %s).", message.encoding.c_str());
-    return sensor_msgs::CompressedImage::Ptr();
-  }
-
-  if (compressedImage.size() > 0)
-  {
-    // Add configuration to binary output
-    compressed->data.resize(sizeof(ConfigHeader));
-    memcpy(&compressed->data[0], &compressionConfig, sizeof(ConfigHeader));
-
-    // Add compressed binary data to messages
-    compressed->data.insert(compressed->data.end(), compressedImage.begin(), compressedImage.end());
-
-    return compressed;
+    // RVL data is preceded by the image size
+    const size_t sizeHeader = (compression_format == "rvl") ? 8 : 0;
+    data.resize(sizeof(ConfigHeader) + sizeHeader + compressedSize);
+    uint8_t* out = &data[0];
+    memcpy(out, &compressionConfig, sizeof(ConfigHeader));
+    out += sizeof(ConfigHeader);
+    if (sizeHeader)
+    {
+      uint32_t imageCols = cols;
+      uint32_t imageRows = rows;
+      memcpy(out, &imageCols, 4);
+      memcpy(out + 4, &imageRows, 4);
+      out += sizeHeader;
+    }
+    memcpy(out, strips[0].data(), strips[0].size());
   }
 
-  return sensor_msgs::CompressedImage::Ptr();
+  return compressed;
 }
 
 }  // namespace compressed_depth_image_transport
@@ -0,0 +1,73 @@
+// Times encoding and decoding of a synthetic 640x480 depth frame for each
+// compression format and a range of strip counts.
+//   rosrun compressed_depth_image_transport codec_speed_test [iterations]
+
+#include "compressed_depth_image_transport/codec.h"
+
+#include <ros/time.h>
+#include <ros/console.h>
+
+#include <boost/lexical_cast.hpp>
+
+#include <cmath>
+#include <limits>
+
+using namespace compressed_depth_image_transport;
+
+int main(int argc, char** argv)
+{
+  int iterations = 100;
+  if (argc > 1)
+  {
+    iterations = boost::lexical_cast<int>(argv[1]);
+  }
+
+  // Sloped floor with a few objects and invalid pixels, roughly like a real sensor
+  sensor_msgs::Image image;
+  image.encoding = sensor_msgs::image_encodings::TYPE_32FC1;
+  image.width = 640;
+  image.height = 480;
+  image.step = image.width * sizeof(float);
+  image.data.resize(image.step * image.height);
+  float* depth = reinterpret_cast<float*>(&image.data[0]);
+  for (uint32_t row = 0; row < image.height; ++row)
+  {
+    for (uint32_t col = 0; col < image.width; ++col)
+    {
+      float z = 1.0f + 8.0f * (image.height - row) / image.height;
+      if (std::abs((int)col - 200) < 60 && std::abs((int)row - 300) < 80)
+        z = 1.5f;
+      if ((row * 7 + col * 13) % 97 == 0)
+        z = std::numeric_limits<float>::quiet_NaN();
+      depth[row * image.width + col] = z;
+    }
+  }
+
+  const char* formats[] = {"png", "rvl"};
+  const int strips[] = {1, 2, 4, 8};
+  for (const char* format : formats)
+  {
+    for (int numStrips : strips)
+    {
+      sensor_msgs::CompressedImage::Ptr compressed;
+      ros::WallTime start = ros::WallTime::now();
+      for (int i = 0; i < iterations; ++i)
+      {
+        compressed = encodeCompressedDepthImage(image, format, 10.0, 100.0, 1, numStrips);
+      }
+      ros::WallDuration encode = ros::WallTime::now() - start;
+
+      start = ros::WallTime::now();
+      for (int i = 0; i < iterations; ++i)
+      {
+        decodeCompressedDepthImage(*compressed);
+      }
+      ros::WallDuration decode = ros::WallTime::now() - start;
+
+      ROS_INFO("%s, %d strips: encode %.3f ms, decode %.3f ms, %lu bytes", format, numStrips,
+               encode.toSec() * 1.0e3 / iterations, decode.toSec() * 1.0e3 / iterations, compressed->data.size());
+    }
+  }
+
+  return 0;
+}
@@ -0,0 +1,104 @@
+#include "compressed_depth_image_transport/codec.h"
+#include "compressed_depth_image_transport/compression_common.h"
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+
+using compressed_depth_image_transport::decodeCompressedDepthImage;
+using compressed_depth_image_transport::encodeCompressedDepthImage;
+
+namespace {
+
+sensor_msgs::Image makeImage(const std::string& encoding, int width, int height) {
+  sensor_msgs::Image image;
+  image.encoding = encoding;
+  image.width = width;
+  image.height = height;
+  image.step = width * sensor_msgs::image_encodings::bitDepth(encoding) / 8;
+  image.data.resize(image.step * height);
+  return image;
+}
+
+compressed_depth_image_transport::compressionFormat headerFormat(
+    const sensor_msgs::CompressedImage& compressed) {
+  compressed_depth_image_transport::ConfigHeader header;
+  memcpy(&header, &compressed.data[0], sizeof(header));
+  return header.format;
+}
+
+}  // namespace
+
+TEST(CodecTest, stripedRawDepthRoundTrip) {
+  sensor_msgs::Image original = makeImage(sensor_msgs::image_encodings::TYPE_16UC1, 64, 37);
+  uint16_t* depth = reinterpret_cast<uint16_t*>(&original.data[0]);
+  for (size_t i = 0; i < original.width * original.height; ++i) {
+    // Runs of invalid pixels between valid depths below depth_max
+    depth[i] = (rand() % 4) ? rand() % 10000 : 0;
+  }
+
+  const char* formats[] = {"png", "rvl"};
+  const int strips[] = {1, 2, 5, 37, 100};
+  for (const char* format : formats) {
+    for (int numStrips : strips) {
+      sensor_msgs::CompressedImage::Ptr compressed =
+          encodeCompressedDepthImage(original, format, 10.0, 100.0, 1, numStrips);
+      ASSERT_TRUE(compressed);
+      EXPECT_EQ(headerFormat(*compressed), numStrips > 1 ? compressed_depth_image_transport::STRIPED
+                                                         : compressed_depth_image_transport::INV_DEPTH);
+
+      sensor_msgs::Image::Ptr decoded = decodeCompressedDepthImage(*compressed);
+      ASSERT_TRUE(decoded);
+      EXPECT_EQ(original.width, decoded->width);
+      EXPECT_EQ(original.height, decoded->height);
+      EXPECT_TRUE(original.data == decoded->data) << format << " with " << numStrips << " strips";
+    }
+  }
+}
+
+TEST(CodecTest, stripedInverseDepthMatchesSingleStrip) {
+  sensor_msgs::Image original = makeImage(sensor_msgs::image_encodings::TYPE_32FC1, 80, 60);
+  float* depth = reinterpret_cast<float*>(&original.data[0]);
+  for (size_t i = 0; i < original.width * original.height; ++i) {
+    switch (i % 7) {
+      case 0: depth[i] = std::numeric_limits<float>::quiet_NaN(); break;
+      case 1: depth[i] = 20.0f; break;  // beyond depth_max
+      default: depth[i] = 0.5f + 9.0f * rand() / RAND_MAX; break;
+    }
+  }
+
+  const char* formats[] = {"png", "rvl"};
+  for (const char* format : formats) {
+    sensor_msgs::Image::Ptr reference =
+        decodeCompressedDepthImage(*encodeCompressedDepthImage(original, format, 10.0, 100.0, 1, 1));
+    sensor_msgs::Image::Ptr striped =
+        decodeCompressedDepthImage(*encodeCompressedDepthImage(original, format, 10.0, 100.0, 1, 4));
+    ASSERT_TRUE(reference);
+    ASSERT_TRUE(striped);
+    EXPECT_TRUE(reference->data == striped->data) << format;
+
+    const float* decoded = reinterpret_cast<const float*>(&striped->data[0]);
+    for (size_t i = 0; i < original.width * original.height; ++i) {
+      if (std::isfinite(depth[i]) && depth[i] < 10.0f)
+        EXPECT_NEAR(depth[i], decoded[i], 0.1f);
+      else
+        EXPECT_TRUE(std::isnan(decoded[i]));
+    }
+  }
+}
+
+TEST(CodecTest, truncatedStripsAreRejected) {
+  sensor_msgs::Image original = makeImage(sensor_msgs::image_encodings::TYPE_16UC1, 32, 32);
+  sensor_msgs::CompressedImage::Ptr compressed =
+      encodeCompressedDepthImage(original, "rvl", 10.0, 100.0, 1, 4);
+  ASSERT_TRUE(compressed);
+  compressed->data.resize(compressed->data.size() - 4);
+  EXPECT_FALSE(decodeCompressedDepthImage(*compressed));
+}
+
+int main(int argc, char** argv) {
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -36,19 +36,29 @@
 #include <sensor_msgs/CompressedImage.h>
 #include <dynamic_reconfigure/server.h>
 #include <compressed_image_transport/CompressedPublisherConfig.h>
+#include <boost/thread/mutex.hpp>
+
+#include "compressed_image_transport/encode_queue.h"
+#include "compressed_image_transport/jpeg_encoder.h"
 
 namespace compressed_image_transport {
 
 class CompressedPublisher : public image_transport::SimplePublisherPlugin<sensor_msgs::CompressedImage>
 {
 public:
-  virtual ~CompressedPublisher() {}
+  CompressedPublisher();
+  virtual ~CompressedPublisher();
 
   virtual std::string getTransportName() const
   {
     return "compressed";
   }
 
+  // Overridden to hand shared images to the encode threads without copying them
+  virtual void publish(const sensor_msgs::ImageConstPtr& message) const;
+
+  virtual void shutdown();
+
 protected:
   // Overridden to set up reconfigure server
   virtual void advertiseImpl(ros::NodeHandle &nh, const std::string &base_topic, uint32_t queue_size,
@@ -60,9 +70,30 @@ protected:
                        const PublishFn& publish_fn) const;
 
   typedef compressed_image_transport::CompressedPublisherConfig Config;
+  typedef boost::shared_ptr<const Config> ConfigConstPtr;
+
+  // Compresses message into compressed, returns false if nothing should be published
+  bool encode(JpegEncoder& jpeg, const Config& config, const sensor_msgs::Image& message,
+              sensor_msgs::CompressedImage& compressed) const;
+
+  void publishCompressed(const sensor_msgs::CompressedImage& compressed) const;
+
+  // Returns the current settings. They are replaced, never modified, so the
+  // encode threads can keep using a snapshot while the config changes.
+  ConfigConstPtr getConfig() const;
+
   typedef dynamic_reconfigure::Server<Config> ReconfigureServer;
   boost::shared_ptr<ReconfigureServer> reconfigure_server_;
-  Config config_;
+  mutable boost::mutex config_mutex_;
+  ConfigConstPtr config_;
+
+  // Encoder state for images compressed in the publishing thread
+  mutable boost::mutex encoder_mutex_;
+  mutable JpegEncoder encoder_;
+
+  mutable boost::mutex queue_mutex_;
+  boost::shared_ptr<EncodeQueue> encode_queue_;
+  int encode_threads_;
 
   void configCb(Config& config, uint32_t level);
 };
@@ -0,0 +1,120 @@
+/*********************************************************************
+* Software License Agreement (BSD License)
+* 
+*  Copyright (c) 2012, Willow Garage, Inc.
+*  All rights reserved.
+* 
+*  Redistribution and use in source and binary forms, with or without
+*  modification, are permitted provided that the following conditions
+*  are met:
+* 
+*   * Redistributions of source code must retain the above copyright
+*     notice, this list of conditions and the following disclaimer.
+*   * Redistributions in binary form must reproduce the above
+*     copyright notice, this list of conditions and the following
+*     disclaimer in the documentation and/or other materials provided
+*     with the distribution.
+*   * Neither the name of the Willow Garage nor the names of its
+*     contributors may be used to endorse or promote products derived
+*     from this software without specific prior written permission.
+* 
+*  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+*  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+*  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+*  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+*  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+*  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+*  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+*  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+*  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+*  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+*  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+*  POSSIBILITY OF SUCH DAMAGE.
+*********************************************************************/
+
+#ifndef COMPRESSED_IMAGE_TRANSPORT_ENCODE_QUEUE
+#define COMPRESSED_IMAGE_TRANSPORT_ENCODE_QUEUE
+
+#include <sensor_msgs/Image.h>
+#include <sensor_msgs/CompressedImage.h>
+#include <compressed_image_transport/CompressedPublisherConfig.h>
+#include <boost/function.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/thread.hpp>
+
+#include "compressed_image_transport/jpeg_encoder.h"
+
+#include <deque>
+#include <map>
+#include <vector>
+
+namespace compressed_image_transport
+{
+
+/**
+ * Compresses images on a pool of worker threads and publishes the results in
+ * the order the images were pushed. Each worker keeps its own JpegEncoder, and
+ * output messages are recycled so their buffers are reused across frames.
+ */
+class EncodeQueue
+{
+public:
+  typedef boost::shared_ptr<const CompressedPublisherConfig> ConfigConstPtr;
+  //! Fills the compressed message; returns false if nothing should be published.
+  typedef boost::function<bool(JpegEncoder&, const CompressedPublisherConfig&, const sensor_msgs::Image&,
+                               sensor_msgs::CompressedImage&)> EncodeFn;
+  typedef boost::function<void(const sensor_msgs::CompressedImage&)> PublishFn;
+
+  EncodeQueue(int num_threads, const EncodeFn& encode_fn, const PublishFn& publish_fn);
+  ~EncodeQueue();
+
+  /**
+   * Queue an image for compression with the given settings. Returns false,
+   * dropping the image, if every worker already has a frame waiting.
+   */
+  bool push(const sensor_msgs::ImageConstPtr& image, const ConfigConstPtr& config);
+
+private:
+  typedef boost::shared_ptr<sensor_msgs::CompressedImage> CompressedImagePtr;
+
+  struct Job
+  {
+    uint64_t seq;
+    sensor_msgs::ImageConstPtr image;
+    ConfigConstPtr config;
+  };
+
+  struct Result
+  {
+    bool ok;
+    CompressedImagePtr message;
+  };
+
+  void workerThread();
+  CompressedImagePtr takeMessage();
+  void finish(uint64_t seq, const Result& result);
+
+  EncodeFn encode_fn_;
+  PublishFn publish_fn_;
+  size_t max_pending_;
+
+  // Input side
+  boost::mutex mutex_;
+  boost::condition_variable cond_;
+  std::deque<Job> jobs_;
+  uint64_t next_seq_;
+  size_t pending_; // pushed but not yet published
+  bool shutdown_;
+
+  // Output side, publishes strictly in sequence order
+  boost::mutex output_mutex_;
+  uint64_t next_output_;
+  std::map<uint64_t, Result> done_;
+  std::vector<CompressedImagePtr> free_messages_;
+
+  boost::thread_group threads_;
+};
+
+} //namespace compressed_image_transport
+
+#endif
@@ -0,0 +1,75 @@
+/*********************************************************************
+* Software License Agreement (BSD License)
+* 
+*  Copyright (c) 2012, Willow Garage, Inc.
+*  All rights reserved.
+* 
+*  Redistribution and use in source and binary forms, with or without
+*  modification, are permitted provided that the following conditions
+*  are met:
+* 
+*   * Redistributions of source code must retain the above copyright
+*     notice, this list of conditions and the following disclaimer.
+*   * Redistributions in binary form must reproduce the above
+*     copyright notice, this list of conditions and the following
+*     disclaimer in the documentation and/or other materials provided
+*     with the distribution.
+*   * Neither the name of the Willow Garage nor the names of its
+*     contributors may be used to endorse or promote products derived
+*     from this software without specific prior written permission.
+* 
+*  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+*  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+*  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+*  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+*  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+*  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+*  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+*  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+*  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+*  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+*  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+*  POSSIBILITY OF SUCH DAMAGE.
+*********************************************************************/
+
+#ifndef COMPRESSED_IMAGE_TRANSPORT_JPEG_ENCODER
+#define COMPRESSED_IMAGE_TRANSPORT_JPEG_ENCODER
+
+#include <sensor_msgs/Image.h>
+#include <turbojpeg.h>
+
+#include <vector>
+
+namespace compressed_image_transport
+{
+
+/**
+ * Encodes 8-bit mono/RGB/BGR/RGBA/BGRA images straight from the message
+ * buffer with TurboJPEG. The compressor handle and its output buffer are
+ * kept between frames. Not thread-safe; use one encoder per thread.
+ */
+class JpegEncoder
+{
+public:
+  JpegEncoder();
+  ~JpegEncoder();
+
+  /**
+   * Compress image into output. Returns false if the encoding or layout is not
+   * supported here (or TurboJPEG fails), in which case the caller should fall
+   * back to OpenCV.
+   */
+  bool encode(const sensor_msgs::Image& image, int quality, bool progressive, std::vector<uint8_t>& output);
+
+private:
+  JpegEncoder(const JpegEncoder&);
+  JpegEncoder& operator=(const JpegEncoder&);
+
+  tjhandle tj_;
+  unsigned char* buffer_;
+  unsigned long buffer_size_;
+};
+
+} //namespace compressed_image_transport
+
+#endif
@@ -57,6 +57,27 @@ namespace enc = sensor_msgs::image_encodings;
 namespace compressed_image_transport
 {
 
+CompressedPublisher::CompressedPublisher()
+ : config_(boost::make_shared<Config>(Config::__getDefault__())), encode_threads_(0)
+{}
+
+CompressedPublisher::~CompressedPublisher()
+{
+  // Stop the workers before the publisher they publish with goes away
+  boost::mutex::scoped_lock lock(queue_mutex_);
+  encode_queue_.reset();
+}
+
+void CompressedPublisher::shutdown()
+{
+  {
+    boost::mutex::scoped_lock lock(queue_mutex_);
+    encode_queue_.reset();
+    encode_threads_ = 0;
+  }
+  image_transport::SimplePublisherPlugin<sensor_msgs::CompressedImage>::shutdown();
+}
+
 void CompressedPublisher::advertiseImpl(ros::NodeHandle &nh, const std::string &base_topic, uint32_t queue_size,
                                         const image_transport::SubscriberStatusCallback &user_connect_cb,
                                         const image_transport::SubscriberStatusCallback &user_disconnect_cb,
@@ -71,15 +92,75 @@ void CompressedPublisher::advertiseImpl(ros::NodeHandle &nh, const std::string &
   reconfigure_server_->setCallback(f);
 }
 
+CompressedPublisher::ConfigConstPtr CompressedPublisher::getConfig() const
+{
+  boost::mutex::scoped_lock lock(config_mutex_);
+  return config_;
+}
+
 void CompressedPublisher::configCb(Config& config, uint32_t level)
 {
-  config_ = config;
+  {
+    boost::mutex::scoped_lock lock(config_mutex_);
+    config_ = boost::make_shared<Config>(config);
+  }
+
+  boost::mutex::scoped_lock lock(queue_mutex_);
+  if (config.encode_threads != encode_threads_)
+  {
+    encode_queue_.reset();
+    if (config.encode_threads > 0)
+    {
+      encode_queue_ = boost::make_shared<EncodeQueue>(
+          config.encode_threads,
+          boost::bind(&CompressedPublisher::encode, this, boost::placeholders::_1, boost::placeholders::_2,
+                      boost::placeholders::_3, boost::placeholders::_4),
+          boost::bind(&CompressedPublisher::publishCompressed, this, boost::placeholders::_1));
+    }
+    encode_threads_ = config.encode_threads;
+  }
+}
+
+void CompressedPublisher::publish(const sensor_msgs::ImageConstPtr& message) const
+{
+  {
+    boost::mutex::scoped_lock lock(queue_mutex_);
+    if (encode_queue_)
+    {
+      if (!encode_queue_->push(message, getConfig()))
+        ROS_WARN_THROTTLE(5.0, "Compressed Image Transport - encode threads are falling behind, dropping image");
+      return;
+    }
+  }
+
+  image_transport::SimplePublisherPlugin<sensor_msgs::CompressedImage>::publish(*message);
+}
+
+void CompressedPublisher::publishCompressed(const sensor_msgs::CompressedImage& compressed) const
+{
+  getPublisher().publish(compressed);
 }
 
 void CompressedPublisher::publish(const sensor_msgs::Image& message, const PublishFn& publish_fn) const
 {
   // Compressed image message
   sensor_msgs::CompressedImage compressed;
+
+  ConfigConstPtr config = getConfig();
+  bool ok;
+  {
+    boost::mutex::scoped_lock lock(encoder_mutex_);
+    ok = encode(encoder_, *config, message, compressed);
+  }
+
+  // Publish message
+  if (ok)
+    publish_fn(compressed);
+}
+
+bool CompressedPublisher::encode(JpegEncoder& jpeg, const Config& config, const sensor_msgs::Image& message,
+                                 sensor_msgs::CompressedImage& compressed) const
+{
   compressed.header = message.header;
   compressed.format = message.encoding;
 
@@ -88,9 +169,9 @@ void CompressedPublisher::publish(const sensor_msgs::Image& message, const Publi
 
   // Get codec configuration
   compressionFormat encodingFormat = UNDEFINED;
-  if (config_.format == compressed_image_transport::CompressedPublisher_jpeg)
+  if (config.format == compressed_image_transport::CompressedPublisher_jpeg)
     encodingFormat = JPEG;
-  if (config_.format == compressed_image_transport::CompressedPublisher_png)
+  if (config.format == compressed_image_transport::CompressedPublisher_png)
     encodingFormat = PNG;
 
   // Bit depth of image encoding
@@ -104,13 +185,13 @@ void CompressedPublisher::publish(const sensor_msgs::Image& message, const Publi
     {
       params.reserve(8);
       params.emplace_back(IMWRITE_JPEG_QUALITY);
-      params.emplace_back(config_.jpeg_quality);
+      params.emplace_back(config.jpeg_quality);
       params.emplace_back(IMWRITE_JPEG_PROGRESSIVE);
-      params.emplace_back(config_.jpeg_progressive ? 1 : 0);
+      params.emplace_back(config.jpeg_progressive ? 1 : 0);
       params.emplace_back(IMWRITE_JPEG_OPTIMIZE);
-      params.emplace_back(config_.jpeg_optimize ? 1 : 0);
+      params.emplace_back(config.jpeg_optimize ? 1 : 0);
       params.emplace_back(IMWRITE_JPEG_RST_INTERVAL);
-      params.emplace_back(config_.jpeg_restart_interval);
+      params.emplace_back(config.jpeg_restart_interval);
 
       // Update ros message format header
       compressed.format += "; jpeg compressed ";
@@ -127,6 +208,16 @@ void CompressedPublisher::publish(const sensor_msgs::Image& message, const Publi
           compressed.format += targetFormat;
         }
 
+        // TurboJPEG compresses 8-bit images straight from the message buffer. It has
+        // no equivalent for the optimize and restart interval settings.
+        if (!config.jpeg_optimize && config.jpeg_restart_interval == 0 &&
+            jpeg.encode(message, config.jpeg_quality, config.jpeg_progressive, compressed.data))
+        {
+          float cRatio = (float)(message.step * message.height) / (float)compressed.data.size();
+          ROS_DEBUG("Compressed Image Transport - Codec: jpg (turbojpeg), Compression Ratio: 1:%.2f (%lu bytes)", cRatio, compressed.data.size());
+          return true;
+        }
+
         // OpenCV-ros bridge
         try
         {
@@ -155,8 +246,7 @@ void CompressedPublisher::publish(const sensor_msgs::Image& message, const Publi
           ROS_ERROR("%s", e.what());
         }
 
-        // Publish message
-        publish_fn(compressed);
+        return true;
       }
       else
         ROS_ERROR("Compressed Image Transport - JPEG compression requires 8/16-bit color format (input format is: %s)", message.encoding.c_str());
@@ -168,7 +258,7 @@ void CompressedPublisher::publish(const sensor_msgs::Image& message, const Publi
     {
       params.reserve(2);
       params.emplace_back(IMWRITE_PNG_COMPRESSION);
-      params.emplace_back(config_.png_level);
+      params.emplace_back(config.png_level);
 
       // Update ros message format header
       compressed.format += "; png compressed ";
@@ -208,16 +298,15 @@ void CompressedPublisher::publish(const sensor_msgs::Image& message, const Publi
         catch (cv_bridge::Exception& e)
         {
           ROS_ERROR("%s", e.what());
-          return;
+          return false;
         }
         catch (cv::Exception& e)
         {
           ROS_ERROR("%s", e.what());
-          return;
+          return false;
         }
 
-        // Publish message
-        publish_fn(compressed);
+        return true;
       }
       else
         ROS_ERROR("Compressed Image Transport - PNG compression requires 8/16-bit encoded color format (input format is: %s)", message.encoding.c_str());
@@ -225,10 +314,11 @@ void CompressedPublisher::publish(const sensor_msgs::Image& message, const Publi
     }
 
     default:
-      ROS_ERROR("Unknown compression type '%s', valid options are 'jpeg' and 'png'", config_.format.c_str());
+      ROS_ERROR("Unknown compression type '%s', valid options are 'jpeg' and 'png'", config.format.c_str());
       break;
   }
 
+  return false;
 }
 
 } //namespace compressed_image_transport
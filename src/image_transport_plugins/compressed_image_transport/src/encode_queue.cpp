@@ -0,0 +1,137 @@
+/*********************************************************************
+* Software License Agreement (BSD License)
+* 
+*  Copyright (c) 2012, Willow Garage, Inc.
+*  All rights reserved.
+* 
+*  Redistribution and use in source and binary forms, with or without
+*  modification, are permitted provided that the following conditions
+*  are met:
+* 
+*   * Redistributions of source code must retain the above copyright
+*     notice, this list of conditions and the following disclaimer.
+*   * Redistributions in binary form must reproduce the above
+*     copyright notice, this list of conditions and the following
+*     disclaimer in the documentation and/or other materials provided
+*     with the distribution.
+*   * Neither the name of the Willow Garage nor the names of its
+*     contributors may be used to endorse or promote products derived
+*     from this software without specific prior written permission.
+* 
+*  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+*  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+*  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+*  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+*  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+*  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+*  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+*  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+*  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+*  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+*  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+*  POSSIBILITY OF SUCH DAMAGE.
+*********************************************************************/
+
+#include "compressed_image_transport/encode_queue.h"
+
+namespace compressed_image_transport
+{
+
+EncodeQueue::EncodeQueue(int num_threads, const EncodeFn& encode_fn, const PublishFn& publish_fn)
+ : encode_fn_(encode_fn), publish_fn_(publish_fn), max_pending_(2 * num_threads),
+   next_seq_(0), pending_(0), shutdown_(false), next_output_(0)
+{
+  for (int i = 0; i < num_threads; ++i)
+    threads_.create_thread(boost::bind(&EncodeQueue::workerThread, this));
+}
+
+EncodeQueue::~EncodeQueue()
+{
+  {
+    boost::mutex::scoped_lock lock(mutex_);
+    shutdown_ = true;
+    jobs_.clear();
+  }
+  cond_.notify_all();
+  threads_.join_all();
+}
+
+bool EncodeQueue::push(const sensor_msgs::ImageConstPtr& image, const ConfigConstPtr& config)
+{
+  {
+    boost::mutex::scoped_lock lock(mutex_);
+    if (pending_ >= max_pending_)
+      return false;
+
+    Job job;
+    job.seq = next_seq_++;
+    job.image = image;
+    job.config = config;
+    jobs_.push_back(job);
+    ++pending_;
+  }
+  cond_.notify_one();
+  return true;
+}
+
+void EncodeQueue::workerThread()
+{
+  JpegEncoder encoder;
+  while (true)
+  {
+    Job job;
+    {
+      boost::mutex::scoped_lock lock(mutex_);
+      while (jobs_.empty() && !shutdown_)
+        cond_.wait(lock);
+      if (shutdown_)
+        return;
+      job = jobs_.front();
+      jobs_.pop_front();
+    }
+
+    Result result;
+    result.message = takeMessage();
+    result.ok = encode_fn_(encoder, *job.config, *job.image, *result.message);
+    finish(job.seq, result);
+  }
+}
+
+EncodeQueue::CompressedImagePtr EncodeQueue::takeMessage()
+{
+  boost::mutex::scoped_lock lock(output_mutex_);
+  if (free_messages_.empty())
+    return CompressedImagePtr(new sensor_msgs::CompressedImage);
+
+  CompressedImagePtr message = free_messages_.back();
+  free_messages_.pop_back();
+  return message;
+}
+
+void EncodeQueue::finish(uint64_t seq, const Result& result)
+{
+  boost::mutex::scoped_lock lock(output_mutex_);
+  done_[seq] = result;
+
+  // Publish every frame that is now contiguous with what has already gone out.
+  // publish_fn_ serializes the message, so it can be recycled right after.
+  size_t published = 0;
+  while (!done_.empty() && done_.begin()->first == next_output_)
+  {
+    Result& next = done_.begin()->second;
+    if (next.ok)
+      publish_fn_(*next.message);
+    free_messages_.push_back(next.message);
+    done_.erase(done_.begin());
+    ++next_output_;
+    ++published;
+  }
+
+  if (published)
+  {
+    boost::mutex::scoped_lock input_lock(mutex_);
+    pending_ -= published;
+  }
+}
+
+} //namespace compressed_image_transport
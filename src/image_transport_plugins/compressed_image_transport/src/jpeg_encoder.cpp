@@ -0,0 +1,122 @@
+/*********************************************************************
+* Software License Agreement (BSD License)
+* 
+*  Copyright (c) 2012, Willow Garage, Inc.
+*  All rights reserved.
+* 
+*  Redistribution and use in source and binary forms, with or without
+*  modification, are permitted provided that the following conditions
+*  are met:
+* 
+*   * Redistributions of source code must retain the above copyright
+*     notice, this list of conditions and the following disclaimer.
+*   * Redistributions in binary form must reproduce the above
+*     copyright notice, this list of conditions and the following
+*     disclaimer in the documentation and/or other materials provided
+*     with the distribution.
+*   * Neither the name of the Willow Garage nor the names of its
+*     contributors may be used to endorse or promote products derived
+*     from this software without specific prior written permission.
+* 
+*  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+*  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+*  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+*  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+*  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+*  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+*  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+*  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+*  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+*  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+*  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+*  POSSIBILITY OF SUCH DAMAGE.
+*********************************************************************/
+
+#include "compressed_image_transport/jpeg_encoder.h"
+#include <sensor_msgs/image_encodings.h>
+#include <ros/console.h>
+
+namespace enc = sensor_msgs::image_encodings;
+
+namespace compressed_image_transport
+{
+
+JpegEncoder::JpegEncoder()
+ : tj_(0), buffer_(0), buffer_size_(0)
+{}
+
+JpegEncoder::~JpegEncoder()
+{
+  if (buffer_)
+    tjFree(buffer_);
+  if (tj_)
+    tjDestroy(tj_);
+}
+
+bool JpegEncoder::encode(const sensor_msgs::Image& image, int quality, bool progressive, std::vector<uint8_t>& output)
+{
+  int pixelFormat;
+  int subsampling = TJSAMP_420; // same chroma subsampling as cv::imencode
+  if (image.encoding == enc::MONO8)
+  {
+    pixelFormat = TJPF_GRAY;
+    subsampling = TJSAMP_GRAY;
+  }
+  else if (image.encoding == enc::RGB8)
+    pixelFormat = TJPF_RGB;
+  else if (image.encoding == enc::BGR8)
+    pixelFormat = TJPF_BGR;
+  else if (image.encoding == enc::RGBA8)
+    pixelFormat = TJPF_RGBA;
+  else if (image.encoding == enc::BGRA8)
+    pixelFormat = TJPF_BGRA;
+  else
+    return false;
+
+  if (image.width == 0 || image.height == 0 ||
+      image.step < image.width * tjPixelSize[pixelFormat] ||
+      image.data.size() < static_cast<size_t>(image.step) * image.height)
+    return false;
+
+  int flags = 0;
+  if (progressive)
+  {
+#ifdef TJFLAG_PROGRESSIVE
+    flags |= TJFLAG_PROGRESSIVE;
+#else
+    return false;
+#endif
+  }
+
+  if (!tj_)
+    tj_ = tjInitCompress();
+  if (!tj_)
+    return false;
+
+  // Size the output buffer for the worst case once, so TurboJPEG never reallocates it
+  unsigned long needed = tjBufSize(image.width, image.height, subsampling);
+  if (needed > buffer_size_)
+  {
+    if (buffer_)
+      tjFree(buffer_);
+    buffer_ = tjAlloc(needed);
+    buffer_size_ = buffer_ ? needed : 0;
+    if (!buffer_)
+      return false;
+  }
+
+  unsigned long jpegSize = buffer_size_;
+  // Old TurboJPEG require a const_cast here. This was fixed in TurboJPEG 1.5.
+  unsigned char* src = const_cast<unsigned char*>(image.data.data());
+  if (tjCompress2(tj_, src, image.width, image.step, image.height, pixelFormat,
+                  &buffer_, &jpegSize, subsampling, quality, flags | TJFLAG_NOREALLOC) != 0)
+  {
+    ROS_WARN_THROTTLE(10.0, "Could not compress data using TurboJPEG, falling back to OpenCV");
+    return false;
+  }
+
+  output.assign(buffer_, buffer_ + jpegSize);
+  return true;
+}
+
+} //namespace compressed_image_transport
@@ -171,6 +171,54 @@ TEST(Basic, loop)
     EXPECT_EQ(receivedEncodings[i], expectedEncodings[i]);
 }
 
+static std::vector<int> receivedFrames;
+
+void handleFrame(const sensor_msgs::ImageConstPtr& img)
+{
+  receivedFrames.push_back(atoi(img->header.frame_id.c_str()));
+}
+
+TEST(Basic, orderedEncodeThreads)
+{
+  ros::NodeHandle nh;
+  // Read by the publisher's reconfigure server when the topic is advertised
+  nh.setParam("img_threaded/compressed/encode_threads", 4);
+
+  image_transport::ImageTransport it(nh);
+  image_transport::Publisher pub = it.advertise("img_threaded", 50);
+  image_transport::Subscriber sub = it.subscribe("img_threaded", 50, &handleFrame, image_transport::TransportHints("compressed"));
+
+  ros::WallTime start = ros::WallTime::now();
+  while(pub.getNumSubscribers() == 0 && (ros::WallTime::now() - start) < ros::WallDuration(3.0))
+  {
+    ros::spinOnce();
+    ros::WallDuration(0.01).sleep();
+  }
+
+  const int numFrames = 30;
+  for(int i = 0; i < numFrames; ++i)
+  {
+    cv_bridge::CvImage cvImg;
+    cvImg.image = cv::Mat(480, 640, CV_8UC3, cv::Scalar(i, 2 * i, 3 * i));
+    cvImg.encoding = sensor_msgs::image_encodings::BGR8;
+    cvImg.header.frame_id = std::to_string(i);
+
+    pub.publish(cvImg.toImageMsg());
+    ros::WallDuration(0.01).sleep();
+  }
+
+  start = ros::WallTime::now();
+  while(receivedFrames.size() < static_cast<size_t>(numFrames) && (ros::WallTime::now() - start) < ros::WallDuration(3.0))
+  {
+    ros::spinOnce();
+    ros::WallDuration(0.1).sleep();
+  }
+
+  // Frames may be dropped when the encode threads fall behind, but never reordered
+  ASSERT_FALSE(receivedFrames.empty());
+  for(std::size_t i = 1; i < receivedFrames.size(); ++i)
+    EXPECT_LT(receivedFrames[i - 1], receivedFrames[i]);
+}
 
 int main(int argc, char **argv)
 {
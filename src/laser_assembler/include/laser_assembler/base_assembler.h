@@ -41,7 +41,11 @@
 #include "sensor_msgs/point_cloud_conversion.h"
 #include "message_filters/subscriber.h"
 
+#include <algorithm>
+#include <cstring>
 #include <deque>
+#include <thread>
+#include <vector>
 
 // Service
 #include "laser_assembler/AssembleScans.h"
@@ -116,8 +120,24 @@ private:
   bool buildCloud2(AssembleScans2::Request& req, AssembleScans2::Response& resp) ;
   bool assembleScans2(AssembleScans2::Request& req, AssembleScans2::Response& resp) ;
 
-  //! \brief Stores history of scans
-  std::deque<sensor_msgs::PointCloud> scan_hist_ ;
+  typedef boost::shared_ptr<const sensor_msgs::PointCloud2> ScanConstPtr ;
+
+  //! \brief Orders scans by stamp, so the history can be binary searched
+  struct StampLess
+  {
+    bool operator()(const ScanConstPtr& scan, const ros::Time& stamp) const { return scan->header.stamp < stamp ; }
+    bool operator()(const ros::Time& stamp, const ScanConstPtr& scan) const { return stamp < scan->header.stamp ; }
+  } ;
+
+  //! \brief Copies the scans to assemble for [begin, end) out of the history, holding the lock only for that long
+  void snapshotScans(const ros::Time& begin, const ros::Time& end, std::vector<ScanConstPtr>& scans) ;
+
+  //! \brief Concatenates the (downsampled) points of scans into cloud
+  void mergeScans(const std::vector<ScanConstPtr>& scans, sensor_msgs::PointCloud2& cloud) ;
+
+  //! \brief Stores history of scans, sorted by stamp. Scans are never modified once stored, so a snapshot of the
+  //!        pointers stays valid while new scans come in
+  std::deque<ScanConstPtr> scan_hist_ ;
   boost::mutex scan_hist_mutex_ ;
 
   //! \brief The number points currently in the scan history
@@ -132,6 +152,9 @@ private:
   //! \brief Specify how much to downsample the data. A value of 1 preserves all the data. 3 would keep 1/3 of the data.
   unsigned int downsample_factor_ ;
 
+  //! \brief The max number of threads copying points when assembling a cloud
+  unsigned int assemble_threads_ ;
+
 } ;
 
 template <class T>
@@ -177,6 +200,16 @@ BaseAssembler<T>::BaseAssembler(const std::string& max_size_param_name) : privat
   if (downsample_factor_ != 1)
     ROS_WARN("Downsample set to [%u]. Note that this is an unreleased/unstable feature", downsample_factor_);
 
+  // ***** Set assemble_threads *****
+  int tmp_assemble_threads ;
+  private_ns_.param("assemble_threads", tmp_assemble_threads, (int) std::max(std::thread::hardware_concurrency(), 1u));
+  if (tmp_assemble_threads < 1)
+  {
+    ROS_ERROR("Parameter assemble_threads<1: %i", tmp_assemble_threads) ;
+    tmp_assemble_threads = 1 ;
+  }
+  assemble_threads_ = tmp_assemble_threads ;
+
   // ***** Start Services *****
   build_cloud_server_    = n_.advertiseService("build_cloud",    &BaseAssembler<T>::buildCloud,    this);
   assemble_scans_server_ = n_.advertiseService("assemble_scans", &BaseAssembler<T>::assembleScans, this);
@@ -245,15 +278,27 @@ void BaseAssembler<T>::msgCallback(const boost::shared_ptr<const T>& scan_ptr)
     return ;
   }
 
-  // Add the current scan (now of type PointCloud) into our history of scans
+  // Sanity check: Each channel should be the same length as the points vector
+  for (unsigned int chan_ind = 0; chan_ind < cur_cloud.channels.size(); chan_ind++)
+  {
+    if (cur_cloud.points.size () != cur_cloud.channels[chan_ind].values.size())
+      ROS_FATAL("Trying to add a malformed point cloud. Cloud has %u points, but channel %u has %u elems", (int)cur_cloud.points.size (), chan_ind, (int)cur_cloud.channels[chan_ind].values.size ());
+  }
+
+  // Store the scan as a PointCloud2, so assembling is a matter of copying whole points
+  boost::shared_ptr<sensor_msgs::PointCloud2> cur_cloud2(new sensor_msgs::PointCloud2) ;
+  sensor_msgs::convertPointCloudToPointCloud2(cur_cloud, *cur_cloud2) ;
+
+  // Add the current scan into our history of scans
   scan_hist_mutex_.lock() ;
-  if (scan_hist_.size() == max_scans_)                           // Is our deque full?
+  if (!scan_hist_.empty() && scan_hist_.size() >= max_scans_)   // Is our deque full?
   {
-    total_pts_ -= scan_hist_.front().points.size () ;            // We're removing an elem, so this reduces our total point count
+    total_pts_ -= scan_hist_.front()->width ;                    // We're removing an elem, so this reduces our total point count
     scan_hist_.pop_front() ;                                     // The front of the deque has the oldest elem, so we can get rid of it
   }
-  scan_hist_.push_back(cur_cloud) ;                              // Add the newest scan to the back of the deque
-  total_pts_ += cur_cloud.points.size () ;                       // Add the new scan to the running total of points
+  // Scans nearly always arrive in order, so this is the back of the deque
+  scan_hist_.insert(std::upper_bound(scan_hist_.begin(), scan_hist_.end(), cur_cloud2->header.stamp, StampLess()), cur_cloud2) ;
+  total_pts_ += cur_cloud2->width ;                              // Add the new scan to the running total of points
 
   //printf("Scans: %4u  Points: %10u\n", scan_hist_.size(), total_pts_) ;
 
@@ -270,82 +315,111 @@ bool BaseAssembler<T>::buildCloud(AssembleScans::Request& req, AssembleScans::Re
 
 
 template <class T>
-bool BaseAssembler<T>::assembleScans(AssembleScans::Request& req, AssembleScans::Response& resp)
+void BaseAssembler<T>::snapshotScans(const ros::Time& begin, const ros::Time& end, std::vector<ScanConstPtr>& scans)
 {
-  //printf("Starting Service Request\n") ;
+  scans.clear() ;
+  boost::mutex::scoped_lock lock(scan_hist_mutex_) ;
 
-  scan_hist_mutex_.lock() ;
-  // Determine where in our history we actually are
-  unsigned int i = 0 ;
+  // Find the first scan at or after begin, and the first one at or after end
+  typename std::deque<ScanConstPtr>::const_iterator first = std::lower_bound(scan_hist_.begin(), scan_hist_.end(), begin, StampLess()) ;
+  typename std::deque<ScanConstPtr>::const_iterator past_end = std::lower_bound(first, scan_hist_.end(), end, StampLess()) ;
+  unsigned int start_index = first - scan_hist_.begin() ;
+  unsigned int past_end_index = past_end - scan_hist_.begin() ;
 
-  // Find the beginning of the request. Probably should be a search
-  while ( i < scan_hist_.size() &&                                                    // Don't go past end of deque
-          scan_hist_[i].header.stamp < req.begin )                                    // Keep stepping until we've exceeded the start time
-  {
-    i++ ;
-  }
-  unsigned int start_index = i ;
+  scans.reserve((past_end_index - start_index + downsample_factor_ - 1) / downsample_factor_) ;
+  for (unsigned int i = start_index; i < past_end_index; i += downsample_factor_)
+    scans.push_back(scan_hist_[i]) ;
+
+  ROS_DEBUG("Point Cloud Results: Aggregated from index %u->%u. BufferSize: %lu", start_index, past_end_index, scan_hist_.size()) ;
+}
 
-  unsigned int req_pts = 0 ;                                                          // Keep a total of the points in the current request
-  // Find the end of the request
-  while ( i < scan_hist_.size() &&                                                    // Don't go past end of deque
-          scan_hist_[i].header.stamp < req.end )                                      // Don't go past the end-time of the request
+template <class T>
+void BaseAssembler<T>::mergeScans(const std::vector<ScanConstPtr>& scans, sensor_msgs::PointCloud2& cloud)
+{
+  // Note: We are assuming that channel information is consistent across multiple scans. Scans that don't match the
+  // first one are left out
+  const sensor_msgs::PointCloud2& layout = *scans.front() ;
+  cloud.header.frame_id = fixed_frame_ ;
+  cloud.header.stamp = scans.back()->header.stamp ;
+  cloud.fields = layout.fields ;
+  cloud.is_bigendian = layout.is_bigendian ;
+  cloud.point_step = layout.point_step ;
+  cloud.height = 1 ;
+  cloud.is_dense = true ;
+
+  // Lay the scans out one after the other in the output
+  struct Segment
+  {
+    const uint8_t* src ;
+    size_t offset ;
+    size_t points ;
+  } ;
+  std::vector<Segment> segments ;
+  segments.reserve(scans.size()) ;
+  size_t req_pts = 0 ;
+  for (size_t i = 0; i < scans.size(); i++)
   {
-    req_pts += (scan_hist_[i].points.size ()+downsample_factor_-1)/downsample_factor_ ;
-    i += downsample_factor_ ;
+    const sensor_msgs::PointCloud2& scan = *scans[i] ;
+    if (scan.point_step != layout.point_step || scan.fields != layout.fields)
+    {
+      ROS_ERROR("Scan at %f has different channels than the first scan in the request. Leaving it out", scan.header.stamp.toSec()) ;
+      continue ;
+    }
+    Segment segment = { scan.data.data(), req_pts * cloud.point_step, (scan.width + downsample_factor_ - 1) / downsample_factor_ } ;
+    segments.push_back(segment) ;
+    req_pts += segment.points ;
+    cloud.is_dense = cloud.is_dense && scan.is_dense ;
   }
-  unsigned int past_end_index = i ;
+  cloud.width = req_pts ;
+  cloud.row_step = cloud.width * cloud.point_step ;
+  cloud.data.resize(cloud.row_step) ;
 
-  if (start_index == past_end_index)
+  if (downsample_factor_ != 1)
   {
-    resp.cloud.header.frame_id = fixed_frame_ ;
-    resp.cloud.header.stamp = req.end ;
-    resp.cloud.points.resize (0) ;
-    resp.cloud.channels.resize (0) ;
+    for (size_t i = 0; i < segments.size(); i++)
+      for (size_t j = 0; j < segments[i].points; j++)
+        memcpy(&cloud.data[segments[i].offset + j * cloud.point_step], segments[i].src + j * downsample_factor_ * cloud.point_step, cloud.point_step) ;
+    return ;
   }
-  else
+
+  // Split the output bytes evenly between the threads; each copies the parts of the scans that fall in its share
+  const size_t min_bytes_per_thread = 1 << 20 ;
+  size_t total_bytes = cloud.data.size() ;
+  size_t num_threads = std::max<size_t>(std::min<size_t>(assemble_threads_, total_bytes / min_bytes_per_thread), 1) ;
+  uint8_t* dst = cloud.data.data() ;
+  const size_t point_step = cloud.point_step ;
+  auto copy_range = [&segments, dst, point_step](size_t begin, size_t end)
   {
-    // Note: We are assuming that channel information is consistent across multiple scans. If not, then bad things (segfaulting) will happen
-    // Allocate space for the cloud
-    resp.cloud.points.resize (req_pts);
-    const unsigned int num_channels = scan_hist_[start_index].channels.size ();
-    resp.cloud.channels.resize (num_channels) ;
-    for (i = 0; i<num_channels; i++)
+    for (size_t i = 0; i < segments.size(); i++)
     {
-      resp.cloud.channels[i].name = scan_hist_[start_index].channels[i].name ;
-      resp.cloud.channels[i].values.resize (req_pts) ;
+      size_t seg_begin = std::max(begin, segments[i].offset) ;
+      size_t seg_end = std::min(end, segments[i].offset + segments[i].points * point_step) ;
+      if (seg_begin < seg_end)
+        memcpy(dst + seg_begin, segments[i].src + (seg_begin - segments[i].offset), seg_end - seg_begin) ;
     }
-    //resp.cloud.header.stamp = req.end ;
-    resp.cloud.header.frame_id = fixed_frame_ ;
-    unsigned int cloud_count = 0 ;
-    for (i=start_index; i<past_end_index; i+=downsample_factor_)
-    {
+  } ;
+  std::vector<std::thread> workers ;
+  for (size_t t = 1; t < num_threads; t++)
+    workers.push_back(std::thread(copy_range, t * total_bytes / num_threads, (t + 1) * total_bytes / num_threads)) ;
+  copy_range(0, total_bytes / num_threads) ;
+  for (size_t t = 0; t < workers.size(); t++)
+    workers[t].join() ;
+}
 
-      // Sanity check: Each channel should be the same length as the points vector
-      for (unsigned int chan_ind = 0; chan_ind < scan_hist_[i].channels.size(); chan_ind++)
-      {
-        if (scan_hist_[i].points.size () != scan_hist_[i].channels[chan_ind].values.size())
-          ROS_FATAL("Trying to add a malformed point cloud. Cloud has %u points, but channel %u has %u elems", (int)scan_hist_[i].points.size (), chan_ind, (int)scan_hist_[i].channels[chan_ind].values.size ());
-      }
-
-      for(unsigned int j=0; j<scan_hist_[i].points.size (); j+=downsample_factor_)
-      {
-        resp.cloud.points[cloud_count].x = scan_hist_[i].points[j].x ;
-        resp.cloud.points[cloud_count].y = scan_hist_[i].points[j].y ;
-        resp.cloud.points[cloud_count].z = scan_hist_[i].points[j].z ;
-
-        for (unsigned int k=0; k<num_channels; k++)
-          resp.cloud.channels[k].values[cloud_count] = scan_hist_[i].channels[k].values[j] ;
-
-        cloud_count++ ;
-      }
-      resp.cloud.header.stamp = scan_hist_[i].header.stamp;
-    }
-  }
-  scan_hist_mutex_.unlock() ;
+template <class T>
+bool BaseAssembler<T>::assembleScans(AssembleScans::Request& req, AssembleScans::Response& resp)
+{
+  AssembleScans2::Request tmp_req;
+  AssembleScans2::Response tmp_res;
+  tmp_req.begin = req.begin;
+  tmp_req.end = req.end;
+  bool ret = assembleScans2(tmp_req, tmp_res);
 
-  ROS_DEBUG("Point Cloud Results: Aggregated from index %u->%u. BufferSize: %lu. Points in cloud: %u", start_index, past_end_index, scan_hist_.size(), (int)resp.cloud.points.size ()) ;
-  return true ;
+  if ( ret )
+  {
+    sensor_msgs::convertPointCloud2ToPointCloud(tmp_res.cloud, resp.cloud);
+  }
+  return ret;
 }
 
 template <class T>
@@ -358,16 +432,21 @@ bool BaseAssembler<T>::buildCloud2(AssembleScans2::Request& req, AssembleScans2:
 template <class T>
 bool BaseAssembler<T>::assembleScans2(AssembleScans2::Request& req, AssembleScans2::Response& resp)
 {
-  AssembleScans::Request tmp_req;
-  AssembleScans::Response tmp_res;
-  tmp_req.begin = req.begin;
-  tmp_req.end = req.end;
-  bool ret = assembleScans(tmp_req, tmp_res);
+  // Only the pointers are copied under the lock, so incoming scans aren't held up by the assembly
+  std::vector<ScanConstPtr> scans ;
+  snapshotScans(req.begin, req.end, scans) ;
 
-  if ( ret )
+  if (scans.empty())
   {
-    sensor_msgs::convertPointCloudToPointCloud2(tmp_res.cloud, resp.cloud);
+    sensor_msgs::PointCloud empty ;
+    empty.header.frame_id = fixed_frame_ ;
+    empty.header.stamp = req.end ;
+    sensor_msgs::convertPointCloudToPointCloud2(empty, resp.cloud) ;
   }
-  return ret;
+  else
+    mergeScans(scans, resp.cloud) ;
+
+  ROS_DEBUG("Points in cloud: %u", resp.cloud.width) ;
+  return true ;
 }
 }
@@ -65,19 +65,26 @@ namespace laser_filters
 
       bool update(const sensor_msgs::LaserScan& input_scan, sensor_msgs::LaserScan& filtered_scan){
         filtered_scan = input_scan; //copy entire message
+        return updateInPlace(filtered_scan);
+      }
+
+      bool supportsInPlace() const {
+        return true;
+      }
 
-        double current_angle = input_scan.angle_min;
+      bool updateInPlace(sensor_msgs::LaserScan& filtered_scan){
+        double current_angle = filtered_scan.angle_min;
         unsigned int count = 0;
         //loop through the scan and remove ranges at angles between lower_angle_ and upper_angle_
-        for(unsigned int i = 0; i < input_scan.ranges.size(); ++i){
+        for(unsigned int i = 0; i < filtered_scan.ranges.size(); ++i){
           if((current_angle > lower_angle_) && (current_angle < upper_angle_)){
-            filtered_scan.ranges[i] = input_scan.range_max + 1.0;
+            filtered_scan.ranges[i] = filtered_scan.range_max + 1.0;
             if(i < filtered_scan.intensities.size()){
               filtered_scan.intensities[i] = 0.0;
             }
             count++;
           }
-          current_angle += input_scan.angle_increment;
+          current_angle += filtered_scan.angle_increment;
         }
 
         ROS_DEBUG("Filtered out %u points from the laser scan.", count);
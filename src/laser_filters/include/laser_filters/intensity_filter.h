@@ -51,6 +51,8 @@ public:
   LaserScanIntensityFilter();
   bool configure();
   bool update(const sensor_msgs::LaserScan& input_scan, sensor_msgs::LaserScan& output_scan);
+  bool updateInPlace(sensor_msgs::LaserScan& scan);
+  bool supportsInPlace() const { return true; }
 
 private:
   std::shared_ptr<dynamic_reconfigure::Server<IntensityFilterConfig>> dyn_server_;
@@ -80,18 +80,28 @@ public:
   }
 
   bool update(const sensor_msgs::LaserScan& input_scan, sensor_msgs::LaserScan& filtered_scan)
+  {
+    filtered_scan = input_scan;
+    return updateInPlace(filtered_scan);
+  }
+
+  bool supportsInPlace() const
+  {
+    return true;
+  }
+
+  bool updateInPlace(sensor_msgs::LaserScan& filtered_scan)
   {
     double lower_threshold = config_.lower_threshold;
     double upper_threshold = config_.upper_threshold;
 
     if (config_.use_message_range_limits)
     {
-      lower_threshold = input_scan.range_min;
-      upper_threshold = input_scan.range_max;
+      lower_threshold = filtered_scan.range_min;
+      upper_threshold = filtered_scan.range_max;
     }
-    filtered_scan = input_scan;
     for (unsigned int i=0;
-         i < input_scan.ranges.size();
+         i < filtered_scan.ranges.size();
          i++) // Need to check ever reading in the current scan
     {
 
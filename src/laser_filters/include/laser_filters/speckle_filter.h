@@ -161,6 +161,8 @@ public:
   void configure(SpeckleFilterConfig& config) { reconfigureCB(config, 0); }
 
   bool update(const sensor_msgs::LaserScan& input_scan, sensor_msgs::LaserScan& output_scan);
+  bool updateInPlace(sensor_msgs::LaserScan& scan);
+  bool supportsInPlace() const { return true; }
 
 private:
   std::shared_ptr<dynamic_reconfigure::Server<laser_filters::SpeckleFilterConfig>> dyn_server_;
@@ -66,9 +66,13 @@ bool LaserScanIntensityFilter::configure()
 bool LaserScanIntensityFilter::update(const sensor_msgs::LaserScan& input_scan, sensor_msgs::LaserScan& filtered_scan)
 {
   filtered_scan = input_scan;
+  return updateInPlace(filtered_scan);
+}
 
+bool LaserScanIntensityFilter::updateInPlace(sensor_msgs::LaserScan& filtered_scan)
+{
   // Need to check ever reading in the current scan
-  for (unsigned int i=0; i < input_scan.ranges.size() && i < input_scan.intensities.size(); i++)
+  for (unsigned int i=0; i < filtered_scan.ranges.size() && i < filtered_scan.intensities.size(); i++)
   {
     float& range = filtered_scan.ranges[i];
     float& intensity = filtered_scan.intensities[i];
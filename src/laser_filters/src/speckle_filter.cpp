@@ -73,9 +73,13 @@ bool LaserScanSpeckleFilter::configure()
 
 bool LaserScanSpeckleFilter::update(const sensor_msgs::LaserScan& input_scan, sensor_msgs::LaserScan& output_scan)
 {
-  boost::recursive_mutex::scoped_lock lock(own_mutex_);
-
   output_scan = input_scan;
+  return updateInPlace(output_scan);
+}
+
+bool LaserScanSpeckleFilter::updateInPlace(sensor_msgs::LaserScan& output_scan)
+{
+  boost::recursive_mutex::scoped_lock lock(own_mutex_);
 
   std::vector<bool> &valid_ranges = valid_ranges_work_;
 
@@ -87,7 +91,7 @@ bool LaserScanSpeckleFilter::update(const sensor_msgs::LaserScan& input_scan, se
   }
 
   size_t i = 0;
-  size_t i_max = input_scan.ranges.size();
+  size_t i_max = output_scan.ranges.size();
   valid_ranges.clear();
   while (i < i_max) {
     bool out_of_range = output_scan.ranges[i] > config_.max_range;
@@ -96,7 +100,7 @@ bool LaserScanSpeckleFilter::update(const sensor_msgs::LaserScan& input_scan, se
   }
 
   i = 0;
-  i_max = input_scan.ranges.size() - config_.filter_window + 1;
+  i_max = output_scan.ranges.size() - config_.filter_window + 1;
   while (i < i_max) {
     bool window_valid = validator_->checkWindowValid(
       output_scan, i, config_.filter_window, config_.max_range_difference
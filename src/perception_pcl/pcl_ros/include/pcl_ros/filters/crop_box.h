@@ -42,6 +42,7 @@
 // PCL includes
 #include <pcl/filters/crop_box.h>
 #include "pcl_ros/filters/filter.h"
+#include "pcl_ros/filters/point_cloud2_filters.h"
 
 // Dynamic reconfigure
 #include "pcl_ros/CropBoxConfig.h"
@@ -79,6 +80,27 @@ namespace pcl_ros
         pcl_conversions::moveFromPCL(pcl_output, output);
       }
 
+      /** \brief Call the filter straight on the ROS message. Only unorganized output over the whole cloud is handled.
+        * \param input the input point cloud dataset
+        * \param indices the input set of indices to use from \a input
+        * \param transform the output transform to apply, or NULL
+        * \param output the resultant filtered dataset
+        */
+      inline bool
+      filterNative (const PointCloud2::ConstPtr &input, const IndicesPtr &indices,
+                    const Eigen::Matrix4f *transform, PointCloud2 &output)
+      {
+        boost::mutex::scoped_lock lock (mutex_);
+        if (indices || impl_.getKeepOrganized ())
+          return (false);
+
+        if (!selectCropBox (*input, impl_.getMin (), impl_.getMax (), impl_.getNegative (), selected_))
+          return (false);
+        copyPointCloud (*input, selected_, transform, output);
+        output.is_dense = true;
+        return (true);
+      }
+
       /** \brief Child initialization routine.
         * \param nh ROS node handle
         * \param has_service set to true if the child has a Dynamic Reconfigure service
@@ -96,6 +118,9 @@ namespace pcl_ros
     private:
       /** \brief The PCL filter implementation used. */
       pcl::CropBox<pcl::PCLPointCloud2> impl_;
+
+      /** \brief Scratch buffer for the points selected by filterNative (). */
+      std::vector<int> selected_;
     public:
       EIGEN_MAKE_ALIGNED_OPERATOR_NEW
   };
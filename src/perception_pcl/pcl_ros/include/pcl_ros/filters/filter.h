@@ -113,6 +113,22 @@ namespace pcl_ros
       filter (const PointCloud2::ConstPtr &input, const IndicesPtr &indices, 
               PointCloud2 &output) = 0;
 
+      /** \brief Optional filter method working straight on the ROS message, without a PCL conversion. Children
+        * whose filter only selects points override this, and write the selected points to \a output in one pass
+        * with \a transform applied on the way.
+        * \param input the input point cloud dataset.
+        * \param indices a pointer to the vector of point indices to use.
+        * \param transform the output transform to apply, or NULL to keep the input frame
+        * \param output the resultant filtered PointCloud2
+        * \return false if the input cannot be handled natively, in which case filter () is called instead
+        */
+      virtual bool
+      filterNative (const PointCloud2::ConstPtr &/*input*/, const IndicesPtr &/*indices*/,
+                    const Eigen::Matrix4f */*transform*/, PointCloud2 &/*output*/)
+      {
+        return (false);
+      }
+
       /** \brief Lazy transport subscribe routine. */
       virtual void
       subscribe();
@@ -125,7 +141,8 @@ namespace pcl_ros
       virtual void 
       onInit ();
 
-      /** \brief Call the child filter () method, optionally transform the result, and publish it.
+      /** \brief Call the child filter () method, optionally transform the result, and publish it. The output
+        * transform is looked up first so that filterNative () can apply it while writing the output.
         * \param input the input point cloud dataset.
         * \param indices a pointer to the vector of point indices to use.   
         */
@@ -0,0 +1,86 @@
+/*
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2009, Willow Garage, Inc.
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Willow Garage, Inc. nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef PCL_ROS_FILTERS_POINT_CLOUD2_FILTERS_H_
+#define PCL_ROS_FILTERS_POINT_CLOUD2_FILTERS_H_
+
+#include <string>
+#include <vector>
+#include <Eigen/Core>
+#include <sensor_msgs/PointCloud2.h>
+
+namespace pcl_ros
+{
+  /** \brief Select the points of a PointCloud2 that pass a field range test, reading straight from the message
+    * buffer. Matches pcl::PassThrough<pcl::PCLPointCloud2> without keep_organized: points with non-finite x/y/z are
+    * always dropped, and if \a field_name is empty no range test is applied.
+    * \param in the input PointCloud2 dataset
+    * \param field_name the FLOAT32 field to test, or empty
+    * \param min the minimum allowed field value
+    * \param max the maximum allowed field value
+    * \param negative set to true to keep the points outside (\a min; \a max) instead
+    * \param selected the resultant point indices, in input order
+    * \return false if x/y/z or \a field_name are missing or not FLOAT32, or the rows of \a in are padded
+    */
+  bool
+  selectPassThrough (const sensor_msgs::PointCloud2 &in, const std::string &field_name,
+                     double min, double max, bool negative, std::vector<int> &selected);
+
+  /** \brief Select the points of a PointCloud2 that lie inside an axis aligned box, reading straight from the
+    * message buffer. Matches pcl::CropBox<pcl::PCLPointCloud2> with no box transform and without keep_organized.
+    * \param in the input PointCloud2 dataset
+    * \param min_pt the minimum box corner (x, y, z used)
+    * \param max_pt the maximum box corner (x, y, z used)
+    * \param negative set to true to keep the points outside the box instead
+    * \param selected the resultant point indices, in input order
+    * \return false if x/y/z are missing or not FLOAT32, or the rows of \a in are padded
+    */
+  bool
+  selectCropBox (const sensor_msgs::PointCloud2 &in, const Eigen::Vector4f &min_pt, const Eigen::Vector4f &max_pt,
+                 bool negative, std::vector<int> &selected);
+
+  /** \brief Copy a subset of points into an unorganized PointCloud2, transforming them on the way. The points
+    * go through the same PointCloud2Transform as pcl_ros::transformPointCloud, a few thousand at a time right
+    * after they are copied, so coordinates, normals and viewpoints come out as they would from it.
+    * \param in the input PointCloud2 dataset
+    * \param selected the indices of the points to copy
+    * \param transform the transform to apply, or NULL to copy the points unchanged
+    * \param out the resultant PointCloud2 dataset (must not be \a in)
+    */
+  void
+  copyPointCloud (const sensor_msgs::PointCloud2 &in, const std::vector<int> &selected,
+                  const Eigen::Matrix4f *transform, sensor_msgs::PointCloud2 &out);
+}
+
+#endif  //#ifndef PCL_ROS_FILTERS_POINT_CLOUD2_FILTERS_H_
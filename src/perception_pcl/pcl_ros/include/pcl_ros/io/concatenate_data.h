@@ -46,6 +46,10 @@
 #include <message_filters/pass_through.h>
 #include <message_filters/sync_policies/exact_time.h>
 #include <message_filters/sync_policies/approximate_time.h>
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/thread.hpp>
+#include "pcl_ros/transforms.h"
 
 namespace pcl_ros
 {
@@ -65,15 +69,17 @@ namespace pcl_ros
       typedef PointCloud2::ConstPtr PointCloud2ConstPtr;
 
       /** \brief Empty constructor. */
-      PointCloudConcatenateDataSynchronizer () : maximum_queue_size_ (3) {};
+      PointCloudConcatenateDataSynchronizer () : PointCloudConcatenateDataSynchronizer (3) {};
 
       /** \brief Empty constructor.
         * \param queue_size the maximum queue size
         */
-      PointCloudConcatenateDataSynchronizer (int queue_size) : maximum_queue_size_(queue_size), approximate_sync_(false) {};
+      PointCloudConcatenateDataSynchronizer (int queue_size) : maximum_queue_size_(queue_size), approximate_sync_(false),
+        num_threads_ (1), deskew_ (false), time_field_ ("time"), time_scale_ (1.0),
+        next_slice_ (0), slices_left_ (0), shutting_down_ (false) {};
 
-      /** \brief Empty destructor. */
-      virtual ~PointCloudConcatenateDataSynchronizer () {};
+      /** \brief Destructor. Stops the transform worker threads. */
+      virtual ~PointCloudConcatenateDataSynchronizer ();
 
       void onInit ();
       void subscribe ();
@@ -101,6 +107,45 @@ namespace pcl_ros
       /** \brief TF listener object. */
       tf::TransformListener tf_;
 
+      /** \brief Number of threads transforming the inputs, including the callback thread (1 by default). */
+      int num_threads_;
+
+      /** \brief True if points are motion compensated using a per-point time field (false by default). */
+      bool deskew_;
+
+      /** \brief Frame that is fixed in the world, used to relate sensor poses at different times when deskewing. */
+      std::string fixed_frame_;
+
+      /** \brief Name of the per-point time field, relative to the cloud's header stamp ("time" by default). */
+      std::string time_field_;
+
+      /** \brief Seconds per unit of the time field (1 by default, 1e-9 for nanoseconds). */
+      double time_scale_;
+
+      /** \brief A contiguous run of points of one input, copied and transformed into the output. */
+      struct Slice
+      {
+        const uint8_t *in;
+        uint8_t *out;
+        size_t size;
+        /** \brief Transform into the output frame, NULL if the input is already in it. */
+        const PointCloud2Transform *transform;
+      };
+
+      /** \brief Transforms of each input of the current output. */
+      std::vector<PointCloud2Transform> transforms_;
+
+      /** \brief Point step shared by the inputs of the current output. */
+      uint32_t point_step_;
+
+      /** \brief Work queue of the transform workers. */
+      boost::thread_group workers_;
+      boost::mutex slices_mutex_;
+      boost::condition_variable slices_ready_, slices_done_;
+      std::vector<Slice> slices_;
+      size_t next_slice_, slices_left_;
+      bool shutting_down_;
+
       /** \brief Null passthrough filter, used for pushing empty elements in the 
         * synchronizer */
       message_filters::PassThrough<PointCloud2> nf_;
@@ -129,7 +174,39 @@ namespace pcl_ros
                   const PointCloud2::ConstPtr &in5, const PointCloud2::ConstPtr &in6, 
                   const PointCloud2::ConstPtr &in7, const PointCloud2::ConstPtr &in8);
       
-      void combineClouds (const PointCloud2 &in1, const PointCloud2 &in2, PointCloud2 &out);
+      /** \brief Transform two clouds into the output frame and concatenate them.
+        * \return false if either could not be transformed
+        */
+      bool combineClouds (const PointCloud2 &in1, const PointCloud2 &in2, PointCloud2 &out);
+
+      /** \brief True if the clouds share one packed layout with FLOAT32 coordinates, so concatenateClouds can
+        * be used instead of combineClouds.
+        */
+      bool canConcatenate (const std::vector<PointCloud2ConstPtr> &clouds) const;
+
+      /** \brief Concatenate clouds accepted by canConcatenate into out in a single pass, transforming every
+        * input straight into its part of the output.
+        * \return false if any input could not be transformed
+        */
+      bool concatenateClouds (const std::vector<PointCloud2ConstPtr> &clouds, const ros::Time &stamp, PointCloud2 &out);
+
+      /** \brief Set up the transform of a cloud into the output frame at the output stamp, deskewed if
+        * enabled and the cloud has a time field.
+        * \return false if TF could not provide it
+        */
+      bool lookupTransform (const PointCloud2 &cloud, const ros::Time &stamp, PointCloud2Transform &transform);
+
+      /** \brief Run slices on the worker threads and the calling thread, returning once all are done. */
+      void runSlices (std::vector<Slice> &slices);
+
+      /** \brief Take slices off slices_ until none are left; slices_mutex_ must be held. */
+      void drainSlices (boost::unique_lock<boost::mutex> &lock);
+
+      /** \brief Copy and transform one slice. */
+      void transformSlice (const Slice &slice) const;
+
+      /** \brief Worker thread main loop. */
+      void workerLoop ();
   };
 }
 
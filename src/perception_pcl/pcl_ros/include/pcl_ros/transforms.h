@@ -39,6 +39,7 @@
 
 #include <sensor_msgs/PointCloud2.h>
 #include <pcl/common/transforms.h>
+#include <Eigen/StdVector>
 #include <tf/transform_datatypes.h>
 #include <tf/transform_listener.h>
 #include <tf2_ros/buffer.h>
@@ -247,7 +248,92 @@ namespace pcl_ros
                        const sensor_msgs::PointCloud2 &in,
                        sensor_msgs::PointCloud2 &out);
 
-  /** \brief Transform a sensor_msgs::PointCloud2 dataset using an Eigen 4x4 matrix.
+  /** \brief Transforms the points of sensor_msgs::PointCloud2 datasets laid out alike. The x/y/z and vp_x/vp_y/vp_z
+    * fields are transformed and normal_x/normal_y/normal_z rotated, wherever they are in the point. Points with
+    * non-finite x/y/z keep their coordinates and normals, except for max range points: if the cloud has a finite
+    * "distance" field, it holds their x, which is transformed along with y/z and saved in distance again.
+    *
+    * Either one transform is applied to every point, or several knots evenly spaced over an interval of time. In the
+    * latter case each point is transformed by the linear blend of the two knots around its time field value, which
+    * deskews clouds captured over a sweep. Blending the matrices is accurate for the small motions between knots.
+    */
+  class PointCloud2Transform
+  {
+    public:
+      typedef std::vector<Eigen::Matrix4f, Eigen::aligned_allocator<Eigen::Matrix4f> > Knots;
+
+      PointCloud2Transform ();
+
+      /** \brief Set up a single transform for clouds with the fields of \a layout.
+        * \param layout a cloud with the field layout of the clouds to transform
+        * \param transform the transformation to use on the points
+        * \return false if the x/y/z fields are missing or not FLOAT32
+        */
+      bool
+      init (const sensor_msgs::PointCloud2 &layout, const Eigen::Matrix4f &transform);
+
+      /** \brief Set up a transform that varies with a per point time field, for clouds with the fields of \a layout.
+        * \param layout a cloud with the field layout of the clouds to transform
+        * \param knots the transformations at \a time_begin, evenly spaced up to \a time_end. Times outside of the
+        * interval use the first or the last knot.
+        * \param time_field the per point time field (FLOAT32, FLOAT64, INT32 or UINT32)
+        * \param time_begin the \a time_field value of the first knot
+        * \param time_end the \a time_field value of the last knot
+        * \return false if the x/y/z or time fields are missing or of an unsupported type, or \a knots is empty
+        */
+      bool
+      init (const sensor_msgs::PointCloud2 &layout, const Knots &knots, const std::string &time_field,
+            double time_begin, double time_end);
+
+      /** \brief Get the smallest and largest value of a per point time field.
+        * \return false if the field is missing or of an unsupported type, or the cloud is empty
+        */
+      static bool
+      getTimeRange (const sensor_msgs::PointCloud2 &cloud, const std::string &time_field,
+                    double &time_min, double &time_max);
+
+      /** \brief Transform \a n consecutive points starting at \a in into \a out, which may be \a in. */
+      void
+      transformPoints (const uint8_t *in, uint8_t *out, size_t n) const;
+
+      /** \brief Transform every point of \a in into \a out, which may be \a in.
+        * \param in the input PointCloud2 dataset, laid out as the one given to init ()
+        * \param out the resultant transformed PointCloud2 dataset
+        * \param num_threads the maximum number of threads to use, including the calling one
+        */
+      void
+      transform (const sensor_msgs::PointCloud2 &in, sensor_msgs::PointCloud2 &out,
+                 unsigned int num_threads = 1) const;
+
+    private:
+      bool
+      initFields (const sensor_msgs::PointCloud2 &layout);
+
+      void
+      transformBlock (uint8_t *points, size_t n) const;
+
+      void
+      deskewBlock (uint8_t *points, size_t n) const;
+
+      /** \brief Transform the coordinates of one point, including max range points. */
+      void
+      transformCoordinates (const Eigen::Matrix4f &m, uint8_t *p) const;
+
+      /** \brief Knots, and the differences between neighbouring knots. */
+      Knots knots_, deltas_;
+
+      int time_offset_;
+      uint8_t time_datatype_;
+      double time_begin_, knots_per_unit_;
+
+      size_t point_step_;
+      int x_offset_, y_offset_, z_offset_, distance_offset_;
+      int normal_offset_[3], vp_offset_[3];
+      bool has_normals_, has_vp_;
+  };
+
+  /** \brief Transform a sensor_msgs::PointCloud2 dataset using an Eigen 4x4 matrix, as PointCloud2Transform does.
+    * \a in and \a out may be the same cloud.
     * \param transform the transformation to use on the points
     * \param in the input PointCloud2 dataset
     * \param out the resultant transformed PointCloud2 dataset
@@ -257,6 +343,41 @@ namespace pcl_ros
                        const sensor_msgs::PointCloud2 &in, 
                        sensor_msgs::PointCloud2 &out);
 
+  /** \brief Transform a sensor_msgs::PointCloud2 dataset using an Eigen 4x4 matrix, splitting large clouds over
+    * several threads.
+    * \param transform the transformation to use on the points
+    * \param in the input PointCloud2 dataset
+    * \param out the resultant transformed PointCloud2 dataset
+    * \param num_threads the maximum number of threads to use, including the calling one
+    */
+  void
+  transformPointCloud (const Eigen::Matrix4f &transform,
+                       const sensor_msgs::PointCloud2 &in,
+                       sensor_msgs::PointCloud2 &out,
+                       unsigned int num_threads);
+
+  /** \brief Transform a sensor_msgs::PointCloud2 dataset whose points were captured over an interval of time, such as
+    * a spinning laser sweep. Each point is transformed by the linear blend of \a transform_begin and \a transform_end
+    * at its \a time_field value, clamped to [\a time_begin; \a time_end]. See PointCloud2Transform.
+    * \param transform_begin the transformation at \a time_begin
+    * \param transform_end the transformation at \a time_end
+    * \param time_field the per point time field (FLOAT32, FLOAT64, INT32 or UINT32)
+    * \param time_begin the \a time_field value of \a transform_begin
+    * \param time_end the \a time_field value of \a transform_end
+    * \param in the input PointCloud2 dataset
+    * \param out the resultant transformed PointCloud2 dataset
+    * \param num_threads the maximum number of threads to use, including the calling one
+    * \return false if the x/y/z or time fields are missing or of an unsupported type
+    */
+  bool
+  transformPointCloud (const Eigen::Matrix4f &transform_begin,
+                       const Eigen::Matrix4f &transform_end,
+                       const std::string &time_field,
+                       double time_begin, double time_end,
+                       const sensor_msgs::PointCloud2 &in,
+                       sensor_msgs::PointCloud2 &out,
+                       unsigned int num_threads = 1);
+
   /** \brief Obtain the transformation matrix from TF into an Eigen form
     * \param bt the TF transformation
     * \param out_mat the Eigen transformation
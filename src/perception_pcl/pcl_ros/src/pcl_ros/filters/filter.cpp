@@ -62,43 +62,45 @@
 void
 pcl_ros::Filter::computePublish (const PointCloud2::ConstPtr &input, const IndicesPtr &indices)
 {
-  PointCloud2 output;
-  // Call the virtual method in the child
-  filter (input, indices, output);
-
-  PointCloud2::Ptr cloud_tf (new PointCloud2 (output));   // set the output by default
-  // Check whether the user has given a different output TF frame
-  if (!tf_output_frame_.empty () && output.header.frame_id != tf_output_frame_)
+  // Filters keep the input frame, so the output transform is known before filtering: either to the user given
+  // output TF frame, or back to the original frame if the input was transformed
+  std::string target_frame = tf_output_frame_.empty () ? tf_input_orig_frame_ : tf_output_frame_;
+  bool transform_output = !target_frame.empty () && input->header.frame_id != target_frame;
+  Eigen::Matrix4f transform = Eigen::Matrix4f::Identity ();
+  if (transform_output)
   {
-    NODELET_DEBUG ("[%s::computePublish] Transforming output dataset from %s to %s.", getName ().c_str (), output.header.frame_id.c_str (), tf_output_frame_.c_str ());
-    // Convert the cloud into the different frame
-    PointCloud2 cloud_transformed;
-    if (!pcl_ros::transformPointCloud (tf_output_frame_, output, cloud_transformed, tf_listener_))
+    NODELET_DEBUG ("[%s::computePublish] Transforming output dataset from %s to %s.", getName ().c_str (), input->header.frame_id.c_str (), target_frame.c_str ());
+    tf::StampedTransform tf_transform;
+    try
     {
-      NODELET_ERROR ("[%s::computePublish] Error converting output dataset from %s to %s.", getName ().c_str (), output.header.frame_id.c_str (), tf_output_frame_.c_str ());
-      return;
+      tf_listener_.waitForTransform (target_frame, input->header.frame_id, input->header.stamp, ros::Duration (1));
+      tf_listener_.lookupTransform (target_frame, input->header.frame_id, input->header.stamp, tf_transform);
     }
-    cloud_tf.reset (new PointCloud2 (cloud_transformed));
-  }
-  if (tf_output_frame_.empty () && output.header.frame_id != tf_input_orig_frame_)
-  // no tf_output_frame given, transform the dataset to its original frame
-  {
-    NODELET_DEBUG ("[%s::computePublish] Transforming output dataset from %s back to %s.", getName ().c_str (), output.header.frame_id.c_str (), tf_input_orig_frame_.c_str ());
-    // Convert the cloud into the different frame
-    PointCloud2 cloud_transformed;
-    if (!pcl_ros::transformPointCloud (tf_input_orig_frame_, output, cloud_transformed, tf_listener_))
+    catch (const tf::TransformException &e)
     {
-      NODELET_ERROR ("[%s::computePublish] Error converting output dataset from %s back to %s.", getName ().c_str (), output.header.frame_id.c_str (), tf_input_orig_frame_.c_str ());
+      NODELET_ERROR ("[%s::computePublish] Error converting output dataset from %s to %s: %s", getName ().c_str (), input->header.frame_id.c_str (), target_frame.c_str (), e.what ());
       return;
     }
-    cloud_tf.reset (new PointCloud2 (cloud_transformed));
+    pcl_ros::transformAsMatrix (tf_transform, transform);
+  }
+
+  PointCloud2::Ptr output (new PointCloud2);
+  // Try the conversion free path first, which also applies the transform while writing the output
+  if (!filterNative (input, indices, transform_output ? &transform : NULL, *output))
+  {
+    // Call the virtual method in the child
+    filter (input, indices, *output);
+    if (transform_output)
+      pcl_ros::transformPointCloud (transform, *output, *output);
   }
+  if (transform_output)
+    output->header.frame_id = target_frame;
 
   // Copy timestamp to keep it
-  cloud_tf->header.stamp = input->header.stamp;
+  output->header.stamp = input->header.stamp;
 
   // Publish a boost shared ptr
-  pub_output_.publish (cloud_tf);
+  pub_output_.publish (output);
 }
 
 //////////////////////////////////////////////////////////////////////////////////////////////
@@ -225,13 +227,13 @@ pcl_ros::Filter::input_indices_callback (const PointCloud2::ConstPtr &cloud, con
     NODELET_DEBUG ("[%s::input_indices_callback] Transforming input dataset from %s to %s.", getName ().c_str (), cloud->header.frame_id.c_str (), tf_input_frame_.c_str ());
     // Save the original frame ID
     // Convert the cloud into the different frame
-    PointCloud2 cloud_transformed;
-    if (!pcl_ros::transformPointCloud (tf_input_frame_, *cloud, cloud_transformed, tf_listener_))
+    PointCloud2::Ptr cloud_transformed (new PointCloud2);
+    if (!pcl_ros::transformPointCloud (tf_input_frame_, *cloud, *cloud_transformed, tf_listener_))
     {
       NODELET_ERROR ("[%s::input_indices_callback] Error converting input dataset from %s to %s.", getName ().c_str (), cloud->header.frame_id.c_str (), tf_input_frame_.c_str ());
       return;
     }
-    cloud_tf = boost::make_shared<PointCloud2> (cloud_transformed);
+    cloud_tf = cloud_transformed;
   }
   else
     cloud_tf = cloud;
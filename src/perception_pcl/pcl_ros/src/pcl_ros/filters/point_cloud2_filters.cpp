@@ -0,0 +1,154 @@
+/*
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2009, Willow Garage, Inc.
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Willow Garage, Inc. nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <ros/console.h>
+#include <sensor_msgs/point_cloud2_iterator.h>
+#include "pcl_ros/transforms.h"
+#include "pcl_ros/filters/point_cloud2_filters.h"
+
+namespace
+{
+  /** \brief Number of points copied before they are transformed, so they are still in cache. */
+  const size_t COPY_CHUNK = 4096;
+
+  /** \brief True if the cloud has a FLOAT32 field of that name. */
+  bool
+  hasFloatField (const sensor_msgs::PointCloud2 &cloud, const std::string &name)
+  {
+    for (size_t d = 0; d < cloud.fields.size (); ++d)
+      if (cloud.fields[d].name == name)
+        return (cloud.fields[d].datatype == sensor_msgs::PointField::FLOAT32);
+    return (false);
+  }
+
+  /** \brief True if the cloud has FLOAT32 x/y/z and no padding between its rows. */
+  bool
+  canSelect (const sensor_msgs::PointCloud2 &cloud)
+  {
+    return (hasFloatField (cloud, "x") && hasFloatField (cloud, "y") && hasFloatField (cloud, "z") &&
+            cloud.row_step == cloud.width * cloud.point_step);
+  }
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+bool
+pcl_ros::selectPassThrough (const sensor_msgs::PointCloud2 &in, const std::string &field_name,
+                            double min, double max, bool negative, std::vector<int> &selected)
+{
+  if (!canSelect (in) || (!field_name.empty () && !hasFloatField (in, field_name)))
+    return (false);
+
+  size_t nr_points = static_cast<size_t> (in.width) * in.height;
+  selected.clear ();
+  selected.reserve (nr_points);
+  sensor_msgs::PointCloud2ConstIterator<float> iter_x (in, "x"), iter_y (in, "y"), iter_z (in, "z");
+  sensor_msgs::PointCloud2ConstIterator<float> iter_field (in, field_name.empty () ? "x" : field_name);
+  for (size_t cp = 0; cp < nr_points; ++cp, ++iter_x, ++iter_y, ++iter_z, ++iter_field)
+  {
+    if (!std::isfinite (*iter_x) || !std::isfinite (*iter_y) || !std::isfinite (*iter_z))
+      continue;
+
+    if (!field_name.empty ())
+    {
+      float value = *iter_field;
+      // Same comparisons as PCL: the negative test excludes the limits, the positive one includes them
+      if (negative ? (value < max && value > min) : (value > max || value < min))
+        continue;
+    }
+    selected.push_back (static_cast<int> (cp));
+  }
+  return (true);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+bool
+pcl_ros::selectCropBox (const sensor_msgs::PointCloud2 &in, const Eigen::Vector4f &min_pt, const Eigen::Vector4f &max_pt,
+                        bool negative, std::vector<int> &selected)
+{
+  if (!canSelect (in))
+    return (false);
+
+  size_t nr_points = static_cast<size_t> (in.width) * in.height;
+  selected.clear ();
+  selected.reserve (nr_points);
+  sensor_msgs::PointCloud2ConstIterator<float> iter_x (in, "x"), iter_y (in, "y"), iter_z (in, "z");
+  for (size_t cp = 0; cp < nr_points; ++cp, ++iter_x, ++iter_y, ++iter_z)
+  {
+    float x = *iter_x, y = *iter_y, z = *iter_z;
+    if (!std::isfinite (x) || !std::isfinite (y) || !std::isfinite (z))
+      continue;
+
+    bool inside = x >= min_pt[0] && y >= min_pt[1] && z >= min_pt[2] &&
+                  x <= max_pt[0] && y <= max_pt[1] && z <= max_pt[2];
+    if (inside != negative)
+      selected.push_back (static_cast<int> (cp));
+  }
+  return (true);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+void
+pcl_ros::copyPointCloud (const sensor_msgs::PointCloud2 &in, const std::vector<int> &selected,
+                         const Eigen::Matrix4f *transform, sensor_msgs::PointCloud2 &out)
+{
+  out.header       = in.header;
+  out.fields       = in.fields;
+  out.is_bigendian = in.is_bigendian;
+  out.point_step   = in.point_step;
+  out.height       = 1;
+  out.width        = static_cast<uint32_t> (selected.size ());
+  out.row_step     = out.point_step * out.width;
+  out.is_dense     = in.is_dense;
+  out.data.resize (static_cast<size_t> (out.row_step));
+
+  PointCloud2Transform point_transform;
+  if (transform && !point_transform.init (in, *transform))
+  {
+    ROS_ERROR ("Copying the points untransformed.");
+    transform = NULL;
+  }
+
+  for (size_t begin = 0; begin < selected.size (); begin += COPY_CHUNK)
+  {
+    size_t end = std::min (begin + COPY_CHUNK, selected.size ());
+    uint8_t *dst = &out.data[begin * out.point_step];
+    for (size_t i = begin; i < end; ++i)
+      memcpy (&out.data[i * out.point_step], &in.data[static_cast<size_t> (selected[i]) * in.point_step], in.point_step);
+    if (transform)
+      point_transform.transformPoints (dst, dst, end - begin);
+  }
+}
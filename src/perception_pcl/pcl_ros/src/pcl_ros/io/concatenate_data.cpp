@@ -41,6 +41,41 @@
 
 #include <pcl_conversions/pcl_conversions.h>
 
+#include <algorithm>
+
+namespace
+{
+  /** \brief Number of intervals a deskewed input's sweep is split into, interpolating linearly in each. */
+  const int DESKEW_INTERVALS = 16;
+
+  /** \brief Largest number of points transformed as one unit of work. */
+  const size_t SLICE_POINTS = 32768;
+
+  /** \brief True if b can be appended to a by copying its points verbatim. */
+  bool
+  sameLayout (const sensor_msgs::PointCloud2 &a, const sensor_msgs::PointCloud2 &b)
+  {
+    if (a.point_step != b.point_step || a.is_bigendian != b.is_bigendian || a.fields.size () != b.fields.size ())
+      return (false);
+    for (size_t i = 0; i < a.fields.size (); ++i)
+    {
+      const sensor_msgs::PointField &fa = a.fields[i], &fb = b.fields[i];
+      bool same_name = fa.name == fb.name || ((fa.name == "rgb" || fa.name == "rgba") && (fb.name == "rgb" || fb.name == "rgba"));
+      if (!same_name || fa.offset != fb.offset || fa.datatype != fb.datatype || fa.count != fb.count)
+        return (false);
+    }
+    return (true);
+  }
+
+  /** \brief True if the points of a cloud are packed without padding between rows. */
+  bool
+  isPacked (const sensor_msgs::PointCloud2 &cloud)
+  {
+    return (cloud.row_step == cloud.width * cloud.point_step &&
+            cloud.data.size () >= static_cast<size_t> (cloud.row_step) * cloud.height);
+  }
+}
+
 //////////////////////////////////////////////////////////////////////////////////////////////
 void
 pcl_ros::PointCloudConcatenateDataSynchronizer::onInit ()
@@ -80,6 +115,20 @@ pcl_ros::PointCloudConcatenateDataSynchronizer::onInit ()
 
   // ---[ Optional parameters
   pnh_->getParam ("max_queue_size", maximum_queue_size_);
+  pnh_->getParam ("num_threads", num_threads_);
+  pnh_->getParam ("deskew", deskew_);
+  pnh_->getParam ("fixed_frame", fixed_frame_);
+  pnh_->getParam ("time_field", time_field_);
+  pnh_->getParam ("time_scale", time_scale_);
+
+  if (deskew_ && fixed_frame_.empty ())
+  {
+    NODELET_ERROR ("[onInit] Need a 'fixed_frame' parameter to deskew the inputs, continuing without deskewing.");
+    deskew_ = false;
+  }
+
+  for (int i = 1; i < num_threads_; ++i)
+    workers_.create_thread (boost::bind (&PointCloudConcatenateDataSynchronizer::workerLoop, this));
 
   // Output
   pub_output_ = advertise<PointCloud2> (*pnh_, "output", maximum_queue_size_);
@@ -87,6 +136,17 @@ pcl_ros::PointCloudConcatenateDataSynchronizer::onInit ()
   onInitPostProcess ();
 }
 
+//////////////////////////////////////////////////////////////////////////////////////////////
+pcl_ros::PointCloudConcatenateDataSynchronizer::~PointCloudConcatenateDataSynchronizer ()
+{
+  {
+    boost::lock_guard<boost::mutex> lock (slices_mutex_);
+    shutting_down_ = true;
+  }
+  slices_ready_.notify_all ();
+  workers_.join_all ();
+}
+
 //////////////////////////////////////////////////////////////////////////////////////////////
 void
 pcl_ros::PointCloudConcatenateDataSynchronizer::subscribe ()
@@ -202,7 +262,7 @@ pcl_ros::PointCloudConcatenateDataSynchronizer::unsubscribe ()
 }
 
 //////////////////////////////////////////////////////////////////////////////////////////////
-void 
+bool 
 pcl_ros::PointCloudConcatenateDataSynchronizer::combineClouds (const PointCloud2 &in1, const PointCloud2 &in2, PointCloud2 &out)
 {
   //ROS_INFO ("Two pointclouds received: %zu and %zu.", in1.data.size (), in2.data.size ());
@@ -215,7 +275,7 @@ pcl_ros::PointCloudConcatenateDataSynchronizer::combineClouds (const PointCloud2
     if (!pcl_ros::transformPointCloud (output_frame_, in1, *in1_t, tf_))
     {
       NODELET_ERROR ("[%s::combineClouds] Error converting first input dataset from %s to %s.", getName ().c_str (), in1.header.frame_id.c_str (), output_frame_.c_str ());
-      return;
+      return (false);
     }
   }
   else
@@ -228,7 +288,7 @@ pcl_ros::PointCloudConcatenateDataSynchronizer::combineClouds (const PointCloud2
     if (!pcl_ros::transformPointCloud (output_frame_, in2, *in2_t, tf_))
     {
       NODELET_ERROR ("[%s::combineClouds] Error converting second input dataset from %s to %s.", getName ().c_str (), in2.header.frame_id.c_str (), output_frame_.c_str ());
-      return;
+      return (false);
     }
   }
   else
@@ -240,6 +300,198 @@ pcl_ros::PointCloudConcatenateDataSynchronizer::combineClouds (const PointCloud2
   pcl::concatenatePointCloud (*in1_t, *in2_t, out);
   // Copy header
   out.header.stamp = in1.header.stamp;
+  return (true);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+bool
+pcl_ros::PointCloudConcatenateDataSynchronizer::lookupTransform (
+    const PointCloud2 &cloud, const ros::Time &stamp, PointCloud2Transform &transform)
+{
+  double t_min = 0.0, t_max = 0.0;
+  bool deskew = deskew_ && PointCloud2Transform::getTimeRange (cloud, time_field_, t_min, t_max);
+
+  try
+  {
+    if (!deskew)
+    {
+      // Plain transform at the cloud's own stamp, as pcl_ros::transformPointCloud does
+      tf::StampedTransform tf_transform;
+      tf_.waitForTransform (output_frame_, cloud.header.frame_id, cloud.header.stamp, ros::Duration (1));
+      tf_.lookupTransform (output_frame_, cloud.header.frame_id, cloud.header.stamp, tf_transform);
+      Eigen::Matrix4f m;
+      transformAsMatrix (tf_transform, m);
+      return (transform.init (cloud, m));
+    }
+
+    // Where the sensor was at each knot time, seen from the output frame at the output stamp
+    int intervals = (t_max > t_min) ? DESKEW_INTERVALS : 0;
+    ros::Time last = cloud.header.stamp + ros::Duration (t_max * time_scale_);
+    tf_.waitForTransform (output_frame_, stamp, cloud.header.frame_id, last, fixed_frame_, ros::Duration (1));
+    PointCloud2Transform::Knots knots;
+    for (int k = 0; k <= intervals; ++k)
+    {
+      double t = (intervals > 0) ? t_min + (t_max - t_min) * k / intervals : t_min;
+      tf::StampedTransform tf_transform;
+      tf_.lookupTransform (output_frame_, stamp, cloud.header.frame_id,
+                           cloud.header.stamp + ros::Duration (t * time_scale_), fixed_frame_, tf_transform);
+      Eigen::Matrix4f m;
+      transformAsMatrix (tf_transform, m);
+      knots.push_back (m);
+    }
+    return (transform.init (cloud, knots, time_field_, t_min, t_max));
+  }
+  catch (const tf::TransformException &e)
+  {
+    NODELET_ERROR ("[%s::lookupTransform] %s", getName ().c_str (), e.what ());
+    return (false);
+  }
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+void
+pcl_ros::PointCloudConcatenateDataSynchronizer::transformSlice (const Slice &slice) const
+{
+  if (slice.transform)
+    slice.transform->transformPoints (slice.in, slice.out, slice.size);
+  else
+    memcpy (slice.out, slice.in, slice.size * point_step_);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+void
+pcl_ros::PointCloudConcatenateDataSynchronizer::drainSlices (boost::unique_lock<boost::mutex> &lock)
+{
+  while (next_slice_ < slices_.size ())
+  {
+    const Slice &slice = slices_[next_slice_++];
+    lock.unlock ();
+    transformSlice (slice);
+    lock.lock ();
+    if (--slices_left_ == 0)
+      slices_done_.notify_all ();
+  }
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+void
+pcl_ros::PointCloudConcatenateDataSynchronizer::runSlices (std::vector<Slice> &slices)
+{
+  boost::unique_lock<boost::mutex> lock (slices_mutex_);
+  slices_.swap (slices);
+  next_slice_ = 0;
+  slices_left_ = slices_.size ();
+  slices_ready_.notify_all ();
+  drainSlices (lock);
+  while (slices_left_ > 0)
+    slices_done_.wait (lock);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+void
+pcl_ros::PointCloudConcatenateDataSynchronizer::workerLoop ()
+{
+  boost::unique_lock<boost::mutex> lock (slices_mutex_);
+  while (!shutting_down_)
+  {
+    drainSlices (lock);
+    slices_ready_.wait (lock);
+  }
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+bool
+pcl_ros::PointCloudConcatenateDataSynchronizer::canConcatenate (const std::vector<PointCloud2ConstPtr> &clouds) const
+{
+  // All non-empty inputs must share the packed layout of the first one
+  const PointCloud2 *layout = NULL;
+  for (size_t c = 0; c < clouds.size (); ++c)
+  {
+    if (clouds[c]->width * clouds[c]->height == 0)
+      continue;
+    if (!isPacked (*clouds[c]))
+      return (false);
+    if (!layout)
+      layout = clouds[c].get ();
+    else if (!sameLayout (*layout, *clouds[c]))
+      return (false);
+  }
+  if (!layout)
+    layout = clouds[0].get ();
+
+  // The coordinates have to be FLOAT32 for PointCloud2Transform
+  PointCloud2Transform transform;
+  return (transform.init (*layout, Eigen::Matrix4f::Identity ()));
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+bool
+pcl_ros::PointCloudConcatenateDataSynchronizer::concatenateClouds (
+    const std::vector<PointCloud2ConstPtr> &clouds, const ros::Time &stamp, PointCloud2 &out)
+{
+  const PointCloud2 *layout = clouds[0].get ();
+  for (size_t c = 0; c < clouds.size (); ++c)
+  {
+    if (clouds[c]->width * clouds[c]->height > 0)
+    {
+      layout = clouds[c].get ();
+      break;
+    }
+  }
+  point_step_ = layout->point_step;
+
+  // Transforms of every input
+  transforms_.resize (clouds.size ());
+  std::vector<bool> identity (clouds.size (), false);
+  size_t nr_points = 0;
+  bool is_dense = true;
+  for (size_t c = 0; c < clouds.size (); ++c)
+  {
+    const PointCloud2 &cloud = *clouds[c];
+    if (cloud.width * cloud.height == 0)
+      continue;
+    if (cloud.header.frame_id == output_frame_ && !deskew_)
+      identity[c] = true;
+    else if (!lookupTransform (cloud, stamp, transforms_[c]))
+    {
+      NODELET_ERROR ("[%s::concatenateClouds] Error converting input dataset from %s to %s.", getName ().c_str (), cloud.header.frame_id.c_str (), output_frame_.c_str ());
+      return (false);
+    }
+    nr_points += cloud.width * cloud.height;
+    is_dense = is_dense && cloud.is_dense;
+  }
+
+  // Preallocate the output and cut the inputs into slices of it
+  out.header.stamp = stamp;
+  out.header.frame_id = output_frame_;
+  out.fields = layout->fields;
+  out.is_bigendian = layout->is_bigendian;
+  out.point_step = point_step_;
+  out.height = 1;
+  out.width = nr_points;
+  out.row_step = out.width * out.point_step;
+  out.is_dense = is_dense;
+  out.data.resize (out.row_step);
+
+  std::vector<Slice> slices;
+  uint8_t *dst = out.data.data ();
+  for (size_t c = 0; c < clouds.size (); ++c)
+  {
+    const PointCloud2 &cloud = *clouds[c];
+    size_t size = cloud.width * cloud.height;
+    for (size_t begin = 0; begin < size; begin += SLICE_POINTS)
+    {
+      Slice slice;
+      slice.in = &cloud.data[begin * point_step_];
+      slice.out = dst + begin * point_step_;
+      slice.size = std::min (SLICE_POINTS, size - begin);
+      slice.transform = identity[c] ? NULL : &transforms_[c];
+      slices.push_back (slice);
+    }
+    dst += size * point_step_;
+  }
+  runSlices (slices);
+  return (true);
 }
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -250,37 +502,36 @@ pcl_ros::PointCloudConcatenateDataSynchronizer::input (
     const PointCloud2::ConstPtr &in5, const PointCloud2::ConstPtr &in6, 
     const PointCloud2::ConstPtr &in7, const PointCloud2::ConstPtr &in8)
 {
-  PointCloud2::Ptr out1 (new PointCloud2 ());
-  PointCloud2::Ptr out2 (new PointCloud2 ());
-  pcl_ros::PointCloudConcatenateDataSynchronizer::combineClouds (*in1, *in2, *out1);
-  if (in3 && in3->width * in3->height > 0)
+  // The first two inputs are always present; the rest count once they carry points
+  const PointCloud2::ConstPtr inputs[] = {in1, in2, in3, in4, in5, in6, in7, in8};
+  std::vector<PointCloud2ConstPtr> clouds;
+  for (int i = 0; i < 8; ++i)
+  {
+    if (inputs[i] && (i < 2 || inputs[i]->width * inputs[i]->height > 0))
+      clouds.push_back (inputs[i]);
+  }
+
+  // Nothing is published if any input cannot be transformed into the output frame
+  PointCloud2::Ptr out (new PointCloud2 ());
+  if (canConcatenate (clouds))
+  {
+    if (!concatenateClouds (clouds, in1->header.stamp, *out))
+      return;
+  }
+  else
   {
-    pcl_ros::PointCloudConcatenateDataSynchronizer::combineClouds (*out1, *in3, *out2);
-    out1 = out2;
-    if (in4 && in4->width * in4->height > 0)
+    // Layouts differ, so merge pairwise and let pcl::concatenatePointCloud reconcile them
+    if (!combineClouds (*clouds[0], *clouds[1], *out))
+      return;
+    for (size_t i = 2; i < clouds.size (); ++i)
     {
-      pcl_ros::PointCloudConcatenateDataSynchronizer::combineClouds (*out2, *in4, *out1);
-      if (in5 && in5->width * in5->height > 0)
-      {
-        pcl_ros::PointCloudConcatenateDataSynchronizer::combineClouds (*out1, *in5, *out2);
-        out1 = out2;
-        if (in6 && in6->width * in6->height > 0)
-        {
-          pcl_ros::PointCloudConcatenateDataSynchronizer::combineClouds (*out2, *in6, *out1);
-          if (in7 && in7->width * in7->height > 0)
-          {
-            pcl_ros::PointCloudConcatenateDataSynchronizer::combineClouds (*out1, *in7, *out2);
-            out1 = out2;
-            if (in8 && in8->width * in8->height > 0)
-            {
-              pcl_ros::PointCloudConcatenateDataSynchronizer::combineClouds (*out2, *in8, *out1);
-            }
-          } 
-        }
-      }
+      PointCloud2::Ptr next (new PointCloud2 ());
+      if (!combineClouds (*out, *clouds[i], *next))
+        return;
+      out = next;
     }
   }
-  pub_output_.publish (boost::make_shared<PointCloud2> (*out1)); 
+  pub_output_.publish (out);
 }
 
 typedef pcl_ros::PointCloudConcatenateDataSynchronizer PointCloudConcatenateDataSynchronizer;
@@ -0,0 +1,162 @@
+/*
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2009, Willow Garage, Inc.
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Willow Garage, Inc. nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/** Times a passthrough -> voxel grid -> statistical outlier removal chain the way the filter nodelets run it,
+  * once with a PCL conversion and message copy at every stage plus a separate output transform, and once with the
+  * conversion free passthrough and the output transform applied in place.
+  *
+  * Usage: filter_chain_benchmark [points] [iterations]
+  */
+
+#include <cstdlib>
+#include <limits>
+#include <random>
+#include <ros/ros.h>
+#include <pcl/filters/passthrough.h>
+#include <pcl/filters/voxel_grid.h>
+#include <pcl/filters/statistical_outlier_removal.h>
+#include <pcl_conversions/pcl_conversions.h>
+#include <sensor_msgs/point_cloud2_iterator.h>
+#include "pcl_ros/transforms.h"
+#include "pcl_ros/filters/point_cloud2_filters.h"
+
+typedef sensor_msgs::PointCloud2 PointCloud2;
+
+namespace
+{
+  PointCloud2::Ptr
+  makeCloud (size_t nr_points)
+  {
+    PointCloud2::Ptr cloud (new PointCloud2);
+    cloud->header.frame_id = "sensor";
+    sensor_msgs::PointCloud2Modifier modifier (*cloud);
+    modifier.setPointCloud2Fields (4, "x", 1, sensor_msgs::PointField::FLOAT32,
+                                      "y", 1, sensor_msgs::PointField::FLOAT32,
+                                      "z", 1, sensor_msgs::PointField::FLOAT32,
+                                      "intensity", 1, sensor_msgs::PointField::FLOAT32);
+    modifier.resize (nr_points);
+
+    std::mt19937 rng (42);
+    std::uniform_real_distribution<float> xy (-40.0f, 40.0f), z (-2.0f, 6.0f), intensity (0.0f, 255.0f);
+    sensor_msgs::PointCloud2Iterator<float> it (*cloud, "x");
+    for (size_t i = 0; i < nr_points; ++i, ++it)
+    {
+      // A few percent of returns are invalid, as with a real scanner
+      bool valid = i % 37 != 0;
+      it[0] = valid ? xy (rng) : std::numeric_limits<float>::quiet_NaN ();
+      it[1] = xy (rng);
+      it[2] = z (rng);
+      it[3] = intensity (rng);
+    }
+    cloud->is_dense = false;
+    return (cloud);
+  }
+
+  /** \brief Run one PCL filter stage the way the nodelets used to: convert, filter, move back, copy to publish. */
+  template <typename FilterT> PointCloud2::Ptr
+  convertingStage (FilterT &filter, const PointCloud2 &input)
+  {
+    pcl::PCLPointCloud2::Ptr pcl_input (new pcl::PCLPointCloud2);
+    pcl_conversions::toPCL (input, *pcl_input);
+    filter.setInputCloud (pcl_input);
+    pcl::PCLPointCloud2 pcl_output;
+    filter.filter (pcl_output);
+    PointCloud2 output;
+    pcl_conversions::moveFromPCL (pcl_output, output);
+    return (PointCloud2::Ptr (new PointCloud2 (output)));
+  }
+}
+
+int
+main (int argc, char **argv)
+{
+  size_t nr_points = argc > 1 ? strtoul (argv[1], NULL, 10) : 300000;
+  int iterations = argc > 2 ? atoi (argv[2]) : 20;
+
+  PointCloud2::Ptr cloud = makeCloud (nr_points);
+  Eigen::Matrix4f transform = Eigen::Matrix4f::Identity ();
+  transform.block<3, 1> (0, 3) << 1.5f, -0.2f, 0.8f;
+
+  pcl::PassThrough<pcl::PCLPointCloud2> passthrough;
+  passthrough.setFilterFieldName ("z");
+  passthrough.setFilterLimits (-1.0, 4.0);
+  pcl::VoxelGrid<pcl::PCLPointCloud2> voxel;
+  voxel.setLeafSize (0.2f, 0.2f, 0.2f);
+  pcl::StatisticalOutlierRemoval<pcl::PCLPointCloud2> outliers;
+  outliers.setMeanK (8);
+  outliers.setStddevMulThresh (1.0);
+
+  double converting[4] = {0, 0, 0, 0}, native[4] = {0, 0, 0, 0};
+  size_t converting_points = 0, native_points = 0;
+  for (int i = 0; i < iterations; ++i)
+  {
+    ros::WallTime t0 = ros::WallTime::now ();
+    PointCloud2::Ptr a = convertingStage (passthrough, *cloud);
+    ros::WallTime t1 = ros::WallTime::now ();
+    PointCloud2::Ptr b = convertingStage (voxel, *a);
+    ros::WallTime t2 = ros::WallTime::now ();
+    PointCloud2::Ptr c = convertingStage (outliers, *b);
+    ros::WallTime t3 = ros::WallTime::now ();
+    PointCloud2 c_transformed;
+    pcl_ros::transformPointCloud (transform, *c, c_transformed);
+    PointCloud2::Ptr c_tf (new PointCloud2 (c_transformed));
+    ros::WallTime t4 = ros::WallTime::now ();
+    converting[0] += (t1 - t0).toSec (); converting[1] += (t2 - t1).toSec ();
+    converting[2] += (t3 - t2).toSec (); converting[3] += (t4 - t3).toSec ();
+    converting_points = c_tf->width * c_tf->height;
+
+    t0 = ros::WallTime::now ();
+    std::vector<int> selected;
+    PointCloud2::Ptr na (new PointCloud2);
+    pcl_ros::selectPassThrough (*cloud, "z", -1.0, 4.0, false, selected);
+    pcl_ros::copyPointCloud (*cloud, selected, NULL, *na);
+    t1 = ros::WallTime::now ();
+    PointCloud2::Ptr nb = convertingStage (voxel, *na);
+    t2 = ros::WallTime::now ();
+    PointCloud2::Ptr nc = convertingStage (outliers, *nb);
+    t3 = ros::WallTime::now ();
+    pcl_ros::transformPointCloud (transform, *nc, *nc);
+    t4 = ros::WallTime::now ();
+    native[0] += (t1 - t0).toSec (); native[1] += (t2 - t1).toSec ();
+    native[2] += (t3 - t2).toSec (); native[3] += (t4 - t3).toSec ();
+    native_points = nc->width * nc->height;
+  }
+
+  const char *stages[4] = {"passthrough", "voxel grid", "outlier removal", "output transform"};
+  ROS_INFO ("%zu points, %d iterations (ms per cloud)", nr_points, iterations);
+  for (int s = 0; s < 4; ++s)
+    ROS_INFO ("  %-16s converting %8.3f   native %8.3f", stages[s], 1e3 * converting[s] / iterations, 1e3 * native[s] / iterations);
+  ROS_INFO ("  output points    converting %8zu   native %8zu", converting_points, native_points);
+  return (0);
+}
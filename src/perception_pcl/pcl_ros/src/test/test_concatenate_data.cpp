@@ -0,0 +1,245 @@
+/*
+ * Copyright (c) 2010, Willow Garage, Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the Willow Garage, Inc. nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <limits>
+
+#include <ros/ros.h>
+#include <sensor_msgs/PointCloud2.h>
+#include <sensor_msgs/point_cloud2_iterator.h>
+#include <tf/transform_broadcaster.h>
+#include <tf/transform_datatypes.h>
+
+/* Checks the output of two PointCloudConcatenateDataSynchronizer nodelets, both running with several threads:
+ * "concatenate" transforms every input at its stamp, "concatenate_deskew" also deskews the inputs using their
+ * per point time field while base_link moves along x in odom at one meter per second.
+ */
+
+namespace
+{
+  const size_t NR_POINTS = 100000;
+  const float SWEEP = 0.1f;
+
+  /** \brief Where sensor_a and sensor_b sit on base_link. */
+  tf::Transform
+  sensorPose (const std::string &frame)
+  {
+    if (frame == "sensor_a")
+      return (tf::Transform (tf::Quaternion (0, 0, 0, 1), tf::Vector3 (1, 0, 0)));
+    return (tf::Transform (tf::createQuaternionFromYaw (M_PI / 2), tf::Vector3 (0, 2, 0)));
+  }
+
+  sensor_msgs::PointCloud2::Ptr
+  makeCloud (const std::string &frame, const ros::Time &stamp)
+  {
+    sensor_msgs::PointCloud2::Ptr cloud (new sensor_msgs::PointCloud2);
+    cloud->header.frame_id = frame;
+    cloud->header.stamp = stamp;
+    sensor_msgs::PointCloud2Modifier modifier (*cloud);
+    modifier.setPointCloud2Fields (7, "x", 1, sensor_msgs::PointField::FLOAT32,
+                                   "y", 1, sensor_msgs::PointField::FLOAT32,
+                                   "z", 1, sensor_msgs::PointField::FLOAT32,
+                                   "normal_x", 1, sensor_msgs::PointField::FLOAT32,
+                                   "normal_y", 1, sensor_msgs::PointField::FLOAT32,
+                                   "normal_z", 1, sensor_msgs::PointField::FLOAT32,
+                                   "time", 1, sensor_msgs::PointField::FLOAT32);
+    modifier.resize (NR_POINTS);
+    cloud->is_dense = false;
+    sensor_msgs::PointCloud2Iterator<float> it (*cloud, "x");
+    for (size_t i = 0; i < NR_POINTS; ++i, ++it)
+    {
+      it[0] = (i % 17 == 0) ? std::numeric_limits<float>::quiet_NaN () : 0.001f * static_cast<float> (i % 1000);
+      it[1] = 0.5f;
+      it[2] = 0.01f * static_cast<float> (i % 100);
+      it[3] = 1.0f;
+      it[4] = 0.0f;
+      it[5] = 0.0f;
+      it[6] = SWEEP * static_cast<float> (i) / NR_POINTS;
+    }
+    return (cloud);
+  }
+
+  /** \brief Check the points of one input, starting at \a out, against the pose of its sensor. */
+  void
+  expectTransformed (const sensor_msgs::PointCloud2 &in, sensor_msgs::PointCloud2ConstIterator<float> &out, bool deskew)
+  {
+    tf::Transform pose = sensorPose (in.header.frame_id);
+    sensor_msgs::PointCloud2ConstIterator<float> src (in, "x");
+    for (size_t i = 0; i < NR_POINTS; ++i, ++src, ++out)
+    {
+      if (!std::isfinite (src[0]))
+      {
+        // Invalid points are passed through
+        ASSERT_TRUE (std::isnan (out[0])) << "point " << i;
+        for (int d = 1; d < 6; ++d)
+          ASSERT_EQ (src[d], out[d]) << "point " << i;
+        continue;
+      }
+      tf::Vector3 p = pose * tf::Vector3 (src[0], src[1], src[2]);
+      tf::Vector3 n = pose.getBasis () * tf::Vector3 (src[3], src[4], src[5]);
+      // base_link has moved on by the point's time when the point was taken
+      if (deskew)
+        p += tf::Vector3 (src[6], 0, 0);
+      ASSERT_NEAR (p.x (), out[0], 1e-4) << "point " << i;
+      ASSERT_NEAR (p.y (), out[1], 1e-4) << "point " << i;
+      ASSERT_NEAR (p.z (), out[2], 1e-4) << "point " << i;
+      ASSERT_NEAR (n.x (), out[3], 1e-4) << "normal " << i;
+      ASSERT_NEAR (n.y (), out[4], 1e-4) << "normal " << i;
+      ASSERT_NEAR (n.z (), out[5], 1e-4) << "normal " << i;
+      ASSERT_EQ (src[6], out[6]) << "point " << i;
+    }
+  }
+}
+
+class ConcatenateData : public testing::Test
+{
+  protected:
+    void
+    SetUp ()
+    {
+      pub_a_ = nh_.advertise<sensor_msgs::PointCloud2> ("input_a", 1);
+      pub_b_ = nh_.advertise<sensor_msgs::PointCloud2> ("input_b", 1);
+      sub_ = nh_.subscribe ("concatenate/output", 10, &ConcatenateData::output, this);
+      sub_deskew_ = nh_.subscribe ("concatenate_deskew/output", 10, &ConcatenateData::outputDeskew, this);
+
+      // The nodelets only subscribe to their inputs once their output is subscribed to
+      ros::WallTime timeout = ros::WallTime::now () + ros::WallDuration (10.0);
+      while ((pub_a_.getNumSubscribers () < 2 || pub_b_.getNumSubscribers () < 2) && ros::WallTime::now () < timeout)
+        ros::WallDuration (0.1).sleep ();
+      ASSERT_EQ (2u, pub_a_.getNumSubscribers ());
+      ASSERT_EQ (2u, pub_b_.getNumSubscribers ());
+    }
+
+    /** \brief Broadcast the sensor poses and base_link moving in odom around stamp. */
+    void
+    broadcastTransforms (const ros::Time &stamp)
+    {
+      std::vector<tf::StampedTransform> transforms;
+      for (int i = -10; i <= 20; ++i)
+      {
+        ros::Time t = stamp + ros::Duration (0.05 * i);
+        transforms.push_back (tf::StampedTransform (tf::Transform (tf::Quaternion (0, 0, 0, 1), tf::Vector3 (0.05 * i, 0, 0)),
+                                                    t, "odom", "base_link"));
+        transforms.push_back (tf::StampedTransform (sensorPose ("sensor_a"), t, "base_link", "sensor_a"));
+        transforms.push_back (tf::StampedTransform (sensorPose ("sensor_b"), t, "base_link", "sensor_b"));
+      }
+      broadcaster_.sendTransform (transforms);
+    }
+
+    void
+    output (const sensor_msgs::PointCloud2::ConstPtr &cloud)
+    {
+      outputs_.push_back (cloud);
+    }
+
+    void
+    outputDeskew (const sensor_msgs::PointCloud2::ConstPtr &cloud)
+    {
+      outputs_deskew_.push_back (cloud);
+    }
+
+    /** \brief Spin until both nodelets have published \a count outputs or the timeout runs out. */
+    void
+    waitForOutputs (size_t count, double timeout)
+    {
+      ros::WallTime end = ros::WallTime::now () + ros::WallDuration (timeout);
+      while ((outputs_.size () < count || outputs_deskew_.size () < count) && ros::WallTime::now () < end)
+      {
+        ros::spinOnce ();
+        ros::WallDuration (0.01).sleep ();
+      }
+    }
+
+    ros::NodeHandle nh_;
+    ros::Publisher pub_a_, pub_b_;
+    ros::Subscriber sub_, sub_deskew_;
+    tf::TransformBroadcaster broadcaster_;
+    std::vector<sensor_msgs::PointCloud2::ConstPtr> outputs_, outputs_deskew_;
+};
+
+TEST_F (ConcatenateData, transformsAndDeskews)
+{
+  ros::Time stamp = ros::Time::now ();
+  broadcastTransforms (stamp);
+  ros::WallDuration (0.5).sleep ();
+
+  sensor_msgs::PointCloud2::Ptr a = makeCloud ("sensor_a", stamp);
+  sensor_msgs::PointCloud2::Ptr b = makeCloud ("sensor_b", stamp);
+  pub_a_.publish (a);
+  pub_b_.publish (b);
+  waitForOutputs (1, 10.0);
+  ASSERT_EQ (1u, outputs_.size ());
+  ASSERT_EQ (1u, outputs_deskew_.size ());
+
+  const sensor_msgs::PointCloud2 *outputs[] = {outputs_[0].get (), outputs_deskew_[0].get ()};
+  for (int deskew = 0; deskew < 2; ++deskew)
+  {
+    const sensor_msgs::PointCloud2 &out = *outputs[deskew];
+    EXPECT_EQ ("base_link", out.header.frame_id);
+    EXPECT_EQ (stamp, out.header.stamp);
+    ASSERT_EQ (2 * NR_POINTS, out.width * out.height);
+    sensor_msgs::PointCloud2ConstIterator<float> it (out, "x");
+    expectTransformed (*a, it, deskew);
+    expectTransformed (*b, it, deskew);
+  }
+}
+
+TEST_F (ConcatenateData, lookupFailureDropsOutput)
+{
+  ros::Time stamp = ros::Time::now ();
+  broadcastTransforms (stamp);
+  ros::WallDuration (0.5).sleep ();
+
+  // No transform is known for sensor_c, so nothing may come out for this stamp
+  pub_a_.publish (makeCloud ("sensor_a", stamp));
+  pub_b_.publish (makeCloud ("sensor_c", stamp));
+  waitForOutputs (1, 3.0);
+  EXPECT_EQ (0u, outputs_.size ());
+  EXPECT_EQ (0u, outputs_deskew_.size ());
+
+  ros::Time next = stamp + ros::Duration (0.1);
+  pub_a_.publish (makeCloud ("sensor_a", next));
+  pub_b_.publish (makeCloud ("sensor_b", next));
+  waitForOutputs (1, 10.0);
+  ASSERT_EQ (1u, outputs_.size ());
+  ASSERT_EQ (1u, outputs_deskew_.size ());
+  EXPECT_EQ (next, outputs_[0]->header.stamp);
+  EXPECT_EQ (next, outputs_deskew_[0]->header.stamp);
+}
+
+int
+main (int argc, char **argv)
+{
+  testing::InitGoogleTest (&argc, argv);
+  ros::init (argc, argv, "test_concatenate_data");
+  return (RUN_ALL_TESTS ());
+}
@@ -0,0 +1,318 @@
+/*
+ * Copyright (c) 2010, Willow Garage, Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the Willow Garage, Inc. nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <limits>
+#include <map>
+
+#include <boost/bind.hpp>
+
+#include <ros/ros.h>
+#include <pcl/point_types.h>
+#include <pcl/point_cloud.h>
+#include <pcl/common/transforms.h>
+#include <pcl/filters/passthrough.h>
+#include <pcl/filters/crop_box.h>
+#include <pcl_conversions/pcl_conversions.h>
+#include <sensor_msgs/PointCloud2.h>
+
+#include "pcl_ros/filters/point_cloud2_filters.h"
+
+/* The PassThrough and CropBox nodelets filter PointCloud2 messages without a PCL conversion where they can. Their
+ * output has to stay the same as that of the PCL filters they wrap, for every combination of settings.
+ */
+
+namespace
+{
+  /** \brief An organized cloud where every 7th point is NaN, with points on the filter limits. */
+  sensor_msgs::PointCloud2
+  makeCloud ()
+  {
+    pcl::PointCloud<pcl::PointXYZRGBNormal> cloud;
+    cloud.width = 40;
+    cloud.height = 30;
+    cloud.is_dense = false;
+    cloud.points.resize (cloud.width * cloud.height);
+    for (size_t i = 0; i < cloud.points.size (); ++i)
+    {
+      pcl::PointXYZRGBNormal &p = cloud.points[i];
+      p.x = 0.1f * static_cast<float> (i % cloud.width) - 2.0f;
+      p.y = 0.1f * static_cast<float> (i / cloud.width) - 1.5f;
+      p.z = 0.25f * static_cast<float> (i % 13) - 1.0f;
+      p.normal_x = 0.0f;
+      p.normal_y = 0.6f;
+      p.normal_z = 0.8f;
+      p.rgb = static_cast<float> (i);
+      if (i % 7 == 0)
+        p.y = std::numeric_limits<float>::quiet_NaN ();
+    }
+    sensor_msgs::PointCloud2 msg;
+    pcl::toROSMsg (cloud, msg);
+    msg.header.frame_id = "sensor";
+    return (msg);
+  }
+
+  struct PassThroughConfig
+  {
+    double min, max;
+    bool negative, keep_organized;
+  };
+
+  struct CropBoxConfig
+  {
+    Eigen::Vector4f min_pt, max_pt;
+    bool negative, keep_organized;
+  };
+
+  /** \brief The settings of the nodelets in test_filters_native.launch. */
+  std::map<std::string, PassThroughConfig>
+  passThroughConfigs ()
+  {
+    std::map<std::string, PassThroughConfig> configs;
+    PassThroughConfig plain = {-0.5, 1.0, false, false};
+    configs["passthrough"] = plain;
+    PassThroughConfig negative = {-0.5, 1.0, true, false};
+    configs["passthrough_negative"] = negative;
+    PassThroughConfig organized = {-0.5, 1.0, false, true};
+    configs["passthrough_organized"] = organized;
+    PassThroughConfig organized_negative = {-0.5, 1.0, true, true};
+    configs["passthrough_organized_negative"] = organized_negative;
+    return (configs);
+  }
+
+  std::map<std::string, CropBoxConfig>
+  cropBoxConfigs ()
+  {
+    std::map<std::string, CropBoxConfig> configs;
+    Eigen::Vector4f min_pt (-1.0f, -1.0f, -0.5f, 1.0f), max_pt (1.0f, 0.5f, 1.0f, 1.0f);
+    CropBoxConfig plain = {min_pt, max_pt, false, false};
+    configs["crop_box"] = plain;
+    CropBoxConfig negative = {min_pt, max_pt, true, false};
+    configs["crop_box_negative"] = negative;
+    CropBoxConfig organized = {min_pt, max_pt, false, true};
+    configs["crop_box_organized"] = organized;
+    CropBoxConfig organized_negative = {min_pt, max_pt, true, true};
+    configs["crop_box_organized_negative"] = organized_negative;
+    return (configs);
+  }
+
+  sensor_msgs::PointCloud2
+  passThrough (const sensor_msgs::PointCloud2 &in, const PassThroughConfig &config)
+  {
+    pcl::PCLPointCloud2::Ptr pcl_in (new pcl::PCLPointCloud2);
+    pcl_conversions::toPCL (in, *pcl_in);
+    pcl::PassThrough<pcl::PCLPointCloud2> filter;
+    filter.setInputCloud (pcl_in);
+    filter.setFilterFieldName ("z");
+    filter.setFilterLimits (config.min, config.max);
+#if PCL_VERSION_COMPARE(<, 1, 10, 0)
+    filter.setFilterLimitsNegative (config.negative);
+#else
+    filter.setNegative (config.negative);
+#endif
+    filter.setKeepOrganized (config.keep_organized);
+    pcl::PCLPointCloud2 pcl_out;
+    filter.filter (pcl_out);
+    sensor_msgs::PointCloud2 out;
+    pcl_conversions::moveFromPCL (pcl_out, out);
+    return (out);
+  }
+
+  sensor_msgs::PointCloud2
+  cropBox (const sensor_msgs::PointCloud2 &in, const CropBoxConfig &config)
+  {
+    pcl::PCLPointCloud2::Ptr pcl_in (new pcl::PCLPointCloud2);
+    pcl_conversions::toPCL (in, *pcl_in);
+    pcl::CropBox<pcl::PCLPointCloud2> filter;
+    filter.setInputCloud (pcl_in);
+    filter.setMin (config.min_pt);
+    filter.setMax (config.max_pt);
+    filter.setNegative (config.negative);
+    filter.setKeepOrganized (config.keep_organized);
+    pcl::PCLPointCloud2 pcl_out;
+    filter.filter (pcl_out);
+    sensor_msgs::PointCloud2 out;
+    pcl_conversions::moveFromPCL (pcl_out, out);
+    return (out);
+  }
+
+  void
+  expectSamePoints (const sensor_msgs::PointCloud2 &expected, const sensor_msgs::PointCloud2 &actual)
+  {
+    EXPECT_EQ (expected.width, actual.width);
+    EXPECT_EQ (expected.height, actual.height);
+    EXPECT_EQ (expected.point_step, actual.point_step);
+    EXPECT_EQ (expected.row_step, actual.row_step);
+    EXPECT_TRUE (expected.data == actual.data);
+  }
+}
+
+TEST (FiltersNative, selectPassThroughMatchesPCL)
+{
+  sensor_msgs::PointCloud2 in = makeCloud ();
+  std::map<std::string, PassThroughConfig> configs = passThroughConfigs ();
+  for (std::map<std::string, PassThroughConfig>::const_iterator it = configs.begin (); it != configs.end (); ++it)
+  {
+    if (it->second.keep_organized)
+      continue;
+    SCOPED_TRACE (it->first);
+    std::vector<int> selected;
+    ASSERT_TRUE (pcl_ros::selectPassThrough (in, "z", it->second.min, it->second.max, it->second.negative, selected));
+    sensor_msgs::PointCloud2 out;
+    pcl_ros::copyPointCloud (in, selected, NULL, out);
+    expectSamePoints (passThrough (in, it->second), out);
+  }
+
+  std::vector<int> selected;
+  EXPECT_FALSE (pcl_ros::selectPassThrough (in, "intensity", 0.0, 1.0, false, selected));
+}
+
+TEST (FiltersNative, selectCropBoxMatchesPCL)
+{
+  sensor_msgs::PointCloud2 in = makeCloud ();
+  std::map<std::string, CropBoxConfig> configs = cropBoxConfigs ();
+  for (std::map<std::string, CropBoxConfig>::const_iterator it = configs.begin (); it != configs.end (); ++it)
+  {
+    if (it->second.keep_organized)
+      continue;
+    SCOPED_TRACE (it->first);
+    std::vector<int> selected;
+    ASSERT_TRUE (pcl_ros::selectCropBox (in, it->second.min_pt, it->second.max_pt, it->second.negative, selected));
+    sensor_msgs::PointCloud2 out;
+    pcl_ros::copyPointCloud (in, selected, NULL, out);
+    expectSamePoints (cropBox (in, it->second), out);
+  }
+}
+
+TEST (FiltersNative, copyTransformsNormals)
+{
+  sensor_msgs::PointCloud2 in = makeCloud ();
+  std::vector<int> selected;
+  ASSERT_TRUE (pcl_ros::selectPassThrough (in, "", 0.0, 0.0, false, selected));
+  Eigen::Affine3f transform = Eigen::Translation3f (1.0f, 2.0f, 3.0f) * Eigen::AngleAxisf (0.5f, Eigen::Vector3f::UnitZ ());
+  sensor_msgs::PointCloud2 out;
+  pcl_ros::copyPointCloud (in, selected, &transform.matrix (), out);
+
+  pcl::PointCloud<pcl::PointXYZRGBNormal> cloud, expected, actual;
+  pcl::fromROSMsg (in, cloud);
+  pcl::transformPointCloudWithNormals (cloud, selected, expected, transform.matrix ());
+  pcl::fromROSMsg (out, actual);
+  ASSERT_EQ (expected.points.size (), actual.points.size ());
+  for (size_t i = 0; i < expected.points.size (); ++i)
+  {
+    EXPECT_NEAR (expected.points[i].x, actual.points[i].x, 1e-5);
+    EXPECT_NEAR (expected.points[i].y, actual.points[i].y, 1e-5);
+    EXPECT_NEAR (expected.points[i].z, actual.points[i].z, 1e-5);
+    EXPECT_NEAR (expected.points[i].normal_x, actual.points[i].normal_x, 1e-5);
+    EXPECT_NEAR (expected.points[i].normal_y, actual.points[i].normal_y, 1e-5);
+    EXPECT_NEAR (expected.points[i].normal_z, actual.points[i].normal_z, 1e-5);
+    EXPECT_EQ (expected.points[i].rgb, actual.points[i].rgb);
+  }
+}
+
+class FilterNodelets : public testing::Test
+{
+  protected:
+    void
+    SetUp ()
+    {
+      pub_ = nh_.advertise<sensor_msgs::PointCloud2> ("input", 1);
+      std::map<std::string, PassThroughConfig> pass_through = passThroughConfigs ();
+      std::map<std::string, CropBoxConfig> crop_box = cropBoxConfigs ();
+      for (std::map<std::string, PassThroughConfig>::const_iterator it = pass_through.begin (); it != pass_through.end (); ++it)
+        subscribeOutput (it->first);
+      for (std::map<std::string, CropBoxConfig>::const_iterator it = crop_box.begin (); it != crop_box.end (); ++it)
+        subscribeOutput (it->first);
+
+      // The nodelets only subscribe to their input once their output is subscribed to
+      ros::WallTime timeout = ros::WallTime::now () + ros::WallDuration (10.0);
+      while (pub_.getNumSubscribers () < subs_.size () && ros::WallTime::now () < timeout)
+        ros::WallDuration (0.1).sleep ();
+      ASSERT_EQ (subs_.size (), pub_.getNumSubscribers ());
+    }
+
+    void
+    subscribeOutput (const std::string &name)
+    {
+      subs_.push_back (nh_.subscribe<sensor_msgs::PointCloud2> (name + "/output", 1,
+                                                                boost::bind (&FilterNodelets::output, this, name, _1)));
+    }
+
+    void
+    output (const std::string &name, const sensor_msgs::PointCloud2::ConstPtr &cloud)
+    {
+      outputs_[name] = cloud;
+    }
+
+    ros::NodeHandle nh_;
+    ros::Publisher pub_;
+    std::vector<ros::Subscriber> subs_;
+    std::map<std::string, sensor_msgs::PointCloud2::ConstPtr> outputs_;
+};
+
+TEST_F (FilterNodelets, matchPCL)
+{
+  sensor_msgs::PointCloud2 in = makeCloud ();
+  in.header.stamp = ros::Time::now ();
+  pub_.publish (in);
+
+  ros::WallTime timeout = ros::WallTime::now () + ros::WallDuration (10.0);
+  while (outputs_.size () < subs_.size () && ros::WallTime::now () < timeout)
+  {
+    ros::spinOnce ();
+    ros::WallDuration (0.01).sleep ();
+  }
+  ASSERT_EQ (subs_.size (), outputs_.size ());
+
+  std::map<std::string, PassThroughConfig> pass_through = passThroughConfigs ();
+  for (std::map<std::string, PassThroughConfig>::const_iterator it = pass_through.begin (); it != pass_through.end (); ++it)
+  {
+    SCOPED_TRACE (it->first);
+    expectSamePoints (passThrough (in, it->second), *outputs_[it->first]);
+    EXPECT_EQ (in.header.stamp, outputs_[it->first]->header.stamp);
+  }
+  std::map<std::string, CropBoxConfig> crop_box = cropBoxConfigs ();
+  for (std::map<std::string, CropBoxConfig>::const_iterator it = crop_box.begin (); it != crop_box.end (); ++it)
+  {
+    SCOPED_TRACE (it->first);
+    expectSamePoints (cropBox (in, it->second), *outputs_[it->first]);
+    EXPECT_EQ (in.header.stamp, outputs_[it->first]->header.stamp);
+  }
+}
+
+int
+main (int argc, char **argv)
+{
+  testing::InitGoogleTest (&argc, argv);
+  ros::init (argc, argv, "test_filters_native");
+  return (RUN_ALL_TESTS ());
+}
@@ -0,0 +1,298 @@
+/*
+ * Copyright (c) 2010, Willow Garage, Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the Willow Garage, Inc. nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include <Eigen/Geometry>
+#include <pcl/point_types.h>
+#include <pcl/point_cloud.h>
+#include <pcl/common/transforms.h>
+#include <pcl_conversions/pcl_conversions.h>
+#include <sensor_msgs/point_cloud2_iterator.h>
+
+#include "pcl_ros/transforms.h"
+
+namespace
+{
+  Eigen::Matrix4f
+  testTransform (float x, float y, float z, float angle)
+  {
+    Eigen::Affine3f t = Eigen::Translation3f (x, y, z) * Eigen::AngleAxisf (angle, Eigen::Vector3f (1, 2, 3).normalized ());
+    return (t.matrix ());
+  }
+
+  /** \brief A cloud with normals where every 7th point is NaN and every 11th infinite. */
+  pcl::PointCloud<pcl::PointXYZRGBNormal>
+  makeCloud (size_t nr_points)
+  {
+    pcl::PointCloud<pcl::PointXYZRGBNormal> cloud;
+    cloud.width = static_cast<uint32_t> (nr_points);
+    cloud.height = 1;
+    cloud.is_dense = false;
+    cloud.points.resize (nr_points);
+    for (size_t i = 0; i < nr_points; ++i)
+    {
+      pcl::PointXYZRGBNormal &p = cloud.points[i];
+      p.x = 0.01f * static_cast<float> (i % 1000) - 5.0f;
+      p.y = 0.02f * static_cast<float> (i % 500) - 3.0f;
+      p.z = 0.5f + 0.001f * static_cast<float> (i);
+      Eigen::Vector3f normal = Eigen::Vector3f (p.x, 1.0f, p.y).normalized ();
+      p.normal_x = normal[0];
+      p.normal_y = normal[1];
+      p.normal_z = normal[2];
+      p.curvature = 0.1f;
+      p.rgb = 0.5f;
+      if (i % 7 == 0)
+        p.x = std::numeric_limits<float>::quiet_NaN ();
+      if (i % 11 == 0)
+        p.z = std::numeric_limits<float>::infinity ();
+    }
+    return (cloud);
+  }
+
+  bool
+  near (float a, float b)
+  {
+    if (!std::isfinite (a) || !std::isfinite (b))
+      return (std::isnan (a) == std::isnan (b) && (std::isnan (a) || a == b));
+    return (std::fabs (a - b) <= 1e-5f * std::max (1.0f, std::fabs (a)));
+  }
+
+  void
+  expectSameCloud (const pcl::PointCloud<pcl::PointXYZRGBNormal> &expected, const sensor_msgs::PointCloud2 &msg)
+  {
+    pcl::PointCloud<pcl::PointXYZRGBNormal> actual;
+    pcl::fromROSMsg (msg, actual);
+    ASSERT_EQ (expected.points.size (), actual.points.size ());
+    for (size_t i = 0; i < expected.points.size (); ++i)
+    {
+      const pcl::PointXYZRGBNormal &e = expected.points[i], &a = actual.points[i];
+      EXPECT_TRUE (near (e.x, a.x) && near (e.y, a.y) && near (e.z, a.z)) << "point " << i;
+      EXPECT_TRUE (near (e.normal_x, a.normal_x) && near (e.normal_y, a.normal_y) && near (e.normal_z, a.normal_z))
+        << "normal " << i;
+      EXPECT_EQ (e.rgb, a.rgb);
+      EXPECT_EQ (e.curvature, a.curvature);
+    }
+  }
+}
+
+TEST (PointCloud2Transform, matchesPCL)
+{
+  pcl::PointCloud<pcl::PointXYZRGBNormal> cloud = makeCloud (1000);
+  Eigen::Matrix4f transform = testTransform (1.0f, -2.0f, 0.5f, 0.7f);
+
+  pcl::PointCloud<pcl::PointXYZRGBNormal> expected;
+  pcl::transformPointCloudWithNormals (cloud, expected, transform);
+
+  sensor_msgs::PointCloud2 in, out;
+  pcl::toROSMsg (cloud, in);
+  pcl_ros::transformPointCloud (transform, in, out);
+  expectSameCloud (expected, out);
+
+  // In place
+  pcl_ros::transformPointCloud (transform, in, in);
+  expectSameCloud (expected, in);
+}
+
+TEST (PointCloud2Transform, threadsMatchPCL)
+{
+  pcl::PointCloud<pcl::PointXYZRGBNormal> cloud = makeCloud (300000);
+  Eigen::Matrix4f transform = testTransform (-3.0f, 0.0f, 2.0f, -1.2f);
+
+  pcl::PointCloud<pcl::PointXYZRGBNormal> expected;
+  pcl::transformPointCloudWithNormals (cloud, expected, transform);
+
+  sensor_msgs::PointCloud2 in, out_single, out_threads;
+  pcl::toROSMsg (cloud, in);
+  pcl_ros::transformPointCloud (transform, in, out_single);
+  pcl_ros::transformPointCloud (transform, in, out_threads, 4);
+  EXPECT_TRUE (out_single.data == out_threads.data);
+  expectSameCloud (expected, out_threads);
+}
+
+TEST (PointCloud2Transform, paddedRows)
+{
+  pcl::PointCloud<pcl::PointXYZRGBNormal> cloud = makeCloud (600);
+  cloud.width = 200;
+  cloud.height = 3;
+  Eigen::Matrix4f transform = testTransform (0.0f, 1.0f, 0.0f, 0.3f);
+
+  pcl::PointCloud<pcl::PointXYZRGBNormal> expected;
+  pcl::transformPointCloudWithNormals (cloud, expected, transform);
+
+  // Append padding to each row, which has to come through untouched
+  sensor_msgs::PointCloud2 packed, in, out;
+  pcl::toROSMsg (cloud, packed);
+  in = packed;
+  in.row_step = packed.row_step + 16;
+  in.data.assign (in.row_step * in.height, 0xab);
+  for (size_t r = 0; r < in.height; ++r)
+    std::copy (packed.data.begin () + r * packed.row_step, packed.data.begin () + (r + 1) * packed.row_step,
+               in.data.begin () + r * in.row_step);
+
+  pcl_ros::transformPointCloud (transform, in, out, 2);
+  ASSERT_EQ (in.row_step, out.row_step);
+  for (size_t r = 0; r < in.height; ++r)
+    for (size_t b = packed.row_step; b < in.row_step; ++b)
+      EXPECT_EQ (0xab, out.data[r * out.row_step + b]);
+
+  sensor_msgs::PointCloud2 unpadded = out;
+  unpadded.row_step = packed.row_step;
+  unpadded.data.clear ();
+  for (size_t r = 0; r < out.height; ++r)
+    unpadded.data.insert (unpadded.data.end (), out.data.begin () + r * out.row_step,
+                          out.data.begin () + r * out.row_step + packed.row_step);
+  expectSameCloud (expected, unpadded);
+}
+
+TEST (PointCloud2Transform, maxRangePoints)
+{
+  sensor_msgs::PointCloud2 in;
+  sensor_msgs::PointCloud2Modifier modifier (in);
+  modifier.setPointCloud2Fields (4, "x", 1, sensor_msgs::PointField::FLOAT32,
+                                 "y", 1, sensor_msgs::PointField::FLOAT32,
+                                 "z", 1, sensor_msgs::PointField::FLOAT32,
+                                 "distance", 1, sensor_msgs::PointField::FLOAT32);
+  modifier.resize (3);
+  const float nan = std::numeric_limits<float>::quiet_NaN ();
+  const float points[3][4] = {{1.0f, 2.0f, 3.0f, 0.0f},    // valid
+                              {nan, 2.0f, 3.0f, 10.0f},    // max range, x saved in distance
+                              {nan, 2.0f, 3.0f, nan}};     // invalid
+  sensor_msgs::PointCloud2Iterator<float> it (in, "x");
+  for (size_t i = 0; i < 3; ++i, ++it)
+    for (int d = 0; d < 4; ++d)
+      it[d] = points[i][d];
+
+  Eigen::Matrix4f transform = testTransform (1.0f, 2.0f, 3.0f, 0.5f);
+  sensor_msgs::PointCloud2 out;
+  pcl_ros::transformPointCloud (transform, in, out);
+
+  sensor_msgs::PointCloud2ConstIterator<float> result (out, "x");
+  Eigen::Vector4f valid = transform * Eigen::Vector4f (1.0f, 2.0f, 3.0f, 1.0f);
+  EXPECT_TRUE (near (valid[0], result[0]) && near (valid[1], result[1]) && near (valid[2], result[2]));
+  EXPECT_EQ (0.0f, result[3]);
+  ++result;
+  Eigen::Vector4f max_range = transform * Eigen::Vector4f (10.0f, 2.0f, 3.0f, 1.0f);
+  EXPECT_TRUE (std::isnan (result[0]));
+  EXPECT_TRUE (near (max_range[1], result[1]) && near (max_range[2], result[2]));
+  EXPECT_TRUE (near (max_range[0], result[3]));
+  ++result;
+  EXPECT_TRUE (std::isnan (result[0]) && std::isnan (result[3]));
+  EXPECT_EQ (2.0f, result[1]);
+  EXPECT_EQ (3.0f, result[2]);
+}
+
+TEST (PointCloud2Transform, deskew)
+{
+  sensor_msgs::PointCloud2 in;
+  sensor_msgs::PointCloud2Modifier modifier (in);
+  modifier.setPointCloud2Fields (7, "x", 1, sensor_msgs::PointField::FLOAT32,
+                                 "y", 1, sensor_msgs::PointField::FLOAT32,
+                                 "z", 1, sensor_msgs::PointField::FLOAT32,
+                                 "normal_x", 1, sensor_msgs::PointField::FLOAT32,
+                                 "normal_y", 1, sensor_msgs::PointField::FLOAT32,
+                                 "normal_z", 1, sensor_msgs::PointField::FLOAT32,
+                                 "time", 1, sensor_msgs::PointField::FLOAT64);
+  const size_t nr_points = 200000;
+  modifier.resize (nr_points);
+  sensor_msgs::PointCloud2Iterator<float> it (in, "x");
+  sensor_msgs::PointCloud2Iterator<double> time (in, "time");
+  for (size_t i = 0; i < nr_points; ++i, ++it, ++time)
+  {
+    it[0] = 1.0f;
+    it[1] = static_cast<float> (i % 100);
+    it[2] = (i % 13 == 0) ? std::numeric_limits<float>::quiet_NaN () : 2.0f;
+    it[3] = 0.0f;
+    it[4] = 0.0f;
+    it[5] = 1.0f;
+    // Times run past both ends of the interval, where the end transforms apply
+    *time = -0.5 + 2.0 * static_cast<double> (i) / nr_points;
+  }
+
+  pcl_ros::PointCloud2Transform::Knots knots;
+  knots.push_back (testTransform (0.0f, 0.0f, 0.0f, 0.0f));
+  knots.push_back (testTransform (1.0f, 0.0f, 0.0f, 0.2f));
+  knots.push_back (testTransform (1.0f, 2.0f, 0.0f, 0.4f));
+
+  double time_min, time_max;
+  ASSERT_TRUE (pcl_ros::PointCloud2Transform::getTimeRange (in, "time", time_min, time_max));
+  EXPECT_DOUBLE_EQ (-0.5, time_min);
+  EXPECT_NEAR (1.5, time_max, 1e-4);
+
+  pcl_ros::PointCloud2Transform transform;
+  ASSERT_TRUE (transform.init (in, knots, "time", 0.0, 1.0));
+  sensor_msgs::PointCloud2 out;
+  transform.transform (in, out, 4);
+
+  sensor_msgs::PointCloud2ConstIterator<float> src (in, "x"), dst (out, "x");
+  sensor_msgs::PointCloud2ConstIterator<double> t (in, "time");
+  for (size_t i = 0; i < nr_points; ++i, ++src, ++dst, ++t)
+  {
+    double u = std::min (std::max (*t, 0.0), 1.0) * 2.0;
+    size_t k = std::min<size_t> (static_cast<size_t> (u), 1);
+    Eigen::Matrix4f m = knots[k] + static_cast<float> (u - k) * (knots[k + 1] - knots[k]);
+
+    if (!std::isfinite (src[2]))
+    {
+      // Invalid points keep their coordinates and normals
+      for (int d = 0; d < 6; ++d)
+        ASSERT_TRUE (near (src[d], dst[d])) << "point " << i;
+      continue;
+    }
+    Eigen::Vector4f p = m * Eigen::Vector4f (src[0], src[1], src[2], 1.0f);
+    Eigen::Vector3f n = m.topLeftCorner<3, 3> () * Eigen::Vector3f (src[3], src[4], src[5]);
+    for (int d = 0; d < 3; ++d)
+    {
+      ASSERT_TRUE (near (p[d], dst[d])) << "point " << i;
+      ASSERT_TRUE (near (n[d], dst[d + 3])) << "normal " << i;
+    }
+  }
+
+  // Two equal knots are the plain transform
+  sensor_msgs::PointCloud2 plain, blended;
+  pcl_ros::transformPointCloud (knots[1], in, plain);
+  ASSERT_TRUE (pcl_ros::transformPointCloud (knots[1], knots[1], "time", 0.0, 1.0, in, blended, 2));
+  sensor_msgs::PointCloud2ConstIterator<float> plain_it (plain, "x"), blended_it (blended, "x");
+  for (size_t i = 0; i < nr_points; ++i, ++plain_it, ++blended_it)
+    for (int d = 0; d < 6; ++d)
+      ASSERT_TRUE (near (plain_it[d], blended_it[d])) << "point " << i;
+
+  EXPECT_FALSE (pcl_ros::transformPointCloud (knots[0], knots[1], "stamp", 0.0, 1.0, in, blended));
+}
+
+int
+main (int argc, char **argv)
+{
+  testing::InitGoogleTest (&argc, argv);
+  return (RUN_ALL_TESTS ());
+}
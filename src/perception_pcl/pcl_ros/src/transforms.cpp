@@ -37,11 +37,393 @@
 #include <sensor_msgs/PointCloud2.h>
 #include <tf2_eigen/tf2_eigen.h>
 #include <pcl_conversions/pcl_conversions.h>
+#include <boost/bind.hpp>
+#include <boost/thread/thread.hpp>
+#include <algorithm>
+#include <limits>
 #include "pcl_ros/transforms.h"
 #include "pcl_ros/impl/transforms.hpp"
 
+namespace
+{
+  /** \brief Number of points gathered into one set of coordinate arrays. */
+  const size_t TRANSFORM_BLOCK = 256;
+
+  /** \brief Smallest number of points worth handing to a thread of its own. */
+  const size_t TRANSFORM_POINTS_PER_THREAD = 65536;
+
+  typedef Eigen::Array<float, TRANSFORM_BLOCK, 1> BlockArray;
+
+  inline float
+  readFloat (const uint8_t *p)
+  {
+    float v;
+    memcpy (&v, p, sizeof (v));
+    return (v);
+  }
+
+  inline void
+  writeFloat (uint8_t *p, float v)
+  {
+    memcpy (p, &v, sizeof (v));
+  }
+
+  inline bool
+  isTimeType (uint8_t datatype)
+  {
+    return (datatype == sensor_msgs::PointField::FLOAT32 || datatype == sensor_msgs::PointField::FLOAT64 ||
+            datatype == sensor_msgs::PointField::INT32 || datatype == sensor_msgs::PointField::UINT32);
+  }
+
+  inline double
+  readTime (const uint8_t *p, uint8_t datatype)
+  {
+    switch (datatype)
+    {
+      case sensor_msgs::PointField::FLOAT32: { float t; memcpy (&t, p, sizeof (t)); return t; }
+      case sensor_msgs::PointField::FLOAT64: { double t; memcpy (&t, p, sizeof (t)); return t; }
+      case sensor_msgs::PointField::UINT32: { uint32_t t; memcpy (&t, p, sizeof (t)); return t; }
+      case sensor_msgs::PointField::INT32: { int32_t t; memcpy (&t, p, sizeof (t)); return t; }
+    }
+    return 0.0;
+  }
+
+  /** \brief Offset of a FLOAT32 field, or -1 if it is missing or of another type. */
+  int
+  floatOffset (const sensor_msgs::PointCloud2 &cloud, const std::string &name)
+  {
+    int idx = pcl::getFieldIndex (cloud, name);
+    if (idx == -1 || cloud.fields[idx].datatype != sensor_msgs::PointField::FLOAT32)
+      return (-1);
+    return (cloud.fields[idx].offset);
+  }
+
+  /** \brief Gather the three fields at \a offset of \a n points. */
+  inline void
+  gather (const uint8_t *points, size_t point_step, const int offset[3], size_t n,
+          BlockArray &x, BlockArray &y, BlockArray &z)
+  {
+    for (size_t i = 0; i < n; ++i, points += point_step)
+    {
+      x[i] = readFloat (points + offset[0]);
+      y[i] = readFloat (points + offset[1]);
+      z[i] = readFloat (points + offset[2]);
+    }
+  }
+
+  /** \brief Row \a r of \a m applied to (x, y, z, w) for the first \a n points, which Eigen vectorizes. */
+  inline void
+  transformRow (const Eigen::Matrix4f &m, int r, float w, size_t n,
+                const BlockArray &x, const BlockArray &y, const BlockArray &z, BlockArray &out)
+  {
+    out.head (n) = m (r, 0) * x.head (n) + m (r, 1) * y.head (n) + m (r, 2) * z.head (n) + w * m (r, 3);
+  }
+}
+
 namespace pcl_ros
 {
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+PointCloud2Transform::PointCloud2Transform ()
+  : time_offset_ (0), time_datatype_ (0), time_begin_ (0.0), knots_per_unit_ (0.0), point_step_ (0),
+    x_offset_ (-1), y_offset_ (-1), z_offset_ (-1), distance_offset_ (-1), has_normals_ (false), has_vp_ (false)
+{
+  for (int d = 0; d < 3; ++d)
+    normal_offset_[d] = vp_offset_[d] = -1;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool
+PointCloud2Transform::initFields (const sensor_msgs::PointCloud2 &layout)
+{
+  int x_idx = pcl::getFieldIndex (layout, "x");
+  int y_idx = pcl::getFieldIndex (layout, "y");
+  int z_idx = pcl::getFieldIndex (layout, "z");
+  if (x_idx == -1 || y_idx == -1 || z_idx == -1)
+  {
+    ROS_ERROR ("Input dataset has no X-Y-Z coordinates! Cannot convert to Eigen format.");
+    return (false);
+  }
+  x_offset_ = floatOffset (layout, "x");
+  y_offset_ = floatOffset (layout, "y");
+  z_offset_ = floatOffset (layout, "z");
+  if (x_offset_ == -1 || y_offset_ == -1 || z_offset_ == -1)
+  {
+    ROS_ERROR ("X-Y-Z coordinates not floats. Currently only floats are supported.");
+    return (false);
+  }
+  distance_offset_ = floatOffset (layout, "distance");
+  point_step_ = layout.point_step;
+
+  // Normals and viewpoints are only handled when all three components are there
+  normal_offset_[0] = floatOffset (layout, "normal_x");
+  normal_offset_[1] = floatOffset (layout, "normal_y");
+  normal_offset_[2] = floatOffset (layout, "normal_z");
+  has_normals_ = normal_offset_[0] != -1 && normal_offset_[1] != -1 && normal_offset_[2] != -1;
+  vp_offset_[0] = floatOffset (layout, "vp_x");
+  vp_offset_[1] = floatOffset (layout, "vp_y");
+  vp_offset_[2] = floatOffset (layout, "vp_z");
+  has_vp_ = vp_offset_[0] != -1 && vp_offset_[1] != -1 && vp_offset_[2] != -1;
+  return (true);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool
+PointCloud2Transform::init (const sensor_msgs::PointCloud2 &layout, const Eigen::Matrix4f &transform)
+{
+  if (!initFields (layout))
+    return (false);
+  knots_.assign (1, transform);
+  deltas_.clear ();
+  return (true);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool
+PointCloud2Transform::init (const sensor_msgs::PointCloud2 &layout, const Knots &knots, const std::string &time_field,
+                            double time_begin, double time_end)
+{
+  if (!initFields (layout))
+    return (false);
+  if (knots.empty ())
+  {
+    ROS_ERROR ("No transforms given to deskew the dataset with.");
+    return (false);
+  }
+
+  int time_idx = pcl::getFieldIndex (layout, time_field);
+  if (time_idx == -1)
+  {
+    ROS_ERROR ("Input dataset has no %s field! Cannot deskew it.", time_field.c_str ());
+    return (false);
+  }
+  if (!isTimeType (layout.fields[time_idx].datatype))
+  {
+    ROS_ERROR ("Time field %s has an unsupported type.", time_field.c_str ());
+    return (false);
+  }
+  time_offset_ = layout.fields[time_idx].offset;
+  time_datatype_ = layout.fields[time_idx].datatype;
+
+  knots_ = knots;
+  deltas_.clear ();
+  for (size_t k = 0; k + 1 < knots.size (); ++k)
+    deltas_.push_back (knots[k + 1] - knots[k]);
+  time_begin_ = time_begin;
+  knots_per_unit_ = (knots.size () > 1 && time_end > time_begin) ? (knots.size () - 1) / (time_end - time_begin) : 0.0;
+  return (true);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool
+PointCloud2Transform::getTimeRange (const sensor_msgs::PointCloud2 &cloud, const std::string &time_field,
+                                    double &time_min, double &time_max)
+{
+  int time_idx = pcl::getFieldIndex (cloud, time_field);
+  if (time_idx == -1 || !isTimeType (cloud.fields[time_idx].datatype) || cloud.width * cloud.height == 0)
+    return (false);
+
+  const sensor_msgs::PointField &field = cloud.fields[time_idx];
+  time_min = std::numeric_limits<double>::max ();
+  time_max = -time_min;
+  for (size_t r = 0; r < cloud.height; ++r)
+  {
+    const uint8_t *p = &cloud.data[r * cloud.row_step + field.offset];
+    for (size_t i = 0; i < cloud.width; ++i, p += cloud.point_step)
+    {
+      double t = readTime (p, field.datatype);
+      time_min = std::min (time_min, t);
+      time_max = std::max (time_max, t);
+    }
+  }
+  return (true);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void
+PointCloud2Transform::transformPoints (const uint8_t *in, uint8_t *out, size_t n) const
+{
+  for (size_t b = 0; b < n; b += TRANSFORM_BLOCK)
+  {
+    size_t count = std::min (TRANSFORM_BLOCK, n - b);
+    uint8_t *block = out + b * point_step_;
+    // Copy each block just before transforming it, so that it is still in cache
+    if (in != out)
+      memcpy (block, in + b * point_step_, count * point_step_);
+    if (knots_.size () > 1)
+      deskewBlock (block, count);
+    else
+      transformBlock (block, count);
+  }
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void
+PointCloud2Transform::transform (const sensor_msgs::PointCloud2 &in, sensor_msgs::PointCloud2 &out,
+                                 unsigned int num_threads) const
+{
+  // Copy the other data
+  if (&in != &out)
+  {
+    out.header = in.header;
+    out.height = in.height;
+    out.width  = in.width;
+    out.fields = in.fields;
+    out.is_bigendian = in.is_bigendian;
+    out.point_step   = in.point_step;
+    out.row_step     = in.row_step;
+    out.is_dense     = in.is_dense;
+    out.data.resize (in.data.size ());
+  }
+  const uint8_t *src = in.data.data ();
+  uint8_t *dst = out.data.data ();
+
+  if (in.row_step != in.width * in.point_step)
+  {
+    // Padded rows are rare; copy them as a whole and transform them one by one
+    if (src != dst)
+      memcpy (dst, src, in.data.size ());
+    for (size_t r = 0; r < in.height; ++r)
+      transformPoints (dst + r * in.row_step, dst + r * in.row_step, in.width);
+    return;
+  }
+
+  size_t nr_points = static_cast<size_t> (in.width) * in.height;
+  size_t threads = std::min<size_t> (std::max (num_threads, 1u), nr_points / TRANSFORM_POINTS_PER_THREAD + 1);
+  size_t chunk = (nr_points + threads - 1) / threads;
+  boost::thread_group workers;
+  for (size_t first = chunk; first < nr_points; first += chunk)
+    workers.create_thread (boost::bind (&PointCloud2Transform::transformPoints, this, src + first * point_step_,
+                                        dst + first * point_step_, std::min (chunk, nr_points - first)));
+  transformPoints (src, dst, std::min (chunk, nr_points));
+  workers.join_all ();
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void
+PointCloud2Transform::transformCoordinates (const Eigen::Matrix4f &m, uint8_t *p) const
+{
+  float x = readFloat (p + x_offset_), y = readFloat (p + y_offset_), z = readFloat (p + z_offset_);
+  if (std::isfinite (x) && std::isfinite (y) && std::isfinite (z))
+  {
+    Eigen::Vector4f pt_out = m * Eigen::Vector4f (x, y, z, 1);
+    writeFloat (p + x_offset_, pt_out[0]);
+    writeFloat (p + y_offset_, pt_out[1]);
+    writeFloat (p + z_offset_, pt_out[2]);
+  }
+  else if (distance_offset_ != -1 && std::isfinite (readFloat (p + distance_offset_)))
+  {
+    // Max range point: the x value is saved in distance, transform it and save it there again
+    Eigen::Vector4f pt_out = m * Eigen::Vector4f (readFloat (p + distance_offset_), y, z, 1);
+    writeFloat (p + distance_offset_, pt_out[0]);
+    writeFloat (p + x_offset_, std::numeric_limits<float>::quiet_NaN ());
+    writeFloat (p + y_offset_, pt_out[1]);
+    writeFloat (p + z_offset_, pt_out[2]);
+  }
+  // Invalid points stay as they are
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void
+PointCloud2Transform::transformBlock (uint8_t *points, size_t n) const
+{
+  const Eigen::Matrix4f &m = knots_[0];
+  const int xyz_offset[3] = {x_offset_, y_offset_, z_offset_};
+  BlockArray x, y, z, tx, ty, tz;
+  bool valid[TRANSFORM_BLOCK];
+
+  gather (points, point_step_, xyz_offset, n, x, y, z);
+  transformRow (m, 0, 1.0f, n, x, y, z, tx);
+  transformRow (m, 1, 1.0f, n, x, y, z, ty);
+  transformRow (m, 2, 1.0f, n, x, y, z, tz);
+  for (size_t i = 0; i < n; ++i)
+  {
+    uint8_t *p = points + i * point_step_;
+    valid[i] = std::isfinite (x[i]) && std::isfinite (y[i]) && std::isfinite (z[i]);
+    if (valid[i])
+    {
+      writeFloat (p + x_offset_, tx[i]);
+      writeFloat (p + y_offset_, ty[i]);
+      writeFloat (p + z_offset_, tz[i]);
+    }
+    else
+      transformCoordinates (m, p);
+  }
+
+  // Normals are only rotated, and left as they are on invalid points
+  if (has_normals_)
+  {
+    gather (points, point_step_, normal_offset_, n, x, y, z);
+    transformRow (m, 0, 0.0f, n, x, y, z, tx);
+    transformRow (m, 1, 0.0f, n, x, y, z, ty);
+    transformRow (m, 2, 0.0f, n, x, y, z, tz);
+    for (size_t i = 0; i < n; ++i)
+    {
+      if (!valid[i])
+        continue;
+      uint8_t *p = points + i * point_step_;
+      writeFloat (p + normal_offset_[0], tx[i]);
+      writeFloat (p + normal_offset_[1], ty[i]);
+      writeFloat (p + normal_offset_[2], tz[i]);
+    }
+  }
+
+  // Transform the viewpoint info too
+  if (has_vp_)
+  {
+    gather (points, point_step_, vp_offset_, n, x, y, z);
+    transformRow (m, 0, 1.0f, n, x, y, z, tx);
+    transformRow (m, 1, 1.0f, n, x, y, z, ty);
+    transformRow (m, 2, 1.0f, n, x, y, z, tz);
+    for (size_t i = 0; i < n; ++i)
+    {
+      uint8_t *p = points + i * point_step_;
+      writeFloat (p + vp_offset_[0], tx[i]);
+      writeFloat (p + vp_offset_[1], ty[i]);
+      writeFloat (p + vp_offset_[2], tz[i]);
+    }
+  }
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void
+PointCloud2Transform::deskewBlock (uint8_t *points, size_t n) const
+{
+  // Every point has a matrix of its own, so the points are transformed one by one
+  double last = static_cast<double> (deltas_.size ());
+  for (size_t i = 0; i < n; ++i)
+  {
+    uint8_t *p = points + i * point_step_;
+    double u = (readTime (p + time_offset_, time_datatype_) - time_begin_) * knots_per_unit_;
+    if (!(u > 0.0))
+      u = 0.0;
+    u = std::min (u, last);
+    size_t k = std::min (static_cast<size_t> (u), deltas_.size () - 1);
+    Eigen::Matrix4f m = knots_[k] + static_cast<float> (u - k) * deltas_[k];
+
+    bool valid = std::isfinite (readFloat (p + x_offset_)) && std::isfinite (readFloat (p + y_offset_)) &&
+                 std::isfinite (readFloat (p + z_offset_));
+    transformCoordinates (m, p);
+    if (has_normals_ && valid)
+    {
+      Eigen::Vector3f normal (readFloat (p + normal_offset_[0]), readFloat (p + normal_offset_[1]),
+                              readFloat (p + normal_offset_[2]));
+      normal = m.topLeftCorner<3, 3> () * normal;
+      writeFloat (p + normal_offset_[0], normal[0]);
+      writeFloat (p + normal_offset_[1], normal[1]);
+      writeFloat (p + normal_offset_[2], normal[2]);
+    }
+    if (has_vp_)
+    {
+      Eigen::Vector4f vp (readFloat (p + vp_offset_[0]), readFloat (p + vp_offset_[1]),
+                          readFloat (p + vp_offset_[2]), 1);
+      vp = m * vp;
+      writeFloat (p + vp_offset_[0], vp[0]);
+      writeFloat (p + vp_offset_[1], vp[1]);
+      writeFloat (p + vp_offset_[2], vp[2]);
+    }
+  }
+}
+
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 bool
 transformPointCloud (const std::string &target_frame, const sensor_msgs::PointCloud2 &in, 
@@ -153,105 +535,35 @@ void
 transformPointCloud (const Eigen::Matrix4f &transform, const sensor_msgs::PointCloud2 &in,
                      sensor_msgs::PointCloud2 &out)
 {
-  // Get X-Y-Z indices
-  int x_idx = pcl::getFieldIndex (in, "x");
-  int y_idx = pcl::getFieldIndex (in, "y");
-  int z_idx = pcl::getFieldIndex (in, "z");
-
-  if (x_idx == -1 || y_idx == -1 || z_idx == -1)
-  {
-    ROS_ERROR ("Input dataset has no X-Y-Z coordinates! Cannot convert to Eigen format.");
-    return;
-  }
+  transformPointCloud (transform, in, out, 1);
+}
 
-  if (in.fields[x_idx].datatype != sensor_msgs::PointField::FLOAT32 || 
-      in.fields[y_idx].datatype != sensor_msgs::PointField::FLOAT32 || 
-      in.fields[z_idx].datatype != sensor_msgs::PointField::FLOAT32)
-  {
-    ROS_ERROR ("X-Y-Z coordinates not floats. Currently only floats are supported.");
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void
+transformPointCloud (const Eigen::Matrix4f &transform, const sensor_msgs::PointCloud2 &in,
+                     sensor_msgs::PointCloud2 &out, unsigned int num_threads)
+{
+  PointCloud2Transform job;
+  if (!job.init (in, transform))
     return;
-  }
-
-  // Check if distance is available
-  int dist_idx = pcl::getFieldIndex (in, "distance");
-
-  // Copy the other data
-  if (&in != &out)
-  {
-    out.header = in.header;
-    out.height = in.height;
-    out.width  = in.width;
-    out.fields = in.fields;
-    out.is_bigendian = in.is_bigendian;
-    out.point_step   = in.point_step;
-    out.row_step     = in.row_step;
-    out.is_dense     = in.is_dense;
-    out.data.resize (in.data.size ());
-    // Copy everything as it's faster than copying individual elements
-    memcpy (out.data.data (), in.data.data (), in.data.size ());
-  }
-
-  Eigen::Array4i xyz_offset (in.fields[x_idx].offset, in.fields[y_idx].offset, in.fields[z_idx].offset, 0);
-
-  for (size_t i = 0; i < in.width * in.height; ++i)
-  {
-    Eigen::Vector4f pt (*(float*)&in.data[xyz_offset[0]], *(float*)&in.data[xyz_offset[1]], *(float*)&in.data[xyz_offset[2]], 1);
-    Eigen::Vector4f pt_out;
-    
-    bool max_range_point = false;
-    int distance_ptr_offset = (dist_idx < 0 ? -1 : (i*in.point_step + in.fields[dist_idx].offset)); // If dist_idx is negative, it must not be used as an index
-    float* distance_ptr = (dist_idx < 0 ? NULL : (float*)(&in.data[distance_ptr_offset]));
-    if (!std::isfinite (pt[0]) || !std::isfinite (pt[1]) || !std::isfinite (pt[2]))
-    {
-      if (distance_ptr==NULL || !std::isfinite(*distance_ptr))  // Invalid point
-      {
-        pt_out = pt;
-      }
-      else  // max range point
-      {
-        pt[0] = *distance_ptr;  // Replace x with the x value saved in distance
-        pt_out = transform * pt;
-        max_range_point = true;
-        //std::cout << pt[0]<<","<<pt[1]<<","<<pt[2]<<" => "<<pt_out[0]<<","<<pt_out[1]<<","<<pt_out[2]<<"\n";
-      }
-    }
-    else
-    {
-      pt_out = transform * pt;
-    }
-
-    if (max_range_point)
-    {
-      // Save x value in distance again
-      *(float*)(&out.data[distance_ptr_offset]) = pt_out[0];
-      pt_out[0] = std::numeric_limits<float>::quiet_NaN();
-    }
+  job.transform (in, out, num_threads);
+}
 
-    memcpy (&out.data[xyz_offset[0]], &pt_out[0], sizeof (float));
-    memcpy (&out.data[xyz_offset[1]], &pt_out[1], sizeof (float));
-    memcpy (&out.data[xyz_offset[2]], &pt_out[2], sizeof (float));
-  
-    
-    xyz_offset += in.point_step;
-  }
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool
+transformPointCloud (const Eigen::Matrix4f &transform_begin, const Eigen::Matrix4f &transform_end,
+                     const std::string &time_field, double time_begin, double time_end,
+                     const sensor_msgs::PointCloud2 &in, sensor_msgs::PointCloud2 &out, unsigned int num_threads)
+{
+  PointCloud2Transform::Knots knots;
+  knots.push_back (transform_begin);
+  knots.push_back (transform_end);
 
-  // Check if the viewpoint information is present
-  int vp_idx = pcl::getFieldIndex (in, "vp_x");
-  if (vp_idx != -1)
-  {
-    // Transform the viewpoint info too
-    for (size_t i = 0; i < out.width * out.height; ++i)
-    {
-      float *pstep = (float*)&out.data[i * out.point_step + out.fields[vp_idx].offset];
-      // Assume vp_x, vp_y, vp_z are consecutive
-      Eigen::Vector4f vp_in (pstep[0], pstep[1], pstep[2], 1);
-      Eigen::Vector4f vp_out = transform * vp_in;
-
-      pstep[0] = vp_out[0];
-      pstep[1] = vp_out[1];
-      pstep[2] = vp_out[2];
-    }
-  }
+  PointCloud2Transform job;
+  if (!job.init (in, knots, time_field, time_begin, time_end))
+    return (false);
+  job.transform (in, out, num_threads);
+  return (true);
 }
 
 //////////////////////////////////////////////////////////////////////////////////////////////
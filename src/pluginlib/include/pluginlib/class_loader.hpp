@@ -39,6 +39,7 @@
 #include "pluginlib/class_desc.hpp"
 #include "pluginlib/class_loader_base.hpp"
 #include "pluginlib/exceptions.hpp"
+#include "pluginlib/plugin_index.hpp"
 #include "ros/console.h"
 #include "ros/package.h"
 #include "tinyxml2.h"  // NOLINT
@@ -310,7 +311,7 @@ private:
   /// Join two filesystem paths together utilzing appropriate path separator.
   std::string joinPaths(const std::string & path1, const std::string & path2);
 
-  /// Parse a plugin XML file.
+  /// Parse a plugin XML file, unless its contents are recorded in the plugin index.
   /**
    * Also insert the appropriate ClassDesc entries into the passes
    * classes_available map.
@@ -319,6 +320,18 @@ private:
     const std::string & xml_file, std::map<std::string,
     ClassDesc> & class_available);
 
+  /// Insert the classes of a plugin manifest deriving from the base class into classes_available.
+  void addClassesFromManifest(
+    const std::string & xml_file, const PluginIndexManifest & manifest,
+    std::map<std::string, ClassDesc> & classes_available);
+
+  /// Crawl for classes which are missing from the plugin index, at most once.
+  /**
+   * \return true if the package path was crawled, false if the plugin
+   *   manifest paths did not come from the plugin index or were crawled already
+   */
+  bool recrawlIfIndexed();
+
   /// Strip all but the filename from an explicit file path.
   /**
    * \param path The path to strip
@@ -341,6 +354,8 @@ private:
   std::string package_;
   std::string base_class_;
   std::string attrib_name_;
+  PluginIndex plugin_index_;
+  bool plugin_xml_paths_indexed_;  // True if plugin_xml_paths_ came from plugin_index_
   class_loader::MultiLibraryClassLoader lowlevel_class_loader_;  // The underlying classloader
 };
 
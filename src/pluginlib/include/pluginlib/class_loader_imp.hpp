@@ -73,6 +73,8 @@ ClassLoader<T>::ClassLoader(
   package_(package),
   base_class_(base_class),
   attrib_name_(attrib_name),
+  plugin_index_(package, attrib_name),
+  plugin_xml_paths_indexed_(false),
   // NOTE: The parameter to the class loader enables/disables on-demand class
   // loading/unloading.
   // Leaving it off for now... libraries will be loaded immediately and won't
@@ -90,6 +92,7 @@ ClassLoader<T>::ClassLoader(
     plugin_xml_paths_ = getPluginXmlPaths(package_, attrib_name_);
   }
   classes_available_ = determineAvailableClasses(plugin_xml_paths_);
+  plugin_index_.save();
   ROS_DEBUG_NAMED("pluginlib.ClassLoader",
     "Finished constructring ClassLoader, base = %s, address = %p",
     base_class.c_str(), this);
@@ -236,7 +239,18 @@ std::vector<std::string> ClassLoader<T>::getPluginXmlPaths(
 {
   // Pull possible files from manifests of packages which depend on this package and export class
   std::vector<std::string> paths;
+  bool indexed = package == package_ && attrib_name == attrib_name_;
+  if (indexed && !force_recrawl && plugin_index_.getPluginXmlPaths(paths)) {
+    ROS_DEBUG_NAMED("pluginlib.ClassLoader", "Using plugin xml paths from index %s.",
+      plugin_index_.getIndexPath().c_str());
+    plugin_xml_paths_indexed_ = true;
+    return paths;
+  }
   ros::package::getPlugins(package, attrib_name, paths, force_recrawl);
+  if (indexed) {
+    plugin_index_.setPluginXmlPaths(paths);
+    plugin_xml_paths_indexed_ = false;
+  }
   return paths;
 }
 
@@ -601,6 +615,9 @@ template<class T>
 bool ClassLoader<T>::isClassAvailable(const std::string & lookup_name)
 /***************************************************************************/
 {
+  if (classes_available_.find(lookup_name) == classes_available_.end() && !recrawlIfIndexed()) {
+    return false;
+  }
   return classes_available_.find(lookup_name) != classes_available_.end();
 }
 
@@ -617,6 +634,9 @@ void ClassLoader<T>::loadLibraryForClass(const std::string & lookup_name)
 /***************************************************************************/
 {
   ClassMapIterator it = classes_available_.find(lookup_name);
+  if (it == classes_available_.end() && recrawlIfIndexed()) {
+    it = classes_available_.find(lookup_name);
+  }
   if (it == classes_available_.end()) {
     ROS_DEBUG_NAMED("pluginlib.ClassLoader", "Class %s has no mapping in classes_available_.",
       lookup_name.c_str());
@@ -636,6 +656,7 @@ void ClassLoader<T>::loadLibraryForClass(const std::string & lookup_name)
 
   try {
     lowlevel_class_loader_.loadLibrary(library_path);
+    lowlevel_class_loader_.declareClass(it->second.derived_class_, library_path);
     it->second.resolved_library_path_ = library_path;
   } catch (const class_loader::LibraryLoadException & ex) {
     std::string error_string =
@@ -653,6 +674,14 @@ void ClassLoader<T>::processSingleXMLPluginFile(
   ClassDesc> & classes_available)
 /***************************************************************************/
 {
+  const PluginIndexManifest * indexed_manifest = plugin_index_.getManifest(xml_file);
+  if (NULL != indexed_manifest) {
+    ROS_DEBUG_NAMED("pluginlib.ClassLoader", "Using indexed contents of xml file %s.",
+      xml_file.c_str());
+    addClassesFromManifest(xml_file, *indexed_manifest, classes_available);
+    return;
+  }
+
   ROS_DEBUG_NAMED("pluginlib.ClassLoader", "Processing xml file %s...", xml_file.c_str());
   tinyxml2::XMLDocument document;
   document.LoadFile(xml_file.c_str());
@@ -683,6 +712,7 @@ void ClassLoader<T>::processSingleXMLPluginFile(
     config = config->FirstChildElement("library");
   }
 
+  PluginIndexManifest manifest;
   tinyxml2::XMLElement * library = config;
   while (library != NULL) {
     const char* path = library->Attribute("path");
@@ -706,6 +736,7 @@ void ClassLoader<T>::processSingleXMLPluginFile(
         "Plugins will likely not be exported properly.\n)",
         xml_file.c_str());
     }
+    manifest.package_ = package_name;
 
     tinyxml2::XMLElement * class_element = library->FirstChildElement("class");
     while (class_element) {
@@ -739,27 +770,70 @@ void ClassLoader<T>::processSingleXMLPluginFile(
         lookup_name = derived_class;
       }
 
-      // make sure that this class is of the right type before registering it
-      if (base_class_type == base_class_) {
-        // register class here
-        tinyxml2::XMLElement * description = class_element->FirstChildElement("description");
-        std::string description_str;
-        if (description) {
-          description_str = description->GetText() ? description->GetText() : "";
-        } else {
-          description_str = "No 'description' tag for this plugin in plugin description file.";
-        }
-
-        classes_available.insert(std::pair<std::string, ClassDesc>(lookup_name,
-          ClassDesc(lookup_name, derived_class, base_class_type, package_name, description_str,
-          library_path, xml_file)));
+      // record classes of every base class type, the index is shared by all of them
+      tinyxml2::XMLElement * description = class_element->FirstChildElement("description");
+      PluginIndexClass plugin_class;
+      if (description) {
+        plugin_class.description_ = description->GetText() ? description->GetText() : "";
+      } else {
+        plugin_class.description_ =
+          "No 'description' tag for this plugin in plugin description file.";
       }
+      plugin_class.lookup_name_ = lookup_name;
+      plugin_class.derived_class_ = derived_class;
+      plugin_class.base_class_ = base_class_type;
+      plugin_class.library_name_ = library_path;
+      manifest.classes_.push_back(plugin_class);
 
       // step to next class_element
       class_element = class_element->NextSiblingElement("class");
     }
     library = library->NextSiblingElement("library");
   }
+
+  addClassesFromManifest(xml_file, plugin_index_.setManifest(xml_file, manifest),
+    classes_available);
+}
+
+template<class T>
+void ClassLoader<T>::addClassesFromManifest(
+  const std::string & xml_file, const PluginIndexManifest & manifest,
+  std::map<std::string, ClassDesc> & classes_available)
+/***************************************************************************/
+{
+  for (std::vector<PluginIndexClass>::const_iterator it = manifest.classes_.begin();
+    it != manifest.classes_.end(); ++it)
+  {
+    // make sure that this class is of the right type before registering it
+    if (it->base_class_ == base_class_) {
+      classes_available.insert(std::pair<std::string, ClassDesc>(it->lookup_name_,
+        ClassDesc(it->lookup_name_, it->derived_class_, it->base_class_, manifest.package_,
+        it->description_, it->library_name_, xml_file)));
+    }
+  }
+}
+
+template<class T>
+bool ClassLoader<T>::recrawlIfIndexed()
+/***************************************************************************/
+{
+  if (!plugin_xml_paths_indexed_) {
+    return false;
+  }
+  // A package may have started exporting plugins without changing any of the
+  // files the index is validated against, so look again before giving up.
+  // This goes through the rospack cache rather than forcing a crawl, so a miss
+  // for a class which does not exist at all stays cheap.
+  ROS_DEBUG_NAMED("pluginlib.ClassLoader", "Class not found in plugin index, recrawling.");
+  std::vector<std::string> paths;
+  ros::package::getPlugins(package_, attrib_name_, paths, false);
+  plugin_index_.setPluginXmlPaths(paths);
+  plugin_xml_paths_indexed_ = false;
+  plugin_xml_paths_ = paths;
+  std::map<std::string, ClassDesc> updated_classes = determineAvailableClasses(plugin_xml_paths_);
+  classes_available_.insert(updated_classes.begin(), updated_classes.end());
+  plugin_index_.save();
+  return true;
 }
 
 template<class T>
@@ -794,6 +868,7 @@ void ClassLoader<T>::refreshDeclaredClasses()
       classes_available_.insert(std::pair<std::string, ClassDesc>(it->first, it->second));
     }
   }
+  plugin_index_.save();
 }
 
 template<class T>
@@ -0,0 +1,613 @@
+/*********************************************************************
+*
+* Software License Agreement (BSD License)
+*
+*  Copyright (c) 2008, Willow Garage, Inc.
+*  All rights reserved.
+*
+*  Redistribution and use in source and binary forms, with or without
+*  modification, are permitted provided that the following conditions
+*  are met:
+*
+*   * Redistributions of source code must retain the above copyright
+*     notice, this list of conditions and the following disclaimer.
+*   * Redistributions in binary form must reproduce the above
+*     copyright notice, this list of conditions and the following
+*     disclaimer in the documentation and/or other materials provided
+*     with the distribution.
+*   * Neither the name of Willow Garage, Inc. nor the names of its
+*     contributors may be used to endorse or promote products derived
+*     from this software without specific prior written permission.
+*
+*  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+*  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+*  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+*  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+*  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+*  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+*  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+*  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+*  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+*  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+*  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+*  POSSIBILITY OF SUCH DAMAGE.
+*
+*********************************************************************/
+
+#ifndef PLUGINLIB__PLUGIN_INDEX_HPP_
+#define PLUGINLIB__PLUGIN_INDEX_HPP_
+
+#include <algorithm>
+#include <cstdlib>
+#include <ctime>
+#include <fstream>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "boost/algorithm/string.hpp"
+#include "boost/filesystem.hpp"
+#include "ros/console.h"
+
+namespace pluginlib
+{
+
+/// A class declared in a plugin manifest, whatever its base class type.
+struct PluginIndexClass
+{
+  std::string lookup_name_;
+  std::string derived_class_;
+  std::string base_class_;
+  std::string description_;
+  std::string library_name_;
+};
+
+/// The contents of a single plugin manifest (plugin XML file).
+struct PluginIndexManifest
+{
+  std::string package_;  // The package exporting the manifest
+  std::vector<PluginIndexClass> classes_;
+};
+
+/// A persistent index of the plugin manifests exported for a package.
+/**
+ * Crawling the package path with ros::package::getPlugins() and parsing every
+ * plugin manifest dominate the construction of a ClassLoader. The index records
+ * the result of both in $ROS_HOME/pluginlib/<package>.<attrib_name>.index, so
+ * that later loaders in this or any other process can skip them.
+ *
+ * Entries are validated against the modification time and size of the files
+ * they were derived from before being used: a manifest is parsed again when it
+ * or the package.xml next to it changed, and the package path is crawled again
+ * when ROS_PACKAGE_PATH, one of its directories, one of the manifests or one of
+ * the exporting packages changed. A package which starts exporting plugins
+ * without touching any of these is picked up by a recrawl when a class cannot
+ * be found, or by ClassLoader::refreshDeclaredClasses().
+ *
+ * Manifests are recorded with all of their classes, so a single index serves
+ * the loaders of every base class of a package. Setting the PLUGINLIB_NO_INDEX
+ * environment variable disables the index.
+ */
+class PluginIndex
+{
+public:
+  /**
+   * \param package The package containing the base class
+   * \param attrib_name The attribute exporting plugin manifests in package.xml files
+   */
+  PluginIndex(const std::string & package, const std::string & attrib_name);
+
+  /// Return whether the index is used, i.e. PLUGINLIB_NO_INDEX is not set.
+  static bool isEnabled();
+
+  /// Return the path of the index file, or an empty string if the index is disabled.
+  const std::string & getIndexPath() const;
+
+  /// Get the plugin manifest paths found by the last crawl, if it is still valid.
+  /**
+   * \param paths Set to the recorded paths on success
+   * \return true if the recorded crawl is still valid, false otherwise
+   */
+  bool getPluginXmlPaths(std::vector<std::string> & paths) const;
+
+  /// Record the plugin manifest paths found by a crawl of the package path.
+  void setPluginXmlPaths(const std::vector<std::string> & paths);
+
+  /// Get the recorded contents of a plugin manifest, if they are still valid.
+  /**
+   * \param xml_file The path to the plugin manifest
+   * \return The recorded contents, or NULL if they are missing or out of date
+   */
+  const PluginIndexManifest * getManifest(const std::string & xml_file) const;
+
+  /// Record the contents of a plugin manifest.
+  /**
+   * \param xml_file The path to the plugin manifest
+   * \param manifest The contents parsed from the plugin manifest
+   * \return The recorded contents
+   */
+  const PluginIndexManifest & setManifest(
+    const std::string & xml_file,
+    const PluginIndexManifest & manifest);
+
+  /// Write the index to disk if it has been modified.
+  /**
+   * The index is written to a temporary file which is then renamed over the
+   * previous one, so concurrent readers never see a partial index.
+   * \return true if the index on disk is up to date, false otherwise
+   */
+  bool save();
+
+private:
+  /// The modification time and size of a file or directory.
+  struct FileStamp
+  {
+    std::time_t mtime_;
+    boost::uintmax_t size_;
+  };
+  typedef std::map<std::string, FileStamp> StampMap;
+
+  struct ManifestEntry
+  {
+    FileStamp stamp_;
+    std::string package_manifest_path_;
+    FileStamp package_manifest_stamp_;
+    PluginIndexManifest manifest_;
+    bool persistent_;  // False if the files were modified too recently to trust their stamps
+  };
+  typedef std::map<std::string, ManifestEntry> ManifestMap;
+
+  /// Stamp a file, failing if it is missing or was modified too recently to be trusted.
+  static bool stampFile(const std::string & path, FileStamp & stamp);
+
+  /// Check that a file still matches a stamp.
+  static bool matchesStamp(const std::string & path, const FileStamp & stamp);
+
+  /// Return the path of the package.xml (or manifest.xml) enclosing a plugin manifest.
+  static std::string findPackageManifest(const std::string & xml_file);
+
+  static std::string getROSPackagePath();
+  static std::string getIndexDirectory();
+
+  static void writeString(std::ostream & out, const std::string & value);
+  static bool readString(std::istream & in, std::string & value);
+  static void writeStamp(std::ostream & out, const FileStamp & stamp);
+  static bool readStamp(std::istream & in, FileStamp & stamp);
+
+  /// Read the index file, keeping it only if it was written for the same package path.
+  bool load();
+  bool read(std::istream & in);
+  void write(std::ostream & out) const;
+
+  std::string package_;
+  std::string attrib_name_;
+  std::string ros_package_path_;
+  std::string index_path_;
+  bool has_plugin_xml_paths_;
+  std::vector<std::string> plugin_xml_paths_;
+  StampMap crawl_stamps_;
+  ManifestMap manifests_;
+  bool dirty_;
+};
+
+// Bump whenever the layout of the index file changes
+static const int PLUGIN_INDEX_VERSION = 1;
+
+inline PluginIndex::PluginIndex(const std::string & package, const std::string & attrib_name)
+: package_(package),
+  attrib_name_(attrib_name),
+  ros_package_path_(getROSPackagePath()),
+  has_plugin_xml_paths_(false),
+  dirty_(false)
+/***************************************************************************/
+{
+  if (isEnabled()) {
+    std::string directory = getIndexDirectory();
+    if (!directory.empty()) {
+      index_path_ = (boost::filesystem::path(directory) /
+        (package_ + "." + attrib_name_ + ".index")).string();
+      load();
+    }
+  }
+}
+
+inline bool PluginIndex::isEnabled()
+/***************************************************************************/
+{
+  const char * env = std::getenv("PLUGINLIB_NO_INDEX");
+  return NULL == env || std::string(env) == "0";
+}
+
+inline const std::string & PluginIndex::getIndexPath() const
+/***************************************************************************/
+{
+  return index_path_;
+}
+
+inline bool PluginIndex::getPluginXmlPaths(std::vector<std::string> & paths) const
+/***************************************************************************/
+{
+  if (!has_plugin_xml_paths_) {
+    return false;
+  }
+  for (StampMap::const_iterator it = crawl_stamps_.begin(); it != crawl_stamps_.end(); ++it) {
+    if (!matchesStamp(it->first, it->second)) {
+      ROS_DEBUG_NAMED("pluginlib.PluginIndex", "%s changed, the package path must be crawled.",
+        it->first.c_str());
+      return false;
+    }
+  }
+  paths = plugin_xml_paths_;
+  return true;
+}
+
+inline void PluginIndex::setPluginXmlPaths(const std::vector<std::string> & paths)
+/***************************************************************************/
+{
+  plugin_xml_paths_ = paths;
+  crawl_stamps_.clear();
+  has_plugin_xml_paths_ = false;
+  dirty_ = true;
+
+  // Forget manifests which are no longer exported
+  for (ManifestMap::iterator it = manifests_.begin(); it != manifests_.end(); ) {
+    if (std::find(paths.begin(), paths.end(), it->first) == paths.end()) {
+      manifests_.erase(it++);
+    } else {
+      ++it;
+    }
+  }
+
+  std::vector<std::string> watched;
+  boost::split(watched, ros_package_path_, boost::is_any_of(
+#ifdef _WIN32
+      ";"
+#else
+      ":"
+#endif
+  ));
+  for (std::vector<std::string>::const_iterator it = paths.begin(); it != paths.end(); ++it) {
+    watched.push_back(*it);
+    watched.push_back(findPackageManifest(*it));
+  }
+  for (std::vector<std::string>::const_iterator it = watched.begin(); it != watched.end(); ++it) {
+    if (it->empty() || crawl_stamps_.count(*it)) {
+      continue;
+    }
+    FileStamp stamp;
+    if (!stampFile(*it, stamp)) {
+      crawl_stamps_.clear();
+      return;
+    }
+    crawl_stamps_[*it] = stamp;
+  }
+  has_plugin_xml_paths_ = true;
+}
+
+inline const PluginIndexManifest * PluginIndex::getManifest(const std::string & xml_file) const
+/***************************************************************************/
+{
+  ManifestMap::const_iterator it = manifests_.find(xml_file);
+  if (it == manifests_.end() || !it->second.persistent_) {
+    return NULL;
+  }
+  const ManifestEntry & entry = it->second;
+  if (!matchesStamp(xml_file, entry.stamp_) ||
+    (!entry.package_manifest_path_.empty() &&
+    !matchesStamp(entry.package_manifest_path_, entry.package_manifest_stamp_)))
+  {
+    return NULL;
+  }
+  return &entry.manifest_;
+}
+
+inline const PluginIndexManifest & PluginIndex::setManifest(
+  const std::string & xml_file,
+  const PluginIndexManifest & manifest)
+/***************************************************************************/
+{
+  ManifestEntry & entry = manifests_[xml_file];
+  entry.manifest_ = manifest;
+  entry.package_manifest_path_ = findPackageManifest(xml_file);
+  entry.package_manifest_stamp_.mtime_ = 0;
+  entry.package_manifest_stamp_.size_ = 0;
+  entry.persistent_ = stampFile(xml_file, entry.stamp_) &&
+    (entry.package_manifest_path_.empty() ||
+    stampFile(entry.package_manifest_path_, entry.package_manifest_stamp_));
+  dirty_ = true;
+  return entry.manifest_;
+}
+
+inline bool PluginIndex::save()
+/***************************************************************************/
+{
+  if (!dirty_ || index_path_.empty()) {
+    return !dirty_;
+  }
+
+  namespace fs = boost::filesystem;
+  boost::system::error_code ec;
+  fs::path index_path(index_path_);
+  fs::create_directories(index_path.parent_path(), ec);
+  fs::path temp_path = index_path.parent_path() / fs::unique_path(
+    index_path.filename().string() + ".%%%%-%%%%-%%%%.tmp");
+  {
+    std::ofstream out(temp_path.string().c_str(), std::ios::out | std::ios::binary);
+    write(out);
+    out.close();
+    if (!out) {
+      ROS_DEBUG_NAMED("pluginlib.PluginIndex", "Could not write plugin index %s.",
+        temp_path.string().c_str());
+      fs::remove(temp_path, ec);
+      return false;
+    }
+  }
+  fs::rename(temp_path, index_path, ec);
+  if (ec) {
+    ROS_DEBUG_NAMED("pluginlib.PluginIndex", "Could not replace plugin index %s: %s.",
+      index_path_.c_str(), ec.message().c_str());
+    fs::remove(temp_path, ec);
+    return false;
+  }
+  ROS_DEBUG_NAMED("pluginlib.PluginIndex", "Wrote plugin index %s.", index_path_.c_str());
+  dirty_ = false;
+  return true;
+}
+
+inline bool PluginIndex::stampFile(const std::string & path, FileStamp & stamp)
+/***************************************************************************/
+{
+  boost::system::error_code ec;
+  boost::filesystem::file_status status = boost::filesystem::status(path, ec);
+  if (ec || !boost::filesystem::exists(status)) {
+    return false;
+  }
+  stamp.mtime_ = boost::filesystem::last_write_time(path, ec);
+  if (ec) {
+    return false;
+  }
+  stamp.size_ = 0;
+  if (boost::filesystem::is_regular_file(status)) {
+    stamp.size_ = boost::filesystem::file_size(path, ec);
+    if (ec) {
+      return false;
+    }
+  }
+  // Modification times have a resolution of a second, so a file modified in the
+  // current second may still change without its stamp changing.
+  return stamp.mtime_ + 1 < std::time(NULL);
+}
+
+inline bool PluginIndex::matchesStamp(const std::string & path, const FileStamp & stamp)
+/***************************************************************************/
+{
+  boost::system::error_code ec;
+  std::time_t mtime = boost::filesystem::last_write_time(path, ec);
+  if (ec || mtime != stamp.mtime_) {
+    return false;
+  }
+  if (boost::filesystem::is_regular_file(path, ec)) {
+    return boost::filesystem::file_size(path, ec) == stamp.size_ && !ec;
+  }
+  return !ec && 0 == stamp.size_;
+}
+
+inline std::string PluginIndex::findPackageManifest(const std::string & xml_file)
+/***************************************************************************/
+{
+  boost::system::error_code ec;
+  boost::filesystem::path parent = boost::filesystem::path(xml_file).parent_path();
+  while (!parent.empty()) {
+    if (boost::filesystem::exists(parent / "package.xml", ec)) {
+      return (parent / "package.xml").string();
+    }
+    if (boost::filesystem::exists(parent / "manifest.xml", ec)) {
+      return (parent / "manifest.xml").string();
+    }
+    parent = parent.parent_path();
+  }
+  return "";
+}
+
+inline std::string PluginIndex::getROSPackagePath()
+/***************************************************************************/
+{
+  const char * env = std::getenv("ROS_PACKAGE_PATH");
+  return env ? env : "";
+}
+
+inline std::string PluginIndex::getIndexDirectory()
+/***************************************************************************/
+{
+  boost::filesystem::path ros_home;
+  if (const char * env = std::getenv("ROS_HOME")) {
+    ros_home = env;
+#ifdef _WIN32
+  } else if (const char * home = std::getenv("USERPROFILE")) {
+#else
+  } else if (const char * home = std::getenv("HOME")) {
+#endif
+    ros_home = boost::filesystem::path(home) / ".ros";
+  } else {
+    return "";
+  }
+  return (ros_home / "pluginlib").string();
+}
+
+inline void PluginIndex::writeString(std::ostream & out, const std::string & value)
+/***************************************************************************/
+{
+  out << value.size() << ':' << value << '\n';
+}
+
+inline bool PluginIndex::readString(std::istream & in, std::string & value)
+/***************************************************************************/
+{
+  size_t size;
+  char separator;
+  if (!(in >> size) || !in.get(separator) || separator != ':' || size > (1u << 24)) {
+    return false;
+  }
+  value.resize(size);
+  if (size > 0 && !in.read(&value[0], size)) {
+    return false;
+  }
+  return in.get(separator) && separator == '\n';
+}
+
+inline void PluginIndex::writeStamp(std::ostream & out, const FileStamp & stamp)
+/***************************************************************************/
+{
+  out << stamp.mtime_ << ' ' << stamp.size_ << '\n';
+}
+
+inline bool PluginIndex::readStamp(std::istream & in, FileStamp & stamp)
+/***************************************************************************/
+{
+  return static_cast<bool>(in >> stamp.mtime_ >> stamp.size_);
+}
+
+inline bool PluginIndex::load()
+/***************************************************************************/
+{
+  std::ifstream in(index_path_.c_str(), std::ios::in | std::ios::binary);
+  if (!in) {
+    return false;
+  }
+  if (!read(in)) {
+    ROS_DEBUG_NAMED("pluginlib.PluginIndex", "Ignoring stale or invalid plugin index %s.",
+      index_path_.c_str());
+    has_plugin_xml_paths_ = false;
+    plugin_xml_paths_.clear();
+    crawl_stamps_.clear();
+    manifests_.clear();
+    return false;
+  }
+  ROS_DEBUG_NAMED("pluginlib.PluginIndex", "Read plugin index %s with %u manifests.",
+    index_path_.c_str(), static_cast<unsigned int>(manifests_.size()));
+  return true;
+}
+
+inline bool PluginIndex::read(std::istream & in)
+/***************************************************************************/
+{
+  std::string magic, package, attrib_name, ros_package_path;
+  int version;
+  if (!(in >> magic >> version) || magic != "pluginlib_index" ||
+    version != PLUGIN_INDEX_VERSION ||
+    !readString(in, package) || package != package_ ||
+    !readString(in, attrib_name) || attrib_name != attrib_name_ ||
+    !readString(in, ros_package_path) || ros_package_path != ros_package_path_ ||
+    !(in >> has_plugin_xml_paths_))
+  {
+    return false;
+  }
+
+  size_t count;
+  if (!(in >> count)) {
+    return false;
+  }
+  plugin_xml_paths_.resize(count);
+  for (size_t i = 0; i < count; ++i) {
+    if (!readString(in, plugin_xml_paths_[i])) {
+      return false;
+    }
+  }
+
+  if (!(in >> count)) {
+    return false;
+  }
+  for (size_t i = 0; i < count; ++i) {
+    std::string path;
+    FileStamp stamp;
+    if (!readString(in, path) || !readStamp(in, stamp)) {
+      return false;
+    }
+    crawl_stamps_[path] = stamp;
+  }
+
+  if (!(in >> count)) {
+    return false;
+  }
+  for (size_t i = 0; i < count; ++i) {
+    std::string xml_file;
+    if (!readString(in, xml_file)) {
+      return false;
+    }
+    ManifestEntry & entry = manifests_[xml_file];
+    size_t class_count;
+    if (!readStamp(in, entry.stamp_) ||
+      !readString(in, entry.package_manifest_path_) ||
+      !readStamp(in, entry.package_manifest_stamp_) ||
+      !readString(in, entry.manifest_.package_) ||
+      !(in >> class_count))
+    {
+      return false;
+    }
+    entry.persistent_ = true;
+    entry.manifest_.classes_.resize(class_count);
+    for (size_t c = 0; c < class_count; ++c) {
+      PluginIndexClass & plugin_class = entry.manifest_.classes_[c];
+      if (!readString(in, plugin_class.lookup_name_) ||
+        !readString(in, plugin_class.derived_class_) ||
+        !readString(in, plugin_class.base_class_) ||
+        !readString(in, plugin_class.description_) ||
+        !readString(in, plugin_class.library_name_))
+      {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+inline void PluginIndex::write(std::ostream & out) const
+/***************************************************************************/
+{
+  out << "pluginlib_index " << PLUGIN_INDEX_VERSION << '\n';
+  writeString(out, package_);
+  writeString(out, attrib_name_);
+  writeString(out, ros_package_path_);
+  out << has_plugin_xml_paths_ << '\n';
+
+  out << plugin_xml_paths_.size() << '\n';
+  for (size_t i = 0; i < plugin_xml_paths_.size(); ++i) {
+    writeString(out, plugin_xml_paths_[i]);
+  }
+
+  out << crawl_stamps_.size() << '\n';
+  for (StampMap::const_iterator it = crawl_stamps_.begin(); it != crawl_stamps_.end(); ++it) {
+    writeString(out, it->first);
+    writeStamp(out, it->second);
+  }
+
+  size_t count = 0;
+  for (ManifestMap::const_iterator it = manifests_.begin(); it != manifests_.end(); ++it) {
+    count += it->second.persistent_ ? 1 : 0;
+  }
+  out << count << '\n';
+  for (ManifestMap::const_iterator it = manifests_.begin(); it != manifests_.end(); ++it) {
+    const ManifestEntry & entry = it->second;
+    if (!entry.persistent_) {
+      continue;
+    }
+    writeString(out, it->first);
+    writeStamp(out, entry.stamp_);
+    writeString(out, entry.package_manifest_path_);
+    writeStamp(out, entry.package_manifest_stamp_);
+    writeString(out, entry.manifest_.package_);
+    out << entry.manifest_.classes_.size() << '\n';
+    for (size_t c = 0; c < entry.manifest_.classes_.size(); ++c) {
+      const PluginIndexClass & plugin_class = entry.manifest_.classes_[c];
+      writeString(out, plugin_class.lookup_name_);
+      writeString(out, plugin_class.derived_class_);
+      writeString(out, plugin_class.base_class_);
+      writeString(out, plugin_class.description_);
+      writeString(out, plugin_class.library_name_);
+    }
+  }
+}
+
+}  // namespace pluginlib
+
+#endif  // PLUGINLIB__PLUGIN_INDEX_HPP_
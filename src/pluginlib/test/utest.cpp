@@ -29,6 +29,12 @@
 
 #include <gtest/gtest.h>
 
+#include <cstdlib>
+#include <ctime>
+#include <fstream>
+#include <string>
+#include <vector>
+
 #include <pluginlib/class_loader.hpp>
 
 #include "./test_base.h"
@@ -132,6 +138,98 @@ TEST(PluginlibTest, brokenXML) {
   ADD_FAILURE() << "Didn't throw exception as expected";
 }
 
+TEST(PluginlibTest, indexedClassLoader) {
+  namespace fs = boost::filesystem;
+  fs::path dir = fs::temp_directory_path() / fs::unique_path("pluginlib_index_%%%%-%%%%");
+  fs::create_directories(dir);
+
+  const char * ros_home = std::getenv("ROS_HOME");
+  std::string saved_ros_home = ros_home ? ros_home : "";
+  setenv("ROS_HOME", dir.string().c_str(), 1);
+
+  {
+    // The second loader is constructed from the index written by the first one
+    pluginlib::ClassLoader<test_base::Fubar> first_loader("pluginlib", "test_base::Fubar");
+    pluginlib::ClassLoader<test_base::Fubar> test_loader("pluginlib", "test_base::Fubar");
+    EXPECT_EQ(first_loader.getPluginXmlPaths(), test_loader.getPluginXmlPaths());
+    EXPECT_EQ(first_loader.getDeclaredClasses(), test_loader.getDeclaredClasses());
+    EXPECT_EQ("This is a foo plugin.", test_loader.getClassDescription("pluginlib/foo"));
+    EXPECT_EQ("test_plugins::Bar", test_loader.getClassType("pluginlib/bar"));
+    EXPECT_EQ("pluginlib", test_loader.getClassPackage("pluginlib/bar"));
+    EXPECT_FALSE(test_loader.isClassAvailable("pluginlib/foobar"));
+
+    boost::shared_ptr<test_base::Fubar> foo = test_loader.createInstance("pluginlib/foo");
+    foo->initialize(10.0);
+    EXPECT_EQ(100.0, foo->result());
+  }
+
+  if (ros_home) {
+    setenv("ROS_HOME", saved_ros_home.c_str(), 1);
+  } else {
+    unsetenv("ROS_HOME");
+  }
+  fs::remove_all(dir);
+}
+
+TEST(PluginlibTest, pluginIndex) {
+  namespace fs = boost::filesystem;
+  fs::path dir = fs::temp_directory_path() / fs::unique_path("pluginlib_index_%%%%-%%%%");
+  fs::create_directories(dir / "test_pkg");
+  std::string xml_file = (dir / "test_pkg" / "plugins.xml").string();
+  std::ofstream(xml_file.c_str()) << "<library path=\"lib/libtest\"/>";
+  std::ofstream((dir / "test_pkg" / "package.xml").string().c_str()) << "<package/>";
+
+  // Stamps of files modified within the last second are not trusted
+  std::time_t mtime = std::time(NULL) - 10;
+  fs::last_write_time(xml_file, mtime);
+  fs::last_write_time(dir / "test_pkg" / "package.xml", mtime);
+
+  const char * ros_home = std::getenv("ROS_HOME");
+  std::string saved_ros_home = ros_home ? ros_home : "";
+  setenv("ROS_HOME", dir.string().c_str(), 1);
+
+  pluginlib::PluginIndexManifest manifest;
+  manifest.package_ = "test_pkg";
+  pluginlib::PluginIndexClass plugin_class;
+  plugin_class.lookup_name_ = "test_pkg/foo";
+  plugin_class.derived_class_ = "test_pkg::Foo";
+  plugin_class.base_class_ = "test_base::Fubar";
+  plugin_class.description_ = "Spans\nlines: 3:";
+  plugin_class.library_name_ = "lib/libtest";
+  manifest.classes_.push_back(plugin_class);
+  {
+    pluginlib::PluginIndex index("pluginlib", "plugin_index_test");
+    std::vector<std::string> paths;
+    EXPECT_FALSE(index.getPluginXmlPaths(paths));
+    EXPECT_TRUE(NULL == index.getManifest(xml_file));
+    index.setManifest(xml_file, manifest);
+    EXPECT_EQ(pluginlib::PluginIndex::isEnabled(), index.save());
+  }
+
+  pluginlib::PluginIndex index("pluginlib", "plugin_index_test");
+  if (pluginlib::PluginIndex::isEnabled()) {
+    const pluginlib::PluginIndexManifest * indexed = index.getManifest(xml_file);
+    ASSERT_TRUE(NULL != indexed);
+    EXPECT_EQ("test_pkg", indexed->package_);
+    ASSERT_EQ(1u, indexed->classes_.size());
+    EXPECT_EQ("test_pkg::Foo", indexed->classes_[0].derived_class_);
+    EXPECT_EQ("Spans\nlines: 3:", indexed->classes_[0].description_);
+
+    // Touching the manifest invalidates its entry
+    fs::last_write_time(xml_file, mtime + 1);
+    EXPECT_TRUE(NULL == index.getManifest(xml_file));
+  } else {
+    EXPECT_TRUE(NULL == index.getManifest(xml_file));
+  }
+
+  if (ros_home) {
+    setenv("ROS_HOME", saved_ros_home.c_str(), 1);
+  } else {
+    unsetenv("ROS_HOME");
+  }
+  fs::remove_all(dir);
+}
+
 // Run all the tests that were declared with TEST()
 int main(int argc, char ** argv)
 {
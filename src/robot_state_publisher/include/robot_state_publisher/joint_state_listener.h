@@ -40,6 +40,7 @@
 #include <memory>
 #include <map>
 #include <string>
+#include <vector>
 
 #include <boost/scoped_ptr.hpp>
 #include <urdf/model.h>
@@ -74,6 +75,9 @@ public:
 private:
   std::string getTFPrefix();
 
+  /// Rebuilds the joint names, mimic joints and publish times used for messages with these names
+  void compileJointNames(const std::vector<std::string>& names);
+
 protected:
   virtual void callbackJointState(const JointStateConstPtr& state);
   virtual void callbackFixedJoint(const ros::TimerEvent& e);
@@ -83,10 +87,25 @@ protected:
   ros::Subscriber joint_state_sub_;
   ros::Timer timer_;
   ros::Time last_callback_time_;
+  /// Entries are reset but never erased, last_publish_time_its_ points into it
   std::map<std::string, ros::Time> last_publish_time_;
   MimicMap mimic_;
   bool use_tf_static_;
   bool ignore_timestamp_;
+  std::string tf_prefix_key_;
+
+  struct CompiledMimic
+  {
+    size_t source_index;
+    double multiplier;
+    double offset;
+  };
+
+  /// The names of the last joint state message, followed by the mimic joints they drive
+  std::vector<std::string> joint_names_;
+  std::vector<double> joint_positions_;
+  std::vector<CompiledMimic> mimic_joints_;
+  std::vector<std::map<std::string, ros::Time>::iterator> last_publish_time_its_;
 
 };
 }
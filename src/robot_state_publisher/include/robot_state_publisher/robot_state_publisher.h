@@ -39,11 +39,13 @@
 
 #include <map>
 #include <string>
+#include <vector>
 
 #include <ros/ros.h>
 #include <urdf/model.h>
 #include <tf2_ros/static_transform_broadcaster.h>
 #include <tf2_ros/transform_broadcaster.h>
+#include <tf2_msgs/TFMessage.h>
 #include <kdl/frames.hpp>
 #include <kdl/segment.hpp>
 #include <kdl/tree.hpp>
@@ -88,13 +90,41 @@ public:
   void publishTransforms(const std::map<std::string, double>& joint_positions, const ros::Time& time, const std::string & tf_prefix);
   void publishFixedTransforms(const std::string & tf_prefix, bool use_tf_static = false);
 
+  /** Publish transforms to tf for joints given in message order
+   * The segment of each joint and its prefixed frame ids are looked up once and kept
+   * until the joint names or tf_prefix change, and the published message is reused,
+   * so publishing the same joints again does not allocate.
+   * \param joint_names The joint names. Only the first occurrence of a name is published.
+   * \param joint_positions The joint positions, in the order of joint_names
+   * \param time The time at which the joint positions were recorded
+   * \param tf_prefix The tf_prefix prepended to the frame ids
+   */
+  void publishTransforms(const std::vector<std::string>& joint_names, const std::vector<double>& joint_positions,
+                         const ros::Time& time, const std::string & tf_prefix);
+
 protected:
   virtual void addChildren(const KDL::SegmentMap::const_iterator segment);
 
+  /// Rebuilds the joint table and message used by the message order publishTransforms()
+  void compileJoints(const std::vector<std::string>& joint_names, const std::string & tf_prefix);
+
   std::map<std::string, SegmentPair> segments_, segments_fixed_;
   urdf::Model model_;
   tf2_ros::TransformBroadcaster tf_broadcaster_;
   tf2_ros::StaticTransformBroadcaster static_tf_broadcaster_;
+
+  /// A joint of compiled_joint_names_ with a moving segment, published as tf_message_.transforms[i]
+  struct CompiledJoint
+  {
+    size_t position_index;
+    const KDL::Segment* segment;
+  };
+
+  std::vector<std::string> compiled_joint_names_;
+  std::string compiled_tf_prefix_;
+  std::vector<CompiledJoint> compiled_joints_;
+  std::vector<size_t> unknown_joints_;
+  tf2_msgs::TFMessage tf_message_;
 };
 
 }
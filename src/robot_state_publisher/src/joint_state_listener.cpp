@@ -37,6 +37,7 @@
 #include <algorithm>
 #include <map>
 #include <string>
+#include <vector>
 
 #include <ros/ros.h>
 #include <urdf/model.h>
@@ -71,6 +72,7 @@ JointStateListener::JointStateListener(const std::shared_ptr<RobotStatePublisher
   // ignore_timestamp_ == true, joins_states messages are accepted, no matter their timestamp
   n_tilde.param("ignore_timestamp", ignore_timestamp_, false);
   // get the tf_prefix parameter from the closest namespace
+  n_tilde.searchParam("tf_prefix", tf_prefix_key_);
   publish_interval_ = ros::Duration(1.0/std::max(publish_freq, 1.0));
 
   // Setting tcpNoNelay tells the subscriber to ask publishers that connect
@@ -92,17 +94,41 @@ JointStateListener::~JointStateListener()
 
 std::string JointStateListener::getTFPrefix()
 {
-  ros::NodeHandle n_tilde("~");
   std::string tf_prefix;
 
-  // get the tf_prefix parameter from the closest namespace
-  std::string tf_prefix_key;
-  n_tilde.searchParam("tf_prefix", tf_prefix_key);
-  n_tilde.param(tf_prefix_key, tf_prefix, std::string(""));
+  // the key was resolved at construction, the value is kept up to date by the parameter server
+  if (tf_prefix_key_.empty() || !ros::param::getCached(tf_prefix_key_, tf_prefix)) {
+    tf_prefix.clear();
+  }
 
   return tf_prefix;
 }
 
+void JointStateListener::compileJointNames(const std::vector<std::string>& names)
+{
+  joint_names_ = names;
+  mimic_joints_.clear();
+
+  // a mimic joint is published if its joint is, unless the message already contains it
+  for (MimicMap::const_iterator i = mimic_.begin(); i != mimic_.end(); i++) {
+    std::vector<std::string>::const_iterator source = std::find(joint_names_.begin(), joint_names_.end(), i->second->joint_name);
+    if (source != joint_names_.end() && std::find(joint_names_.begin(), joint_names_.end(), i->first) == joint_names_.end()) {
+      CompiledMimic mimic;
+      mimic.source_index = source - joint_names_.begin();
+      mimic.multiplier = i->second->multiplier;
+      mimic.offset = i->second->offset;
+      mimic_joints_.push_back(mimic);
+      joint_names_.push_back(i->first);
+    }
+  }
+  joint_positions_.resize(joint_names_.size());
+
+  last_publish_time_its_.clear();
+  for (size_t i = 0; i < names.size(); ++i) {
+    last_publish_time_its_.push_back(last_publish_time_.insert(std::make_pair(names[i], ros::Time())).first);
+  }
+}
+
 void JointStateListener::callbackFixedJoint(const ros::TimerEvent& e)
 {
   (void)e;
@@ -130,7 +156,9 @@ void JointStateListener::callbackJointState(const JointStateConstPtr& state)
   if (last_callback_time_ > now) {
     // force re-publish of joint transforms
     ROS_WARN("Moved backwards in time (probably because ROS clock was reset), re-publishing joint transforms!");
-    last_publish_time_.clear();
+    for (std::map<std::string, ros::Time>::iterator it = last_publish_time_.begin(); it != last_publish_time_.end(); ++it) {
+      it->second = ros::Time();
+    }
   }
   ros::Duration warning_threshold(30.0);
   if ((state->header.stamp + warning_threshold) < now) {
@@ -138,10 +166,17 @@ void JointStateListener::callbackJointState(const JointStateConstPtr& state)
   }
   last_callback_time_ = now;
 
+  // the joint names usually repeat from message to message, only look them up when they change
+  const size_t num_joints = state->name.size();
+  if (joint_names_.size() != num_joints + mimic_joints_.size() ||
+      !std::equal(state->name.begin(), state->name.end(), joint_names_.begin())) {
+    compileJointNames(state->name);
+  }
+
   // determine least recently published joint
   ros::Time last_published = now;
-  for (size_t i = 0; i < state->name.size(); ++i) {
-    ros::Time t = last_publish_time_[state->name[i]];
+  for (size_t i = 0; i < num_joints; ++i) {
+    ros::Time t = last_publish_time_its_[i]->second;
     last_published = (t < last_published) ? t : last_published;
   }
   // note: if a joint was seen for the first time,
@@ -149,24 +184,18 @@ void JointStateListener::callbackJointState(const JointStateConstPtr& state)
 
   // check if we need to publish
   if (ignore_timestamp_ || state->header.stamp >= last_published + publish_interval_) {
-    // get joint positions from state message
-    std::map<std::string, double> joint_positions;
-    for (size_t i = 0; i < state->name.size(); ++i) {
-      joint_positions.insert(make_pair(state->name[i], state->position[i]));
-    }
-
-    for (MimicMap::iterator i = mimic_.begin(); i != mimic_.end(); i++) {
-      if(joint_positions.find(i->second->joint_name) != joint_positions.end()) {
-        double pos = joint_positions[i->second->joint_name] * i->second->multiplier + i->second->offset;
-        joint_positions.insert(make_pair(i->first, pos));
-      }
+    // get joint positions from state message, mimic joints follow in the order they were compiled
+    std::copy(state->position.begin(), state->position.end(), joint_positions_.begin());
+    for (size_t i = 0; i < mimic_joints_.size(); ++i) {
+      const CompiledMimic& mimic = mimic_joints_[i];
+      joint_positions_[num_joints + i] = joint_positions_[mimic.source_index] * mimic.multiplier + mimic.offset;
     }
 
-    state_publisher_->publishTransforms(joint_positions, state->header.stamp, getTFPrefix());
+    state_publisher_->publishTransforms(joint_names_, joint_positions_, state->header.stamp, getTFPrefix());
 
     // store publish time in joint map
-    for (size_t i = 0; i<state->name.size(); ++i) {
-      last_publish_time_[state->name[i]] = state->header.stamp;
+    for (size_t i = 0; i < num_joints; ++i) {
+      last_publish_time_its_[i]->second = state->header.stamp;
     }
   }
 }
@@ -34,8 +34,10 @@
 
 /* Author: Wim Meeussen */
 
+#include <algorithm>
 #include <map>
 #include <string>
+#include <vector>
 
 #include <kdl/frames_io.hpp>
 #include <geometry_msgs/TransformStamped.h>
@@ -141,6 +143,66 @@ void RobotStatePublisher::publishTransforms(const std::map<std::string, double>&
   tf_broadcaster_.sendTransform(tf_transforms);
 }
 
+// look up the segments of joints given in message order
+void RobotStatePublisher::compileJoints(const std::vector<std::string>& joint_names, const std::string & tf_prefix)
+{
+  ROS_DEBUG("Compiling joint table for %zu joints", joint_names.size());
+  compiled_joint_names_ = joint_names;
+  compiled_tf_prefix_ = tf_prefix;
+  compiled_joints_.clear();
+  unknown_joints_.clear();
+  tf_message_.transforms.clear();
+
+  for (size_t i = 0; i < joint_names.size(); ++i) {
+    // like inserting into a map, the first occurrence of a joint wins
+    if (std::find(joint_names.begin(), joint_names.begin() + i, joint_names[i]) != joint_names.begin() + i) {
+      continue;
+    }
+    std::map<std::string, SegmentPair>::const_iterator seg = segments_.find(joint_names[i]);
+    if (seg != segments_.end()) {
+      CompiledJoint joint;
+      joint.position_index = i;
+      joint.segment = &seg->second.segment;
+      compiled_joints_.push_back(joint);
+
+      geometry_msgs::TransformStamped tf_transform;
+      tf_transform.header.frame_id = prefix_frame(tf_prefix, seg->second.root);
+      tf_transform.child_frame_id = prefix_frame(tf_prefix, seg->second.tip);
+      tf_message_.transforms.push_back(tf_transform);
+    }
+    else {
+      unknown_joints_.push_back(i);
+    }
+  }
+}
+
+// publish moving transforms in message order
+void RobotStatePublisher::publishTransforms(const std::vector<std::string>& joint_names, const std::vector<double>& joint_positions,
+                                            const ros::Time& time, const std::string & tf_prefix)
+{
+  ROS_DEBUG("Publishing transforms for moving joints");
+  if (joint_positions.size() < joint_names.size()) {
+    ROS_ERROR("Received %zu joint positions for %zu joints", joint_positions.size(), joint_names.size());
+    return;
+  }
+  if (joint_names != compiled_joint_names_ || tf_prefix != compiled_tf_prefix_) {
+    compileJoints(joint_names, tf_prefix);
+  }
+
+  for (size_t i = 0; i < unknown_joints_.size(); ++i) {
+    ROS_WARN_THROTTLE(10, "Joint state with name: \"%s\" was received but not found in URDF", joint_names[unknown_joints_[i]].c_str());
+  }
+
+  // only the stamp and the transform change between messages
+  for (size_t i = 0; i < compiled_joints_.size(); ++i) {
+    const CompiledJoint& joint = compiled_joints_[i];
+    geometry_msgs::TransformStamped& tf_transform = tf_message_.transforms[i];
+    tf_transform.header.stamp = time;
+    tf_transform.transform = tf2::kdlToTransform(joint.segment->pose(joint_positions[joint.position_index])).transform;
+  }
+  tf_broadcaster_.sendTransform(tf_message_);
+}
+
 // publish fixed transforms
 void RobotStatePublisher::publishFixedTransforms(const std::string & tf_prefix, bool use_tf_static)
 {
@@ -0,0 +1,247 @@
+/*********************************************************************
+* Software License Agreement (BSD License)
+*
+*  Copyright (c) 2008, Willow Garage, Inc.
+*  All rights reserved.
+*
+*  Redistribution and use in source and binary forms, with or without
+*  modification, are permitted provided that the following conditions
+*  are met:
+*
+*   * Redistributions of source code must retain the above copyright
+*     notice, this list of conditions and the following disclaimer.
+*   * Redistributions in binary form must reproduce the above
+*     copyright notice, this list of conditions and the following
+*     disclaimer in the documentation and/or other materials provided
+*     with the distribution.
+*   * Neither the name of the Willow Garage nor the names of its
+*     contributors may be used to endorse or promote products derived
+*     from this software without specific prior written permission.
+*
+*  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+*  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+*  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+*  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+*  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+*  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+*  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+*  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+*  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+*  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+*  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+*  POSSIBILITY OF SUCH DAMAGE.
+*********************************************************************/
+
+/*
+ * Checks that the message order publishTransforms() and its compiled joint table publish the
+ * same transforms as the map based publishTransforms(), also through JointStateListener with
+ * mimic joints.
+ */
+
+#include <algorithm>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+#include <ros/ros.h>
+#include <geometry_msgs/TransformStamped.h>
+#include <sensor_msgs/JointState.h>
+#include <tf2_msgs/TFMessage.h>
+#include <urdf/model.h>
+#include <kdl_parser/kdl_parser.hpp>
+
+#include "robot_state_publisher/joint_state_listener.h"
+#include "robot_state_publisher/robot_state_publisher.h"
+
+using namespace robot_state_publisher;
+
+#define EPS 1e-9
+
+typedef std::vector<geometry_msgs::TransformStamped> V_Transform;
+
+bool childFrameLess(const geometry_msgs::TransformStamped& a, const geometry_msgs::TransformStamped& b)
+{
+  return a.child_frame_id < b.child_frame_id;
+}
+
+// Compares everything but the stamps, in any order
+void expectSameTransforms(V_Transform expected, V_Transform actual)
+{
+  std::sort(expected.begin(), expected.end(), childFrameLess);
+  std::sort(actual.begin(), actual.end(), childFrameLess);
+  ASSERT_EQ(expected.size(), actual.size());
+  for (size_t i = 0; i < expected.size(); ++i) {
+    EXPECT_EQ(expected[i].header.frame_id, actual[i].header.frame_id);
+    EXPECT_EQ(expected[i].child_frame_id, actual[i].child_frame_id);
+    EXPECT_NEAR(expected[i].transform.translation.x, actual[i].transform.translation.x, EPS);
+    EXPECT_NEAR(expected[i].transform.translation.y, actual[i].transform.translation.y, EPS);
+    EXPECT_NEAR(expected[i].transform.translation.z, actual[i].transform.translation.z, EPS);
+    EXPECT_NEAR(expected[i].transform.rotation.x, actual[i].transform.rotation.x, EPS);
+    EXPECT_NEAR(expected[i].transform.rotation.y, actual[i].transform.rotation.y, EPS);
+    EXPECT_NEAR(expected[i].transform.rotation.z, actual[i].transform.rotation.z, EPS);
+    EXPECT_NEAR(expected[i].transform.rotation.w, actual[i].transform.rotation.w, EPS);
+  }
+}
+
+class TestJointTable : public testing::Test
+{
+protected:
+  void SetUp()
+  {
+    ASSERT_TRUE(model_.initParam("robot_description"));
+    ASSERT_TRUE(kdl_parser::treeFromUrdfModel(model_, tree_));
+    state_pub_ = std::make_shared<RobotStatePublisher>(tree_, model_);
+
+    tf_sub_ = n_.subscribe("tf", 100, &TestJointTable::callbackTF, this);
+    for (unsigned int i = 0; i < 100 && tf_sub_.getNumPublishers() == 0; i++) {
+      ros::WallDuration(0.05).sleep();
+    }
+    ASSERT_GT(tf_sub_.getNumPublishers(), 0U);
+  }
+
+  void callbackTF(const tf2_msgs::TFMessage::ConstPtr& msg)
+  {
+    for (size_t i = 0; i < msg->transforms.size(); ++i) {
+      received_[msg->transforms[i].header.stamp].push_back(msg->transforms[i]);
+    }
+  }
+
+  // Every publish gets its own stamp, so the transforms of one publish are those with its stamp
+  V_Transform waitForTransforms(const ros::Time& stamp)
+  {
+    for (unsigned int i = 0; i < 100 && !received_.count(stamp); i++) {
+      ros::spinOnce();
+      ros::WallDuration(0.05).sleep();
+    }
+    EXPECT_TRUE(received_.count(stamp)) << "no transforms stamped " << stamp;
+    return received_[stamp];
+  }
+
+  V_Transform publishMap(const std::map<std::string, double>& joint_positions, const std::string& tf_prefix)
+  {
+    ros::Time stamp(++stamp_sec_, 0);
+    state_pub_->publishTransforms(joint_positions, stamp, tf_prefix);
+    return waitForTransforms(stamp);
+  }
+
+  V_Transform publishTable(const std::vector<std::string>& joint_names, const std::vector<double>& joint_positions,
+                           const std::string& tf_prefix)
+  {
+    ros::Time stamp(++stamp_sec_, 0);
+    state_pub_->publishTransforms(joint_names, joint_positions, stamp, tf_prefix);
+    return waitForTransforms(stamp);
+  }
+
+  // The map the message order overload stands for, where the first occurrence of a name wins
+  static std::map<std::string, double> toMap(const std::vector<std::string>& joint_names,
+                                             const std::vector<double>& joint_positions)
+  {
+    std::map<std::string, double> joint_map;
+    for (size_t i = 0; i < joint_names.size(); ++i) {
+      joint_map.insert(std::make_pair(joint_names[i], joint_positions[i]));
+    }
+    return joint_map;
+  }
+
+  ros::NodeHandle n_;
+  urdf::Model model_;
+  KDL::Tree tree_;
+  std::shared_ptr<RobotStatePublisher> state_pub_;
+  ros::Subscriber tf_sub_;
+  std::map<ros::Time, V_Transform> received_;
+  int stamp_sec_ = 0;
+};
+
+TEST_F(TestJointTable, matchesMap)
+{
+  std::vector<std::string> names = {"joint1", "joint2", "joint3"};
+  std::vector<double> positions = {0.3, 0.7, -0.2};
+
+  V_Transform table = publishTable(names, positions, "");
+  EXPECT_EQ(3U, table.size());
+  expectSameTransforms(publishMap(toMap(names, positions), ""), table);
+
+  // the compiled table is reused for new positions
+  positions = {-1.1, 0.05, 2.5};
+  expectSameTransforms(publishMap(toMap(names, positions), ""), publishTable(names, positions, ""));
+}
+
+TEST_F(TestJointTable, duplicateAndUnknownJoints)
+{
+  std::vector<std::string> names = {"joint2", "unknown_joint", "joint1", "joint2"};
+  std::vector<double> positions = {0.1, 5.0, 0.4, 0.9};
+
+  V_Transform table = publishTable(names, positions, "");
+  EXPECT_EQ(2U, table.size());
+  expectSameTransforms(publishMap(toMap(names, positions), ""), table);
+}
+
+TEST_F(TestJointTable, rebuiltOnChange)
+{
+  std::vector<std::string> names = {"joint1", "joint2"};
+  std::vector<double> positions = {0.3, 0.7};
+  expectSameTransforms(publishMap(toMap(names, positions), ""), publishTable(names, positions, ""));
+
+  // a new tf_prefix changes the frame ids
+  expectSameTransforms(publishMap(toMap(names, positions), "robot"), publishTable(names, positions, "robot"));
+  expectSameTransforms(publishMap(toMap(names, positions), "/other"), publishTable(names, positions, "/other"));
+  expectSameTransforms(publishMap(toMap(names, positions), ""), publishTable(names, positions, ""));
+
+  // and new joint names the segments
+  names = {"joint2", "joint1"};
+  expectSameTransforms(publishMap(toMap(names, positions), ""), publishTable(names, positions, ""));
+  names = {"joint3"};
+  positions = {1.5};
+  expectSameTransforms(publishMap(toMap(names, positions), ""), publishTable(names, positions, ""));
+}
+
+TEST_F(TestJointTable, mimicJoints)
+{
+  MimicMap mimic;
+  for (std::map<std::string, urdf::JointSharedPtr>::iterator i = model_.joints_.begin(); i != model_.joints_.end(); i++) {
+    if (i->second->mimic) {
+      mimic.insert(make_pair(i->first, i->second->mimic));
+    }
+  }
+  ASSERT_EQ(1U, mimic.size());
+  JointStateListener listener(state_pub_, mimic);
+
+  ros::Publisher js_pub = n_.advertise<sensor_msgs::JointState>("joint_states", 10);
+  for (unsigned int i = 0; i < 100 && js_pub.getNumSubscribers() == 0; i++) {
+    ros::WallDuration(0.05).sleep();
+  }
+  ASSERT_GT(js_pub.getNumSubscribers(), 0U);
+
+  // joint3 follows joint1 with a multiplier of 2 and an offset of 0.5
+  sensor_msgs::JointState js_msg;
+  js_msg.name = {"joint1", "joint2"};
+  js_msg.position = {0.3, 0.7};
+  js_msg.header.stamp = ros::Time(++stamp_sec_, 0);
+  js_pub.publish(js_msg);
+  std::map<std::string, double> expected = {{"joint1", 0.3}, {"joint2", 0.7}, {"joint3", 0.3 * 2.0 + 0.5}};
+  V_Transform published = waitForTransforms(js_msg.header.stamp);
+  EXPECT_EQ(3U, published.size());
+  expectSameTransforms(publishMap(expected, ""), published);
+
+  // a mimic joint in the message is not overwritten
+  js_msg.name = {"joint1", "joint3"};
+  js_msg.position = {0.3, 0.1};
+  js_msg.header.stamp = ros::Time(++stamp_sec_, 0);
+  js_pub.publish(js_msg);
+  expected = {{"joint1", 0.3}, {"joint3", 0.1}};
+  published = waitForTransforms(js_msg.header.stamp);
+  EXPECT_EQ(2U, published.size());
+  expectSameTransforms(publishMap(expected, ""), published);
+}
+
+int main(int argc, char** argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  ros::init(argc, argv, "test_joint_table");
+
+  int res = RUN_ALL_TESTS();
+
+  return res;
+}
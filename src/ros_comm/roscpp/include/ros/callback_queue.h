@@ -36,6 +36,7 @@
 #define ROSCPP_CALLBACK_QUEUE_H
 
 #include "ros/callback_queue_interface.h"
+#include "ros/latency_histogram.h"
 #include "ros/time.h"
 #include "common.h"
 
@@ -132,6 +133,11 @@ public:
    */
   bool isEnabled();
 
+  /**
+   * \brief Appends the latencies from addCallback() to the start of a callback, and of the callbacks, of every queue
+   */
+  static void getLatencyStatistics(V_LatencyStatistics& stats);
+
 protected:
   void setupTLS();
 
@@ -157,6 +163,8 @@ protected:
     CallbackInterfacePtr callback;
     uint64_t removal_id;
     bool marked_for_removal;
+    // zero unless latency statistics are enabled
+    ros::SteadyTime add_time;
   };
   typedef std::list<CallbackInfo> L_CallbackInfo;
   typedef std::deque<CallbackInfo> D_CallbackInfo;
@@ -181,6 +189,10 @@ protected:
   boost::thread_specific_ptr<TLS> tls_;
 
   bool enabled_;
+
+  uint32_t latency_id_;
+  LatencyHistogram queue_latency_;
+  LatencyHistogram callback_latency_;
 };
 typedef boost::shared_ptr<CallbackQueue> CallbackQueuePtr;
 
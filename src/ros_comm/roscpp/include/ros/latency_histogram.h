@@ -0,0 +1,135 @@
+/*
+ * Copyright (C) 2009, Willow Garage, Inc.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *   * Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the names of Willow Garage, Inc. nor the names of its
+ *     contributors may be used to endorse or promote products derived from
+ *     this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef ROSCPP_LATENCY_HISTOGRAM_H
+#define ROSCPP_LATENCY_HISTOGRAM_H
+
+#include "common.h"
+
+#include <boost/atomic.hpp>
+
+#include <string>
+#include <vector>
+
+namespace ros
+{
+
+/**
+ * \brief A histogram of latencies in nanoseconds, which can be recorded into from several threads without locking.
+ *
+ * Buckets are spaced like an HDR histogram: values below 16ns get a bucket each, above that every power of two is
+ * split into 16 buckets, which bounds the relative error of a bucket to 1/16.  Values of 2^43ns (about 2.4 hours)
+ * and above share the last bucket.
+ *
+ * Recording is only done if latency statistics are enabled by the /enable_latency_statistics parameter, which
+ * ros::start() reads.  The histograms of subscriptions and callback queues can then be read through the
+ * ~get_latency_statistics service of the node.  The buckets are allocated by the first record(), so a histogram
+ * which never records, as is the case while latency statistics are disabled, stays small.
+ */
+class ROSCPP_DECL LatencyHistogram
+{
+public:
+  static const size_t SUB_BUCKET_BITS = 4;
+  static const size_t SUB_BUCKETS = 1 << SUB_BUCKET_BITS;
+  static const size_t MAX_EXPONENT = 43;
+  static const size_t NUM_BUCKETS = (MAX_EXPONENT - SUB_BUCKET_BITS + 1) * SUB_BUCKETS;
+
+  /**
+   * \brief A copy of the counts of a histogram, or the sum of several
+   */
+  struct ROSCPP_DECL Snapshot
+  {
+    Snapshot();
+
+    /// Adds the counts of another snapshot
+    void merge(const Snapshot& other);
+    /// Returns the upper bound of the bucket holding the given fraction (0-1) of the recorded values, or 0 if empty
+    uint64_t percentile(double fraction) const;
+
+    uint64_t count;
+    uint64_t sum;
+    uint64_t max;
+    std::vector<uint64_t> buckets;
+  };
+
+  LatencyHistogram();
+  ~LatencyHistogram();
+
+  /**
+   * \brief Records a latency.  Negative latencies, e.g. from unsynchronized clocks, are ignored.
+   */
+  void record(int64_t nanoseconds);
+  /**
+   * \brief Copies the current counts.  Values recorded concurrently may or may not be included.
+   */
+  void snapshot(Snapshot& out) const;
+
+  static size_t bucketIndex(uint64_t nanoseconds);
+  /// Returns the exclusive upper bound of a bucket, in nanoseconds
+  static uint64_t bucketUpperBound(size_t index);
+
+  static bool isEnabled() { return s_enabled_.load(boost::memory_order_relaxed); }
+  static void setEnabled(bool enabled) { s_enabled_.store(enabled, boost::memory_order_relaxed); }
+
+private:
+  struct Buckets
+  {
+    Buckets();
+
+    boost::atomic<uint64_t> counts[NUM_BUCKETS];
+  };
+
+  LatencyHistogram(const LatencyHistogram&);
+  LatencyHistogram& operator=(const LatencyHistogram&);
+
+  /// Returns the buckets, allocating them if this is the first record
+  Buckets* getBuckets();
+
+  boost::atomic<uint64_t> count_;
+  boost::atomic<uint64_t> sum_;
+  boost::atomic<uint64_t> max_;
+  boost::atomic<Buckets*> buckets_;
+
+  static boost::atomic<bool> s_enabled_;
+};
+
+/**
+ * \brief A snapshot of one stage of message delivery, as reported by the ~get_latency_statistics service
+ */
+struct LatencyStatistics
+{
+  /// The subscribed topic, or the callback queue
+  std::string source;
+  /// "transport", "queue" or "callback"
+  std::string stage;
+  LatencyHistogram::Snapshot histogram;
+};
+typedef std::vector<LatencyStatistics> V_LatencyStatistics;
+
+}
+
+#endif
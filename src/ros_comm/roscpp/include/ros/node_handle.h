@@ -2101,6 +2101,16 @@ if (service)  // Enter if advertised service is valid
    */
   bool getParamNames(std::vector<std::string>& keys) const;
 
+  /** \brief Fetch a whole namespace of parameters into the local cache
+   *
+   * After a single call to the master, getParam(), getParamCached(), param() and
+   * hasParam() for keys below the namespace are answered locally.  See ros::param::prefetch().
+   *
+   * \param ns The namespace to fetch, relative to this NodeHandle.  Defaults to the namespace of this NodeHandle.
+   * \return true if the namespace was fetched, false otherwise
+   */
+  bool prefetchParams(const std::string& ns = std::string()) const;
+
   /** \brief Assign value from parameter server, with default.
    *
    * This method tries to retrieve the indicated parameter value from the
@@ -591,6 +591,22 @@ ROSCPP_DECL bool search(const std::string& key, std::string& result);
  */
 ROSCPP_DECL bool getParamNames(std::vector<std::string>& keys);
 
+/** \brief Fetch a whole namespace of parameters into the local cache
+ *
+ * A single call to the master retrieves every parameter below the namespace
+ * and subscribes to updates of the namespace.  Afterwards get(), getCached()
+ * and has() for the namespace and any key below it are answered from the
+ * local copy, which the master keeps current the same way as for getCached().
+ * Call this before reading many parameters of one namespace, e.g. the
+ * private parameters of a node at startup.
+ *
+ * \param ns The namespace to fetch
+ *
+ * \return true if the namespace was fetched, false otherwise
+ * \throws InvalidNameException if the namespace is not a valid graph resource name
+ */
+ROSCPP_DECL bool prefetch(const std::string& ns);
+
 /**
  * \brief Unsubscribe cached parameter from the master
  * \param key the cached parameter to be unsubscribed
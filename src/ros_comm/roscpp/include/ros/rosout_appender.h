@@ -44,6 +44,8 @@
 
 #include <boost/thread.hpp>
 
+#include <vector>
+
 namespace rosgraph_msgs
 {
 ROS_DECLARE_MESSAGE(Log);
@@ -67,17 +69,44 @@ public:
   virtual void log(::ros::console::Level level, const char* str, const char* file, const char* function, int line);
 
 protected:
+  /**
+   * \brief A log call as queued by log(). Slots are reused, so their strings keep their capacity between bursts.
+   */
+  struct LogRecord
+  {
+    ::ros::console::Level level;
+    ros::Time stamp;
+    std::string msg;
+    std::string file;
+    std::string function;
+    int line;
+  };
+  typedef std::vector<LogRecord> V_LogRecord;
+
   void logThread();
+  void publishBatch(const V_LogRecord& batch, size_t count, uint64_t dropped);
+  bool takeBudget(::ros::console::Level level, size_t bytes);
 
   std::string last_error_;
 
-  typedef std::vector<rosgraph_msgs::LogPtr> V_Log;
-  V_Log log_queue_;
+  V_LogRecord log_queue_;
+  size_t queued_;                 ///< Number of filled slots at the front of log_queue_
+  size_t max_queue_size_;         ///< Slots after which log() drops messages below Error, 0 for unbounded
+  uint64_t dropped_;              ///< Messages dropped by log() since the last batch
   boost::mutex queue_mutex_;
   boost::condition_variable queue_condition_;
   bool shutting_down_;
   bool disable_topics_;
 
+  // Per-node budget, as token buckets refilled at the configured rates. Only touched by the publish thread.
+  double message_rate_limit_;
+  double byte_rate_limit_;
+  double message_budget_;
+  double byte_budget_;
+  WallTime last_refill_;
+  uint64_t suppressed_;
+  bool collapse_repeats_;
+
   boost::thread publish_thread_;
 };
 
@@ -35,6 +35,7 @@
 #include "ros/transport_hints.h"
 #include "ros/xmlrpc_manager.h"
 #include "ros/statistics.h"
+#include "ros/latency_histogram.h"
 #include "xmlrpcpp/XmlRpc.h"
 
 #include <boost/thread.hpp>
@@ -95,6 +96,10 @@ public:
   bool isDropped() { return dropped_; }
   XmlRpc::XmlRpcValue getStats();
   void getInfo(XmlRpc::XmlRpcValue& info);
+  /**
+   * \brief Appends the transport, queue and callback latencies of this subscription, summed over its callbacks
+   */
+  void getLatencyStatistics(V_LatencyStatistics& stats);
 
   bool addCallback(const SubscriptionCallbackHelperPtr& helper, const std::string& md5sum, CallbackQueueInterface* queue, int32_t queue_size, const VoidConstPtr& tracked_object, bool allow_concurrent_callbacks);
   void removeCallback(const SubscriptionCallbackHelperPtr& helper);
@@ -227,6 +232,8 @@ private:
   TransportHints transport_hints_;
 
   StatisticsLogger statistics_;
+  // header stamp to receipt, for serialized messages with a header
+  LatencyHistogram transport_latency_;
 
   struct LatchInfo
   {
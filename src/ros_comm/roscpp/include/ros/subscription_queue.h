@@ -32,6 +32,7 @@
 #include "common.h"
 #include "ros/message_event.h"
 #include "callback_queue_interface.h"
+#include "latency_histogram.h"
 
 #include <boost/thread/recursive_mutex.hpp>
 #include <boost/thread/mutex.hpp>
@@ -60,6 +61,8 @@ private:
 
     bool nonconst_need_copy;
     ros::Time receipt_time;
+    // zero unless latency statistics are enabled
+    ros::SteadyTime push_time;
   };
   typedef std::deque<Item> D_Item;
 
@@ -76,6 +79,11 @@ public:
   virtual bool ready();
   bool full();
 
+  /**
+   * \brief Adds the latencies from push() to the start of the callback, and of the callback, to the snapshots
+   */
+  void getLatency(LatencyHistogram::Snapshot& queue, LatencyHistogram::Snapshot& callback) const;
+
 private:
   bool fullNoLock();
   std::string topic_;
@@ -88,6 +96,9 @@ private:
   bool allow_concurrent_callbacks_;
 
   boost::recursive_mutex callback_mutex_;
+
+  LatencyHistogram queue_latency_;
+  LatencyHistogram callback_latency_;
 };
 
 }
@@ -36,12 +36,12 @@
 #include <boost/thread/thread.hpp>
 #include <boost/thread/mutex.hpp>
 #include <boost/thread/recursive_mutex.hpp>
+#include <boost/unordered_map.hpp>
 
 #include "ros/assert.h"
 #include "ros/callback_queue_interface.h"
 
 #include <vector>
-#include <list>
 
 namespace ros
 {
@@ -95,14 +95,18 @@ private:
 
     bool oneshot;
 
+    // position in waiting_, or -1 while not waiting to fire. Protected by waiting_mutex_
+    int32_t waiting_index;
+    // insertion order into waiting_, so timers due at the same time fire first-in first-out
+    uint64_t waiting_order;
+
     // debugging info
     uint32_t total_calls;
   };
   typedef boost::shared_ptr<TimerInfo> TimerInfoPtr;
   typedef boost::weak_ptr<TimerInfo> TimerInfoWPtr;
   typedef std::vector<TimerInfoPtr> V_TimerInfo;
-
-  typedef std::list<int32_t> L_int32;
+  typedef boost::unordered_map<int32_t, TimerInfoPtr> M_TimerInfo;
 
 public:
   TimerManager();
@@ -123,18 +127,30 @@ public:
 private:
   void threadFunc();
 
-  bool waitingCompare(int32_t lhs, int32_t rhs);
   TimerInfoPtr findTimer(int32_t handle);
   void schedule(const TimerInfoPtr& info);
   void updateNext(const TimerInfoPtr& info, const T& current_time);
 
-  V_TimerInfo timers_;
+  // waiting_ is a binary min-heap on (next_expected, waiting_order) with each TimerInfo
+  // tracking its own position, so that insertion, removal and rescheduling are O(log n).
+  // All of these require both timers_mutex_ and waiting_mutex_.
+  bool waitingLess(const TimerInfoPtr& lhs, const TimerInfoPtr& rhs) const;
+  void waitingPush(const TimerInfoPtr& info);
+  void waitingRemove(const TimerInfoPtr& info);
+  void waitingUpdate(const TimerInfoPtr& info);
+  void waitingRebuild();
+  void waitingSiftUp(size_t index);
+  void waitingSiftDown(size_t index);
+  void waitingPlace(const TimerInfoPtr& info, size_t index);
+
+  M_TimerInfo timers_;
   boost::mutex timers_mutex_;
   boost::condition_variable timers_cond_;
   volatile bool new_timer_;
 
   boost::mutex waiting_mutex_;
-  L_int32 waiting_;
+  V_TimerInfo waiting_;
+  uint64_t waiting_counter_;
 
   uint32_t id_counter_;
   boost::mutex id_mutex_;
@@ -232,7 +248,7 @@ private:
 
 template<class T, class D, class E>
 TimerManager<T, D, E>::TimerManager() :
-  new_timer_(false), id_counter_(0), thread_started_(false), quit_(false)
+  new_timer_(false), waiting_counter_(0), id_counter_(0), thread_started_(false), quit_(false)
 {
 #if !defined(BOOST_THREAD_HAS_CONDATTR_SET_CLOCK_MONOTONIC) && !defined(BOOST_THREAD_INTERNAL_CLOCK_IS_MONO)
   ROS_ASSERT_MSG(false,
@@ -258,32 +274,144 @@ TimerManager<T, D, E>::~TimerManager()
 }
 
 template<class T, class D, class E>
-bool TimerManager<T, D, E>::waitingCompare(int32_t lhs, int32_t rhs)
+typename TimerManager<T, D, E>::TimerInfoPtr TimerManager<T, D, E>::findTimer(int32_t handle)
 {
-  TimerInfoPtr infol = findTimer(lhs);
-  TimerInfoPtr infor = findTimer(rhs);
-  if (!infol || !infor)
+  typename M_TimerInfo::iterator it = timers_.find(handle);
+  if (it != timers_.end())
   {
-    return infol < infor;
+    return it->second;
   }
 
-  return infol->next_expected < infor->next_expected;
+  return TimerInfoPtr();
 }
 
 template<class T, class D, class E>
-typename TimerManager<T, D, E>::TimerInfoPtr TimerManager<T, D, E>::findTimer(int32_t handle)
+bool TimerManager<T, D, E>::waitingLess(const TimerInfoPtr& lhs, const TimerInfoPtr& rhs) const
 {
-  typename V_TimerInfo::iterator it = timers_.begin();
-  typename V_TimerInfo::iterator end = timers_.end();
-  for (; it != end; ++it)
+  if (lhs->next_expected != rhs->next_expected)
   {
-    if ((*it)->handle == handle)
+    return lhs->next_expected < rhs->next_expected;
+  }
+
+  return lhs->waiting_order < rhs->waiting_order;
+}
+
+template<class T, class D, class E>
+void TimerManager<T, D, E>::waitingPlace(const TimerInfoPtr& info, size_t index)
+{
+  waiting_[index] = info;
+  info->waiting_index = index;
+}
+
+template<class T, class D, class E>
+void TimerManager<T, D, E>::waitingSiftUp(size_t index)
+{
+  TimerInfoPtr info = waiting_[index];
+  while (index > 0)
+  {
+    size_t parent = (index - 1) / 2;
+    if (!waitingLess(info, waiting_[parent]))
     {
-      return *it;
+      break;
     }
+
+    waitingPlace(waiting_[parent], index);
+    index = parent;
   }
 
-  return TimerInfoPtr();
+  waitingPlace(info, index);
+}
+
+template<class T, class D, class E>
+void TimerManager<T, D, E>::waitingSiftDown(size_t index)
+{
+  TimerInfoPtr info = waiting_[index];
+  size_t size = waiting_.size();
+  while (true)
+  {
+    size_t child = 2 * index + 1;
+    if (child >= size)
+    {
+      break;
+    }
+
+    if (child + 1 < size && waitingLess(waiting_[child + 1], waiting_[child]))
+    {
+      ++child;
+    }
+
+    if (!waitingLess(waiting_[child], info))
+    {
+      break;
+    }
+
+    waitingPlace(waiting_[child], index);
+    index = child;
+  }
+
+  waitingPlace(info, index);
+}
+
+template<class T, class D, class E>
+void TimerManager<T, D, E>::waitingPush(const TimerInfoPtr& info)
+{
+  if (info->waiting_index >= 0)
+  {
+    waitingUpdate(info);
+    return;
+  }
+
+  info->waiting_order = waiting_counter_++;
+  waiting_.push_back(info);
+  waitingSiftUp(waiting_.size() - 1);
+}
+
+template<class T, class D, class E>
+void TimerManager<T, D, E>::waitingRemove(const TimerInfoPtr& info)
+{
+  if (info->waiting_index < 0)
+  {
+    return;
+  }
+
+  size_t index = info->waiting_index;
+  info->waiting_index = -1;
+
+  TimerInfoPtr last = waiting_.back();
+  waiting_.pop_back();
+  if (index < waiting_.size())
+  {
+    waitingPlace(last, index);
+    waitingUpdate(last);
+  }
+}
+
+template<class T, class D, class E>
+void TimerManager<T, D, E>::waitingUpdate(const TimerInfoPtr& info)
+{
+  if (info->waiting_index < 0)
+  {
+    return;
+  }
+
+  size_t index = info->waiting_index;
+  if (index > 0 && waitingLess(info, waiting_[(index - 1) / 2]))
+  {
+    waitingSiftUp(index);
+  }
+  else
+  {
+    waitingSiftDown(index);
+  }
+}
+
+template<class T, class D, class E>
+void TimerManager<T, D, E>::waitingRebuild()
+{
+  for (size_t i = waiting_.size() / 2; i-- > 0;)
+  {
+    waitingSiftDown(i);
+  }
 }
 
 template<class T, class D, class E>
@@ -325,6 +453,8 @@ int32_t TimerManager<T, D, E>::add(const D& period, const boost::function<void(c
   info->waiting_callbacks = 0;
   info->total_calls = 0;
   info->oneshot = oneshot;
+  info->waiting_index = -1;
+  info->waiting_order = 0;
   if (tracked_object)
   {
     info->tracked_object = tracked_object;
@@ -338,7 +468,7 @@ int32_t TimerManager<T, D, E>::add(const D& period, const boost::function<void(c
 
   {
     boost::mutex::scoped_lock lock(timers_mutex_);
-    timers_.push_back(info);
+    timers_[info->handle] = info;
 
     if (!thread_started_)
     {
@@ -348,8 +478,7 @@ int32_t TimerManager<T, D, E>::add(const D& period, const boost::function<void(c
 
     {
       boost::mutex::scoped_lock lock(waiting_mutex_);
-      waiting_.push_back(info->handle);
-      waiting_.sort(boost::bind(&TimerManager::waitingCompare, this, boost::placeholders::_1, boost::placeholders::_2));
+      waitingPush(info);
     }
 
     new_timer_ = true;
@@ -368,29 +497,18 @@ void TimerManager<T, D, E>::remove(int32_t handle)
   {
     boost::mutex::scoped_lock lock(timers_mutex_);
 
-    typename V_TimerInfo::iterator it = timers_.begin();
-    typename V_TimerInfo::iterator end = timers_.end();
-    for (; it != end; ++it)
+    typename M_TimerInfo::iterator it = timers_.find(handle);
+    if (it != timers_.end())
     {
-      const TimerInfoPtr& info = *it;
-      if (info->handle == handle)
-      {
-        info->removed = true;
-        callback_queue = info->callback_queue;
-        remove_id = (uint64_t)info.get();
-        timers_.erase(it);
-        break;
-      }
-    }
+      const TimerInfoPtr info = it->second;
+      info->removed = true;
+      callback_queue = info->callback_queue;
+      remove_id = (uint64_t)info.get();
+      timers_.erase(it);
 
-    {
       boost::mutex::scoped_lock lock2(waiting_mutex_);
       // Remove from the waiting list if it's in it
-      L_int32::iterator it = std::find(waiting_.begin(), waiting_.end(), handle);
-      if (it != waiting_.end())
-      {
-        waiting_.erase(it);
-      }
+      waitingRemove(info);
     }
   }
 
@@ -414,9 +532,8 @@ void TimerManager<T, D, E>::schedule(const TimerInfoPtr& info)
   {
     boost::mutex::scoped_lock lock(waiting_mutex_);
 
-    waiting_.push_back(info->handle);
-    // waitingCompare requires a lock on the timers_mutex_
-    waiting_.sort(boost::bind(&TimerManager::waitingCompare, this, boost::placeholders::_1, boost::placeholders::_2));
+    // waitingPush requires a lock on the timers_mutex_
+    waitingPush(info);
   }
 
   new_timer_ = true;
@@ -490,7 +607,7 @@ void TimerManager<T, D, E>::setPeriod(int32_t handle, const D& period, bool rese
     // In this case, let next_expected be updated only in updateNext
     
     info->period = period;
-    waiting_.sort(boost::bind(&TimerManager::waitingCompare, this, boost::placeholders::_1, boost::placeholders::_2));
+    waitingUpdate(info);
   }
 
   new_timer_ = true;
@@ -514,11 +631,11 @@ void TimerManager<T, D, E>::threadFunc()
 
       current = T::now();
 
-      typename V_TimerInfo::iterator it = timers_.begin();
-      typename V_TimerInfo::iterator end = timers_.end();
+      typename M_TimerInfo::iterator it = timers_.begin();
+      typename M_TimerInfo::iterator end = timers_.end();
       for (; it != end; ++it)
       {
-        const TimerInfoPtr& info = *it;
+        const TimerInfoPtr& info = it->second;
 
         // Timer may have been added after the time jump, so also check if time has jumped past its last call time
         if (current < info->last_expected)
@@ -527,6 +644,10 @@ void TimerManager<T, D, E>::threadFunc()
           info->next_expected = current + info->period;
         }
       }
+
+      // Any number of keys may have changed, so restore the heap order in one pass
+      boost::mutex::scoped_lock waitlock(waiting_mutex_);
+      waitingRebuild();
     }
 
     current = T::now();
@@ -540,7 +661,7 @@ void TimerManager<T, D, E>::threadFunc()
       }
       else
       {
-        TimerInfoPtr info = findTimer(waiting_.front());
+        TimerInfoPtr info = waiting_.front();
 
         while (!waiting_.empty() && info && info->next_expected <= current)
         {
@@ -550,14 +671,14 @@ void TimerManager<T, D, E>::threadFunc()
           CallbackInterfacePtr cb(boost::make_shared<TimerQueueCallback>(this, info, info->last_expected, info->last_real, info->next_expected, info->last_expired, current));
           info->callback_queue->addCallback(cb, (uint64_t)info.get());
 
-          waiting_.pop_front();
+          waitingRemove(info);
 
           if (waiting_.empty())
           {
             break;
           }
 
-          info = findTimer(waiting_.front());
+          info = waiting_.front();
         }
 
         if (info)
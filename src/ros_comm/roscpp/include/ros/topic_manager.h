@@ -31,6 +31,7 @@
 #include "forwards.h"
 #include "common.h"
 #include "ros/serialization.h"
+#include "ros/latency_histogram.h"
 #include "rosout_appender.h"
 
 #include "xmlrpcpp/XmlRpcValue.h"
@@ -89,6 +90,14 @@ public:
    */
   void getSubscribedTopics(V_string& topics);
 
+  /** @brief Collect the latency histograms of every subscription
+   *
+   * Appends the transport, queue and callback histograms of each
+   * subscription to stats.  Only populated while latency statistics
+   * are enabled.
+   */
+  void getLatencyStatistics(V_LatencyStatistics& stats);
+
   /** @brief Lookup an advertised topic.
    *
    * This method iterates over advertised_topics, looking for one with name
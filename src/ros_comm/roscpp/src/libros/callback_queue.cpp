@@ -34,20 +34,78 @@
 
 #include "ros/callback_queue.h"
 #include "ros/assert.h"
+#include "ros/init.h"
+#include <boost/lexical_cast.hpp>
 #include <boost/scope_exit.hpp>
 
+#include <set>
+
 namespace ros
 {
 
+namespace
+{
+
+// The queues whose latencies are reported.  Never destroyed, as queues may outlive static destruction.
+struct LatencyRegistry
+{
+  LatencyRegistry() : next_id(0) {}
+
+  boost::mutex mutex;
+  std::set<CallbackQueue*> queues;
+  uint32_t next_id;
+};
+
+LatencyRegistry& getLatencyRegistry()
+{
+  static LatencyRegistry* registry = new LatencyRegistry;
+  return *registry;
+}
+
+}
+
 CallbackQueue::CallbackQueue(bool enabled)
 : calling_(0)
 , enabled_(enabled)
 {
+  LatencyRegistry& registry = getLatencyRegistry();
+  boost::mutex::scoped_lock lock(registry.mutex);
+  latency_id_ = registry.next_id++;
+  registry.queues.insert(this);
 }
 
 CallbackQueue::~CallbackQueue()
 {
   disable();
+
+  LatencyRegistry& registry = getLatencyRegistry();
+  boost::mutex::scoped_lock lock(registry.mutex);
+  registry.queues.erase(this);
+}
+
+void CallbackQueue::getLatencyStatistics(V_LatencyStatistics& stats)
+{
+  CallbackQueue* global_queue = getGlobalCallbackQueue();
+
+  LatencyRegistry& registry = getLatencyRegistry();
+  boost::mutex::scoped_lock lock(registry.mutex);
+  for (std::set<CallbackQueue*>::const_iterator it = registry.queues.begin(); it != registry.queues.end(); ++it)
+  {
+    CallbackQueue* queue = *it;
+    std::string source = queue == global_queue ? "global_callback_queue" : "callback_queue_" + boost::lexical_cast<std::string>(queue->latency_id_);
+
+    LatencyStatistics wait;
+    wait.source = source;
+    wait.stage = "queue";
+    queue->queue_latency_.snapshot(wait.histogram);
+    stats.push_back(wait);
+
+    LatencyStatistics callback;
+    callback.source = source;
+    callback.stage = "callback";
+    queue->callback_latency_.snapshot(callback.histogram);
+    stats.push_back(callback);
+  }
 }
 
 void CallbackQueue::enable()
@@ -100,6 +158,10 @@ void CallbackQueue::addCallback(const CallbackInterfacePtr& callback, uint64_t r
   CallbackInfo info;
   info.callback = callback;
   info.removal_id = removal_id;
+  if (LatencyHistogram::isEnabled())
+  {
+    info.add_time = ros::SteadyTime::now();
+  }
 
   {
     boost::mutex::scoped_lock lock(id_info_mutex_);
@@ -407,7 +469,21 @@ CallbackQueue::CallOneResult CallbackQueue::callOneCB(TLS* tls)
       else
       {
         tls->cb_it = tls->callbacks.erase(tls->cb_it);
-        result = cb->call();
+        if (info.add_time.isZero())
+        {
+          result = cb->call();
+        }
+        else
+        {
+          ros::SteadyTime start = ros::SteadyTime::now();
+          result = cb->call();
+          // callbacks which were not ready are queued again, and only counted once they ran
+          if (result == CallbackInterface::Success)
+          {
+            queue_latency_.record((start - info.add_time).toNSec());
+            callback_latency_.record((ros::SteadyTime::now() - start).toNSec());
+          }
+        }
       }
     }
 
@@ -48,8 +48,10 @@
 #include "ros/subscribe_options.h"
 #include "ros/transport/transport_tcp.h"
 #include "ros/internal_timer_manager.h"
+#include "ros/latency_histogram.h"
 #include "xmlrpcpp/XmlRpcSocket.h"
 
+#include "roscpp/GetLatencyStatistics.h"
 #include "roscpp/GetLoggers.h"
 #include "roscpp/SetLoggerLevel.h"
 #include "roscpp/Empty.h"
@@ -246,6 +248,38 @@ bool setLoggerLevel(roscpp::SetLoggerLevel::Request& req, roscpp::SetLoggerLevel
   return success;
 }
 
+bool getLatencyStatistics(roscpp::GetLatencyStatistics::Request&, roscpp::GetLatencyStatistics::Response& resp)
+{
+  V_LatencyStatistics stats;
+  TopicManager::instance()->getLatencyStatistics(stats);
+  CallbackQueue::getLatencyStatistics(stats);
+
+  resp.histograms.resize(stats.size());
+  for (size_t i = 0; i < stats.size(); ++i)
+  {
+    const LatencyHistogram::Snapshot& snapshot = stats[i].histogram;
+    roscpp::LatencyHistogram& histogram = resp.histograms[i];
+    histogram.source = stats[i].source;
+    histogram.stage = stats[i].stage;
+    histogram.count = snapshot.count;
+    histogram.sum = snapshot.sum;
+    histogram.max = snapshot.max;
+    histogram.p50 = snapshot.percentile(0.5);
+    histogram.p90 = snapshot.percentile(0.9);
+    histogram.p99 = snapshot.percentile(0.99);
+    histogram.p999 = snapshot.percentile(0.999);
+    for (size_t b = 0; b < snapshot.buckets.size(); ++b)
+    {
+      if (snapshot.buckets[b] > 0)
+      {
+        histogram.bucket_bounds.push_back(LatencyHistogram::bucketUpperBound(b));
+        histogram.bucket_counts.push_back(snapshot.buckets[b]);
+      }
+    }
+  }
+  return true;
+}
+
 bool closeAllConnections(roscpp::Empty::Request&, roscpp::Empty::Response&)
 {
   ROSCPP_LOG_DEBUG("close_all_connections service called, closing connections");
@@ -319,6 +353,10 @@ void start()
 
   param::param("/tcp_keepalive", TransportTCP::s_use_keepalive_, TransportTCP::s_use_keepalive_);
 
+  bool enable_latency_statistics = false;
+  param::param("/enable_latency_statistics", enable_latency_statistics, enable_latency_statistics);
+  LatencyHistogram::setEnabled(enable_latency_statistics);
+
   PollManager::instance()->addPollThreadListener(checkForShutdown);
   XMLRPCManager::instance()->bind("shutdown", shutdownCallback);
 
@@ -386,6 +424,16 @@ void start()
 
   if (g_shutting_down) goto end;
 
+  if (enable_latency_statistics)
+  {
+    ros::AdvertiseServiceOptions ops;
+    ops.init<roscpp::GetLatencyStatistics>(names::resolve("~get_latency_statistics"), getLatencyStatistics);
+    ops.callback_queue = getInternalCallbackQueue().get();
+    ServiceManager::instance()->advertiseService(ops);
+  }
+
+  if (g_shutting_down) goto end;
+
   {
     bool use_sim_time = false;
     if (!(g_init_options & init_options::NoSimTime))
@@ -0,0 +1,195 @@
+/*
+ * Copyright (C) 2009, Willow Garage, Inc.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *   * Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the names of Willow Garage, Inc. nor the names of its
+ *     contributors may be used to endorse or promote products derived from
+ *     this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "ros/latency_histogram.h"
+
+#include <algorithm>
+
+namespace ros
+{
+
+const size_t LatencyHistogram::SUB_BUCKET_BITS;
+const size_t LatencyHistogram::SUB_BUCKETS;
+const size_t LatencyHistogram::MAX_EXPONENT;
+const size_t LatencyHistogram::NUM_BUCKETS;
+
+boost::atomic<bool> LatencyHistogram::s_enabled_(false);
+
+LatencyHistogram::Snapshot::Snapshot()
+: count(0)
+, sum(0)
+, max(0)
+, buckets(NUM_BUCKETS, 0)
+{
+}
+
+void LatencyHistogram::Snapshot::merge(const Snapshot& other)
+{
+  count += other.count;
+  sum += other.sum;
+  max = std::max(max, other.max);
+  for (size_t i = 0; i < NUM_BUCKETS; ++i)
+  {
+    buckets[i] += other.buckets[i];
+  }
+}
+
+uint64_t LatencyHistogram::Snapshot::percentile(double fraction) const
+{
+  // the counts of a snapshot taken while recording may not add up to count exactly
+  uint64_t total = 0;
+  for (size_t i = 0; i < NUM_BUCKETS; ++i)
+  {
+    total += buckets[i];
+  }
+  if (total == 0)
+  {
+    return 0;
+  }
+
+  uint64_t rank = std::max<uint64_t>(1, static_cast<uint64_t>(fraction * total + 0.5));
+  uint64_t seen = 0;
+  for (size_t i = 0; i < NUM_BUCKETS; ++i)
+  {
+    seen += buckets[i];
+    if (seen >= rank)
+    {
+      // the bound of the last bucket is below the values clamped into it
+      return std::min(bucketUpperBound(i), max);
+    }
+  }
+  return max;
+}
+
+LatencyHistogram::Buckets::Buckets()
+{
+  for (size_t i = 0; i < NUM_BUCKETS; ++i)
+  {
+    counts[i].store(0, boost::memory_order_relaxed);
+  }
+}
+
+LatencyHistogram::LatencyHistogram()
+: count_(0)
+, sum_(0)
+, max_(0)
+, buckets_(NULL)
+{
+}
+
+LatencyHistogram::~LatencyHistogram()
+{
+  delete buckets_.load(boost::memory_order_acquire);
+}
+
+LatencyHistogram::Buckets* LatencyHistogram::getBuckets()
+{
+  Buckets* buckets = buckets_.load(boost::memory_order_acquire);
+  if (buckets)
+  {
+    return buckets;
+  }
+
+  // two threads may record the first value at once, the one losing the exchange uses the other's buckets
+  Buckets* allocated = new Buckets;
+  if (buckets_.compare_exchange_strong(buckets, allocated, boost::memory_order_acq_rel, boost::memory_order_acquire))
+  {
+    return allocated;
+  }
+  delete allocated;
+  return buckets;
+}
+
+void LatencyHistogram::record(int64_t nanoseconds)
+{
+  if (nanoseconds < 0)
+  {
+    return;
+  }
+
+  uint64_t value = static_cast<uint64_t>(nanoseconds);
+  getBuckets()->counts[bucketIndex(value)].fetch_add(1, boost::memory_order_relaxed);
+  sum_.fetch_add(value, boost::memory_order_relaxed);
+  count_.fetch_add(1, boost::memory_order_relaxed);
+
+  uint64_t max = max_.load(boost::memory_order_relaxed);
+  while (value > max && !max_.compare_exchange_weak(max, value, boost::memory_order_relaxed))
+  {
+  }
+}
+
+void LatencyHistogram::snapshot(Snapshot& out) const
+{
+  const Buckets* buckets = buckets_.load(boost::memory_order_acquire);
+  out.count = count_.load(boost::memory_order_relaxed);
+  out.sum = sum_.load(boost::memory_order_relaxed);
+  out.max = max_.load(boost::memory_order_relaxed);
+  out.buckets.resize(NUM_BUCKETS);
+  for (size_t i = 0; i < NUM_BUCKETS; ++i)
+  {
+    out.buckets[i] = buckets ? buckets->counts[i].load(boost::memory_order_relaxed) : 0;
+  }
+}
+
+size_t LatencyHistogram::bucketIndex(uint64_t nanoseconds)
+{
+  if (nanoseconds < SUB_BUCKETS)
+  {
+    return static_cast<size_t>(nanoseconds);
+  }
+
+  // floor(log2(nanoseconds)) by binary search over the bit positions
+  size_t exponent = 0;
+  for (size_t shift = 32; shift > 0; shift /= 2)
+  {
+    if ((nanoseconds >> (exponent + shift)) != 0)
+    {
+      exponent += shift;
+    }
+  }
+  if (exponent >= MAX_EXPONENT)
+  {
+    return NUM_BUCKETS - 1;
+  }
+
+  size_t sub_bucket = static_cast<size_t>(nanoseconds >> (exponent - SUB_BUCKET_BITS)) & (SUB_BUCKETS - 1);
+  return (exponent - SUB_BUCKET_BITS + 1) * SUB_BUCKETS + sub_bucket;
+}
+
+uint64_t LatencyHistogram::bucketUpperBound(size_t index)
+{
+  if (index < SUB_BUCKETS)
+  {
+    return index + 1;
+  }
+
+  size_t exponent = index / SUB_BUCKETS + SUB_BUCKET_BITS - 1;
+  uint64_t sub_bucket = index % SUB_BUCKETS;
+  return (SUB_BUCKETS + sub_bucket + 1) << (exponent - SUB_BUCKET_BITS);
+}
+
+}
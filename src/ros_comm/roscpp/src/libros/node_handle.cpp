@@ -639,6 +639,11 @@ bool NodeHandle::getParamNames(std::vector<std::string>& keys) const
   return param::getParamNames(keys);
 }
 
+bool NodeHandle::prefetchParams(const std::string& ns) const
+{
+  return param::prefetch(resolveName(ns));
+}
+
 bool NodeHandle::getParam(const std::string& key, XmlRpc::XmlRpcValue& v) const
 {
   return param::get(resolveName(key), v);
@@ -34,10 +34,14 @@
 #include <ros/console.h>
 
 #include <boost/thread/recursive_mutex.hpp>
+#include <boost/thread/shared_mutex.hpp>
+#include <boost/thread/locks.hpp>
 #include <boost/lexical_cast.hpp>
 
 #include <vector>
 #include <map>
+#include <list>
+#include <utility>
 
 namespace ros
 {
@@ -50,6 +54,21 @@ M_Param g_params;
 boost::recursive_mutex g_params_mutex;
 S_string g_subscribed_params;
 
+// Namespaces fetched by prefetch(), each mapped to the parameter tree below it.  Lookups only take
+// a shared lock, the trees are kept current by set(), del() and parameter updates from the master.
+M_Param g_prefetched;
+boost::shared_mutex g_prefetched_mutex;
+
+// A prefetch() waiting on the master, with the updates to its namespace that arrived meanwhile.  They
+// are applied to the fetched tree once it is installed, as it may predate them.
+struct PendingPrefetch
+{
+  std::string ns;
+  std::vector<std::pair<std::string, XmlRpc::XmlRpcValue> > updates;
+};
+typedef std::list<PendingPrefetch> L_PendingPrefetch;
+L_PendingPrefetch g_pending_prefetches;
+
 void invalidateParentParams(const std::string& key)
 {
   std::string ns_key = names::parentNamespace(key);
@@ -64,6 +83,211 @@ void invalidateParentParams(const std::string& key)
   }
 }
 
+bool isInNamespace(const std::string& key, const std::string& ns)
+{
+  if (ns == "/")
+  {
+    return true;
+  }
+  return key.compare(0, ns.size(), ns) == 0 && (key.size() == ns.size() || key[ns.size()] == '/');
+}
+
+// Steps through the names of a resolved key below ns, e.g. "b" and "c" for [/a/b/c] in [/a]
+size_t firstName(const std::string& ns)
+{
+  return ns == "/" ? 0 : ns.size();
+}
+
+bool nextName(const std::string& key, size_t& pos, std::string& name)
+{
+  while (pos < key.size())
+  {
+    size_t end = key.find('/', pos + 1);
+    if (end == std::string::npos)
+    {
+      end = key.size();
+    }
+    name.assign(key, pos + 1, end - pos - 1);
+    pos = end;
+    if (!name.empty())
+    {
+      return true;
+    }
+  }
+  return false;
+}
+
+// Returns the value of key in the tree of namespace ns, or NULL if it is not set
+const XmlRpc::XmlRpcValue* findInTree(const XmlRpc::XmlRpcValue& tree, const std::string& ns, const std::string& key)
+{
+  const XmlRpc::XmlRpcValue* value = &tree;
+  size_t pos = firstName(ns);
+  std::string name;
+  while (nextName(key, pos, name))
+  {
+    if (value->getType() != XmlRpc::XmlRpcValue::TypeStruct || !value->hasMember(name))
+    {
+      return NULL;
+    }
+    // the member exists, so operator[] only looks it up
+    value = &(*value)[name];
+  }
+  return value->valid() ? value : NULL;
+}
+
+// Returns false if key is in no prefetched namespace.  Otherwise sets found, and v if it is not NULL.
+bool getPrefetched(const std::string& key, XmlRpc::XmlRpcValue* v, bool& found)
+{
+  boost::shared_lock<boost::shared_mutex> lock(g_prefetched_mutex);
+
+  // nested namespaces hold the same values, use the one closest to the key
+  M_Param::const_iterator ns = g_prefetched.end();
+  for (M_Param::const_iterator it = g_prefetched.begin(); it != g_prefetched.end(); ++it)
+  {
+    if (isInNamespace(key, it->first) && (ns == g_prefetched.end() || it->first.size() > ns->first.size()))
+    {
+      ns = it;
+    }
+  }
+  if (ns == g_prefetched.end())
+  {
+    return false;
+  }
+
+  const XmlRpc::XmlRpcValue* value = findInTree(ns->second, ns->first, key);
+  found = value != NULL;
+  if (found && v)
+  {
+    *v = *value;
+  }
+  return true;
+}
+
+// Applies a new value of key to the tree of namespace ns, if key is in it or contains it.
+// An invalid value deletes the key.
+void updateTree(const std::string& ns, XmlRpc::XmlRpcValue& tree, const std::string& key, const XmlRpc::XmlRpcValue& v)
+{
+  if (isInNamespace(key, ns))
+  {
+    XmlRpc::XmlRpcValue* parent = NULL;
+    XmlRpc::XmlRpcValue* value = &tree;
+    size_t pos = firstName(ns);
+    std::string name;
+    bool is_set = true;
+    while (is_set && nextName(key, pos, name))
+    {
+      if (!v.valid())
+      {
+        // a deleted key is only looked up, not created
+        is_set = value->getType() == XmlRpc::XmlRpcValue::TypeStruct && value->hasMember(name);
+      }
+      else if (value->getType() != XmlRpc::XmlRpcValue::TypeStruct)
+      {
+        // setting a key below a value replaces the value with a namespace
+        *value = XmlRpc::XmlRpcValue();
+      }
+      if (is_set)
+      {
+        parent = value;
+        value = &(*value)[name];
+      }
+    }
+
+    if (v.valid())
+    {
+      *value = v;
+    }
+    else if (!is_set)
+    {
+      // nothing to delete
+    }
+    else if (!parent)
+    {
+      *value = XmlRpc::XmlRpcValue();
+    }
+    else
+    {
+      // XmlRpcValue can't erase a member, so the namespace is rebuilt without it
+      XmlRpc::XmlRpcValue members;
+      members.begin(); // turns it into an empty struct
+      for (XmlRpc::XmlRpcValue::iterator m = parent->begin(); m != parent->end(); ++m)
+      {
+        if (m->first != name)
+        {
+          members[m->first] = m->second;
+        }
+      }
+      *parent = members;
+    }
+  }
+  else if (isInNamespace(ns, key))
+  {
+    // the namespace is part of the new value
+    const XmlRpc::XmlRpcValue* value = findInTree(v, key, ns);
+    tree = value ? *value : XmlRpc::XmlRpcValue();
+  }
+}
+
+// Applies a new value of key to the prefetched namespaces containing it or contained in it, and keeps
+// it for the pending prefetches it concerns.  An invalid value deletes the key.
+void updatePrefetched(const std::string& key, const XmlRpc::XmlRpcValue& v)
+{
+  boost::unique_lock<boost::shared_mutex> lock(g_prefetched_mutex);
+
+  for (M_Param::iterator it = g_prefetched.begin(); it != g_prefetched.end(); ++it)
+  {
+    updateTree(it->first, it->second, key, v);
+  }
+  for (L_PendingPrefetch::iterator it = g_pending_prefetches.begin(); it != g_pending_prefetches.end(); ++it)
+  {
+    if (isInNamespace(key, it->ns) || isInNamespace(it->ns, key))
+    {
+      it->updates.push_back(std::make_pair(key, v));
+    }
+  }
+}
+
+// Returns true if key is in, or contains, a prefetched or pending namespace
+bool isPrefetched(const std::string& key)
+{
+  boost::shared_lock<boost::shared_mutex> lock(g_prefetched_mutex);
+
+  for (M_Param::const_iterator it = g_prefetched.begin(); it != g_prefetched.end(); ++it)
+  {
+    if (isInNamespace(key, it->first) || isInNamespace(it->first, key))
+    {
+      return true;
+    }
+  }
+  for (L_PendingPrefetch::const_iterator it = g_pending_prefetches.begin(); it != g_pending_prefetches.end(); ++it)
+  {
+    if (isInNamespace(key, it->ns) || isInNamespace(it->ns, key))
+    {
+      return true;
+    }
+  }
+  return false;
+}
+
+// The master sends an empty namespace both for a deleted key and for one set to an empty dict.
+// Returns v, or an invalid value if the master no longer has key.
+XmlRpc::XmlRpcValue confirmEmptyNamespace(const std::string& key, const XmlRpc::XmlRpcValue& v)
+{
+  if (v.getType() != XmlRpc::XmlRpcValue::TypeStruct || v.size() != 0)
+  {
+    return v;
+  }
+
+  XmlRpc::XmlRpcValue params, result, payload;
+  params[0] = this_node::getName();
+  params[1] = key;
+  if (master::execute("hasParam", params, result, payload, false) && bool(payload))
+  {
+    return v;
+  }
+  return XmlRpc::XmlRpcValue();
+}
+
 void set(const std::string& key, const XmlRpc::XmlRpcValue& v)
 {
   std::string mapped_key = ros::names::resolve(key);
@@ -87,6 +311,8 @@ void set(const std::string& key, const XmlRpc::XmlRpcValue& v)
         g_params[mapped_key] = v;
       }
       invalidateParentParams(mapped_key);
+      // the master doesn't notify the node setting a parameter
+      updatePrefetched(mapped_key, v);
     }
   }
 }
@@ -210,9 +436,17 @@ void set(const std::string& key, const std::map<std::string, bool>& map)
 
 bool has(const std::string& key)
 {
+  std::string mapped_key = ros::names::resolve(key);
+
+  bool found = false;
+  if (getPrefetched(mapped_key, NULL, found))
+  {
+    return found;
+  }
+
   XmlRpc::XmlRpcValue params, result, payload;
   params[0] = this_node::getName();
-  params[1] = ros::names::resolve(key);
+  params[1] = mapped_key;
   //params[1] = key;
   // We don't loop here, because validateXmlrpcResponse() returns false
   // both when we can't contact the master and when the master says, "I
@@ -229,16 +463,24 @@ bool del(const std::string& key)
 {
   std::string mapped_key = ros::names::resolve(key);
 
+  bool unsubscribe = false;
   {
     boost::recursive_mutex::scoped_lock lock(g_params_mutex);
 
     if (g_subscribed_params.find(mapped_key) != g_subscribed_params.end())
     {
       g_subscribed_params.erase(mapped_key);
-      unsubscribeCachedParam(mapped_key);
+      // a prefetched namespace shares the subscription with the key
+      boost::shared_lock<boost::shared_mutex> prefetched_lock(g_prefetched_mutex);
+      unsubscribe = g_prefetched.find(mapped_key) == g_prefetched.end();
     }
     g_params.erase(mapped_key);
   }
+  // don't hold up lookups and updates while the master is called
+  if (unsubscribe)
+  {
+    unsubscribeCachedParam(mapped_key);
+  }
 
   XmlRpc::XmlRpcValue params, result, payload;
   params[0] = this_node::getName();
@@ -250,6 +492,7 @@ bool del(const std::string& key)
   {
     return false;
   }
+  updatePrefetched(mapped_key, XmlRpc::XmlRpcValue());
 
   return true;
 }
@@ -259,6 +502,13 @@ bool getImpl(const std::string& key, XmlRpc::XmlRpcValue& v, bool use_cache)
   std::string mapped_key = ros::names::resolve(key);
   if (mapped_key.empty()) mapped_key = "/";
 
+  // prefetched namespaces answer get() as well as getCached()
+  bool found = false;
+  if (getPrefetched(mapped_key, &v, found))
+  {
+    return found;
+  }
+
   if (use_cache)
   {
     boost::recursive_mutex::scoped_lock lock(g_params_mutex);
@@ -744,6 +994,51 @@ bool getParamNames(std::vector<std::string>& keys)
   return true;
 }
 
+bool prefetch(const std::string& ns)
+{
+  std::string mapped_ns = ros::names::resolve(ns);
+  if (mapped_ns.empty()) mapped_ns = "/";
+
+  XmlRpc::XmlRpcValue params, result, payload;
+  params[0] = this_node::getName();
+  params[1] = XMLRPCManager::instance()->getServerURI();
+  params[2] = mapped_ns;
+
+  // Updates sent while the master is called may be newer than the tree it returns, so they are kept
+  // and applied to the tree before it is installed.
+  L_PendingPrefetch::iterator pending;
+  {
+    boost::unique_lock<boost::shared_mutex> lock(g_prefetched_mutex);
+    pending = g_pending_prefetches.insert(g_pending_prefetches.end(), PendingPrefetch());
+    pending->ns = mapped_ns;
+  }
+
+  // subscribeParam returns the current value of the namespace, so one call both fetches and subscribes
+  bool ok = master::execute("subscribeParam", params, result, payload, false);
+  if (ok)
+  {
+    payload = confirmEmptyNamespace(mapped_ns, payload);
+  }
+
+  boost::unique_lock<boost::shared_mutex> lock(g_prefetched_mutex);
+  if (ok)
+  {
+    for (size_t i = 0; i < pending->updates.size(); ++i)
+    {
+      updateTree(mapped_ns, payload, pending->updates[i].first, pending->updates[i].second);
+    }
+    g_prefetched[mapped_ns] = payload;
+    ROS_DEBUG_NAMED("cached_parameters", "Prefetched parameter namespace [%s]", mapped_ns.c_str());
+  }
+  g_pending_prefetches.erase(pending);
+  if (!ok)
+  {
+    return false;
+  }
+
+  return true;
+}
+
 bool search(const std::string& key, std::string& result_out)
 {
   return search(this_node::getName(), key, result_out);
@@ -783,13 +1078,19 @@ void update(const std::string& key, const XmlRpc::XmlRpcValue& v)
   std::string clean_key = names::clean(key);
   ROS_DEBUG_NAMED("cached_parameters", "Received parameter update for key [%s]", clean_key.c_str());
 
-  boost::recursive_mutex::scoped_lock lock(g_params_mutex);
+  {
+    boost::recursive_mutex::scoped_lock lock(g_params_mutex);
 
-  if (g_subscribed_params.find(clean_key) != g_subscribed_params.end())
+    if (g_subscribed_params.find(clean_key) != g_subscribed_params.end())
+    {
+      g_params[clean_key] = v;
+    }
+    invalidateParentParams(clean_key);
+  }
+  if (isPrefetched(clean_key))
   {
-    g_params[clean_key] = v;
+    updatePrefetched(clean_key, confirmEmptyNamespace(clean_key, v));
   }
-  invalidateParentParams(clean_key);
 }
 
 void paramUpdateCallback(XmlRpc::XmlRpcValue& params, XmlRpc::XmlRpcValue& result)
@@ -821,6 +1122,22 @@ void unsubscribeCachedParam(void)
     const std::string mapped_key(*itr);
     unsubscribeCachedParam(mapped_key);
   }
+
+  V_string prefetched;
+  {
+    boost::shared_lock<boost::shared_mutex> prefetched_lock(g_prefetched_mutex);
+    for (M_Param::const_iterator it = g_prefetched.begin(); it != g_prefetched.end(); ++it)
+    {
+      if (g_subscribed_params.find(it->first) == g_subscribed_params.end())
+      {
+        prefetched.push_back(it->first);
+      }
+    }
+  }
+  for (size_t i = 0; i < prefetched.size(); ++i)
+  {
+    unsubscribeCachedParam(prefetched[i]);
+  }
 }
 
 void init(const M_string& remappings)
@@ -42,12 +42,24 @@
 
 #include <rosgraph_msgs/Log.h>
 
+#include <algorithm>
+#include <sstream>
+
 namespace ros
 {
 
 ROSOutAppender::ROSOutAppender()
-: shutting_down_(false)
+: queued_(0)
+, max_queue_size_(0)
+, dropped_(0)
+, shutting_down_(false)
 , disable_topics_(false)
+, message_rate_limit_(0.0)
+, byte_rate_limit_(0.0)
+, message_budget_(0.0)
+, byte_budget_(0.0)
+, suppressed_(0)
+, collapse_repeats_(false)
 , publish_thread_(boost::bind(&ROSOutAppender::logThread, this))
 {
   AdvertiseOptions ops;
@@ -76,58 +88,57 @@ const std::string&  ROSOutAppender::getLastError() const
 
 void ROSOutAppender::log(::ros::console::Level level, const char* str, const char* file, const char* function, int line)
 {
-  rosgraph_msgs::LogPtr msg(boost::make_shared<rosgraph_msgs::Log>());
+  ros::Time stamp = ros::Time::now();
 
-  msg->header.stamp = ros::Time::now();
-  if (level == ros::console::levels::Debug)
-  {
-    msg->level = rosgraph_msgs::Log::DEBUG;
-  }
-  else if (level == ros::console::levels::Info)
-  {
-    msg->level = rosgraph_msgs::Log::INFO;
-  }
-  else if (level == ros::console::levels::Warn)
-  {
-    msg->level = rosgraph_msgs::Log::WARN;
-  }
-  else if (level == ros::console::levels::Error)
-  {
-    msg->level = rosgraph_msgs::Log::ERROR;
-  }
-  else if (level == ros::console::levels::Fatal)
+  if (level == ::ros::console::levels::Fatal || level == ::ros::console::levels::Error)
   {
-    msg->level = rosgraph_msgs::Log::FATAL;
+    last_error_ = str;
   }
-  msg->name = this_node::getName();
-  msg->msg = str;
-  msg->file = file;
-  msg->function = function;
-  msg->line = line;
-  
-  // check parameter server/cache for omit_topics flag
-  // the same parameter is checked in rosout.py for the same purpose
-  ros::param::getCached("/rosout_disable_topics_generation", disable_topics_);
 
-  if (!disable_topics_){
-    this_node::getAdvertisedTopics(msg->topics);
+  // Only copy the call into a queue slot here; building and publishing the message happens on the publish thread
+  boost::mutex::scoped_lock lock(queue_mutex_);
+  // Errors and fatal messages are never dropped, they may be the last thing a node says
+  if (max_queue_size_ && queued_ >= max_queue_size_ && level < ::ros::console::levels::Error)
+  {
+    ++dropped_;
+    return;
   }
 
-  if (level == ::ros::console::levels::Fatal || level == ::ros::console::levels::Error)
+  if (queued_ == log_queue_.size())
   {
-    last_error_ = str;
+    log_queue_.resize(queued_ + 1);
   }
 
-  boost::mutex::scoped_lock lock(queue_mutex_);
-  log_queue_.push_back(msg);
+  LogRecord& record = log_queue_[queued_++];
+  record.level = level;
+  record.stamp = stamp;
+  record.msg = str;
+  record.file = file;
+  record.function = function;
+  record.line = line;
+
   queue_condition_.notify_all();
 }
 
 void ROSOutAppender::logThread()
 {
+  // Per-node budgets and batching behavior, read once; all off by default
+  int max_queue_size = 0;
+  ros::param::param("~rosout_rate_limit", message_rate_limit_, 0.0);
+  ros::param::param("~rosout_byte_rate_limit", byte_rate_limit_, 0.0);
+  ros::param::param("~rosout_collapse_repeats", collapse_repeats_, false);
+  ros::param::param("~rosout_max_queue_size", max_queue_size, 0);
+  {
+    boost::mutex::scoped_lock lock(queue_mutex_);
+    max_queue_size_ = std::max(max_queue_size, 0);
+  }
+
+  V_LogRecord batch;
+
   while (!shutting_down_)
   {
-    V_Log local_queue;
+    size_t count;
+    uint64_t dropped;
 
     {
       boost::mutex::scoped_lock lock(queue_mutex_);
@@ -137,7 +148,7 @@ void ROSOutAppender::logThread()
         return;
       }
 
-      if (log_queue_.empty())
+      if (queued_ == 0)
       {
         queue_condition_.wait(lock);
       }
@@ -147,15 +158,145 @@ void ROSOutAppender::logThread()
         return;
       }
 
-      local_queue.swap(log_queue_);
+      // Take the whole burst at once, handing the previous batch's slots back to log()
+      log_queue_.swap(batch);
+      count = queued_;
+      queued_ = 0;
+      dropped = dropped_;
+      dropped_ = 0;
+    }
+
+    publishBatch(batch, count, dropped);
+  }
+}
+
+bool ROSOutAppender::takeBudget(::ros::console::Level level, size_t bytes)
+{
+  if (message_rate_limit_ <= 0.0 && byte_rate_limit_ <= 0.0)
+  {
+    return true;
+  }
+
+  // Refill the enabled buckets, allowing bursts of up to one second's worth
+  WallTime now = WallTime::now();
+  double elapsed = last_refill_.isZero() ? 1.0 : (now - last_refill_).toSec();
+  last_refill_ = now;
+  if (message_rate_limit_ > 0.0)
+  {
+    message_budget_ = std::min(message_budget_ + elapsed * message_rate_limit_, message_rate_limit_);
+  }
+  if (byte_rate_limit_ > 0.0)
+  {
+    byte_budget_ = std::min(byte_budget_ + elapsed * byte_rate_limit_, byte_rate_limit_);
+  }
+
+  bool fits = (message_rate_limit_ <= 0.0 || message_budget_ >= 1.0) &&
+              (byte_rate_limit_ <= 0.0 || byte_budget_ >= bytes);
+  // Fatal messages always go out, and are charged against the budget like any other
+  if (!fits && level != ::ros::console::levels::Fatal)
+  {
+    return false;
+  }
+
+  // Overdrawing is bounded by one second's worth, so a burst of fatal messages cannot mute /rosout for long
+  if (message_rate_limit_ > 0.0)
+  {
+    message_budget_ = std::max(message_budget_ - 1.0, -message_rate_limit_);
+  }
+  if (byte_rate_limit_ > 0.0)
+  {
+    byte_budget_ = std::max(byte_budget_ - bytes, -byte_rate_limit_);
+  }
+  return true;
+}
+
+namespace
+{
+uint8_t toLogLevel(::ros::console::Level level)
+{
+  switch (level)
+  {
+  case ::ros::console::levels::Debug:
+    return rosgraph_msgs::Log::DEBUG;
+  case ::ros::console::levels::Info:
+    return rosgraph_msgs::Log::INFO;
+  case ::ros::console::levels::Warn:
+    return rosgraph_msgs::Log::WARN;
+  case ::ros::console::levels::Error:
+    return rosgraph_msgs::Log::ERROR;
+  case ::ros::console::levels::Fatal:
+    return rosgraph_msgs::Log::FATAL;
+  default:
+    return 0;
+  }
+}
+}
+
+void ROSOutAppender::publishBatch(const V_LogRecord& batch, size_t count, uint64_t dropped)
+{
+  // check parameter server/cache for omit_topics flag
+  // the same parameter is checked in rosout.py for the same purpose
+  ros::param::getCached("/rosout_disable_topics_generation", disable_topics_);
+
+  // One message object for the whole batch; TopicManager::publish serializes it before returning
+  rosgraph_msgs::Log msg;
+  msg.name = this_node::getName();
+  if (!disable_topics_)
+  {
+    this_node::getAdvertisedTopics(msg.topics);
+  }
+  const std::string topic = names::resolve("/rosout");
+
+  for (size_t i = 0; i < count;)
+  {
+    const LogRecord& record = batch[i];
+
+    // Coalesce a run of identical calls into one message carrying the count
+    size_t repeats = 1;
+    while (collapse_repeats_ && i + repeats < count &&
+           batch[i + repeats].level == record.level && batch[i + repeats].line == record.line &&
+           batch[i + repeats].msg == record.msg && batch[i + repeats].file == record.file &&
+           batch[i + repeats].function == record.function)
+    {
+      ++repeats;
     }
+    i += repeats;
 
-    V_Log::iterator it = local_queue.begin();
-    V_Log::iterator end = local_queue.end();
-    for (; it != end; ++it)
+    if (!takeBudget(record.level, record.msg.size()))
     {
-      TopicManager::instance()->publish(names::resolve("/rosout"), *(*it));
+      suppressed_ += repeats;
+      continue;
     }
+
+    msg.header.stamp = record.stamp;
+    msg.level = toLogLevel(record.level);
+    msg.msg = record.msg;
+    if (repeats > 1)
+    {
+      std::stringstream ss;
+      ss << " [repeated " << repeats << " times]";
+      msg.msg += ss.str();
+    }
+    msg.file = record.file;
+    msg.function = record.function;
+    msg.line = record.line;
+    TopicManager::instance()->publish(topic, msg);
+  }
+
+  // Account for anything left out, exempt from the budget so the gap is always visible
+  suppressed_ += dropped;
+  if (suppressed_ && takeBudget(::ros::console::levels::Fatal, 0))
+  {
+    std::stringstream ss;
+    ss << "Suppressed " << suppressed_ << " log messages to stay within the rosout budget of this node";
+    msg.header.stamp = ros::Time::now();
+    msg.level = rosgraph_msgs::Log::WARN;
+    msg.msg = ss.str();
+    msg.file = __FILE__;
+    msg.function = __ROSCONSOLE_FUNCTION__;
+    msg.line = __LINE__;
+    TopicManager::instance()->publish(topic, msg);
+    suppressed_ = 0;
   }
 }
 
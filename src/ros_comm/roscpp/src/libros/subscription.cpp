@@ -58,6 +58,7 @@
 #include "ros/file_log.h"
 #include "ros/transport_hints.h"
 #include "ros/subscription_callback_helper.h"
+#include "ros/serialization.h"
 
 #include <boost/make_shared.hpp>
 
@@ -670,6 +671,26 @@ uint32_t Subscription::handleMessage(const SerializedMessage& m, bool ser, bool
     }
   }
 
+  // the stamp of a header is the closest we get to the publish time
+  if (LatencyHistogram::isEnabled() && m.buf && !callbacks_.empty() && callbacks_.front()->helper_->hasHeader())
+  {
+    try
+    {
+      uint32_t seq;
+      ros::Time stamp;
+      ros::serialization::IStream stream(m.message_start, m.num_bytes - (m.message_start - m.buf.get()));
+      stream.next(seq);
+      stream.next(stamp);
+      if (!stamp.isZero())
+      {
+        transport_latency_.record((receipt_time - stamp).toNSec());
+      }
+    }
+    catch (ros::serialization::StreamOverrunException&)
+    {
+    }
+  }
+
   // measure statistics
   statistics_.callback(connection_header, name_, link->getCallerID(), m, link->getStats().bytes_received_, receipt_time, drops > 0, link->getConnectionID());
 
@@ -689,6 +710,32 @@ uint32_t Subscription::handleMessage(const SerializedMessage& m, bool ser, bool
   return drops;
 }
 
+void Subscription::getLatencyStatistics(V_LatencyStatistics& stats)
+{
+  LatencyStatistics transport;
+  transport.source = name_;
+  transport.stage = "transport";
+  transport_latency_.snapshot(transport.histogram);
+
+  LatencyStatistics queue;
+  queue.source = name_;
+  queue.stage = "queue";
+  LatencyStatistics callback;
+  callback.source = name_;
+  callback.stage = "callback";
+  {
+    boost::mutex::scoped_lock lock(callbacks_mutex_);
+    for (V_CallbackInfo::iterator cb = callbacks_.begin(); cb != callbacks_.end(); ++cb)
+    {
+      (*cb)->subscription_queue_->getLatency(queue.histogram, callback.histogram);
+    }
+  }
+
+  stats.push_back(transport);
+  stats.push_back(queue);
+  stats.push_back(callback);
+}
+
 bool Subscription::addCallback(const SubscriptionCallbackHelperPtr& helper, const std::string& md5sum, CallbackQueueInterface* queue, int32_t queue_size, const VoidConstPtr& tracked_object, bool allow_concurrent_callbacks)
 {
   ROS_ASSERT(helper);
@@ -50,6 +50,12 @@ void SubscriptionQueue::push(const SubscriptionCallbackHelperPtr& helper, const
                                  bool has_tracked_object, const VoidConstWPtr& tracked_object, bool nonconst_need_copy,
                                  ros::Time receipt_time, bool* was_full)
 {
+  ros::SteadyTime push_time;
+  if (LatencyHistogram::isEnabled())
+  {
+    push_time = ros::SteadyTime::now();
+  }
+
   boost::mutex::scoped_lock lock(queue_mutex_);
 
   if (was_full)
@@ -86,6 +92,7 @@ void SubscriptionQueue::push(const SubscriptionCallbackHelperPtr& helper, const
   i.tracked_object = tracked_object;
   i.nonconst_need_copy = nonconst_need_copy;
   i.receipt_time = receipt_time;
+  i.push_time = push_time;
   queue_.push_back(i);
   ++queue_size_;
 }
@@ -161,12 +168,32 @@ CallbackInterface::CallResult SubscriptionQueue::call()
 
     SubscriptionCallbackHelperCallParams params;
     params.event = MessageEvent<void const>(msg, i.deserializer->getConnectionHeader(), i.receipt_time, i.nonconst_need_copy, MessageEvent<void const>::CreateFunction());
-    i.helper->call(params);
+
+    if (i.push_time.isZero())
+    {
+      i.helper->call(params);
+    }
+    else
+    {
+      ros::SteadyTime start = ros::SteadyTime::now();
+      queue_latency_.record((start - i.push_time).toNSec());
+      i.helper->call(params);
+      callback_latency_.record((ros::SteadyTime::now() - start).toNSec());
+    }
   }
 
   return CallbackInterface::Success;
 }
 
+void SubscriptionQueue::getLatency(LatencyHistogram::Snapshot& queue, LatencyHistogram::Snapshot& callback) const
+{
+  LatencyHistogram::Snapshot snapshot;
+  queue_latency_.snapshot(snapshot);
+  queue.merge(snapshot);
+  callback_latency_.snapshot(snapshot);
+  callback.merge(snapshot);
+}
+
 bool SubscriptionQueue::ready()
 {
   return true;
@@ -959,6 +959,16 @@ void TopicManager::getBusInfo(XmlRpcValue &info)
   }
 }
 
+void TopicManager::getLatencyStatistics(V_LatencyStatistics& stats)
+{
+  boost::mutex::scoped_lock lock(subs_mutex_);
+
+  for (L_Subscription::iterator t = subscriptions_.begin(); t != subscriptions_.end(); ++t)
+  {
+    (*t)->getLatencyStatistics(stats);
+  }
+}
+
 void TopicManager::getSubscriptions(XmlRpcValue &subs)
 {
   // force these guys to be arrays, even if we don't populate them
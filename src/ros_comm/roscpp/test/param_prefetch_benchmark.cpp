@@ -0,0 +1,112 @@
+/*
+ * Copyright (C) 2009, Willow Garage, Inc.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *   * Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the names of Stanford University or Willow Garage, Inc. nor the names of its
+ *     contributors may be used to endorse or promote products derived from
+ *     this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Measures how long a node takes to read its parameters at startup, reading each parameter from the
+ * master with get(), with getCached() on first use, or from a namespace fetched once with prefetch().
+ * Needs a running master.
+ *
+ * Usage: param_prefetch_benchmark [max parameters]
+ */
+
+#include "ros/ros.h"
+#include "ros/param.h"
+
+#include <boost/lexical_cast.hpp>
+
+#include <cstdlib>
+#include <cstdio>
+#include <string>
+
+namespace
+{
+
+enum Mode { GET, GET_CACHED, PREFETCH };
+
+const char* modeName(Mode mode)
+{
+  switch (mode)
+  {
+    case GET: return "get";
+    case GET_CACHED: return "getCached";
+    case PREFETCH: return "prefetch+get";
+  }
+  return "";
+}
+
+// Returns the seconds taken to read all parameters, or a negative value if a read failed
+double run(Mode mode, int num_params)
+{
+  // every run uses its own namespace, so nothing is cached from a previous run
+  static int run_count = 0;
+  std::string ns = ros::this_node::getName() + "/run" + boost::lexical_cast<std::string>(run_count++);
+  for (int i = 0; i < num_params; ++i)
+  {
+    ros::param::set(ns + "/param" + boost::lexical_cast<std::string>(i), i);
+  }
+
+  ros::WallTime start = ros::WallTime::now();
+  if (mode == PREFETCH && !ros::param::prefetch(ns))
+  {
+    return -1.0;
+  }
+  for (int i = 0; i < num_params; ++i)
+  {
+    std::string key = ns + "/param" + boost::lexical_cast<std::string>(i);
+    int value = -1;
+    bool ok = mode == GET_CACHED ? ros::param::getCached(key, value) : ros::param::get(key, value);
+    if (!ok || value != i)
+    {
+      return -1.0;
+    }
+  }
+  double seconds = (ros::WallTime::now() - start).toSec();
+
+  ros::param::del(ns);
+  return seconds;
+}
+
+}
+
+int main(int argc, char** argv)
+{
+  ros::init(argc, argv, "param_prefetch_benchmark", ros::init_options::AnonymousName);
+  ros::NodeHandle nh;
+  int max_params = argc > 1 ? atoi(argv[1]) : 1000;
+
+  const Mode modes[] = { GET, GET_CACHED, PREFETCH };
+  for (int num_params = 10; num_params <= max_params; num_params *= 10)
+  {
+    for (size_t m = 0; m < sizeof(modes) / sizeof(modes[0]); ++m)
+    {
+      double seconds = run(modes[m], num_params);
+      printf("%6d params: %-14s %10.2fms\n", num_params, modeName(modes[m]), seconds * 1e3);
+    }
+  }
+
+  return 0;
+}
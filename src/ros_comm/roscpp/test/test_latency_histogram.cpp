@@ -0,0 +1,131 @@
+/*
+ * Copyright (C) 2009, Willow Garage, Inc.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *   * Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the names of Stanford University or Willow Garage, Inc. nor the names of its
+ *     contributors may be used to endorse or promote products derived from
+ *     this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Checks the bucket layout and percentiles of ros::LatencyHistogram.  latency_histogram.cpp is built into this test
+ * on its own, so it doesn't link roscpp.
+ */
+
+#include "ros/latency_histogram.h"
+
+#include <gtest/gtest.h>
+
+#include <limits>
+
+using ros::LatencyHistogram;
+
+TEST(LatencyHistogram, bucketIndex)
+{
+  // one bucket per nanosecond below 2 * SUB_BUCKETS, then two, four, ...
+  for (uint64_t ns = 0; ns < 2 * LatencyHistogram::SUB_BUCKETS; ++ns)
+  {
+    EXPECT_EQ(ns, LatencyHistogram::bucketIndex(ns));
+  }
+  EXPECT_EQ(2 * LatencyHistogram::SUB_BUCKETS, LatencyHistogram::bucketIndex(2 * LatencyHistogram::SUB_BUCKETS));
+  EXPECT_EQ(2 * LatencyHistogram::SUB_BUCKETS, LatencyHistogram::bucketIndex(2 * LatencyHistogram::SUB_BUCKETS + 1));
+  EXPECT_EQ(2 * LatencyHistogram::SUB_BUCKETS + 1, LatencyHistogram::bucketIndex(2 * LatencyHistogram::SUB_BUCKETS + 2));
+
+  // values of 2^MAX_EXPONENT and above share the last bucket
+  EXPECT_EQ(LatencyHistogram::NUM_BUCKETS - 1, LatencyHistogram::bucketIndex((1ULL << LatencyHistogram::MAX_EXPONENT) - 1));
+  EXPECT_EQ(LatencyHistogram::NUM_BUCKETS - 1, LatencyHistogram::bucketIndex(1ULL << LatencyHistogram::MAX_EXPONENT));
+  EXPECT_EQ(LatencyHistogram::NUM_BUCKETS - 1, LatencyHistogram::bucketIndex(std::numeric_limits<uint64_t>::max()));
+}
+
+TEST(LatencyHistogram, bucketUpperBound)
+{
+  uint64_t lower = 0;
+  for (size_t i = 0; i < LatencyHistogram::NUM_BUCKETS; ++i)
+  {
+    uint64_t upper = LatencyHistogram::bucketUpperBound(i);
+    ASSERT_GT(upper, lower);
+    // the bounds are exclusive and the buckets adjacent
+    EXPECT_EQ(i, LatencyHistogram::bucketIndex(lower));
+    EXPECT_EQ(i, LatencyHistogram::bucketIndex(upper - 1));
+    if (i + 1 < LatencyHistogram::NUM_BUCKETS)
+    {
+      EXPECT_EQ(i + 1, LatencyHistogram::bucketIndex(upper));
+    }
+    // a bucket is at most 1/SUB_BUCKETS of its values wide
+    EXPECT_LE((upper - lower) * LatencyHistogram::SUB_BUCKETS, std::max<uint64_t>(upper, LatencyHistogram::SUB_BUCKETS));
+    lower = upper;
+  }
+  EXPECT_EQ(1ULL << LatencyHistogram::MAX_EXPONENT, lower);
+}
+
+TEST(LatencyHistogram, percentile)
+{
+  LatencyHistogram histogram;
+  LatencyHistogram::Snapshot snapshot;
+  histogram.snapshot(snapshot);
+  EXPECT_EQ(0u, snapshot.count);
+  EXPECT_EQ(LatencyHistogram::NUM_BUCKETS, snapshot.buckets.size());
+  EXPECT_EQ(0u, snapshot.percentile(0.5));
+
+  // 1..10ns get a bucket each
+  for (int64_t ns = 1; ns <= 10; ++ns)
+  {
+    histogram.record(ns);
+  }
+  histogram.record(-5);
+  histogram.snapshot(snapshot);
+  EXPECT_EQ(10u, snapshot.count);
+  EXPECT_EQ(55u, snapshot.sum);
+  EXPECT_EQ(10u, snapshot.max);
+  EXPECT_EQ(2u, snapshot.percentile(0.0));
+  EXPECT_EQ(2u, snapshot.percentile(0.1));
+  EXPECT_EQ(6u, snapshot.percentile(0.5));
+  EXPECT_EQ(10u, snapshot.percentile(0.9));
+  EXPECT_EQ(10u, snapshot.percentile(1.0));
+
+  // the percentile is the upper bound of its bucket, but never above the maximum
+  LatencyHistogram large;
+  large.record(1000);
+  large.snapshot(snapshot);
+  EXPECT_EQ(1000u, snapshot.percentile(0.5));
+  large.record(1000000);
+  large.record(1000000);
+  large.record(1000000);
+  large.snapshot(snapshot);
+  EXPECT_EQ(1024u, snapshot.percentile(0.25));
+  EXPECT_EQ(1000000u, snapshot.percentile(0.5));
+  EXPECT_EQ(1000000u, snapshot.percentile(1.0));
+
+  // merged snapshots add up
+  LatencyHistogram::Snapshot merged;
+  histogram.snapshot(merged);
+  merged.merge(snapshot);
+  EXPECT_EQ(14u, merged.count);
+  EXPECT_EQ(1000000u, merged.max);
+  EXPECT_EQ(11u, merged.percentile(10.0 / 14));
+  EXPECT_EQ(1024u, merged.percentile(11.0 / 14));
+}
+
+int main(int argc, char** argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
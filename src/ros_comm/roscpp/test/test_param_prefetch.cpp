@@ -0,0 +1,475 @@
+/*
+ * Copyright (C) 2009, Willow Garage, Inc.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *   * Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the names of Stanford University or Willow Garage, Inc. nor the names of its
+ *     contributors may be used to endorse or promote products derived from
+ *     this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Checks that namespaces fetched with ros::param::prefetch() follow the changes made through the
+ * master.  param.cpp is built into this test on its own, against an in-memory master that sends
+ * parameter updates straight to the paramUpdate callback, so no master needs to be running.
+ */
+
+#include "ros/param.h"
+#include "ros/master.h"
+#include "ros/names.h"
+#include "ros/this_node.h"
+#include "ros/xmlrpc_manager.h"
+
+#include <gtest/gtest.h>
+#include <boost/bind.hpp>
+#include <boost/function.hpp>
+
+#include <map>
+#include <set>
+#include <string>
+
+using XmlRpc::XmlRpcValue;
+
+namespace ros
+{
+namespace param
+{
+void init(const M_string& remappings);
+}
+}
+
+namespace
+{
+
+// Leaf parameters of the fake master, by key
+std::map<std::string, XmlRpcValue> g_leaves;
+// Keys the node is subscribed to
+std::set<std::string> g_subscriptions;
+// The node's paramUpdate callback, as bound by ros::param::init()
+ros::XMLRPCFunc g_param_update;
+// Called in subscribeParam after the reply is made, as if another call got in before it is sent
+boost::function<void()> g_before_subscribe_reply;
+int g_calls = 0;
+
+bool isInNamespace(const std::string& key, const std::string& ns)
+{
+  if (ns == "/")
+  {
+    return true;
+  }
+  return key.compare(0, ns.size(), ns) == 0 && (key.size() == ns.size() || key[ns.size()] == '/');
+}
+
+void eraseLeaves(const std::string& key)
+{
+  for (std::map<std::string, XmlRpcValue>::iterator it = g_leaves.begin(); it != g_leaves.end();)
+  {
+    if (isInNamespace(it->first, key))
+    {
+      g_leaves.erase(it++);
+    }
+    else
+    {
+      ++it;
+    }
+  }
+}
+
+void setLeaves(const std::string& key, XmlRpcValue& v)
+{
+  // a value below an empty namespace takes its place
+  for (std::map<std::string, XmlRpcValue>::iterator it = g_leaves.begin(); it != g_leaves.end();)
+  {
+    if (it->first != key && isInNamespace(key, it->first))
+    {
+      g_leaves.erase(it++);
+    }
+    else
+    {
+      ++it;
+    }
+  }
+
+  // an empty namespace is kept as a leaf, so that it is still set
+  if (v.getType() == XmlRpcValue::TypeStruct && v.size() > 0)
+  {
+    for (XmlRpcValue::iterator m = v.begin(); m != v.end(); ++m)
+    {
+      setLeaves((key == "/" ? "" : key) + "/" + m->first, m->second);
+    }
+  }
+  else
+  {
+    g_leaves[key] = v;
+  }
+}
+
+bool getTree(const std::string& key, XmlRpcValue& tree)
+{
+  if (g_leaves.count(key))
+  {
+    tree = g_leaves[key];
+    return true;
+  }
+  bool found = false;
+  tree = XmlRpcValue();
+  for (std::map<std::string, XmlRpcValue>::iterator it = g_leaves.begin(); it != g_leaves.end(); ++it)
+  {
+    if (it->first == key || !isInNamespace(it->first, key))
+    {
+      continue;
+    }
+    std::string rest = it->first.substr(key == "/" ? 1 : key.size() + 1);
+    XmlRpcValue* v = &tree;
+    size_t pos = 0, end;
+    while ((end = rest.find('/', pos)) != std::string::npos)
+    {
+      v = &(*v)[rest.substr(pos, end - pos)];
+      pos = end + 1;
+    }
+    (*v)[rest.substr(pos)] = it->second;
+    found = true;
+  }
+  return found;
+}
+
+// Sends the master's paramUpdate for key to the node if it is subscribed to a namespace of key, or
+// to a key below it.  A deleted parameter is sent as an empty namespace, like rosmaster does.
+void notify(const std::string& key)
+{
+  for (std::set<std::string>::iterator it = g_subscriptions.begin(); it != g_subscriptions.end(); ++it)
+  {
+    if (isInNamespace(key, *it) || isInNamespace(*it, key))
+    {
+      XmlRpcValue params, result;
+      params[0] = std::string("/master");
+      params[1] = *it + "/";
+      if (!getTree(*it, params[2]))
+      {
+        params[2].begin();
+      }
+      g_param_update(params, result);
+    }
+  }
+}
+
+// Changes made by another node
+void remoteSet(const std::string& key, XmlRpcValue v)
+{
+  eraseLeaves(key);
+  setLeaves(key, v);
+  notify(key);
+}
+
+void remoteDelete(const std::string& key)
+{
+  eraseLeaves(key);
+  notify(key);
+}
+
+} // namespace
+
+namespace ros
+{
+
+namespace master
+{
+bool execute(const std::string& method, const XmlRpcValue& request, XmlRpcValue& response, XmlRpcValue& payload, bool)
+{
+  ++g_calls;
+  XmlRpcValue& req = const_cast<XmlRpcValue&>(request);
+  if (method == "setParam")
+  {
+    std::string key = req[1];
+    eraseLeaves(key);
+    setLeaves(key, req[2]);
+    return true;
+  }
+  if (method == "getParam")
+  {
+    return getTree(req[1], payload);
+  }
+  if (method == "hasParam")
+  {
+    XmlRpcValue tree;
+    payload = getTree(req[1], tree);
+    return true;
+  }
+  if (method == "deleteParam")
+  {
+    eraseLeaves(req[1]);
+    return true;
+  }
+  if (method == "subscribeParam")
+  {
+    g_subscriptions.insert(req[2]);
+    if (!getTree(req[2], payload))
+    {
+      payload.begin();
+    }
+    if (g_before_subscribe_reply)
+    {
+      g_before_subscribe_reply();
+    }
+    return true;
+  }
+  if (method == "unsubscribeParam")
+  {
+    g_subscriptions.erase(req[2]);
+    return true;
+  }
+  ADD_FAILURE() << "unexpected master call " << method;
+  return false;
+}
+} // namespace master
+
+namespace names
+{
+std::string clean(const std::string& name)
+{
+  std::string clean = name;
+  while (clean.size() > 1 && clean[clean.size() - 1] == '/')
+  {
+    clean.erase(clean.size() - 1);
+  }
+  return clean;
+}
+
+std::string resolve(const std::string& name, bool)
+{
+  return name.empty() ? "/" : (name[0] == '/' ? clean(name) : "/" + clean(name));
+}
+
+std::string parentNamespace(const std::string& name)
+{
+  if (name == "/" || name.empty())
+  {
+    return "/";
+  }
+  size_t pos = name.rfind('/');
+  return pos == 0 ? "/" : name.substr(0, pos);
+}
+
+const M_string& getUnresolvedRemappings()
+{
+  static M_string remappings;
+  return remappings;
+}
+} // namespace names
+
+namespace this_node
+{
+const std::string& getName()
+{
+  static std::string name("/test_param_prefetch");
+  return name;
+}
+} // namespace this_node
+
+XMLRPCManager::XMLRPCManager() {}
+XMLRPCManager::~XMLRPCManager() {}
+
+const XMLRPCManagerPtr& XMLRPCManager::instance()
+{
+  static XMLRPCManagerPtr manager(new XMLRPCManager);
+  return manager;
+}
+
+bool XMLRPCManager::bind(const std::string& function_name, const XMLRPCFunc& cb)
+{
+  if (function_name == "paramUpdate")
+  {
+    g_param_update = cb;
+  }
+  return true;
+}
+
+} // namespace ros
+
+class ParamPrefetch : public testing::Test
+{
+protected:
+  void SetUp()
+  {
+    XmlRpcValue ns;
+    ns["a"] = 1;
+    ns["b"]["c"] = std::string("x");
+    ns["b"]["d"] = 2.0;
+    remoteSet("/ns", ns);
+    remoteSet("/other", 3);
+    ASSERT_TRUE(ros::param::prefetch("/ns"));
+    g_calls = 0;
+  }
+
+  void TearDown()
+  {
+    g_before_subscribe_reply.clear();
+    remoteDelete("/");
+  }
+};
+
+TEST_F(ParamPrefetch, readsFromPrefetchedTree)
+{
+  int i = 0;
+  std::string s;
+  EXPECT_TRUE(ros::param::get("/ns/a", i));
+  EXPECT_EQ(1, i);
+  EXPECT_TRUE(ros::param::getCached("/ns/b/c", s));
+  EXPECT_EQ("x", s);
+  EXPECT_FALSE(ros::param::get("/ns/missing", i));
+  EXPECT_TRUE(ros::param::has("/ns/b"));
+  EXPECT_FALSE(ros::param::has("/ns/b/c/d"));
+  EXPECT_EQ(0, g_calls);
+
+  EXPECT_TRUE(ros::param::get("/other", i));
+  EXPECT_EQ(3, i);
+  EXPECT_EQ(1, g_calls);
+}
+
+TEST_F(ParamPrefetch, remoteSet)
+{
+  remoteSet("/ns/b/c", std::string("y"));
+  remoteSet("/ns/e/f", 5);
+  std::string s;
+  int i = 0;
+  EXPECT_TRUE(ros::param::get("/ns/b/c", s));
+  EXPECT_EQ("y", s);
+  EXPECT_TRUE(ros::param::get("/ns/e/f", i));
+  EXPECT_EQ(5, i);
+  EXPECT_TRUE(ros::param::has("/ns/b/d"));
+  EXPECT_EQ(0, g_calls);
+}
+
+TEST_F(ParamPrefetch, remoteDelete)
+{
+  remoteDelete("/ns/b/c");
+  EXPECT_FALSE(ros::param::has("/ns/b/c"));
+  EXPECT_TRUE(ros::param::has("/ns/b/d"));
+  int i = 0;
+  EXPECT_TRUE(ros::param::get("/ns/a", i));
+
+  // the update for the namespace itself is an empty struct once its last member is gone
+  remoteDelete("/ns/a");
+  remoteDelete("/ns/b");
+  EXPECT_FALSE(ros::param::has("/ns/a"));
+  EXPECT_FALSE(ros::param::has("/ns/b"));
+
+  remoteDelete("/ns");
+  EXPECT_FALSE(ros::param::has("/ns"));
+  XmlRpcValue v;
+  EXPECT_FALSE(ros::param::get("/ns", v));
+  // only the two empty namespace updates are checked with the master
+  EXPECT_EQ(2, g_calls);
+}
+
+TEST_F(ParamPrefetch, remoteNamespaceReplace)
+{
+  XmlRpcValue ns;
+  ns["z"] = 4;
+  remoteSet("/ns", ns);
+  int i = 0;
+  EXPECT_TRUE(ros::param::get("/ns/z", i));
+  EXPECT_EQ(4, i);
+  EXPECT_FALSE(ros::param::has("/ns/a"));
+  EXPECT_FALSE(ros::param::has("/ns/b/c"));
+
+  // replacing a parent of the namespace
+  XmlRpcValue root;
+  root["ns"]["y"] = 6;
+  root["other"] = 7;
+  remoteSet("/", root);
+  EXPECT_TRUE(ros::param::get("/ns/y", i));
+  EXPECT_EQ(6, i);
+  EXPECT_FALSE(ros::param::has("/ns/z"));
+  EXPECT_EQ(0, g_calls);
+}
+
+TEST_F(ParamPrefetch, ownWrites)
+{
+  int i = 0;
+  ros::param::set("/ns/a", 8);
+  EXPECT_TRUE(ros::param::get("/ns/a", i));
+  EXPECT_EQ(8, i);
+  EXPECT_TRUE(ros::param::del("/ns/b/c"));
+  EXPECT_FALSE(ros::param::has("/ns/b/c"));
+  EXPECT_TRUE(ros::param::has("/ns/b/d"));
+}
+
+TEST_F(ParamPrefetch, updateDuringPrefetch)
+{
+  // The master replies with the tree as it was, and an update made after it reaches the node first
+  g_before_subscribe_reply = boost::bind(remoteSet, std::string("/late/a"), XmlRpcValue(2));
+  XmlRpcValue ns;
+  ns["a"] = 1;
+  ns["b"] = 1;
+  remoteSet("/late", ns);
+  ASSERT_TRUE(ros::param::prefetch("/late"));
+  g_before_subscribe_reply.clear();
+
+  int i = 0;
+  EXPECT_TRUE(ros::param::get("/late/a", i));
+  EXPECT_EQ(2, i);
+
+  // same for a deletion
+  g_before_subscribe_reply = boost::bind(remoteDelete, std::string("/late/b"));
+  ASSERT_TRUE(ros::param::prefetch("/late"));
+  EXPECT_FALSE(ros::param::has("/late/b"));
+  EXPECT_TRUE(ros::param::has("/late/a"));
+}
+
+TEST_F(ParamPrefetch, emptyNamespace)
+{
+  XmlRpcValue empty;
+  empty.begin();
+
+  remoteSet("/ns/b", empty);
+  XmlRpcValue v;
+  EXPECT_TRUE(ros::param::get("/ns/b", v));
+  EXPECT_EQ(XmlRpcValue::TypeStruct, v.getType());
+  EXPECT_EQ(0, v.size());
+  EXPECT_FALSE(ros::param::has("/ns/b/c"));
+  EXPECT_TRUE(ros::param::has("/ns/a"));
+
+  // the update for a namespace set to an empty dict is the same as for a deleted one
+  remoteSet("/ns", empty);
+  EXPECT_TRUE(ros::param::has("/ns"));
+  EXPECT_TRUE(ros::param::get("/ns", v));
+  EXPECT_EQ(0, v.size());
+  EXPECT_FALSE(ros::param::has("/ns/a"));
+
+  remoteDelete("/ns");
+  EXPECT_FALSE(ros::param::has("/ns"));
+
+  // and so is the reply to subscribeParam; these namespaces stay prefetched, so this test runs last
+  remoteSet("/empty", empty);
+  ASSERT_TRUE(ros::param::prefetch("/empty"));
+  ASSERT_TRUE(ros::param::prefetch("/missing"));
+  g_calls = 0;
+  EXPECT_TRUE(ros::param::has("/empty"));
+  EXPECT_FALSE(ros::param::has("/missing"));
+  EXPECT_EQ(0, g_calls);
+}
+
+int main(int argc, char** argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  ros::param::init(ros::M_string());
+  return RUN_ALL_TESTS();
+}
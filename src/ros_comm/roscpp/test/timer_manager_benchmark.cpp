@@ -0,0 +1,131 @@
+/*
+ * Copyright (C) 2009, Willow Garage, Inc.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *   * Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the names of Stanford University or Willow Garage, Inc. nor the names of its
+ *     contributors may be used to endorse or promote products derived from
+ *     this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Measures TimerManager scheduling jitter and per-fire overhead with 10 to 10,000 concurrent timers.
+ * Each timer reports how late its callback was dispatched relative to its expected time.
+ *
+ * Usage: timer_manager_benchmark [seconds per run]
+ */
+
+#include "ros/timer_manager.h"
+#include "ros/callback_queue.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstdio>
+
+typedef ros::TimerManager<ros::SteadyTime, ros::WallDuration, ros::SteadyTimerEvent> SteadyTimerManager;
+
+namespace
+{
+
+struct Latencies
+{
+  std::vector<double> samples;
+  boost::mutex mutex;
+
+  void callback(const ros::SteadyTimerEvent& event)
+  {
+    boost::mutex::scoped_lock lock(mutex);
+    samples.push_back((event.current_expired - event.current_expected).toSec());
+  }
+};
+
+double percentile(std::vector<double>& samples, double p)
+{
+  if (samples.empty())
+  {
+    return 0.0;
+  }
+
+  size_t index = std::min(samples.size() - 1, (size_t)(p * samples.size()));
+  std::nth_element(samples.begin(), samples.begin() + index, samples.end());
+  return samples[index];
+}
+
+void run(int num_timers, double seconds)
+{
+  Latencies latencies;
+  ros::CallbackQueue queue;
+  std::vector<int32_t> handles;
+  {
+    SteadyTimerManager manager;
+
+    // Periods spread over 10-100ms so expirations interleave instead of firing in lockstep
+    for (int i = 0; i < num_timers; ++i)
+    {
+      ros::WallDuration period(0.01 + 0.09 * (i % 97) / 96.0);
+      handles.push_back(manager.add(period, boost::bind(&Latencies::callback, &latencies, boost::placeholders::_1),
+                                    &queue, ros::VoidConstPtr(), false));
+    }
+
+    ros::SteadyTime end = ros::SteadyTime::now() + ros::WallDuration(seconds);
+    while (ros::SteadyTime::now() < end)
+    {
+      queue.callAvailable(ros::WallDuration(0.01));
+    }
+
+    ros::WallTime remove_start = ros::WallTime::now();
+    for (size_t i = 0; i < handles.size(); ++i)
+    {
+      manager.remove(handles[i]);
+    }
+    double remove_time = (ros::WallTime::now() - remove_start).toSec();
+
+    boost::mutex::scoped_lock lock(latencies.mutex);
+    std::vector<double>& samples = latencies.samples;
+    size_t fires = samples.size();
+    double mean = 0.0;
+    for (size_t i = 0; i < fires; ++i)
+    {
+      mean += samples[i];
+    }
+    mean = fires ? mean / fires : 0.0;
+    double p50 = percentile(samples, 0.5);
+    double p99 = percentile(samples, 0.99);
+    double max = samples.empty() ? 0.0 : *std::max_element(samples.begin(), samples.end());
+
+    printf("%6d timers: %8lu fires, expiry lateness mean %8.1fus p50 %8.1fus p99 %8.1fus max %9.1fus, remove all %8.1fus\n",
+           num_timers, (unsigned long)fires, mean * 1e6, p50 * 1e6, p99 * 1e6, max * 1e6, remove_time * 1e6);
+  }
+}
+
+}
+
+int main(int argc, char** argv)
+{
+  double seconds = argc > 1 ? atof(argv[1]) : 2.0;
+
+  const int counts[] = { 10, 100, 1000, 10000 };
+  for (size_t i = 0; i < sizeof(counts) / sizeof(counts[0]); ++i)
+  {
+    run(counts[i], seconds);
+  }
+
+  return 0;
+}
@@ -0,0 +1,172 @@
+/*********************************************************************
+* Software License Agreement (BSD License)
+*
+*  Copyright (c) 2008, Willow Garage, Inc.
+*  All rights reserved.
+*
+*  Redistribution and use in source and binary forms, with or without
+*  modification, are permitted provided that the following conditions
+*  are met:
+*
+*   * Redistributions of source code must retain the above copyright
+*     notice, this list of conditions and the following disclaimer.
+*   * Redistributions in binary form must reproduce the above
+*     copyright notice, this list of conditions and the following
+*     disclaimer in the documentation and/or other materials provided
+*     with the distribution.
+*   * Neither the name of Willow Garage, Inc. nor the names of its
+*     contributors may be used to endorse or promote products derived
+*     from this software without specific prior written permission.
+*
+*  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+*  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+*  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+*  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+*  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+*  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+*  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+*  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+*  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+*  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+*  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+*  POSSIBILITY OF SUCH DAMAGE.
+********************************************************************/
+
+#ifndef ROSMASTER_MASTER_H
+#define ROSMASTER_MASTER_H
+
+#include "rosmaster/notifier.h"
+#include "rosmaster/param_server.h"
+#include "rosmaster/registrations.h"
+
+#include <string>
+#include <vector>
+
+#include <boost/shared_ptr.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/unordered_map.hpp>
+
+#include <xmlrpcpp/XmlRpcServer.h>
+#include <xmlrpcpp/XmlRpcValue.h>
+
+namespace rosmaster
+{
+
+const int DEFAULT_MASTER_PORT = 11311;
+const size_t NUM_WORKERS = 3;
+
+/**
+ * \brief The ROS Master: the master and parameter server XML-RPC APIs on top of XmlRpcServer.
+ *
+ * A drop-in replacement for rosmaster.master_api.ROSMasterHandler. Registrations are hashed by
+ * name and by node, and publisherUpdate, paramUpdate and shutdown callbacks to nodes go out
+ * through a Notifier, so handling an API call never waits on another node.
+ */
+class Master
+{
+public:
+  /**
+   * \param port Port to listen on, 0 for any
+   * \param num_workers Number of threads contacting nodes
+   * \param timeout Seconds to wait for a node to answer a callback, negative to wait forever
+   * \param send Transport for node callbacks instead of XmlRpcClient, e.g. for benchmarks
+   */
+  Master(int port = DEFAULT_MASTER_PORT, size_t num_workers = NUM_WORKERS, double timeout = -1.0,
+         const Notifier::SendFunc& send = Notifier::SendFunc());
+  ~Master();
+
+  /**
+   * \brief Bind the XML-RPC server
+   * \return false if the port could not be bound
+   */
+  bool start();
+
+  /**
+   * \brief Serve API calls until shutdown is requested, through the API or stop()
+   */
+  void spin();
+
+  /**
+   * \brief Serve API calls for up to timeout seconds
+   */
+  void spinOnce(double timeout);
+  void stop();
+  bool ok() const;
+
+  const std::string& getUri() const { return uri_; }
+  Notifier& getNotifier() { return *notifier_; }
+
+  /**
+   * \brief Handle a master API call with its XML-RPC params, caller_id first
+   *
+   * Arguments are validated as rosmaster does, and result is filled with [code, statusMessage, value].
+   */
+  void call(const std::string& method, XmlRpc::XmlRpcValue& params, XmlRpc::XmlRpcValue& result);
+
+private:
+  typedef void (Master::*Handler)(const std::string& caller_id, XmlRpc::XmlRpcValue& params,
+                                  XmlRpc::XmlRpcValue& result);
+  struct Method
+  {
+    Handler handler;
+    int num_params;                   ///< Including caller_id
+    XmlRpc::XmlRpcValue error_value;  ///< Value returned alongside a failure code
+  };
+  typedef boost::unordered_map<std::string, Method> M_Method;
+
+  class ServerMethod;
+  typedef boost::shared_ptr<ServerMethod> ServerMethodPtr;
+
+  void addMethod(const std::string& name, Handler handler, int num_params, const XmlRpc::XmlRpcValue& error_value);
+
+  void shutdown(const std::string& caller_id, XmlRpc::XmlRpcValue& params, XmlRpc::XmlRpcValue& result);
+  void getUri(const std::string& caller_id, XmlRpc::XmlRpcValue& params, XmlRpc::XmlRpcValue& result);
+  void getPid(const std::string& caller_id, XmlRpc::XmlRpcValue& params, XmlRpc::XmlRpcValue& result);
+
+  void deleteParam(const std::string& caller_id, XmlRpc::XmlRpcValue& params, XmlRpc::XmlRpcValue& result);
+  void setParam(const std::string& caller_id, XmlRpc::XmlRpcValue& params, XmlRpc::XmlRpcValue& result);
+  void getParam(const std::string& caller_id, XmlRpc::XmlRpcValue& params, XmlRpc::XmlRpcValue& result);
+  void searchParam(const std::string& caller_id, XmlRpc::XmlRpcValue& params, XmlRpc::XmlRpcValue& result);
+  void subscribeParam(const std::string& caller_id, XmlRpc::XmlRpcValue& params, XmlRpc::XmlRpcValue& result);
+  void unsubscribeParam(const std::string& caller_id, XmlRpc::XmlRpcValue& params, XmlRpc::XmlRpcValue& result);
+  void hasParam(const std::string& caller_id, XmlRpc::XmlRpcValue& params, XmlRpc::XmlRpcValue& result);
+  void getParamNames(const std::string& caller_id, XmlRpc::XmlRpcValue& params, XmlRpc::XmlRpcValue& result);
+
+  void registerService(const std::string& caller_id, XmlRpc::XmlRpcValue& params, XmlRpc::XmlRpcValue& result);
+  void lookupService(const std::string& caller_id, XmlRpc::XmlRpcValue& params, XmlRpc::XmlRpcValue& result);
+  void unregisterService(const std::string& caller_id, XmlRpc::XmlRpcValue& params, XmlRpc::XmlRpcValue& result);
+  void registerSubscriber(const std::string& caller_id, XmlRpc::XmlRpcValue& params, XmlRpc::XmlRpcValue& result);
+  void unregisterSubscriber(const std::string& caller_id, XmlRpc::XmlRpcValue& params, XmlRpc::XmlRpcValue& result);
+  void registerPublisher(const std::string& caller_id, XmlRpc::XmlRpcValue& params, XmlRpc::XmlRpcValue& result);
+  void unregisterPublisher(const std::string& caller_id, XmlRpc::XmlRpcValue& params, XmlRpc::XmlRpcValue& result);
+  void lookupNode(const std::string& caller_id, XmlRpc::XmlRpcValue& params, XmlRpc::XmlRpcValue& result);
+  void getPublishedTopics(const std::string& caller_id, XmlRpc::XmlRpcValue& params, XmlRpc::XmlRpcValue& result);
+  void getTopicTypes(const std::string& caller_id, XmlRpc::XmlRpcValue& params, XmlRpc::XmlRpcValue& result);
+  void getSystemState(const std::string& caller_id, XmlRpc::XmlRpcValue& params, XmlRpc::XmlRpcValue& result);
+
+  void notifyTopicSubscribers(const std::string& topic);
+  void notifyParamSubscribers(const V_ParamUpdate& updates);
+  void paramUpdateDone(const std::string& caller_id, const std::string& caller_api, const std::string& key,
+                       bool ok, XmlRpc::XmlRpcValue& result);
+  void shutdownNode(const std::string& api, const std::string& caller_id);
+
+  int port_;
+  std::string uri_;
+  bool done_;
+
+  XmlRpc::XmlRpcServer server_;
+  M_Method methods_;
+  std::vector<ServerMethodPtr> server_methods_;   ///< Declared after server_, which they unregister from
+
+  boost::mutex mutex_;
+  RegistrationManager reg_manager_;
+  ParamServer param_server_;
+  typedef boost::unordered_map<std::string, std::string> M_string;
+  M_string topic_types_;
+
+  NotifierPtr notifier_;
+};
+
+} // namespace rosmaster
+
+#endif // ROSMASTER_MASTER_H
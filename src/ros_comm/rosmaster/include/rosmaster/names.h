@@ -0,0 +1,86 @@
+/*********************************************************************
+* Software License Agreement (BSD License)
+*
+*  Copyright (c) 2008, Willow Garage, Inc.
+*  All rights reserved.
+*
+*  Redistribution and use in source and binary forms, with or without
+*  modification, are permitted provided that the following conditions
+*  are met:
+*
+*   * Redistributions of source code must retain the above copyright
+*     notice, this list of conditions and the following disclaimer.
+*   * Redistributions in binary form must reproduce the above
+*     copyright notice, this list of conditions and the following
+*     disclaimer in the documentation and/or other materials provided
+*     with the distribution.
+*   * Neither the name of Willow Garage, Inc. nor the names of its
+*     contributors may be used to endorse or promote products derived
+*     from this software without specific prior written permission.
+*
+*  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+*  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+*  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+*  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+*  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+*  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+*  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+*  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+*  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+*  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+*  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+*  POSSIBILITY OF SUCH DAMAGE.
+********************************************************************/
+
+#ifndef ROSMASTER_NAMES_H
+#define ROSMASTER_NAMES_H
+
+#include <string>
+#include <vector>
+
+namespace rosmaster
+{
+
+/**
+ * \brief Graph resource name helpers, matching rosgraph.names for the subset the master uses.
+ */
+namespace names
+{
+
+const char SEP = '/';
+const char PRIV_NAME = '~';
+const std::string ANYTYPE = "*";
+
+bool isGlobal(const std::string& name);
+bool isPrivate(const std::string& name);
+
+/**
+ * \brief Split a name into its non-empty tokens, e.g. "/a//b/" -> ["a", "b"]
+ */
+void split(const std::string& name, std::vector<std::string>& tokens);
+
+/**
+ * \brief Put name in canonical form: no repeated or trailing separators
+ */
+std::string canonicalize(const std::string& name);
+
+/**
+ * \brief Namespace of name with a trailing separator, e.g. "/wg/node1" -> "/wg/"
+ */
+std::string parentNamespace(const std::string& name);
+
+/**
+ * \brief Join a namespace and a name, leaving global and private names untouched
+ */
+std::string join(const std::string& ns, const std::string& name);
+
+/**
+ * \brief Resolve name to its global, canonical form relative to the caller's node name
+ */
+std::string resolve(const std::string& name, const std::string& caller_id);
+
+} // namespace names
+
+} // namespace rosmaster
+
+#endif // ROSMASTER_NAMES_H
@@ -0,0 +1,141 @@
+/*********************************************************************
+* Software License Agreement (BSD License)
+*
+*  Copyright (c) 2008, Willow Garage, Inc.
+*  All rights reserved.
+*
+*  Redistribution and use in source and binary forms, with or without
+*  modification, are permitted provided that the following conditions
+*  are met:
+*
+*   * Redistributions of source code must retain the above copyright
+*     notice, this list of conditions and the following disclaimer.
+*   * Redistributions in binary form must reproduce the above
+*     copyright notice, this list of conditions and the following
+*     disclaimer in the documentation and/or other materials provided
+*     with the distribution.
+*   * Neither the name of Willow Garage, Inc. nor the names of its
+*     contributors may be used to endorse or promote products derived
+*     from this software without specific prior written permission.
+*
+*  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+*  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+*  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+*  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+*  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+*  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+*  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+*  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+*  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+*  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+*  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+*  POSSIBILITY OF SUCH DAMAGE.
+********************************************************************/
+
+#ifndef ROSMASTER_NOTIFIER_H
+#define ROSMASTER_NOTIFIER_H
+
+#include <deque>
+#include <string>
+#include <vector>
+
+#include <boost/function.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/thread.hpp>
+#include <boost/unordered_map.hpp>
+
+#include <xmlrpcpp/XmlRpcValue.h>
+
+namespace rosmaster
+{
+
+/**
+ * \brief Sends the master's callbacks (publisherUpdate, paramUpdate, shutdown) to nodes from a pool of threads.
+ *
+ * Calls to the same node go out one at a time and in order, while different nodes are contacted in
+ * parallel, so one slow or hung node only delays its own updates. A publisherUpdate for a topic that is
+ * still waiting to be sent is replaced by the newer list rather than queued behind it, so a storm of
+ * registrations costs each subscriber one call with the final list instead of one call per publisher.
+ */
+class Notifier
+{
+public:
+  /**
+   * \brief Performs one XML-RPC call to a node, returning false if the node could not be reached
+   */
+  typedef boost::function<bool(const std::string& api, const std::string& method,
+                               const XmlRpc::XmlRpcValue& params, XmlRpc::XmlRpcValue& result)> SendFunc;
+  /**
+   * \brief Called from a worker thread once a call has completed
+   */
+  typedef boost::function<void(bool ok, XmlRpc::XmlRpcValue& result)> DoneFunc;
+
+  /**
+   * \param num_workers Number of threads contacting nodes
+   * \param timeout Seconds to wait for a node to answer, negative to wait forever
+   * \param send Transport to use instead of XmlRpcClient, e.g. for benchmarks
+   */
+  Notifier(size_t num_workers, double timeout, const SendFunc& send = SendFunc());
+  ~Notifier();
+
+  void publisherUpdate(const std::string& api, const std::string& topic, const std::vector<std::string>& pub_uris);
+  void paramUpdate(const std::string& api, const std::string& key, const XmlRpc::XmlRpcValue& value,
+                   const DoneFunc& done = DoneFunc());
+  void shutdownNode(const std::string& api, const std::string& reason);
+
+  /**
+   * \brief Block until every queued call has been sent
+   */
+  void waitForIdle();
+
+  /**
+   * \brief Drop queued calls and stop the workers, without waiting for calls in progress
+   */
+  void shutdown();
+
+  size_t getSentCount();
+  size_t getCoalescedCount();
+
+private:
+  struct Task
+  {
+    std::string method;
+    std::string topic;              ///< For publisherUpdate, the topic used to coalesce updates
+    XmlRpc::XmlRpcValue params;
+    DoneFunc done;
+  };
+
+  struct Destination
+  {
+    Destination() : busy(false) {}
+
+    std::deque<Task> tasks;
+    bool busy;                      ///< A worker is sending this node's front task
+  };
+  typedef boost::unordered_map<std::string, Destination> M_Destination;
+
+  void enqueue(const std::string& api, Task& task);
+  void workerThread();
+  bool send(const std::string& api, const std::string& method, const XmlRpc::XmlRpcValue& params,
+            XmlRpc::XmlRpcValue& result);
+
+  double timeout_;
+  SendFunc send_;
+
+  boost::mutex mutex_;
+  boost::condition_variable ready_condition_;
+  boost::condition_variable idle_condition_;
+  M_Destination destinations_;
+  std::deque<std::string> ready_;   ///< Nodes with queued calls and no worker on them
+  size_t in_flight_;
+  size_t sent_;
+  size_t coalesced_;
+  bool shutting_down_;
+
+  boost::thread_group workers_;
+};
+typedef boost::shared_ptr<Notifier> NotifierPtr;
+
+} // namespace rosmaster
+
+#endif // ROSMASTER_NOTIFIER_H
@@ -0,0 +1,130 @@
+/*********************************************************************
+* Software License Agreement (BSD License)
+*
+*  Copyright (c) 2008, Willow Garage, Inc.
+*  All rights reserved.
+*
+*  Redistribution and use in source and binary forms, with or without
+*  modification, are permitted provided that the following conditions
+*  are met:
+*
+*   * Redistributions of source code must retain the above copyright
+*     notice, this list of conditions and the following disclaimer.
+*   * Redistributions in binary form must reproduce the above
+*     copyright notice, this list of conditions and the following
+*     disclaimer in the documentation and/or other materials provided
+*     with the distribution.
+*   * Neither the name of Willow Garage, Inc. nor the names of its
+*     contributors may be used to endorse or promote products derived
+*     from this software without specific prior written permission.
+*
+*  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+*  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+*  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+*  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+*  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+*  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+*  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+*  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+*  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+*  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+*  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+*  POSSIBILITY OF SUCH DAMAGE.
+********************************************************************/
+
+#ifndef ROSMASTER_PARAM_SERVER_H
+#define ROSMASTER_PARAM_SERVER_H
+
+#include "rosmaster/registrations.h"
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include <xmlrpcpp/XmlRpcValue.h>
+
+namespace rosmaster
+{
+
+/**
+ * \brief A paramUpdate to send: the new value of key, for each of subscribers
+ */
+struct ParamUpdate
+{
+  V_Provider subscribers;
+  std::string key;
+  XmlRpc::XmlRpcValue value;
+};
+typedef std::vector<ParamUpdate> V_ParamUpdate;
+
+/**
+ * \brief The parameter tree. Dictionaries are namespaces; every other value is a leaf.
+ *
+ * Mirrors rosmaster.paramserver.ParamDictionary. Not threadsafe; the master locks around it.
+ */
+class ParamServer
+{
+public:
+  explicit ParamServer(RegistrationManager& reg_manager);
+
+  /**
+   * \brief Look up a parameter, returning whole namespaces as structs
+   * \return false if key is not set
+   */
+  bool getParam(const std::string& key, XmlRpc::XmlRpcValue& value) const;
+  bool hasParam(const std::string& key) const;
+
+  /**
+   * \brief Set a parameter, replacing the whole namespace if value is a struct
+   * \param caller_id Subscriber not to notify of its own change
+   * \param updates Filled with the notifications the change requires
+   * \return false if key is the root and value is not a struct
+   */
+  bool setParam(const std::string& key, const XmlRpc::XmlRpcValue& value, const std::string& caller_id,
+                V_ParamUpdate& updates);
+
+  /**
+   * \return false if key is not set
+   */
+  bool deleteParam(const std::string& key, V_ParamUpdate& updates);
+
+  /**
+   * \brief Search upwards from the namespace ns for key, see the searchParam master API
+   * \return false if no namespace contains the first part of key
+   */
+  bool searchParam(const std::string& ns, const std::string& key, std::string& found) const;
+
+  void getParamNames(std::vector<std::string>& names) const;
+
+  /**
+   * \brief Register for updates of key, returning its current value or an empty struct if it is not set
+   */
+  void subscribeParam(const std::string& key, const std::string& caller_id, const std::string& caller_api,
+                      XmlRpc::XmlRpcValue& value);
+  void unsubscribeParam(const std::string& key, const std::string& caller_id, const std::string& caller_api);
+
+private:
+  struct Node
+  {
+    typedef std::map<std::string, Node> M_Node;
+
+    bool isNamespace() const { return !value.valid(); }
+    void toXmlRpc(XmlRpc::XmlRpcValue& out) const;
+    void fromXmlRpc(const XmlRpc::XmlRpcValue& in);
+    void getNames(const std::string& ns, std::vector<std::string>& param_names) const;
+
+    XmlRpc::XmlRpcValue value;  ///< Leaf value, invalid for namespaces
+    M_Node children;
+  };
+
+  const Node* find(const std::string& key) const;
+  void computeUpdates(const std::string& key, const XmlRpc::XmlRpcValue& value, const std::string& caller_id,
+                      V_ParamUpdate& updates) const;
+
+  Node root_;
+  RegistrationManager& reg_manager_;
+};
+
+} // namespace rosmaster
+
+#endif // ROSMASTER_PARAM_SERVER_H
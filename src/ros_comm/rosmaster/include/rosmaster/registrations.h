@@ -0,0 +1,213 @@
+/*********************************************************************
+* Software License Agreement (BSD License)
+*
+*  Copyright (c) 2008, Willow Garage, Inc.
+*  All rights reserved.
+*
+*  Redistribution and use in source and binary forms, with or without
+*  modification, are permitted provided that the following conditions
+*  are met:
+*
+*   * Redistributions of source code must retain the above copyright
+*     notice, this list of conditions and the following disclaimer.
+*   * Redistributions in binary form must reproduce the above
+*     copyright notice, this list of conditions and the following
+*     disclaimer in the documentation and/or other materials provided
+*     with the distribution.
+*   * Neither the name of Willow Garage, Inc. nor the names of its
+*     contributors may be used to endorse or promote products derived
+*     from this software without specific prior written permission.
+*
+*  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+*  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+*  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+*  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+*  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+*  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+*  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+*  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+*  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+*  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+*  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+*  POSSIBILITY OF SUCH DAMAGE.
+********************************************************************/
+
+#ifndef ROSMASTER_REGISTRATIONS_H
+#define ROSMASTER_REGISTRATIONS_H
+
+#include <set>
+#include <string>
+#include <vector>
+
+#include <boost/function.hpp>
+#include <boost/unordered_map.hpp>
+
+#include <xmlrpcpp/XmlRpcValue.h>
+
+namespace rosmaster
+{
+
+struct Provider
+{
+  Provider() {}
+  Provider(const std::string& id, const std::string& api)
+  : caller_id(id)
+  , caller_api(api)
+  {}
+
+  bool operator==(const Provider& rhs) const
+  {
+    return caller_id == rhs.caller_id && caller_api == rhs.caller_api;
+  }
+
+  std::string caller_id;
+  std::string caller_api;
+};
+typedef std::vector<Provider> V_Provider;
+
+/**
+ * \brief Multimap from registration key (topic, service or parameter name) to its providers.
+ *
+ * Keys are hashed, so lookups do not depend on how many topics are registered. Services only
+ * keep the most recent provider, along with its service URI.
+ */
+class Registrations
+{
+public:
+  enum Type
+  {
+    TOPIC_SUBSCRIPTIONS = 1,
+    TOPIC_PUBLICATIONS = 2,
+    SERVICE = 3,
+    PARAM_SUBSCRIPTIONS = 4,
+  };
+
+  explicit Registrations(Type type);
+
+  Type getType() const { return type_; }
+  bool empty() const { return map_.empty(); }
+  size_t size() const { return map_.size(); }
+  bool hasKey(const std::string& key) const;
+
+  /**
+   * \brief Providers of key, or an empty list if it is not registered
+   */
+  const V_Provider& get(const std::string& key) const;
+  void getApis(const std::string& key, std::vector<std::string>& apis) const;
+  void getKeys(std::vector<std::string>& keys) const;
+
+  /**
+   * \brief Keys that start with prefix, in order. Only maintained for PARAM_SUBSCRIPTIONS.
+   */
+  void getKeysWithPrefix(const std::string& prefix, std::vector<std::string>& keys) const;
+
+  /**
+   * \brief Service URI of the current provider of service, or an empty string
+   */
+  std::string getServiceApi(const std::string& service) const;
+
+  /**
+   * \brief State in getSystemState() format: [ [key, [caller_id...]] ... ]
+   */
+  void getState(XmlRpc::XmlRpcValue& state) const;
+
+  void add(const std::string& key, const std::string& caller_id, const std::string& caller_api,
+           const std::string& service_api = std::string());
+
+  /**
+   * \brief Remove a registration, filling code/msg/val for the master API
+   * \return true if a registration was removed
+   */
+  bool remove(const std::string& key, const std::string& caller_id, const std::string& caller_api,
+              const std::string& service_api, XmlRpc::XmlRpcValue& result);
+
+  /**
+   * \brief Remove every registration of caller_id among keys
+   */
+  void removeAll(const std::string& caller_id, const std::set<std::string>& keys);
+
+private:
+  void eraseKey(const std::string& key);
+
+  Type type_;
+  typedef boost::unordered_map<std::string, V_Provider> M_Providers;
+  M_Providers map_;
+  typedef boost::unordered_map<std::string, Provider> M_ServiceApi;
+  M_ServiceApi service_api_map_;   ///< service -> (caller_id, service_api)
+  std::set<std::string> ordered_keys_;
+};
+
+/**
+ * \brief What the master knows about a node: its XML-RPC URI and the keys it registered, by type.
+ *
+ * The keys make dropping all of a node's registrations proportional to what it registered,
+ * instead of a scan over every key in the graph.
+ */
+struct NodeRef
+{
+  NodeRef() {}
+  NodeRef(const std::string& id, const std::string& node_api)
+  : caller_id(id)
+  , api(node_api)
+  {}
+
+  std::set<std::string>& keys(Registrations::Type type) { return keys_[type - 1]; }
+  bool empty() const;
+
+  std::string caller_id;
+  std::string api;
+
+private:
+  std::set<std::string> keys_[4];
+};
+
+/**
+ * \brief All registrations of the master, indexed by node. Not threadsafe; the master locks around it.
+ */
+class RegistrationManager
+{
+public:
+  /**
+   * \brief Called with (api, caller_id) of a node that was replaced by another one of the same name
+   */
+  typedef boost::function<void(const std::string&, const std::string&)> ShutdownNodeFunc;
+
+  explicit RegistrationManager(const ShutdownNodeFunc& shutdown_node = ShutdownNodeFunc());
+
+  const NodeRef* getNode(const std::string& caller_id) const;
+
+  void registerService(const std::string& service, const std::string& caller_id, const std::string& caller_api,
+                       const std::string& service_api);
+  void registerPublisher(const std::string& topic, const std::string& caller_id, const std::string& caller_api);
+  void registerSubscriber(const std::string& topic, const std::string& caller_id, const std::string& caller_api);
+  void registerParamSubscriber(const std::string& param, const std::string& caller_id, const std::string& caller_api);
+
+  bool unregisterService(const std::string& service, const std::string& caller_id, const std::string& service_api,
+                         XmlRpc::XmlRpcValue& result);
+  bool unregisterPublisher(const std::string& topic, const std::string& caller_id, const std::string& caller_api,
+                           XmlRpc::XmlRpcValue& result);
+  bool unregisterSubscriber(const std::string& topic, const std::string& caller_id, const std::string& caller_api,
+                            XmlRpc::XmlRpcValue& result);
+  bool unregisterParamSubscriber(const std::string& param, const std::string& caller_id, const std::string& caller_api,
+                                 XmlRpc::XmlRpcValue& result);
+
+  Registrations publishers;
+  Registrations subscribers;
+  Registrations services;
+  Registrations param_subscribers;
+
+private:
+  void registerKey(Registrations& r, const std::string& key, const std::string& caller_id,
+                   const std::string& caller_api, const std::string& service_api = std::string());
+  bool unregisterKey(Registrations& r, const std::string& key, const std::string& caller_id,
+                     const std::string& caller_api, const std::string& service_api, XmlRpc::XmlRpcValue& result);
+  NodeRef& registerNodeApi(const std::string& caller_id, const std::string& caller_api);
+
+  typedef boost::unordered_map<std::string, NodeRef> M_NodeRef;
+  M_NodeRef nodes_;
+  ShutdownNodeFunc shutdown_node_;
+};
+
+} // namespace rosmaster
+
+#endif // ROSMASTER_REGISTRATIONS_H
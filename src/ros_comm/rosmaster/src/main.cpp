@@ -0,0 +1,166 @@
+/*********************************************************************
+* Software License Agreement (BSD License)
+*
+*  Copyright (c) 2008, Willow Garage, Inc.
+*  All rights reserved.
+*
+*  Redistribution and use in source and binary forms, with or without
+*  modification, are permitted provided that the following conditions
+*  are met:
+*
+*   * Redistributions of source code must retain the above copyright
+*     notice, this list of conditions and the following disclaimer.
+*   * Redistributions in binary form must reproduce the above
+*     copyright notice, this list of conditions and the following
+*     disclaimer in the documentation and/or other materials provided
+*     with the distribution.
+*   * Neither the name of Willow Garage, Inc. nor the names of its
+*     contributors may be used to endorse or promote products derived
+*     from this software without specific prior written permission.
+*
+*  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+*  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+*  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+*  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+*  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+*  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+*  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+*  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+*  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+*  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+*  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+*  POSSIBILITY OF SUCH DAMAGE.
+********************************************************************/
+
+/*
+ * Command-line compatible with the rosmaster script, so roslaunch can start either:
+ *
+ *   rosmaster_cpp --core -p PORT -w NUM_WORKERS [-t TIMEOUT] [--master-logger-level LEVEL]
+ */
+
+#include "rosmaster/master.h"
+
+#include <algorithm>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+#include <boost/algorithm/string.hpp>
+
+#include <ros/console.h>
+
+namespace
+{
+
+volatile sig_atomic_t g_shutdown_requested = 0;
+
+void signalHandler(int)
+{
+  g_shutdown_requested = 1;
+}
+
+void usage(const char* prog)
+{
+  fprintf(stderr, "usage: %s [--core] [-p PORT] [-w NUM_WORKERS] [-t TIMEOUT] [--master-logger-level LEVEL]\n", prog);
+}
+
+bool setLoggerLevel(const std::string& level_name)
+{
+  ros::console::Level level;
+  std::string name = boost::algorithm::to_lower_copy(level_name);
+  if (name == "debug")
+    level = ros::console::levels::Debug;
+  else if (name == "info")
+    level = ros::console::levels::Info;
+  else if (name == "warn")
+    level = ros::console::levels::Warn;
+  else if (name == "error")
+    level = ros::console::levels::Error;
+  else if (name == "fatal")
+    level = ros::console::levels::Fatal;
+  else
+    return false;
+
+  if (ros::console::set_logger_level(ROSCONSOLE_DEFAULT_NAME ".master", level))
+  {
+    ros::console::notifyLoggerLevelsChanged();
+  }
+  return true;
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+  bool core = false;
+  int port = rosmaster::DEFAULT_MASTER_PORT;
+  size_t num_workers = rosmaster::NUM_WORKERS;
+  double timeout = -1.0;
+  std::string logger_level;
+
+  for (int i = 1; i < argc; ++i)
+  {
+    std::string arg = argv[i];
+    bool has_value = i + 1 < argc;
+    if (arg == "--core")
+    {
+      core = true;
+    }
+    else if ((arg == "-p" || arg == "--port") && has_value)
+    {
+      port = atoi(argv[++i]);
+    }
+    else if ((arg == "-w" || arg == "--numworkers") && has_value)
+    {
+      num_workers = static_cast<size_t>(std::max(atoi(argv[++i]), 1));
+    }
+    else if ((arg == "-t" || arg == "--timeout") && has_value)
+    {
+      timeout = atof(argv[++i]);
+    }
+    else if (arg == "--master-logger-level" && has_value)
+    {
+      logger_level = argv[++i];
+    }
+    else if (arg.compare(0, 7, "__log:=") == 0)
+    {
+      // Log file remapping, as accepted by the rosmaster script
+    }
+    else
+    {
+      fprintf(stderr, "unrecognized arg: %s\n", arg.c_str());
+      usage(argv[0]);
+      return 2;
+    }
+  }
+
+  if (!core)
+  {
+    fprintf(stderr, "Standalone rosmaster has been deprecated, please use 'roscore' instead\n");
+  }
+
+  if (!logger_level.empty() && !setLoggerLevel(logger_level))
+  {
+    ROS_ERROR("--master-logger-level received unknown option '%s'", logger_level.c_str());
+  }
+
+  rosmaster::Master master(port, num_workers, timeout);
+  if (!master.start())
+  {
+    ROS_FATAL("Unable to start the master on port %d", port);
+    return 1;
+  }
+
+  signal(SIGINT, signalHandler);
+  signal(SIGTERM, signalHandler);
+
+  while (master.ok() && !g_shutdown_requested)
+  {
+    master.spinOnce(0.1);
+  }
+
+  master.stop();
+  return 0;
+}
@@ -0,0 +1,691 @@
+/*********************************************************************
+* Software License Agreement (BSD License)
+*
+*  Copyright (c) 2008, Willow Garage, Inc.
+*  All rights reserved.
+*
+*  Redistribution and use in source and binary forms, with or without
+*  modification, are permitted provided that the following conditions
+*  are met:
+*
+*   * Redistributions of source code must retain the above copyright
+*     notice, this list of conditions and the following disclaimer.
+*   * Redistributions in binary form must reproduce the above
+*     copyright notice, this list of conditions and the following
+*     disclaimer in the documentation and/or other materials provided
+*     with the distribution.
+*   * Neither the name of Willow Garage, Inc. nor the names of its
+*     contributors may be used to endorse or promote products derived
+*     from this software without specific prior written permission.
+*
+*  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+*  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+*  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+*  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+*  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+*  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+*  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+*  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+*  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+*  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+*  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+*  POSSIBILITY OF SUCH DAMAGE.
+********************************************************************/
+
+#include "rosmaster/master.h"
+#include "rosmaster/names.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <stdexcept>
+#include <unistd.h>
+
+#include <boost/bind/bind.hpp>
+#include <boost/lexical_cast.hpp>
+
+#include <ros/console.h>
+#include <xmlrpcpp/XmlRpcException.h>
+#include <xmlrpcpp/XmlRpcServerMethod.h>
+
+using XmlRpc::XmlRpcValue;
+
+namespace rosmaster
+{
+
+namespace
+{
+
+/**
+ * \brief Raised by the validators below, and reported to the caller as code -1
+ */
+class ParameterInvalid : public std::runtime_error
+{
+public:
+  explicit ParameterInvalid(const std::string& msg)
+  : std::runtime_error(msg)
+  {}
+};
+
+void setResult(XmlRpcValue& result, int code, const std::string& msg, const XmlRpcValue& val)
+{
+  result.clear();
+  result[0] = code;
+  result[1] = msg;
+  result[2] = val;
+}
+
+XmlRpcValue emptyArray()
+{
+  XmlRpcValue value;
+  value.setSize(0);
+  return value;
+}
+
+const std::string& nonEmptyString(const XmlRpcValue& value, const std::string& name)
+{
+  if (value.getType() != XmlRpcValue::TypeString)
+  {
+    throw ParameterInvalid("ERROR: parameter [" + name + "] must be a string");
+  }
+  const std::string& str = value;
+  if (str.empty())
+  {
+    throw ParameterInvalid("ERROR: parameter [" + name + "] must be specified and non-empty");
+  }
+  return str;
+}
+
+const std::string& api(const XmlRpcValue& value, const std::string& name)
+{
+  if (value.getType() != XmlRpcValue::TypeString || static_cast<const std::string&>(value).empty())
+  {
+    throw ParameterInvalid("ERROR: parameter [" + name + "] is not an XMLRPC URI");
+  }
+  const std::string& str = value;
+  if (str.compare(0, 7, "http://") != 0 && str.compare(0, 9, "rosrpc://") != 0)
+  {
+    throw ParameterInvalid("ERROR: parameter [" + name + "] is not an RPC URI");
+  }
+  return str;
+}
+
+std::string validName(const XmlRpcValue& value, const std::string& name, const std::string& caller_id)
+{
+  if (value.getType() != XmlRpcValue::TypeString || static_cast<const std::string&>(value).empty())
+  {
+    throw ParameterInvalid("ERROR: parameter [" + name + "] must be a non-empty string");
+  }
+  const std::string& str = value;
+  if (str.find_first_of(": ") != std::string::npos)
+  {
+    throw ParameterInvalid("ERROR: parameter [" + name + "] contains illegal chars");
+  }
+  return names::resolve(str, caller_id);
+}
+
+std::string emptyOrValidName(const XmlRpcValue& value, const std::string& name, const std::string& caller_id)
+{
+  if (value.getType() != XmlRpcValue::TypeString)
+  {
+    throw ParameterInvalid("ERROR: parameter [" + name + "] must be a string");
+  }
+  const std::string& str = value;
+  if (str.empty())
+  {
+    return str;
+  }
+  return names::resolve(str, caller_id);
+}
+
+/**
+ * \brief Topics and services: valid names other than the global namespace
+ */
+std::string graphName(const XmlRpcValue& value, const std::string& name, const std::string& caller_id)
+{
+  std::string resolved = validName(value, name, caller_id);
+  if (static_cast<const std::string&>(value) == "/")
+  {
+    throw ParameterInvalid("ERROR: parameter [" + name + "] cannot be the global namespace");
+  }
+  return resolved;
+}
+
+const std::string& typeName(const XmlRpcValue& value, const std::string& name)
+{
+  if (value.getType() != XmlRpcValue::TypeString || static_cast<const std::string&>(value).empty())
+  {
+    throw ParameterInvalid("ERROR: parameter [" + name + "] must be a non-empty string");
+  }
+  const std::string& str = value;
+  if (str == names::ANYTYPE)
+  {
+    return str;
+  }
+  std::string::size_type sep = str.find('/');
+  if (sep == std::string::npos || str.find('/', sep + 1) != std::string::npos)
+  {
+    throw ParameterInvalid("ERROR: parameter [" + name + "] is not a valid package resource name");
+  }
+  return str;
+}
+
+XmlRpcValue toXmlRpc(const std::vector<std::string>& strings)
+{
+  XmlRpcValue value = emptyArray();
+  for (size_t i = 0; i < strings.size(); ++i)
+  {
+    value[static_cast<int>(i)] = strings[i];
+  }
+  return value;
+}
+
+std::string getHostName()
+{
+  const char* host = getenv("ROS_HOSTNAME");
+  if (!host || !*host)
+  {
+    host = getenv("ROS_IP");
+  }
+  if (host && *host)
+  {
+    return host;
+  }
+
+  char buf[256];
+  if (gethostname(buf, sizeof(buf)) != 0)
+  {
+    return "localhost";
+  }
+  buf[sizeof(buf) - 1] = '\0';
+  return buf;
+}
+
+} // namespace
+
+/**
+ * \brief Forwards an XML-RPC method of the server to Master::call()
+ */
+class Master::ServerMethod : public XmlRpc::XmlRpcServerMethod
+{
+public:
+  ServerMethod(const std::string& name, Master* master)
+  : XmlRpc::XmlRpcServerMethod(name, &master->server_)
+  , master_(master)
+  {}
+
+  void execute(XmlRpcValue& params, XmlRpcValue& result)
+  {
+    master_->call(name(), params, result);
+  }
+
+private:
+  Master* master_;
+};
+
+Master::Master(int port, size_t num_workers, double timeout, const Notifier::SendFunc& send)
+: port_(port)
+, done_(false)
+, reg_manager_(boost::bind(&Master::shutdownNode, this, boost::placeholders::_1, boost::placeholders::_2))
+, param_server_(reg_manager_)
+, notifier_(new Notifier(num_workers, timeout, send))
+{
+  XmlRpcValue zero(0);
+  XmlRpcValue empty_string("");
+
+  addMethod("shutdown", &Master::shutdown, 2, zero);
+  addMethod("getUri", &Master::getUri, 1, empty_string);
+  addMethod("getPid", &Master::getPid, 1, XmlRpcValue(-1));
+
+  addMethod("deleteParam", &Master::deleteParam, 2, zero);
+  addMethod("setParam", &Master::setParam, 3, zero);
+  addMethod("getParam", &Master::getParam, 2, zero);
+  addMethod("searchParam", &Master::searchParam, 2, zero);
+  addMethod("subscribeParam", &Master::subscribeParam, 3, zero);
+  addMethod("unsubscribeParam", &Master::unsubscribeParam, 3, zero);
+  addMethod("hasParam", &Master::hasParam, 2, XmlRpcValue(false));
+  addMethod("getParamNames", &Master::getParamNames, 1, emptyArray());
+
+  addMethod("registerService", &Master::registerService, 4, zero);
+  addMethod("lookupService", &Master::lookupService, 2, empty_string);
+  addMethod("unregisterService", &Master::unregisterService, 3, zero);
+  addMethod("registerSubscriber", &Master::registerSubscriber, 4, emptyArray());
+  addMethod("unregisterSubscriber", &Master::unregisterSubscriber, 3, zero);
+  addMethod("registerPublisher", &Master::registerPublisher, 4, emptyArray());
+  addMethod("unregisterPublisher", &Master::unregisterPublisher, 3, zero);
+  addMethod("lookupNode", &Master::lookupNode, 2, empty_string);
+  addMethod("getPublishedTopics", &Master::getPublishedTopics, 2, zero);
+  addMethod("getTopicTypes", &Master::getTopicTypes, 1, emptyArray());
+
+  XmlRpcValue empty_state;
+  empty_state[0] = emptyArray();
+  empty_state[1] = emptyArray();
+  empty_state[2] = emptyArray();
+  addMethod("getSystemState", &Master::getSystemState, 1, empty_state);
+}
+
+Master::~Master()
+{
+  stop();
+  // Workers may still be calling back into the registrations, so they go first
+  notifier_.reset();
+}
+
+void Master::addMethod(const std::string& name, Handler handler, int num_params, const XmlRpcValue& error_value)
+{
+  Method& method = methods_[name];
+  method.handler = handler;
+  method.num_params = num_params;
+  method.error_value = error_value;
+  server_methods_.push_back(ServerMethodPtr(new ServerMethod(name, this)));
+}
+
+bool Master::start()
+{
+  if (!server_.bindAndListen(port_))
+  {
+    return false;
+  }
+
+  port_ = server_.get_port();
+  uri_ = "http://" + getHostName() + ":" + boost::lexical_cast<std::string>(port_) + "/";
+  ROS_INFO_NAMED("master", "Master initialized: port[%d], uri[%s]", port_, uri_.c_str());
+  return true;
+}
+
+void Master::spin()
+{
+  while (ok())
+  {
+    spinOnce(0.1);
+  }
+}
+
+void Master::spinOnce(double timeout)
+{
+  server_.work(timeout);
+}
+
+void Master::stop()
+{
+  {
+    boost::mutex::scoped_lock lock(mutex_);
+    done_ = true;
+  }
+  if (notifier_)
+  {
+    notifier_->shutdown();
+  }
+  server_.shutdown();
+}
+
+bool Master::ok() const
+{
+  boost::mutex::scoped_lock lock(const_cast<boost::mutex&>(mutex_));
+  return !done_;
+}
+
+void Master::call(const std::string& method_name, XmlRpcValue& params, XmlRpcValue& result)
+{
+  M_Method::const_iterator it = methods_.find(method_name);
+  if (it == methods_.end())
+  {
+    setResult(result, -1, "unknown method [" + method_name + "]", XmlRpcValue(0));
+    return;
+  }
+  const Method& method = it->second;
+
+  if (params.getType() != XmlRpcValue::TypeArray || params.size() == 0)
+  {
+    ROS_ERROR_NAMED("master", "%s invoked without caller_id parameter", method_name.c_str());
+    setResult(result, -1, "missing required caller_id parameter", method.error_value);
+    return;
+  }
+  if (params.size() != method.num_params)
+  {
+    setResult(result, -1, "Error: bad call arity", method.error_value);
+    return;
+  }
+  if (params[0].getType() != XmlRpcValue::TypeString)
+  {
+    ROS_ERROR_NAMED("master", "%s: invalid caller_id param type", method_name.c_str());
+    setResult(result, -1, "caller_id must be a string", method.error_value);
+    return;
+  }
+  std::string caller_id = params[0];
+
+  try
+  {
+    boost::mutex::scoped_lock lock(mutex_);
+    (this->*method.handler)(caller_id, params, result);
+  }
+  catch (ParameterInvalid& e)
+  {
+    ROS_ERROR_NAMED("master", "%s: invalid parameter: %s", method_name.c_str(), e.what());
+    setResult(result, -1, e.what(), method.error_value);
+  }
+  catch (XmlRpc::XmlRpcException& e)
+  {
+    ROS_ERROR_NAMED("master", "%s: %s", method_name.c_str(), e.getMessage().c_str());
+    setResult(result, 0, "Internal failure: " + e.getMessage(), method.error_value);
+  }
+  catch (std::exception& e)
+  {
+    ROS_ERROR_NAMED("master", "%s: %s", method_name.c_str(), e.what());
+    setResult(result, 0, std::string("Internal failure: ") + e.what(), method.error_value);
+  }
+}
+
+void Master::shutdown(const std::string& caller_id, XmlRpcValue& params, XmlRpcValue& result)
+{
+  std::string msg = (params[1].getType() == XmlRpcValue::TypeString) ? static_cast<std::string&>(params[1]) : "";
+  if (!msg.empty())
+  {
+    printf("shutdown request: %s\n", msg.c_str());
+  }
+  else
+  {
+    printf("shutdown request\n");
+  }
+  ROS_INFO_NAMED("master", "external shutdown request from [%s]: %s", caller_id.c_str(), msg.c_str());
+  done_ = true;
+  notifier_->shutdown();
+  setResult(result, 1, "shutdown", XmlRpcValue(0));
+}
+
+void Master::getUri(const std::string&, XmlRpcValue&, XmlRpcValue& result)
+{
+  setResult(result, 1, "", XmlRpcValue(uri_));
+}
+
+void Master::getPid(const std::string&, XmlRpcValue&, XmlRpcValue& result)
+{
+  setResult(result, 1, "", XmlRpcValue(static_cast<int>(getpid())));
+}
+
+void Master::deleteParam(const std::string& caller_id, XmlRpcValue& params, XmlRpcValue& result)
+{
+  std::string key = names::resolve(nonEmptyString(params[1], "key"), caller_id);
+  V_ParamUpdate updates;
+  if (!param_server_.deleteParam(key, updates))
+  {
+    setResult(result, -1, "parameter [" + key + "] is not set", XmlRpcValue(0));
+    return;
+  }
+  notifyParamSubscribers(updates);
+  ROS_DEBUG_NAMED("master", "-PARAM [%s] by %s", key.c_str(), caller_id.c_str());
+  setResult(result, 1, "parameter " + key + " deleted", XmlRpcValue(0));
+}
+
+void Master::setParam(const std::string& caller_id, XmlRpcValue& params, XmlRpcValue& result)
+{
+  std::string key = names::resolve(nonEmptyString(params[1], "key"), caller_id);
+  if (!params[2].valid())
+  {
+    throw ParameterInvalid("ERROR: parameter [value] must be specified");
+  }
+
+  V_ParamUpdate updates;
+  if (!param_server_.setParam(key, params[2], caller_id, updates))
+  {
+    setResult(result, 0, "Internal failure: cannot set root of parameter tree to non-dictionary", XmlRpcValue(0));
+    return;
+  }
+  notifyParamSubscribers(updates);
+  ROS_DEBUG_NAMED("master", "+PARAM [%s] by %s", key.c_str(), caller_id.c_str());
+  setResult(result, 1, "parameter " + key + " set", XmlRpcValue(0));
+}
+
+void Master::getParam(const std::string& caller_id, XmlRpcValue& params, XmlRpcValue& result)
+{
+  std::string key = names::resolve(nonEmptyString(params[1], "key"), caller_id);
+  XmlRpcValue value;
+  if (!param_server_.getParam(key, value))
+  {
+    setResult(result, -1, "Parameter [" + key + "] is not set", XmlRpcValue(0));
+    return;
+  }
+  setResult(result, 1, "Parameter [" + key + "]", value);
+}
+
+void Master::searchParam(const std::string& caller_id, XmlRpcValue& params, XmlRpcValue& result)
+{
+  const std::string& key = nonEmptyString(params[1], "key");
+  std::string found;
+  if (!param_server_.searchParam(caller_id, key, found))
+  {
+    setResult(result, -1, "Cannot find parameter [" + key + "] in an upwards search", XmlRpcValue(""));
+    return;
+  }
+  setResult(result, 1, "Found [" + found + "]", XmlRpcValue(found));
+}
+
+void Master::subscribeParam(const std::string& caller_id, XmlRpcValue& params, XmlRpcValue& result)
+{
+  const std::string& caller_api = api(params[1], "caller_api");
+  std::string key = names::resolve(nonEmptyString(params[2], "key"), caller_id);
+  XmlRpcValue value;
+  param_server_.subscribeParam(key, caller_id, caller_api, value);
+  ROS_DEBUG_NAMED("master", "+CACHEDPARAM [%s] by %s", key.c_str(), caller_id.c_str());
+  setResult(result, 1, "Subscribed to parameter [" + key + "]", value);
+}
+
+void Master::unsubscribeParam(const std::string& caller_id, XmlRpcValue& params, XmlRpcValue& result)
+{
+  const std::string& caller_api = api(params[1], "caller_api");
+  std::string key = names::resolve(nonEmptyString(params[2], "key"), caller_id);
+  param_server_.unsubscribeParam(key, caller_id, caller_api);
+  ROS_DEBUG_NAMED("master", "-CACHEDPARAM [%s] by %s", key.c_str(), caller_id.c_str());
+  setResult(result, 1, "Unsubscribe to parameter [" + key + "]", XmlRpcValue(1));
+}
+
+void Master::hasParam(const std::string& caller_id, XmlRpcValue& params, XmlRpcValue& result)
+{
+  std::string key = names::resolve(nonEmptyString(params[1], "key"), caller_id);
+  setResult(result, 1, key, XmlRpcValue(param_server_.hasParam(key)));
+}
+
+void Master::getParamNames(const std::string&, XmlRpcValue&, XmlRpcValue& result)
+{
+  std::vector<std::string> param_names;
+  param_server_.getParamNames(param_names);
+  setResult(result, 1, "Parameter names", toXmlRpc(param_names));
+}
+
+void Master::registerService(const std::string& caller_id, XmlRpcValue& params, XmlRpcValue& result)
+{
+  std::string service = graphName(params[1], "service", caller_id);
+  const std::string& service_api = api(params[2], "service_api");
+  const std::string& caller_api = api(params[3], "caller_api");
+  reg_manager_.registerService(service, caller_id, caller_api, service_api);
+  ROS_DEBUG_NAMED("master", "+SERVICE [%s] %s %s", service.c_str(), caller_id.c_str(), caller_api.c_str());
+  setResult(result, 1, "Registered [" + caller_id + "] as provider of [" + service + "]", XmlRpcValue(1));
+}
+
+void Master::lookupService(const std::string& caller_id, XmlRpcValue& params, XmlRpcValue& result)
+{
+  std::string service = graphName(params[1], "service", caller_id);
+  std::string service_api = reg_manager_.services.getServiceApi(service);
+  if (service_api.empty())
+  {
+    setResult(result, -1, "no provider", XmlRpcValue(""));
+    return;
+  }
+  setResult(result, 1, "rosrpc URI: [" + service_api + "]", XmlRpcValue(service_api));
+}
+
+void Master::unregisterService(const std::string& caller_id, XmlRpcValue& params, XmlRpcValue& result)
+{
+  std::string service = graphName(params[1], "service", caller_id);
+  const std::string& service_api = api(params[2], "service_api");
+  reg_manager_.unregisterService(service, caller_id, service_api, result);
+  ROS_DEBUG_NAMED("master", "-SERVICE [%s] %s %s", service.c_str(), caller_id.c_str(), service_api.c_str());
+}
+
+void Master::registerSubscriber(const std::string& caller_id, XmlRpcValue& params, XmlRpcValue& result)
+{
+  std::string topic = graphName(params[1], "topic", caller_id);
+  const std::string& topic_type = typeName(params[2], "topic_type");
+  const std::string& caller_api = api(params[3], "caller_api");
+
+  reg_manager_.registerSubscriber(topic, caller_id, caller_api);
+  if (topic_type != names::ANYTYPE)
+  {
+    topic_types_.insert(std::make_pair(topic, topic_type));
+  }
+  ROS_DEBUG_NAMED("master", "+SUB [%s] %s %s", topic.c_str(), caller_id.c_str(), caller_api.c_str());
+
+  std::vector<std::string> pub_uris;
+  reg_manager_.publishers.getApis(topic, pub_uris);
+  setResult(result, 1, "Subscribed to [" + topic + "]", toXmlRpc(pub_uris));
+}
+
+void Master::unregisterSubscriber(const std::string& caller_id, XmlRpcValue& params, XmlRpcValue& result)
+{
+  std::string topic = graphName(params[1], "topic", caller_id);
+  const std::string& caller_api = api(params[2], "caller_api");
+  reg_manager_.unregisterSubscriber(topic, caller_id, caller_api, result);
+  ROS_DEBUG_NAMED("master", "-SUB [%s] %s %s", topic.c_str(), caller_id.c_str(), caller_api.c_str());
+}
+
+void Master::registerPublisher(const std::string& caller_id, XmlRpcValue& params, XmlRpcValue& result)
+{
+  std::string topic = graphName(params[1], "topic", caller_id);
+  const std::string& topic_type = typeName(params[2], "topic_type");
+  const std::string& caller_api = api(params[3], "caller_api");
+
+  reg_manager_.registerPublisher(topic, caller_id, caller_api);
+  if (topic_type != names::ANYTYPE || topic_types_.find(topic) == topic_types_.end())
+  {
+    topic_types_[topic] = topic_type;
+  }
+  notifyTopicSubscribers(topic);
+  ROS_DEBUG_NAMED("master", "+PUB [%s] %s %s", topic.c_str(), caller_id.c_str(), caller_api.c_str());
+
+  std::vector<std::string> sub_uris;
+  reg_manager_.subscribers.getApis(topic, sub_uris);
+  setResult(result, 1, "Registered [" + caller_id + "] as publisher of [" + topic + "]", toXmlRpc(sub_uris));
+}
+
+void Master::unregisterPublisher(const std::string& caller_id, XmlRpcValue& params, XmlRpcValue& result)
+{
+  std::string topic = graphName(params[1], "topic", caller_id);
+  const std::string& caller_api = api(params[2], "caller_api");
+  if (reg_manager_.unregisterPublisher(topic, caller_id, caller_api, result))
+  {
+    notifyTopicSubscribers(topic);
+  }
+  ROS_DEBUG_NAMED("master", "-PUB [%s] %s %s", topic.c_str(), caller_id.c_str(), caller_api.c_str());
+}
+
+void Master::lookupNode(const std::string& caller_id, XmlRpcValue& params, XmlRpcValue& result)
+{
+  std::string node_name = validName(params[1], "node", caller_id);
+  const NodeRef* node = reg_manager_.getNode(node_name);
+  if (!node)
+  {
+    setResult(result, -1, "unknown node [" + node_name + "]", XmlRpcValue(""));
+    return;
+  }
+  setResult(result, 1, "node api", XmlRpcValue(node->api));
+}
+
+void Master::getPublishedTopics(const std::string& caller_id, XmlRpcValue& params, XmlRpcValue& result)
+{
+  std::string subgraph = emptyOrValidName(params[1], "subgraph", caller_id);
+  if (!subgraph.empty() && subgraph[subgraph.size() - 1] != names::SEP)
+  {
+    subgraph += names::SEP;
+  }
+
+  std::vector<std::string> topics;
+  reg_manager_.publishers.getKeys(topics);
+  XmlRpcValue value = emptyArray();
+  int count = 0;
+  for (size_t i = 0; i < topics.size(); ++i)
+  {
+    if (topics[i].compare(0, subgraph.size(), subgraph) != 0)
+    {
+      continue;
+    }
+    XmlRpcValue entry;
+    entry[0] = topics[i];
+    entry[1] = topic_types_[topics[i]];
+    value[count++] = entry;
+  }
+  setResult(result, 1, "current topics", value);
+}
+
+void Master::getTopicTypes(const std::string&, XmlRpcValue&, XmlRpcValue& result)
+{
+  XmlRpcValue value = emptyArray();
+  int count = 0;
+  for (M_string::const_iterator it = topic_types_.begin(); it != topic_types_.end(); ++it)
+  {
+    XmlRpcValue entry;
+    entry[0] = it->first;
+    entry[1] = it->second;
+    value[count++] = entry;
+  }
+  setResult(result, 1, "current system state", value);
+}
+
+void Master::getSystemState(const std::string&, XmlRpcValue&, XmlRpcValue& result)
+{
+  XmlRpcValue state;
+  reg_manager_.publishers.getState(state[0]);
+  reg_manager_.subscribers.getState(state[1]);
+  reg_manager_.services.getState(state[2]);
+  setResult(result, 1, "current system state", state);
+}
+
+void Master::notifyTopicSubscribers(const std::string& topic)
+{
+  const V_Provider& subscribers = reg_manager_.subscribers.get(topic);
+  if (subscribers.empty())
+  {
+    return;
+  }
+
+  std::vector<std::string> pub_uris;
+  reg_manager_.publishers.getApis(topic, pub_uris);
+  for (V_Provider::const_iterator it = subscribers.begin(); it != subscribers.end(); ++it)
+  {
+    notifier_->publisherUpdate(it->caller_api, topic, pub_uris);
+  }
+}
+
+void Master::notifyParamSubscribers(const V_ParamUpdate& updates)
+{
+  for (V_ParamUpdate::const_iterator update = updates.begin(); update != updates.end(); ++update)
+  {
+    for (V_Provider::const_iterator it = update->subscribers.begin(); it != update->subscribers.end(); ++it)
+    {
+      notifier_->paramUpdate(it->caller_api, update->key, update->value,
+                             boost::bind(&Master::paramUpdateDone, this, it->caller_id, it->caller_api, update->key,
+                                         boost::placeholders::_1, boost::placeholders::_2));
+    }
+  }
+}
+
+void Master::paramUpdateDone(const std::string& caller_id, const std::string& caller_api, const std::string& key,
+                             bool ok, XmlRpcValue& result)
+{
+  // A node that rejects the update no longer has the parameter cached
+  if (!ok || result.getType() != XmlRpcValue::TypeArray || result.size() == 0 ||
+      result[0].getType() != XmlRpcValue::TypeInt || static_cast<int>(result[0]) != -1)
+  {
+    return;
+  }
+
+  boost::mutex::scoped_lock lock(mutex_);
+  param_server_.unsubscribeParam(key, caller_id, caller_api);
+}
+
+void Master::shutdownNode(const std::string& api, const std::string& caller_id)
+{
+  ROS_WARN_NAMED("master", "New node registered with name [%s], shutting down the previous one at [%s]",
+                 caller_id.c_str(), api.c_str());
+  notifier_->shutdownNode(api, "[" + caller_id + "] Reason: new node registered with same name");
+}
+
+} // namespace rosmaster
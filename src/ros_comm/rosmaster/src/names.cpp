@@ -0,0 +1,169 @@
+/*********************************************************************
+* Software License Agreement (BSD License)
+*
+*  Copyright (c) 2008, Willow Garage, Inc.
+*  All rights reserved.
+*
+*  Redistribution and use in source and binary forms, with or without
+*  modification, are permitted provided that the following conditions
+*  are met:
+*
+*   * Redistributions of source code must retain the above copyright
+*     notice, this list of conditions and the following disclaimer.
+*   * Redistributions in binary form must reproduce the above
+*     copyright notice, this list of conditions and the following
+*     disclaimer in the documentation and/or other materials provided
+*     with the distribution.
+*   * Neither the name of Willow Garage, Inc. nor the names of its
+*     contributors may be used to endorse or promote products derived
+*     from this software without specific prior written permission.
+*
+*  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+*  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+*  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+*  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+*  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+*  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+*  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+*  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+*  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+*  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+*  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+*  POSSIBILITY OF SUCH DAMAGE.
+********************************************************************/
+
+#include "rosmaster/names.h"
+
+namespace rosmaster
+{
+
+namespace names
+{
+
+bool isGlobal(const std::string& name)
+{
+  return !name.empty() && name[0] == SEP;
+}
+
+bool isPrivate(const std::string& name)
+{
+  return !name.empty() && name[0] == PRIV_NAME;
+}
+
+void split(const std::string& name, std::vector<std::string>& tokens)
+{
+  tokens.clear();
+  std::string::size_type start = 0;
+  while (start < name.size())
+  {
+    std::string::size_type end = name.find(SEP, start);
+    if (end == std::string::npos)
+    {
+      end = name.size();
+    }
+    if (end > start)
+    {
+      tokens.push_back(name.substr(start, end - start));
+    }
+    start = end + 1;
+  }
+}
+
+std::string canonicalize(const std::string& name)
+{
+  if (name.empty() || name == "/")
+  {
+    return name;
+  }
+
+  std::string result;
+  result.reserve(name.size());
+  if (name[0] == SEP)
+  {
+    result += SEP;
+  }
+
+  bool pending_sep = false;
+  for (std::string::size_type i = 0; i < name.size(); ++i)
+  {
+    if (name[i] == SEP)
+    {
+      pending_sep = true;
+      continue;
+    }
+
+    if (pending_sep && !result.empty() && result[result.size() - 1] != SEP)
+    {
+      result += SEP;
+    }
+    pending_sep = false;
+    result += name[i];
+  }
+
+  return result;
+}
+
+std::string parentNamespace(const std::string& name)
+{
+  if (name.empty())
+  {
+    return "/";
+  }
+
+  std::string::size_type end = name.size();
+  if (name[end - 1] == SEP)
+  {
+    --end;
+  }
+
+  std::string::size_type pos = name.rfind(SEP, end == 0 ? 0 : end - 1);
+  if (pos == std::string::npos)
+  {
+    return "/";
+  }
+  return name.substr(0, pos + 1);
+}
+
+std::string join(const std::string& ns, const std::string& name)
+{
+  if (isPrivate(name) || isGlobal(name))
+  {
+    return name;
+  }
+  if (ns == "~")
+  {
+    return PRIV_NAME + name;
+  }
+  if (ns.empty())
+  {
+    return name;
+  }
+  if (ns[ns.size() - 1] == SEP)
+  {
+    return ns + name;
+  }
+  return ns + SEP + name;
+}
+
+std::string resolve(const std::string& name, const std::string& caller_id)
+{
+  if (name.empty())
+  {
+    return parentNamespace(caller_id);
+  }
+
+  std::string canonical = canonicalize(name);
+  if (canonical[0] == SEP)
+  {
+    return canonical;
+  }
+  if (isPrivate(canonical))
+  {
+    return canonicalize(caller_id + SEP + canonical.substr(1));
+  }
+  return parentNamespace(caller_id) + canonical;
+}
+
+} // namespace names
+
+} // namespace rosmaster
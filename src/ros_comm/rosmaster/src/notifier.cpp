@@ -0,0 +1,295 @@
+/*********************************************************************
+* Software License Agreement (BSD License)
+*
+*  Copyright (c) 2008, Willow Garage, Inc.
+*  All rights reserved.
+*
+*  Redistribution and use in source and binary forms, with or without
+*  modification, are permitted provided that the following conditions
+*  are met:
+*
+*   * Redistributions of source code must retain the above copyright
+*     notice, this list of conditions and the following disclaimer.
+*   * Redistributions in binary form must reproduce the above
+*     copyright notice, this list of conditions and the following
+*     disclaimer in the documentation and/or other materials provided
+*     with the distribution.
+*   * Neither the name of Willow Garage, Inc. nor the names of its
+*     contributors may be used to endorse or promote products derived
+*     from this software without specific prior written permission.
+*
+*  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+*  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+*  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+*  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+*  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+*  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+*  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+*  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+*  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+*  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+*  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+*  POSSIBILITY OF SUCH DAMAGE.
+********************************************************************/
+
+#include "rosmaster/notifier.h"
+
+#include <algorithm>
+#include <cstdlib>
+
+#include <xmlrpcpp/XmlRpcClient.h>
+
+namespace rosmaster
+{
+
+namespace
+{
+const double WORK_SLICE = 0.1;   ///< How often a call in progress checks for shutdown, in seconds
+
+bool splitUri(const std::string& uri, std::string& host, int& port, std::string& path)
+{
+  std::string::size_type start = uri.find("://");
+  start = (start == std::string::npos) ? 0 : start + 3;
+
+  std::string::size_type slash = uri.find('/', start);
+  std::string host_port = uri.substr(start, slash == std::string::npos ? std::string::npos : slash - start);
+  path = (slash == std::string::npos) ? std::string("/") : uri.substr(slash);
+
+  std::string::size_type colon = host_port.rfind(':');
+  if (colon == std::string::npos)
+  {
+    return false;
+  }
+  host = host_port.substr(0, colon);
+  port = atoi(host_port.c_str() + colon + 1);
+  return !host.empty() && port > 0;
+}
+}
+
+Notifier::Notifier(size_t num_workers, double timeout, const SendFunc& send)
+: timeout_(timeout)
+, send_(send)
+, in_flight_(0)
+, sent_(0)
+, coalesced_(0)
+, shutting_down_(false)
+{
+  for (size_t i = 0; i < std::max<size_t>(num_workers, 1); ++i)
+  {
+    workers_.create_thread(boost::bind(&Notifier::workerThread, this));
+  }
+}
+
+Notifier::~Notifier()
+{
+  shutdown();
+  workers_.join_all();
+}
+
+void Notifier::publisherUpdate(const std::string& api, const std::string& topic,
+                               const std::vector<std::string>& pub_uris)
+{
+  Task task;
+  task.method = "publisherUpdate";
+  task.topic = topic;
+  task.params[0] = "/master";
+  task.params[1] = topic;
+  task.params[2].setSize(static_cast<int>(pub_uris.size()));
+  for (size_t i = 0; i < pub_uris.size(); ++i)
+  {
+    task.params[2][static_cast<int>(i)] = pub_uris[i];
+  }
+  enqueue(api, task);
+}
+
+void Notifier::paramUpdate(const std::string& api, const std::string& key, const XmlRpc::XmlRpcValue& value,
+                           const DoneFunc& done)
+{
+  Task task;
+  task.method = "paramUpdate";
+  task.params[0] = "/master";
+  task.params[1] = key;
+  task.params[2] = value;
+  task.done = done;
+  enqueue(api, task);
+}
+
+void Notifier::shutdownNode(const std::string& api, const std::string& reason)
+{
+  Task task;
+  task.method = "shutdown";
+  task.params[0] = "/master";
+  task.params[1] = reason;
+  enqueue(api, task);
+}
+
+void Notifier::enqueue(const std::string& api, Task& task)
+{
+  boost::mutex::scoped_lock lock(mutex_);
+  if (shutting_down_)
+  {
+    return;
+  }
+
+  Destination& dest = destinations_[api];
+  if (!task.topic.empty())
+  {
+    for (std::deque<Task>::iterator it = dest.tasks.begin(); it != dest.tasks.end(); ++it)
+    {
+      if (it->topic == task.topic && it->method == task.method)
+      {
+        it->params = task.params;
+        ++coalesced_;
+        return;
+      }
+    }
+  }
+
+  dest.tasks.push_back(task);
+  if (!dest.busy && dest.tasks.size() == 1)
+  {
+    ready_.push_back(api);
+    ready_condition_.notify_one();
+  }
+}
+
+void Notifier::workerThread()
+{
+  while (true)
+  {
+    std::string api;
+    Task task;
+
+    {
+      boost::mutex::scoped_lock lock(mutex_);
+      while (!shutting_down_ && ready_.empty())
+      {
+        ready_condition_.wait(lock);
+      }
+      if (shutting_down_)
+      {
+        return;
+      }
+
+      api = ready_.front();
+      ready_.pop_front();
+      Destination& dest = destinations_[api];
+      dest.busy = true;
+      task = dest.tasks.front();
+      dest.tasks.pop_front();
+      ++in_flight_;
+    }
+
+    XmlRpc::XmlRpcValue result;
+    bool ok = send(api, task.method, task.params, result);
+    if (task.done)
+    {
+      task.done(ok, result);
+    }
+
+    boost::mutex::scoped_lock lock(mutex_);
+    --in_flight_;
+    ++sent_;
+
+    M_Destination::iterator dest = destinations_.find(api);
+    if (dest != destinations_.end())
+    {
+      dest->second.busy = false;
+      if (dest->second.tasks.empty())
+      {
+        destinations_.erase(dest);
+      }
+      else
+      {
+        ready_.push_back(api);
+        ready_condition_.notify_one();
+      }
+    }
+
+    if (ready_.empty() && in_flight_ == 0)
+    {
+      idle_condition_.notify_all();
+    }
+  }
+}
+
+bool Notifier::send(const std::string& api, const std::string& method, const XmlRpc::XmlRpcValue& params,
+                    XmlRpc::XmlRpcValue& result)
+{
+  if (send_)
+  {
+    return send_(api, method, params, result);
+  }
+
+  std::string host, path;
+  int port;
+  if (!splitUri(api, host, port, path))
+  {
+    return false;
+  }
+
+  XmlRpc::XmlRpcClient client(host.c_str(), port, path.c_str());
+  if (!client.executeNonBlock(method.c_str(), params))
+  {
+    return false;
+  }
+
+  // Work in slices so that neither a hung node nor shutdown has to wait on a blocking call
+  double waited = 0.0;
+  while (!client.executeCheckDone(result))
+  {
+    {
+      boost::mutex::scoped_lock lock(mutex_);
+      if (shutting_down_)
+      {
+        client.close();
+        return false;
+      }
+    }
+
+    if (timeout_ >= 0.0 && waited >= timeout_)
+    {
+      client.close();
+      return false;
+    }
+
+    double slice = (timeout_ >= 0.0) ? std::min(WORK_SLICE, timeout_ - waited) : WORK_SLICE;
+    client._disp.work(slice);
+    waited += slice;
+  }
+
+  return result.valid() && !client.isFault();
+}
+
+void Notifier::waitForIdle()
+{
+  boost::mutex::scoped_lock lock(mutex_);
+  while (!shutting_down_ && (!ready_.empty() || in_flight_ > 0))
+  {
+    idle_condition_.wait(lock);
+  }
+}
+
+void Notifier::shutdown()
+{
+  boost::mutex::scoped_lock lock(mutex_);
+  shutting_down_ = true;
+  destinations_.clear();
+  ready_.clear();
+  ready_condition_.notify_all();
+  idle_condition_.notify_all();
+}
+
+size_t Notifier::getSentCount()
+{
+  boost::mutex::scoped_lock lock(mutex_);
+  return sent_;
+}
+
+size_t Notifier::getCoalescedCount()
+{
+  boost::mutex::scoped_lock lock(mutex_);
+  return coalesced_;
+}
+
+} // namespace rosmaster
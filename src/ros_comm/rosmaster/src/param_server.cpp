@@ -0,0 +1,362 @@
+/*********************************************************************
+* Software License Agreement (BSD License)
+*
+*  Copyright (c) 2008, Willow Garage, Inc.
+*  All rights reserved.
+*
+*  Redistribution and use in source and binary forms, with or without
+*  modification, are permitted provided that the following conditions
+*  are met:
+*
+*   * Redistributions of source code must retain the above copyright
+*     notice, this list of conditions and the following disclaimer.
+*   * Redistributions in binary form must reproduce the above
+*     copyright notice, this list of conditions and the following
+*     disclaimer in the documentation and/or other materials provided
+*     with the distribution.
+*   * Neither the name of Willow Garage, Inc. nor the names of its
+*     contributors may be used to endorse or promote products derived
+*     from this software without specific prior written permission.
+*
+*  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+*  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+*  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+*  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+*  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+*  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+*  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+*  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+*  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+*  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+*  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+*  POSSIBILITY OF SUCH DAMAGE.
+********************************************************************/
+
+#include "rosmaster/param_server.h"
+#include "rosmaster/names.h"
+
+namespace rosmaster
+{
+
+namespace
+{
+void makeEmptyStruct(XmlRpc::XmlRpcValue& value)
+{
+  value.clear();
+  value.begin();
+}
+
+/**
+ * \brief Subscription keys are canonical with a trailing separator, so prefix matches fall on namespace boundaries
+ */
+std::string subscriptionKey(const std::string& key)
+{
+  if (key == "/")
+  {
+    return key;
+  }
+  return names::canonicalize(key) + names::SEP;
+}
+}
+
+void ParamServer::Node::toXmlRpc(XmlRpc::XmlRpcValue& out) const
+{
+  if (!isNamespace())
+  {
+    out = value;
+    return;
+  }
+
+  makeEmptyStruct(out);
+  for (M_Node::const_iterator it = children.begin(); it != children.end(); ++it)
+  {
+    it->second.toXmlRpc(out[it->first]);
+  }
+}
+
+void ParamServer::Node::getNames(const std::string& ns, std::vector<std::string>& param_names) const
+{
+  for (M_Node::const_iterator it = children.begin(); it != children.end(); ++it)
+  {
+    std::string name = names::join(ns, it->first);
+    if (it->second.isNamespace())
+    {
+      it->second.getNames(name, param_names);
+    }
+    else
+    {
+      param_names.push_back(name);
+    }
+  }
+}
+
+void ParamServer::Node::fromXmlRpc(const XmlRpc::XmlRpcValue& in)
+{
+  children.clear();
+  if (in.getType() != XmlRpc::XmlRpcValue::TypeStruct)
+  {
+    value = in;
+    return;
+  }
+
+  value.clear();
+  for (XmlRpc::XmlRpcValue::const_iterator it = in.begin(); it != in.end(); ++it)
+  {
+    children[it->first].fromXmlRpc(it->second);
+  }
+}
+
+ParamServer::ParamServer(RegistrationManager& reg_manager)
+: reg_manager_(reg_manager)
+{
+}
+
+const ParamServer::Node* ParamServer::find(const std::string& key) const
+{
+  std::vector<std::string> namespaces;
+  names::split(key, namespaces);
+
+  const Node* node = &root_;
+  for (size_t i = 0; i < namespaces.size(); ++i)
+  {
+    if (!node->isNamespace())
+    {
+      return 0;
+    }
+    Node::M_Node::const_iterator it = node->children.find(namespaces[i]);
+    if (it == node->children.end())
+    {
+      return 0;
+    }
+    node = &it->second;
+  }
+  return node;
+}
+
+bool ParamServer::getParam(const std::string& key, XmlRpc::XmlRpcValue& value) const
+{
+  const Node* node = find(key);
+  if (!node)
+  {
+    return false;
+  }
+  node->toXmlRpc(value);
+  return true;
+}
+
+bool ParamServer::hasParam(const std::string& key) const
+{
+  return find(key) != 0;
+}
+
+bool ParamServer::setParam(const std::string& key, const XmlRpc::XmlRpcValue& value, const std::string& caller_id,
+                           V_ParamUpdate& updates)
+{
+  std::vector<std::string> namespaces;
+  names::split(key, namespaces);
+
+  if (namespaces.empty())
+  {
+    if (value.getType() != XmlRpc::XmlRpcValue::TypeStruct)
+    {
+      return false;
+    }
+    root_.fromXmlRpc(value);
+  }
+  else
+  {
+    // Create missing namespaces, replacing any leaf in the way
+    Node* node = &root_;
+    for (size_t i = 0; i < namespaces.size(); ++i)
+    {
+      if (!node->isNamespace())
+      {
+        node->value.clear();
+      }
+      node = &node->children[namespaces[i]];
+    }
+    node->fromXmlRpc(value);
+  }
+
+  computeUpdates(key, value, caller_id, updates);
+  return true;
+}
+
+bool ParamServer::deleteParam(const std::string& key, V_ParamUpdate& updates)
+{
+  std::vector<std::string> namespaces;
+  names::split(key, namespaces);
+  if (namespaces.empty())
+  {
+    return false;
+  }
+
+  Node* node = &root_;
+  for (size_t i = 0; i + 1 < namespaces.size(); ++i)
+  {
+    Node::M_Node::iterator it = node->children.find(namespaces[i]);
+    if (!node->isNamespace() || it == node->children.end())
+    {
+      return false;
+    }
+    node = &it->second;
+  }
+
+  if (!node->isNamespace() || node->children.erase(namespaces.back()) == 0)
+  {
+    return false;
+  }
+
+  XmlRpc::XmlRpcValue unset;
+  makeEmptyStruct(unset);
+  computeUpdates(key, unset, std::string(), updates);
+  return true;
+}
+
+bool ParamServer::searchParam(const std::string& ns, const std::string& key, std::string& found) const
+{
+  if (key.empty() || names::isPrivate(key) || !names::isGlobal(ns))
+  {
+    return false;
+  }
+
+  if (names::isGlobal(key))
+  {
+    found = key;
+    return hasParam(key);
+  }
+
+  // Only the first namespace of key has to exist; the rest may not have been set yet
+  std::vector<std::string> key_namespaces;
+  names::split(key, key_namespaces);
+  const std::string& key_ns = key_namespaces[0];
+  if (hasParam(names::join(ns, key_ns)))
+  {
+    found = names::join(ns, key);
+    return true;
+  }
+
+  std::vector<std::string> namespaces;
+  names::split(ns, namespaces);
+  for (size_t depth = namespaces.size(); depth-- > 0;)
+  {
+    std::string parent = "/";
+    for (size_t i = 0; i < depth; ++i)
+    {
+      parent += namespaces[i] + names::SEP;
+    }
+    if (hasParam(parent + key_ns))
+    {
+      found = parent + key;
+      return true;
+    }
+  }
+  return false;
+}
+
+void ParamServer::getParamNames(std::vector<std::string>& param_names) const
+{
+  param_names.clear();
+  root_.getNames("/", param_names);
+}
+
+void ParamServer::subscribeParam(const std::string& key, const std::string& caller_id, const std::string& caller_api,
+                                 XmlRpc::XmlRpcValue& value)
+{
+  std::string sub_key = subscriptionKey(key);
+  if (!getParam(sub_key, value))
+  {
+    makeEmptyStruct(value);
+  }
+  reg_manager_.registerParamSubscriber(sub_key, caller_id, caller_api);
+}
+
+void ParamServer::unsubscribeParam(const std::string& key, const std::string& caller_id, const std::string& caller_api)
+{
+  XmlRpc::XmlRpcValue result;
+  reg_manager_.unregisterParamSubscriber(subscriptionKey(key), caller_id, caller_api, result);
+}
+
+void ParamServer::computeUpdates(const std::string& key, const XmlRpc::XmlRpcValue& value, const std::string& caller_id,
+                                 V_ParamUpdate& updates) const
+{
+  const Registrations& subscribers = reg_manager_.param_subscribers;
+  if (subscribers.empty())
+  {
+    return;
+  }
+
+  std::string param_key = subscriptionKey(key);
+
+  // Subscribers of the key itself or of a namespace above it get the new value. Each of those is a
+  // hash lookup, rather than a pass over every subscription.
+  for (std::string::size_type pos = param_key.find(names::SEP); pos != std::string::npos;
+       pos = param_key.find(names::SEP, pos + 1))
+  {
+    const V_Provider& providers = subscribers.get(param_key.substr(0, pos + 1));
+    if (providers.empty())
+    {
+      continue;
+    }
+
+    updates.push_back(ParamUpdate());
+    ParamUpdate& update = updates.back();
+    update.key = param_key;
+    update.value = value;
+    for (V_Provider::const_iterator it = providers.begin(); it != providers.end(); ++it)
+    {
+      if (it->caller_id != caller_id)
+      {
+        update.subscribers.push_back(*it);
+      }
+    }
+  }
+
+  if (value.getType() != XmlRpc::XmlRpcValue::TypeStruct)
+  {
+    return;
+  }
+
+  // A namespace was replaced: subscribers below it get their part of the new value, or an
+  // empty struct if it no longer exists
+  std::vector<std::string> sub_keys;
+  subscribers.getKeysWithPrefix(param_key, sub_keys);
+  std::vector<std::string> namespaces;
+  for (size_t i = 0; i < sub_keys.size(); ++i)
+  {
+    const std::string& sub_key = sub_keys[i];
+    if (sub_key.size() == param_key.size())
+    {
+      continue;
+    }
+
+    names::split(sub_key.substr(param_key.size()), namespaces);
+    const XmlRpc::XmlRpcValue* sub_value = &value;
+    for (size_t j = 0; j < namespaces.size() && sub_value; ++j)
+    {
+      if (sub_value->getType() == XmlRpc::XmlRpcValue::TypeStruct && sub_value->hasMember(namespaces[j]))
+      {
+        sub_value = &(*sub_value)[namespaces[j]];
+      }
+      else
+      {
+        sub_value = 0;
+      }
+    }
+
+    updates.push_back(ParamUpdate());
+    ParamUpdate& update = updates.back();
+    update.subscribers = subscribers.get(sub_key);
+    update.key = sub_key;
+    if (sub_value)
+    {
+      update.value = *sub_value;
+    }
+    else
+    {
+      makeEmptyStruct(update.value);
+    }
+  }
+}
+
+} // namespace rosmaster
@@ -0,0 +1,381 @@
+/*********************************************************************
+* Software License Agreement (BSD License)
+*
+*  Copyright (c) 2008, Willow Garage, Inc.
+*  All rights reserved.
+*
+*  Redistribution and use in source and binary forms, with or without
+*  modification, are permitted provided that the following conditions
+*  are met:
+*
+*   * Redistributions of source code must retain the above copyright
+*     notice, this list of conditions and the following disclaimer.
+*   * Redistributions in binary form must reproduce the above
+*     copyright notice, this list of conditions and the following
+*     disclaimer in the documentation and/or other materials provided
+*     with the distribution.
+*   * Neither the name of Willow Garage, Inc. nor the names of its
+*     contributors may be used to endorse or promote products derived
+*     from this software without specific prior written permission.
+*
+*  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+*  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+*  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+*  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+*  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+*  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+*  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+*  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+*  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+*  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+*  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+*  POSSIBILITY OF SUCH DAMAGE.
+********************************************************************/
+
+#include "rosmaster/registrations.h"
+
+#include <algorithm>
+
+namespace rosmaster
+{
+
+namespace
+{
+const V_Provider g_no_providers;
+
+void setResult(XmlRpc::XmlRpcValue& result, int code, const std::string& msg, int val)
+{
+  result[0] = code;
+  result[1] = msg;
+  result[2] = val;
+}
+}
+
+Registrations::Registrations(Type type)
+: type_(type)
+{
+}
+
+bool Registrations::hasKey(const std::string& key) const
+{
+  return map_.find(key) != map_.end();
+}
+
+const V_Provider& Registrations::get(const std::string& key) const
+{
+  M_Providers::const_iterator it = map_.find(key);
+  if (it == map_.end())
+  {
+    return g_no_providers;
+  }
+  return it->second;
+}
+
+void Registrations::getApis(const std::string& key, std::vector<std::string>& apis) const
+{
+  apis.clear();
+  const V_Provider& providers = get(key);
+  apis.reserve(providers.size());
+  for (V_Provider::const_iterator it = providers.begin(); it != providers.end(); ++it)
+  {
+    apis.push_back(it->caller_api);
+  }
+}
+
+void Registrations::getKeys(std::vector<std::string>& keys) const
+{
+  keys.clear();
+  keys.reserve(map_.size());
+  for (M_Providers::const_iterator it = map_.begin(); it != map_.end(); ++it)
+  {
+    keys.push_back(it->first);
+  }
+}
+
+void Registrations::getKeysWithPrefix(const std::string& prefix, std::vector<std::string>& keys) const
+{
+  keys.clear();
+  for (std::set<std::string>::const_iterator it = ordered_keys_.lower_bound(prefix);
+       it != ordered_keys_.end() && it->compare(0, prefix.size(), prefix) == 0; ++it)
+  {
+    keys.push_back(*it);
+  }
+}
+
+std::string Registrations::getServiceApi(const std::string& service) const
+{
+  M_ServiceApi::const_iterator it = service_api_map_.find(service);
+  if (it == service_api_map_.end())
+  {
+    return std::string();
+  }
+  return it->second.caller_api;
+}
+
+void Registrations::getState(XmlRpc::XmlRpcValue& state) const
+{
+  state.clear();
+  state.setSize(static_cast<int>(map_.size()));
+  int i = 0;
+  for (M_Providers::const_iterator it = map_.begin(); it != map_.end(); ++it, ++i)
+  {
+    XmlRpc::XmlRpcValue entry;
+    entry[0] = it->first;
+    XmlRpc::XmlRpcValue ids;
+    ids.setSize(static_cast<int>(it->second.size()));
+    for (size_t j = 0; j < it->second.size(); ++j)
+    {
+      ids[static_cast<int>(j)] = it->second[j].caller_id;
+    }
+    entry[1] = ids;
+    state[i] = entry;
+  }
+}
+
+void Registrations::add(const std::string& key, const std::string& caller_id, const std::string& caller_api,
+                        const std::string& service_api)
+{
+  Provider provider(caller_id, caller_api);
+  std::pair<M_Providers::iterator, bool> inserted = map_.insert(std::make_pair(key, V_Provider()));
+  V_Provider& providers = inserted.first->second;
+  if (!service_api.empty())
+  {
+    // Only one provider per service: the latest registration wins
+    providers.assign(1, provider);
+    service_api_map_[key] = Provider(caller_id, service_api);
+  }
+  else if (std::find(providers.begin(), providers.end(), provider) == providers.end())
+  {
+    providers.push_back(provider);
+  }
+
+  if (inserted.second && type_ == PARAM_SUBSCRIPTIONS)
+  {
+    ordered_keys_.insert(key);
+  }
+}
+
+void Registrations::eraseKey(const std::string& key)
+{
+  map_.erase(key);
+  if (type_ == PARAM_SUBSCRIPTIONS)
+  {
+    ordered_keys_.erase(key);
+  }
+}
+
+bool Registrations::remove(const std::string& key, const std::string& caller_id, const std::string& caller_api,
+                           const std::string& service_api, XmlRpc::XmlRpcValue& result)
+{
+  if (type_ == SERVICE)
+  {
+    M_ServiceApi::iterator it = service_api_map_.find(key);
+    if (it == service_api_map_.end() || it->second.caller_id != caller_id || it->second.caller_api != service_api)
+    {
+      setResult(result, 1, "[" + service_api + "] is no longer the current service api handle for [" + key + "]", 0);
+      return false;
+    }
+
+    service_api_map_.erase(it);
+    eraseKey(key);
+    setResult(result, 1, "Unregistered [" + caller_id + "] as provider of [" + key + "]", 1);
+    return true;
+  }
+
+  M_Providers::iterator it = map_.find(key);
+  if (it != map_.end())
+  {
+    V_Provider& providers = it->second;
+    V_Provider::iterator provider = std::find(providers.begin(), providers.end(), Provider(caller_id, caller_api));
+    if (provider != providers.end())
+    {
+      providers.erase(provider);
+      if (providers.empty())
+      {
+        eraseKey(key);
+      }
+      setResult(result, 1, "Unregistered [" + caller_id + "] as provider of [" + key + "]", 1);
+      return true;
+    }
+  }
+
+  setResult(result, 1, "[" + caller_id + "] is not a known provider of [" + key + "]", 0);
+  return false;
+}
+
+void Registrations::removeAll(const std::string& caller_id, const std::set<std::string>& keys)
+{
+  for (std::set<std::string>::const_iterator key = keys.begin(); key != keys.end(); ++key)
+  {
+    M_Providers::iterator it = map_.find(*key);
+    if (it == map_.end())
+    {
+      continue;
+    }
+
+    V_Provider& providers = it->second;
+    for (V_Provider::iterator provider = providers.begin(); provider != providers.end();)
+    {
+      if (provider->caller_id == caller_id)
+      {
+        provider = providers.erase(provider);
+      }
+      else
+      {
+        ++provider;
+      }
+    }
+
+    if (type_ == SERVICE)
+    {
+      M_ServiceApi::iterator service = service_api_map_.find(*key);
+      if (service != service_api_map_.end() && service->second.caller_id == caller_id)
+      {
+        service_api_map_.erase(service);
+      }
+    }
+
+    if (providers.empty())
+    {
+      eraseKey(*key);
+    }
+  }
+}
+
+bool NodeRef::empty() const
+{
+  for (size_t i = 0; i < 4; ++i)
+  {
+    if (!keys_[i].empty())
+    {
+      return false;
+    }
+  }
+  return true;
+}
+
+RegistrationManager::RegistrationManager(const ShutdownNodeFunc& shutdown_node)
+: publishers(Registrations::TOPIC_PUBLICATIONS)
+, subscribers(Registrations::TOPIC_SUBSCRIPTIONS)
+, services(Registrations::SERVICE)
+, param_subscribers(Registrations::PARAM_SUBSCRIPTIONS)
+, shutdown_node_(shutdown_node)
+{
+}
+
+const NodeRef* RegistrationManager::getNode(const std::string& caller_id) const
+{
+  M_NodeRef::const_iterator it = nodes_.find(caller_id);
+  if (it == nodes_.end())
+  {
+    return 0;
+  }
+  return &it->second;
+}
+
+NodeRef& RegistrationManager::registerNodeApi(const std::string& caller_id, const std::string& caller_api)
+{
+  M_NodeRef::iterator it = nodes_.find(caller_id);
+  if (it == nodes_.end())
+  {
+    return nodes_.insert(std::make_pair(caller_id, NodeRef(caller_id, caller_api))).first->second;
+  }
+
+  NodeRef& node = it->second;
+  if (node.api != caller_api)
+  {
+    // A new node took over this name: shut the old one down and forget everything it registered
+    if (shutdown_node_)
+    {
+      shutdown_node_(node.api, caller_id);
+    }
+
+    publishers.removeAll(caller_id, node.keys(Registrations::TOPIC_PUBLICATIONS));
+    subscribers.removeAll(caller_id, node.keys(Registrations::TOPIC_SUBSCRIPTIONS));
+    services.removeAll(caller_id, node.keys(Registrations::SERVICE));
+    param_subscribers.removeAll(caller_id, node.keys(Registrations::PARAM_SUBSCRIPTIONS));
+    node = NodeRef(caller_id, caller_api);
+  }
+  return node;
+}
+
+void RegistrationManager::registerKey(Registrations& r, const std::string& key, const std::string& caller_id,
+                                      const std::string& caller_api, const std::string& service_api)
+{
+  NodeRef& node = registerNodeApi(caller_id, caller_api);
+  node.keys(r.getType()).insert(key);
+  r.add(key, caller_id, caller_api, service_api);
+}
+
+bool RegistrationManager::unregisterKey(Registrations& r, const std::string& key, const std::string& caller_id,
+                                        const std::string& caller_api, const std::string& service_api,
+                                        XmlRpc::XmlRpcValue& result)
+{
+  M_NodeRef::iterator it = nodes_.find(caller_id);
+  if (it == nodes_.end())
+  {
+    setResult(result, 1, "[" + caller_id + "] is not a registered node", 0);
+    return false;
+  }
+
+  bool removed = r.remove(key, caller_id, caller_api, service_api, result);
+  if (removed)
+  {
+    it->second.keys(r.getType()).erase(key);
+  }
+  if (it->second.empty())
+  {
+    nodes_.erase(it);
+  }
+  return removed;
+}
+
+void RegistrationManager::registerService(const std::string& service, const std::string& caller_id,
+                                          const std::string& caller_api, const std::string& service_api)
+{
+  registerKey(services, service, caller_id, caller_api, service_api);
+}
+
+void RegistrationManager::registerPublisher(const std::string& topic, const std::string& caller_id,
+                                            const std::string& caller_api)
+{
+  registerKey(publishers, topic, caller_id, caller_api);
+}
+
+void RegistrationManager::registerSubscriber(const std::string& topic, const std::string& caller_id,
+                                             const std::string& caller_api)
+{
+  registerKey(subscribers, topic, caller_id, caller_api);
+}
+
+void RegistrationManager::registerParamSubscriber(const std::string& param, const std::string& caller_id,
+                                                  const std::string& caller_api)
+{
+  registerKey(param_subscribers, param, caller_id, caller_api);
+}
+
+bool RegistrationManager::unregisterService(const std::string& service, const std::string& caller_id,
+                                            const std::string& service_api, XmlRpc::XmlRpcValue& result)
+{
+  return unregisterKey(services, service, caller_id, std::string(), service_api, result);
+}
+
+bool RegistrationManager::unregisterPublisher(const std::string& topic, const std::string& caller_id,
+                                              const std::string& caller_api, XmlRpc::XmlRpcValue& result)
+{
+  return unregisterKey(publishers, topic, caller_id, caller_api, std::string(), result);
+}
+
+bool RegistrationManager::unregisterSubscriber(const std::string& topic, const std::string& caller_id,
+                                               const std::string& caller_api, XmlRpc::XmlRpcValue& result)
+{
+  return unregisterKey(subscribers, topic, caller_id, caller_api, std::string(), result);
+}
+
+bool RegistrationManager::unregisterParamSubscriber(const std::string& param, const std::string& caller_id,
+                                                    const std::string& caller_api, XmlRpc::XmlRpcValue& result)
+{
+  return unregisterKey(param_subscribers, param, caller_id, caller_api, std::string(), result);
+}
+
+} // namespace rosmaster
@@ -77,6 +77,13 @@ def rosmaster_main(argv=sys.argv, stdout=sys.stdout, env=os.environ):
 
     options, args = parser.parse_args(argv[1:])
 
+    # ROS_MASTER_IMPL=cpp hands the same command line over to the native master
+    if env.get('ROS_MASTER_IMPL', '').lower() == 'cpp':
+        try:
+            os.execvp('rosmaster_cpp', ['rosmaster_cpp'] + argv[1:])
+        except OSError as e:
+            stdout.write("WARN: unable to start rosmaster_cpp (%s), falling back to the Python master\n" % e)
+
     # only arg that zenmaster supports is __log remapping of logfilename
     for arg in args:
         if not arg.startswith('__log:='):
@@ -0,0 +1,164 @@
+/*********************************************************************
+* Software License Agreement (BSD License)
+*
+*  Copyright (c) 2008, Willow Garage, Inc.
+*  All rights reserved.
+*
+*  Redistribution and use in source and binary forms, with or without
+*  modification, are permitted provided that the following conditions
+*  are met:
+*
+*   * Redistributions of source code must retain the above copyright
+*     notice, this list of conditions and the following disclaimer.
+*   * Redistributions in binary form must reproduce the above
+*     copyright notice, this list of conditions and the following
+*     disclaimer in the documentation and/or other materials provided
+*     with the distribution.
+*   * Neither the name of Willow Garage, Inc. nor the names of its
+*     contributors may be used to endorse or promote products derived
+*     from this software without specific prior written permission.
+*
+*  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+*  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+*  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+*  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+*  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+*  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+*  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+*  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+*  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+*  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+*  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+*  POSSIBILITY OF SUCH DAMAGE.
+********************************************************************/
+
+/*
+ * Simulates a launch file bringing up many nodes at once: every node registers its publishers,
+ * subscribers, services and cached parameters with the master, then the benchmark waits for all
+ * publisherUpdate and paramUpdate callbacks to be delivered. Callbacks go to a stub that takes a
+ * fixed time to answer, standing in for the nodes' XML-RPC servers.
+ *
+ * Usage: registration_benchmark [nodes] [topics per node] [callback latency in ms]
+ */
+
+#include "rosmaster/master.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+#include <boost/atomic.hpp>
+#include <boost/bind/bind.hpp>
+#include <boost/date_time/posix_time/posix_time.hpp>
+#include <boost/lexical_cast.hpp>
+#include <boost/random/mersenne_twister.hpp>
+#include <boost/random/uniform_int_distribution.hpp>
+#include <boost/thread.hpp>
+
+using XmlRpc::XmlRpcValue;
+
+namespace
+{
+
+boost::atomic<size_t> g_callbacks(0);
+
+bool slowNode(int latency_us, const std::string&, const std::string&, const XmlRpcValue&, XmlRpcValue& result)
+{
+  if (latency_us > 0)
+  {
+    boost::this_thread::sleep(boost::posix_time::microseconds(latency_us));
+  }
+  ++g_callbacks;
+  result[0] = 1;
+  result[1] = "";
+  result[2] = 0;
+  return true;
+}
+
+double elapsed(const boost::posix_time::ptime& start)
+{
+  return (boost::posix_time::microsec_clock::universal_time() - start).total_microseconds() * 1e-6;
+}
+
+void call(rosmaster::Master& master, const char* method, const std::string& caller_id, const XmlRpcValue& a1,
+          const XmlRpcValue& a2, const XmlRpcValue& a3 = XmlRpcValue())
+{
+  XmlRpcValue params, result;
+  params[0] = caller_id;
+  params[1] = a1;
+  params[2] = a2;
+  if (a3.valid())
+  {
+    params[3] = a3;
+  }
+  master.call(method, params, result);
+  if (static_cast<int>(result[0]) != 1)
+  {
+    fprintf(stderr, "%s failed: %s\n", method, static_cast<std::string&>(result[1]).c_str());
+  }
+}
+
+void run(int num_nodes, int topics_per_node, int latency_us, size_t num_workers)
+{
+  g_callbacks = 0;
+  rosmaster::Master master(0, num_workers, -1.0,
+                           boost::bind(&slowNode, latency_us, boost::placeholders::_1, boost::placeholders::_2,
+                                       boost::placeholders::_3, boost::placeholders::_4));
+
+  // Nodes draw their topics from a shared pool, so most topics have several publishers and subscribers
+  int num_topics = std::max(num_nodes * topics_per_node / 4, 1);
+  boost::random::mt19937 rng(42);
+  boost::random::uniform_int_distribution<int> pick_topic(0, num_topics - 1);
+
+  size_t calls = 0;
+  boost::posix_time::ptime start = boost::posix_time::microsec_clock::universal_time();
+  for (int n = 0; n < num_nodes; ++n)
+  {
+    std::string caller_id = "/node_" + boost::lexical_cast<std::string>(n);
+    std::string api = "http://host:" + boost::lexical_cast<std::string>(40000 + n) + "/";
+
+    call(master, "setParam", caller_id, "~rate", 10.0);
+    call(master, "subscribeParam", caller_id, api, "/use_sim_time");
+    call(master, "registerService", caller_id, "~get_loggers", "rosrpc://host:" + boost::lexical_cast<std::string>(50000 + n), api);
+    call(master, "registerPublisher", caller_id, "/rosout", "rosgraph_msgs/Log", api);
+    calls += 4;
+
+    for (int t = 0; t < topics_per_node; ++t)
+    {
+      std::string pub_topic = "/topic_" + boost::lexical_cast<std::string>(pick_topic(rng));
+      std::string sub_topic = "/topic_" + boost::lexical_cast<std::string>(pick_topic(rng));
+      call(master, "registerPublisher", caller_id, pub_topic, "std_msgs/String", api);
+      call(master, "registerSubscriber", caller_id, sub_topic, "std_msgs/String", api);
+      calls += 2;
+    }
+  }
+  double api_time = elapsed(start);
+
+  master.getNotifier().waitForIdle();
+  double total_time = elapsed(start);
+
+  printf("%8zu %12zu %12.3f %12.0f %12zu %12zu %12.3f\n", num_workers, calls, api_time, calls / api_time,
+         static_cast<size_t>(g_callbacks), master.getNotifier().getCoalescedCount(), total_time);
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+  int num_nodes = (argc > 1) ? atoi(argv[1]) : 300;
+  int topics_per_node = (argc > 2) ? atoi(argv[2]) : 10;
+  double latency_ms = (argc > 3) ? atof(argv[3]) : 1.0;
+
+  printf("%d nodes, %d publishers and %d subscribers each, %.1f ms per callback\n", num_nodes, topics_per_node,
+         topics_per_node, latency_ms);
+  printf("%8s %12s %12s %12s %12s %12s %12s\n", "workers", "api calls", "api [s]", "calls/s", "callbacks",
+         "coalesced", "settled [s]");
+
+  size_t workers[] = { 1, rosmaster::NUM_WORKERS, 16, 64 };
+  for (size_t i = 0; i < sizeof(workers) / sizeof(workers[0]); ++i)
+  {
+    run(num_nodes, topics_per_node, static_cast<int>(latency_ms * 1000.0), workers[i]);
+  }
+
+  return 0;
+}
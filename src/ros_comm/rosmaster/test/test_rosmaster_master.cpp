@@ -0,0 +1,398 @@
+/*********************************************************************
+* Software License Agreement (BSD License)
+*
+*  Copyright (c) 2008, Willow Garage, Inc.
+*  All rights reserved.
+*
+*  Redistribution and use in source and binary forms, with or without
+*  modification, are permitted provided that the following conditions
+*  are met:
+*
+*   * Redistributions of source code must retain the above copyright
+*     notice, this list of conditions and the following disclaimer.
+*   * Redistributions in binary form must reproduce the above
+*     copyright notice, this list of conditions and the following
+*     disclaimer in the documentation and/or other materials provided
+*     with the distribution.
+*   * Neither the name of Willow Garage, Inc. nor the names of its
+*     contributors may be used to endorse or promote products derived
+*     from this software without specific prior written permission.
+*
+*  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+*  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+*  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+*  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+*  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+*  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+*  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+*  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+*  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+*  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+*  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+*  POSSIBILITY OF SUCH DAMAGE.
+********************************************************************/
+
+#include "rosmaster/master.h"
+#include "rosmaster/names.h"
+
+#include <string>
+#include <vector>
+
+#include <boost/bind/bind.hpp>
+#include <boost/lexical_cast.hpp>
+#include <boost/thread/mutex.hpp>
+
+#include <gtest/gtest.h>
+
+using XmlRpc::XmlRpcValue;
+
+namespace
+{
+
+struct Call
+{
+  std::string api;
+  std::string method;
+  XmlRpcValue params;
+};
+
+/**
+ * \brief Records node callbacks instead of sending them
+ */
+class Recorder
+{
+public:
+  bool send(const std::string& api, const std::string& method, const XmlRpcValue& params, XmlRpcValue& result)
+  {
+    boost::mutex::scoped_lock lock(mutex_);
+    Call call;
+    call.api = api;
+    call.method = method;
+    call.params = params;
+    calls_.push_back(call);
+    result[0] = 1;
+    result[1] = "";
+    result[2] = 0;
+    return true;
+  }
+
+  std::vector<Call> calls()
+  {
+    boost::mutex::scoped_lock lock(mutex_);
+    return calls_;
+  }
+
+  void clear()
+  {
+    boost::mutex::scoped_lock lock(mutex_);
+    calls_.clear();
+  }
+
+private:
+  boost::mutex mutex_;
+  std::vector<Call> calls_;
+};
+
+class MasterTest : public testing::Test
+{
+protected:
+  MasterTest()
+  : master_(0, 2, -1.0, boost::bind(&Recorder::send, &recorder_, boost::placeholders::_1, boost::placeholders::_2,
+                                    boost::placeholders::_3, boost::placeholders::_4))
+  {}
+
+  XmlRpcValue call(const std::string& method, const std::string& a0, const XmlRpcValue& a1 = XmlRpcValue(),
+                   const XmlRpcValue& a2 = XmlRpcValue(), const XmlRpcValue& a3 = XmlRpcValue())
+  {
+    XmlRpcValue params, result;
+    params[0] = a0;
+    if (a1.valid())
+      params[1] = a1;
+    if (a2.valid())
+      params[2] = a2;
+    if (a3.valid())
+      params[3] = a3;
+    master_.call(method, params, result);
+    return result;
+  }
+
+  std::vector<Call> flushCalls()
+  {
+    master_.getNotifier().waitForIdle();
+    std::vector<Call> calls = recorder_.calls();
+    recorder_.clear();
+    return calls;
+  }
+
+  Recorder recorder_;
+  rosmaster::Master master_;
+};
+
+} // namespace
+
+TEST(RosmasterNames, resolve)
+{
+  using namespace rosmaster::names;
+  EXPECT_EQ("/a/b", canonicalize("/a//b/"));
+  EXPECT_EQ("a/b", canonicalize("a//b"));
+  EXPECT_EQ("/", canonicalize("/"));
+  EXPECT_EQ("/wg/", parentNamespace("/wg/node1"));
+  EXPECT_EQ("/", parentNamespace("/node1"));
+  EXPECT_EQ("/wg/chatter", resolve("chatter", "/wg/node1"));
+  EXPECT_EQ("/wg/node1/x", resolve("~x", "/wg/node1"));
+  EXPECT_EQ("/chatter", resolve("/chatter", "/wg/node1"));
+  EXPECT_EQ("/wg/", resolve("", "/wg/node1"));
+}
+
+TEST_F(MasterTest, topicRegistration)
+{
+  XmlRpcValue result = call("registerSubscriber", "/sub", "chatter", "std_msgs/String", "http://sub:1/");
+  ASSERT_EQ(1, static_cast<int>(result[0]));
+  EXPECT_EQ(0, result[2].size());
+
+  result = call("registerPublisher", "/pub", "/chatter", "std_msgs/String", "http://pub:1/");
+  ASSERT_EQ(1, static_cast<int>(result[0]));
+  ASSERT_EQ(1, result[2].size());
+  EXPECT_EQ("http://sub:1/", static_cast<std::string>(result[2][0]));
+
+  std::vector<Call> calls = flushCalls();
+  ASSERT_EQ(1u, calls.size());
+  EXPECT_EQ("http://sub:1/", calls[0].api);
+  EXPECT_EQ("publisherUpdate", calls[0].method);
+  EXPECT_EQ("/chatter", static_cast<std::string>(calls[0].params[1]));
+  ASSERT_EQ(1, calls[0].params[2].size());
+  EXPECT_EQ("http://pub:1/", static_cast<std::string>(calls[0].params[2][0]));
+
+  result = call("getPublishedTopics", "/sub", "");
+  ASSERT_EQ(1, result[2].size());
+  EXPECT_EQ("/chatter", static_cast<std::string>(result[2][0][0]));
+  EXPECT_EQ("std_msgs/String", static_cast<std::string>(result[2][0][1]));
+
+  result = call("lookupNode", "/sub", "/pub");
+  EXPECT_EQ("http://pub:1/", static_cast<std::string>(result[2]));
+
+  result = call("unregisterPublisher", "/pub", "/chatter", "http://pub:1/");
+  EXPECT_EQ(1, static_cast<int>(result[2]));
+  calls = flushCalls();
+  ASSERT_EQ(1u, calls.size());
+  EXPECT_EQ(0, calls[0].params[2].size());
+
+  // The node is forgotten along with its last registration
+  result = call("lookupNode", "/sub", "/pub");
+  EXPECT_EQ(-1, static_cast<int>(result[0]));
+
+  result = call("unregisterPublisher", "/pub", "/chatter", "http://pub:1/");
+  EXPECT_EQ(1, static_cast<int>(result[0]));
+  EXPECT_EQ(0, static_cast<int>(result[2]));
+}
+
+TEST_F(MasterTest, replacedNodeIsShutDown)
+{
+  call("registerPublisher", "/node", "/a", "std_msgs/String", "http://old:1/");
+  call("registerSubscriber", "/node", "/b", "std_msgs/String", "http://old:1/");
+  flushCalls();
+
+  call("registerPublisher", "/node", "/c", "std_msgs/String", "http://new:1/");
+  std::vector<Call> calls = flushCalls();
+  ASSERT_EQ(1u, calls.size());
+  EXPECT_EQ("http://old:1/", calls[0].api);
+  EXPECT_EQ("shutdown", calls[0].method);
+
+  XmlRpcValue state = call("getSystemState", "/x")[2];
+  ASSERT_EQ(1, state[0].size());
+  EXPECT_EQ("/c", static_cast<std::string>(state[0][0][0]));
+  EXPECT_EQ(0, state[1].size());
+}
+
+TEST_F(MasterTest, services)
+{
+  XmlRpcValue result = call("registerService", "/srv_node", "add", "rosrpc://srv:2/", "http://srv:1/");
+  ASSERT_EQ(1, static_cast<int>(result[0]));
+
+  result = call("lookupService", "/client", "/add");
+  EXPECT_EQ("rosrpc://srv:2/", static_cast<std::string>(result[2]));
+
+  result = call("unregisterService", "/srv_node", "/add", "rosrpc://other:2/");
+  EXPECT_EQ(0, static_cast<int>(result[2]));
+
+  result = call("unregisterService", "/srv_node", "/add", "rosrpc://srv:2/");
+  EXPECT_EQ(1, static_cast<int>(result[2]));
+
+  result = call("lookupService", "/client", "/add");
+  EXPECT_EQ(-1, static_cast<int>(result[0]));
+}
+
+TEST_F(MasterTest, params)
+{
+  XmlRpcValue tree;
+  tree["x"] = 1;
+  tree["sub"]["z"] = "three";
+  ASSERT_EQ(1, static_cast<int>(call("setParam", "/node", "/ns", tree)[0]));
+  ASSERT_EQ(1, static_cast<int>(call("setParam", "/node", "~private", 2.5)[0]));
+
+  XmlRpcValue result = call("getParam", "/other", "/ns/sub/z");
+  EXPECT_EQ("three", static_cast<std::string>(result[2]));
+
+  result = call("getParam", "/other", "/ns");
+  ASSERT_EQ(XmlRpcValue::TypeStruct, result[2].getType());
+  EXPECT_EQ(1, static_cast<int>(result[2]["x"]));
+
+  EXPECT_TRUE(static_cast<bool>(call("hasParam", "/other", "/node/private")[2]));
+  EXPECT_FALSE(static_cast<bool>(call("hasParam", "/other", "/ns/missing")[2]));
+
+  result = call("getParamNames", "/other");
+  ASSERT_EQ(3, result[2].size());
+  EXPECT_EQ("/node/private", static_cast<std::string>(result[2][0]));
+  EXPECT_EQ("/ns/sub/z", static_cast<std::string>(result[2][1]));
+  EXPECT_EQ("/ns/x", static_cast<std::string>(result[2][2]));
+
+  result = call("searchParam", "/ns/deep/node", "sub/z");
+  EXPECT_EQ("/ns/sub/z", static_cast<std::string>(result[2]));
+
+  result = call("deleteParam", "/other", "/ns/sub");
+  EXPECT_EQ(1, static_cast<int>(result[0]));
+  result = call("deleteParam", "/other", "/ns/sub");
+  EXPECT_EQ(-1, static_cast<int>(result[0]));
+
+  // Only namespaces may replace the root
+  EXPECT_EQ(0, static_cast<int>(call("setParam", "/other", "/", 1)[0]));
+}
+
+TEST_F(MasterTest, paramSubscriptions)
+{
+  call("setParam", "/node", "/ns/a/b", 1);
+  XmlRpcValue result = call("subscribeParam", "/watcher", "http://watcher:1/", "/ns/a/b");
+  EXPECT_EQ(1, static_cast<int>(result[2]));
+  result = call("subscribeParam", "/watcher2", "http://watcher2:1/", "/ns/missing");
+  EXPECT_EQ(XmlRpcValue::TypeStruct, result[2].getType());
+  EXPECT_EQ(0, result[2].size());
+  flushCalls();
+
+  // Replacing the namespace above both subscriptions updates each with its part of the new tree
+  XmlRpcValue tree;
+  tree["a"]["b"] = 2;
+  call("setParam", "/node", "/ns", tree);
+  std::vector<Call> calls = flushCalls();
+  ASSERT_EQ(2u, calls.size());
+  for (size_t i = 0; i < calls.size(); ++i)
+  {
+    EXPECT_EQ("paramUpdate", calls[i].method);
+    if (calls[i].api == "http://watcher:1/")
+    {
+      EXPECT_EQ("/ns/a/b/", static_cast<std::string>(calls[i].params[1]));
+      EXPECT_EQ(2, static_cast<int>(calls[i].params[2]));
+    }
+    else
+    {
+      EXPECT_EQ("/ns/missing/", static_cast<std::string>(calls[i].params[1]));
+      EXPECT_EQ(0, calls[i].params[2].size());
+    }
+  }
+
+  // A node is not told about its own change
+  call("setParam", "/watcher", "/ns/a/b", 3);
+  EXPECT_EQ(0u, flushCalls().size());
+
+  call("unsubscribeParam", "/watcher", "http://watcher:1/", "/ns/a/b");
+  call("deleteParam", "/node", "/ns/a");
+  EXPECT_EQ(0u, flushCalls().size());
+}
+
+TEST_F(MasterTest, validation)
+{
+  XmlRpcValue params, result;
+  params[0] = "/node";
+  master_.call("registerPublisher", params, result);
+  EXPECT_EQ(-1, static_cast<int>(result[0]));
+  EXPECT_EQ("Error: bad call arity", static_cast<std::string>(result[1]));
+
+  result = call("registerPublisher", "/node", "/topic", "std_msgs/String", "not_a_uri");
+  EXPECT_EQ(-1, static_cast<int>(result[0]));
+  EXPECT_EQ(XmlRpcValue::TypeArray, result[2].getType());
+
+  result = call("registerPublisher", "/node", "/topic", "String", "http://node:1/");
+  EXPECT_EQ(-1, static_cast<int>(result[0]));
+
+  result = call("registerPublisher", "/node", "/", "std_msgs/String", "http://node:1/");
+  EXPECT_EQ(-1, static_cast<int>(result[0]));
+
+  result = call("getUri", "/node");
+  EXPECT_EQ(1, static_cast<int>(result[0]));
+}
+
+/**
+ * \brief Holds every call until released, so that later calls queue up behind the first
+ */
+class Gate
+{
+public:
+  Gate() : entered_(false), released_(false) {}
+
+  bool send(const std::string&, const std::string&, const XmlRpcValue& params, XmlRpcValue&)
+  {
+    boost::mutex::scoped_lock lock(mutex_);
+    entered_ = true;
+    condition_.notify_all();
+    while (!released_)
+    {
+      condition_.wait(lock);
+    }
+    sent_.push_back(params);
+    return true;
+  }
+
+  void waitForEntered()
+  {
+    boost::mutex::scoped_lock lock(mutex_);
+    while (!entered_)
+    {
+      condition_.wait(lock);
+    }
+  }
+
+  void release()
+  {
+    boost::mutex::scoped_lock lock(mutex_);
+    released_ = true;
+    condition_.notify_all();
+  }
+
+  std::vector<XmlRpcValue> sent_;
+
+private:
+  boost::mutex mutex_;
+  boost::condition_variable condition_;
+  bool entered_;
+  bool released_;
+};
+
+TEST(RosmasterNotifier, coalescesPublisherUpdates)
+{
+  Gate gate;
+  rosmaster::Notifier notifier(4, -1.0, boost::bind(&Gate::send, &gate, boost::placeholders::_1,
+                                                     boost::placeholders::_2, boost::placeholders::_3,
+                                                     boost::placeholders::_4));
+  std::vector<std::string> pubs(1, "http://pub:0/");
+  notifier.publisherUpdate("http://sub:1/", "/chatter", pubs);
+  gate.waitForEntered();
+
+  for (int i = 1; i < 10; ++i)
+  {
+    pubs.push_back("http://pub:" + boost::lexical_cast<std::string>(i) + "/");
+    notifier.publisherUpdate("http://sub:1/", "/chatter", pubs);
+  }
+  gate.release();
+  notifier.waitForIdle();
+
+  // The first update was in flight; the other nine collapse into one carrying the latest list
+  ASSERT_EQ(2u, gate.sent_.size());
+  EXPECT_EQ(1, gate.sent_[0][2].size());
+  EXPECT_EQ(10, gate.sent_[1][2].size());
+  EXPECT_EQ(8u, notifier.getCoalescedCount());
+}
+
+int main(int argc, char** argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -67,7 +67,10 @@ public:
   ros::NodeHandle node_;
   ros::Subscriber rosout_sub_;
   ros::Publisher agg_pub_;
+  ros::WallTimer flush_timer_;
   bool omit_topics_;
+  bool needs_flush_;
+  std::stringstream line_;  ///< Reused to format each line of the log file
 
   Rosout() :
     log_file_name_(ros::file_log::getLogDirectory() + "/rosout.log"),
@@ -76,11 +79,20 @@ public:
     current_file_size_(0),
     max_backup_index_(10),
     current_backup_index_(0),
-    omit_topics_(false)
+    omit_topics_(false),
+    needs_flush_(false)
   {
     init();
   }
 
+  ~Rosout()
+  {
+    if (handle_)
+    {
+      fclose(handle_);
+    }
+  }
+
   void init()
   {
     const char* disable_file_logging_env = getenv("ROSOUT_DISABLE_FILE_LOGGING");
@@ -127,10 +139,39 @@ public:
     agg_pub_ = node_.advertise<rosgraph_msgs::Log>("/rosout_agg", 0);
     std::cout << "re-publishing aggregated messages to /rosout_agg" << std::endl;
 
-    rosout_sub_ = node_.subscribe("/rosout", 0, &Rosout::rosoutCallback, this);
+    // Writes are flushed on a timer rather than per message, so a burst of logs costs one flush.
+    // The subscription queue stays bounded unless max_queue_size is set to 0.
+    double flush_period = 0.1;
+    int max_queue_size = 1000;
+    ros::NodeHandle private_nh("~");
+    private_nh.param("flush_period", flush_period, flush_period);
+    private_nh.param("max_queue_size", max_queue_size, max_queue_size);
+    if (handle_ && flush_period > 0.0)
+    {
+      flush_timer_ = node_.createWallTimer(ros::WallDuration(flush_period), &Rosout::flushCallback, this);
+    }
+
+    rosout_sub_ = node_.subscribe("/rosout", std::max(max_queue_size, 0), &Rosout::rosoutCallback, this);
     std::cout << "subscribed to /rosout" << std::endl;
   }
 
+  void flush()
+  {
+    if (handle_ && needs_flush_)
+    {
+      if (fflush(handle_))
+      {
+        std::cerr << "Error flushing rosout log file '" << log_file_name_.c_str() << "': " << strerror(errno);
+      }
+      needs_flush_ = false;
+    }
+  }
+
+  void flushCallback(const ros::WallTimerEvent&)
+  {
+    flush();
+  }
+
   void rosoutCallback(const rosgraph_msgs::Log::ConstPtr& msg)
   {
     agg_pub_.publish(msg);
@@ -140,7 +181,8 @@ public:
       return;
     }
 
-    std::stringstream ss;
+    std::stringstream& ss = line_;
+    ss.str(std::string());
     ss << msg->header.stamp << " ";
     switch (msg->level)
     {
@@ -198,9 +240,10 @@ public:
     else if (written > 0)
     {
       current_file_size_ += written;
-      if (fflush(handle_))
+      needs_flush_ = true;
+      if (!flush_timer_)
       {
-        std::cerr << "Error flushing rosout log file '" << log_file_name_.c_str() << "': " << strerror(errno);
+        flush();
       }
 
       // check for rolling
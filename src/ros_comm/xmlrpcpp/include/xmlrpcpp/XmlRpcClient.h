@@ -127,6 +127,12 @@ namespace XmlRpc {
     // Number of bytes expected in the response body (parsed from response header)
     int _contentLength;
 
+    // True if the server will keep the connection open after the last response
+    bool _keepAlive;
+
+    // Number of bytes of _header already searched for the end of the header
+    size_t _headerScanned;
+
     // Event dispatcher
     XmlRpcDispatch _disp;
 
@@ -12,6 +12,7 @@
 
 #ifndef MAKEDEPEND
 # include <list>
+# include <unordered_map>
 # include <vector>
 #endif
 
@@ -59,16 +60,28 @@ namespace XmlRpc {
     //! Clear all sources from the monitored sources list. Sources are closed.
     void clear();
 
+    //! Wait for events with epoll instead of poll. Sources are registered with
+    //! the kernel once instead of being re-submitted on every call to work(),
+    //! which keeps each wakeup proportional to the number of ready sources.
+    //! Only available on Linux; returns false if epoll could not be used.
+    bool setUseEpoll(bool useEpoll);
+
+    //! Return true if events are being waited for with epoll.
+    bool getUseEpoll() const { return _epollFd >= 0; }
+
     // helper returning current steady/monotonic time
     double getTime();
 
     // A source to monitor and what to monitor it for
     struct MonitoredSource {
-      MonitoredSource(XmlRpcSource* src, unsigned mask) : _src(src), _mask(mask) {}
+      MonitoredSource(XmlRpcSource* src, unsigned mask) : _src(src), _mask(mask), _fd(-1), _id(0) {}
       XmlRpcSource* getSource() const { return _src; }
       unsigned& getMask() { return _mask; }
       XmlRpcSource* _src;
       unsigned _mask;
+      // File descriptor registered with epoll, and the key its events are reported under
+      int _fd;
+      unsigned long long _id;
     };
 
     // A list of sources to monitor
@@ -78,12 +91,51 @@ namespace XmlRpc {
     SourceList _sources;
   protected:
 
+    // Wait for events on the cached pollfd set, or on the epoll descriptor
+    bool workPoll(int timeout_ms);
+    bool workEpoll(int timeout_ms);
+
+    // Dispatch the events reported for one source and apply the mask it returns
+    void handleSourceEvents(XmlRpcSource* src, bool readable, bool writable, bool oob);
+
+    // Keep the epoll registration of a source in sync with its fd and mask
+    void epollRegister(SourceList::iterator it);
+    void epollUnregister(MonitoredSource& ms);
+
+    // Stop monitoring the source at this position in the list
+    void eraseSource(SourceList::iterator it);
+
+    // Close and forget all sources
+    void closeAll();
+
     // When work should stop (-1 implies wait forever, or until exit is called)
     double _endTime;
 
     bool _doClear;
     bool _inWork;
 
+    // Position of each source in _sources, so lookups don't walk the list
+    typedef std::unordered_map< XmlRpcSource*, SourceList::iterator > SourceIndex;
+    SourceIndex _sourceIndex;
+
+    // Set when sources are added, removed or change their mask; the cached
+    // poll set is only rebuilt when this is set.
+    bool _sourcesChanged;
+
+    // Buffers handed to poll()/epoll_wait(), see XmlRpcDispatch.cpp
+    struct EventBuffers;
+    EventBuffers* _buffers;
+
+    // epoll descriptor (-1 when poll is used) and the sources its events refer to
+    int _epollFd;
+    unsigned long long _nextId;
+    typedef std::unordered_map< unsigned long long, SourceList::iterator > EpollIndex;
+    EpollIndex _epollIndex;
+
+  private:
+    // Not copyable; the event buffers and epoll descriptor are owned
+    XmlRpcDispatch(const XmlRpcDispatch&);
+    XmlRpcDispatch& operator=(const XmlRpcDispatch&);
   };
 } // namespace XmlRpc
 
@@ -83,6 +83,9 @@ namespace XmlRpc {
     // Request headers
     std::string _header;
 
+    // Number of bytes of _header already searched for the end of the header
+    size_t _headerScanned;
+
     // Number of bytes expected in the request body (parsed from header)
     int _contentLength;
 
@@ -104,6 +104,16 @@ namespace XmlRpc {
     //! and updates offset to char after </tag>
     static std::string nextTagData(const char* tag, std::string const& xml, int* offset);
 
+    // http header parsing
+    //! Returns the offset of the first byte after the blank line that ends an http
+    //! header, or std::string::npos if the header is not complete yet. The search
+    //! resumes at *offset, which is advanced past the data already examined.
+    static size_t findHeaderEnd(std::string const& header, size_t* offset);
+
+    //! Returns a pointer to the value of the named field (compared case-insensitively)
+    //! in the header lines between begin and end, or 0 if the field is not present.
+    static const char* findHeaderField(const char* begin, const char* end, const char* name);
+
     //! Convert raw text to encoded xml.
     static std::string xmlEncode(const std::string& raw);
 
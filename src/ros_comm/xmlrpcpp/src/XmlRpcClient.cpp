@@ -58,7 +58,9 @@ XmlRpcClient::XmlRpcClient(const char* host, int port, const char* uri/*=0*/)
   _executing(false),
   _eof(false),
   _isFault(false),
-  _contentLength(0)
+  _contentLength(0),
+  _keepAlive(false),
+  _headerScanned(0)
 {
   XmlRpcUtil::log(1, "XmlRpcClient new client: host %s, port %d.", host, port);
 
@@ -132,16 +134,16 @@ XmlRpcClient::execute(const char* method, XmlRpcValue const& params, XmlRpcValue
     return false;
   }
 
-  // close() if server does not supports HTTP1.1
+  // close() if the server will not keep the connection alive;
   // otherwise, reusing the socket to write leads to a SIGPIPE because
   // the remote server could shut down the corresponding socket.
-  if (_header.find("HTTP/1.1 200 OK", 0, 15) != 0) {
+  if ( ! _keepAlive) {
     close();
   }
 
   XmlRpcUtil::log(1, "XmlRpcClient::execute: method %s completed.", method);
-  _header = "";
-  _response = "";
+  _header.clear();
+  _response.clear();
   return true;
 }
 
@@ -194,8 +196,13 @@ XmlRpcClient::executeCheckDone(XmlRpcValue& result)
   {
     // Hopefully the caller can determine that parsing failed.
   }
+  // Same as execute(): don't reuse a connection the server is about to close
+  if ( ! _keepAlive) {
+    close();
+  }
   //XmlRpcUtil::log(1, "XmlRpcClient::execute: method %s completed.", method);
-  _response = "";
+  _header.clear();
+  _response.clear();
   return true;
 }
 
@@ -373,8 +380,9 @@ XmlRpcClient::writeRequest()
 
   // Wait for the result
   if (_bytesWritten == int(_request.length())) {
-    _header = "";
-    _response = "";
+    _header.clear();
+    _headerScanned = 0;
+    _response.clear();
     _connectionState = READ_HEADER;
   } else {
     // On partial write, remove the portion of the output that was written from
@@ -398,6 +406,7 @@ XmlRpcClient::readHeader()
     // have timed out, so we try one more time.
     if (getKeepOpen() && _header.length() == 0 && _sendAttempts++ == 0) {
       XmlRpcUtil::log(4, "XmlRpcClient::readHeader: re-trying connection");
+      _disp.removeSource(this);       // Unregister the fd before closing it
       XmlRpcSource::close();
       _connectionState = NO_CONNECTION;
       _eof = false;
@@ -415,22 +424,11 @@ XmlRpcClient::readHeader()
 
   XmlRpcUtil::log(4, "XmlRpcClient::readHeader: client has read %d bytes", _header.length());
 
-  char *hp = (char*)_header.c_str();  // Start of header
-  char *ep = hp + _header.length();   // End of string
-  char *bp = 0;                       // Start of body
-  char *lp = 0;                       // Start of content-length value
-
-  for (char *cp = hp; (bp == 0) && (cp < ep); ++cp) {
-    if ((ep - cp > 16) && (strncasecmp(cp, "Content-length: ", 16) == 0))
-      lp = cp + 16;
-    else if ((ep - cp > 4) && (strncmp(cp, "\r\n\r\n", 4) == 0))
-      bp = cp + 4;
-    else if ((ep - cp > 2) && (strncmp(cp, "\n\n", 2) == 0))
-      bp = cp + 2;
-  }
+  // Only the data that arrived since the last read is searched for the end of the header
+  size_t bodyOffset = XmlRpcUtil::findHeaderEnd(_header, &_headerScanned);
 
   // If we haven't gotten the entire header yet, return (keep reading)
-  if (bp == 0) {
+  if (bodyOffset == std::string::npos) {
     if (_eof)          // EOF in the middle of a response is an error
     {
       XmlRpcUtil::error("Error in XmlRpcClient::readHeader: EOF while reading header");
@@ -441,6 +439,11 @@ XmlRpcClient::readHeader()
     return true;  // Keep reading
   }
 
+  const char *hp = _header.c_str();   // Start of header
+  const char *bp = hp + bodyOffset;   // Start of body
+  const char *lp = XmlRpcUtil::findHeaderField(hp, bp, "Content-length");
+  const char *kp = XmlRpcUtil::findHeaderField(hp, bp, "Connection");
+
   // Decode content length
   if (lp == 0) {
     XmlRpcUtil::error("Error XmlRpcClient::readHeader: No Content-length specified");
@@ -462,8 +465,21 @@ XmlRpcClient::readHeader()
   	
   XmlRpcUtil::log(4, "client read content length: %d", _contentLength);
 
-  // Otherwise copy non-header data to response buffer and set state to read response.
-  _response = bp;
+  // The connection can be reused for the next call if the server answered with
+  // HTTP/1.1 (or HTTP/1.0 with keep-alive) and did not ask for it to be closed.
+  // Anything other than 200 OK is treated as a reason to reconnect.
+  if (strncmp(hp, "HTTP/1.1 200", 12) == 0)
+    _keepAlive = (kp == 0 || strncasecmp(kp, "close", 5) != 0);
+  else if (strncmp(hp, "HTTP/1.0 200", 12) == 0)
+    _keepAlive = (kp != 0 && strncasecmp(kp, "keep-alive", 10) == 0);
+  else
+    _keepAlive = false;
+
+  // Otherwise move non-header data to the response buffer and set state to read response.
+  _header.erase(0, bodyOffset);
+  _response.swap(_header);
+  _header.clear();
+  _headerScanned = 0;
   _connectionState = READ_RESPONSE;
   return true;    // Continue monitoring this source
 }
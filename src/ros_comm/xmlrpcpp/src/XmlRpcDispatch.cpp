@@ -7,6 +7,7 @@
 
 #include <math.h>
 #include <errno.h>
+#include <string.h>
 #include <sys/timeb.h>
 
 #if defined(_WINDOWS)
@@ -72,22 +73,61 @@ static int poll( struct pollfd *pfd, int nfds, int timeout)
 #else
 # include <sys/poll.h>
 # include <sys/time.h>
+# if defined(__linux__)
+#  include <sys/epoll.h>
+#  include <unistd.h>
+#  define XMLRPCPP_HAVE_EPOLL
+# endif
 #endif  // _WINDOWS
 
 
 using namespace XmlRpc;
 
+// Loosely based on `man select` > Correspondence between select() and poll() notifications
+// and cloudius-systems/osv#35, cloudius-systems/osv@b53d39a using poll to emulate select
+static const unsigned POLLIN_REQ = POLLIN; // Request read
+static const unsigned POLLIN_CHK = (POLLIN | POLLHUP | POLLERR); // Readable or connection lost
+static const unsigned POLLOUT_REQ = POLLOUT; // Request write
+static const unsigned POLLOUT_CHK = (POLLOUT | POLLERR); // Writable or connection lost
+#if !defined(_WINDOWS)
+static const unsigned POLLEX_REQ = POLLPRI; // Out-of-band data received
+static const unsigned POLLEX_CHK = (POLLPRI | POLLNVAL); // Out-of-band data or invalid fd
+#else
+static const unsigned POLLEX_REQ = POLLRDBAND; // Out-of-band data received
+static const unsigned POLLEX_CHK = (POLLRDBAND | POLLNVAL); // Out-of-band data or invalid fd
+#endif
+
+
+// The pollfd set is rebuilt only when sources are added, removed or change
+// their mask; the epoll event buffer only ever grows.
+struct XmlRpcDispatch::EventBuffers {
+  std::vector<pollfd> fds;
+  std::vector<XmlRpcSource*> sources;
+#ifdef XMLRPCPP_HAVE_EPOLL
+  std::vector<epoll_event> events;
+#endif
+};
+
 
 XmlRpcDispatch::XmlRpcDispatch()
 {
   _endTime = -1.0;
   _doClear = false;
   _inWork = false;
+  _sourcesChanged = true;
+  _buffers = new EventBuffers;
+  _epollFd = -1;
+  _nextId = 1;
 }
 
 
 XmlRpcDispatch::~XmlRpcDispatch()
 {
+#ifdef XMLRPCPP_HAVE_EPOLL
+  if (_epollFd >= 0)
+    ::close(_epollFd);
+#endif
+  delete _buffers;
 }
 
 // Monitor this source for the specified events and call its event handler
@@ -95,19 +135,27 @@ XmlRpcDispatch::~XmlRpcDispatch()
 void
 XmlRpcDispatch::addSource(XmlRpcSource* source, unsigned mask)
 {
-  _sources.push_back(MonitoredSource(source, mask));
+  // A source is only monitored once; adding it again updates its mask
+  if (_sourceIndex.count(source))
+  {
+    setSourceEvents(source, mask);
+    return;
+  }
+
+  SourceList::iterator it = _sources.insert(_sources.end(), MonitoredSource(source, mask));
+  _sourceIndex[source] = it;
+  _sourcesChanged = true;
+  if (_epollFd >= 0)
+    epollRegister(it);
 }
 
 // Stop monitoring this source. Does not close the source.
 void
 XmlRpcDispatch::removeSource(XmlRpcSource* source)
 {
-  for (SourceList::iterator it=_sources.begin(); it!=_sources.end(); ++it)
-    if (it->getSource() == source)
-    {
-      _sources.erase(it);
-      break;
-    }
+  SourceIndex::iterator found = _sourceIndex.find(source);
+  if (found != _sourceIndex.end())
+    eraseSource(found->second);
 }
 
 
@@ -115,34 +163,134 @@ XmlRpcDispatch::removeSource(XmlRpcSource* source)
 void
 XmlRpcDispatch::setSourceEvents(XmlRpcSource* source, unsigned eventMask)
 {
-  for (SourceList::iterator it=_sources.begin(); it!=_sources.end(); ++it)
-    if (it->getSource() == source)
+  SourceIndex::iterator found = _sourceIndex.find(source);
+  if (found == _sourceIndex.end())
+    return;
+
+  found->second->getMask() = eventMask;
+  _sourcesChanged = true;
+  if (_epollFd >= 0)
+    epollRegister(found->second);
+}
+
+
+void
+XmlRpcDispatch::eraseSource(SourceList::iterator it)
+{
+  epollUnregister(*it);
+  _sourceIndex.erase(it->getSource());
+  _sources.erase(it);
+  _sourcesChanged = true;
+}
+
+
+// Switch between poll and epoll. Sources already being monitored are carried over.
+bool
+XmlRpcDispatch::setUseEpoll(bool useEpoll)
+{
+#ifdef XMLRPCPP_HAVE_EPOLL
+  if (useEpoll == (_epollFd >= 0))
+    return true;
+
+  if (useEpoll)
+  {
+    _epollFd = epoll_create1(EPOLL_CLOEXEC);
+    if (_epollFd < 0)
     {
-      it->getMask() = eventMask;
-      break;
+      XmlRpcUtil::error("Error in XmlRpcDispatch::setUseEpoll: could not create epoll descriptor (%d).", errno);
+      return false;
     }
+    for (SourceList::iterator it=_sources.begin(); it!=_sources.end(); ++it)
+      epollRegister(it);
+  }
+  else
+  {
+    for (SourceList::iterator it=_sources.begin(); it!=_sources.end(); ++it)
+      epollUnregister(*it);
+    ::close(_epollFd);
+    _epollFd = -1;
+    _sourcesChanged = true;
+  }
+  return true;
+#else
+  return ! useEpoll;
+#endif
 }
 
 
+// Register the source's current fd and mask with epoll. Events are reported
+// under an id rather than the fd or source pointer, so that events for a
+// source removed by an earlier handler in the same cycle can be recognized.
+void
+XmlRpcDispatch::epollRegister(SourceList::iterator it)
+{
+#ifdef XMLRPCPP_HAVE_EPOLL
+  MonitoredSource& ms = *it;
+  if (ms._id == 0)
+  {
+    ms._id = _nextId++;
+    _epollIndex[ms._id] = it;
+  }
+
+  // Sources must be removed (or get a zero mask) before their fd is closed,
+  // so that the registration is deleted while the fd is still valid. The
+  // kernel only drops a closed fd from the epoll set once every duplicate of
+  // it (dup(), fork()) is closed too, and by then its number may have been
+  // reused, so a registration left behind cannot be deleted here.
+  int fd = ms.getSource()->getfd();
+  if (fd < 0)
+  {
+    ms._fd = -1;
+    return;
+  }
+
+  epoll_event ev;
+  memset(&ev, 0, sizeof(ev));
+  if (ms.getMask() & ReadableEvent) ev.events |= EPOLLIN;
+  if (ms.getMask() & WritableEvent) ev.events |= EPOLLOUT;
+  if (ms.getMask() & Exception) ev.events |= EPOLLPRI;
+  ev.data.u64 = ms._id;
+
+  int result = -1;
+  if (fd == ms._fd)
+    result = epoll_ctl(_epollFd, EPOLL_CTL_MOD, fd, &ev);
+  if (result != 0)
+  {
+    result = epoll_ctl(_epollFd, EPOLL_CTL_ADD, fd, &ev);
+    if (result != 0 && errno == EEXIST)
+      result = epoll_ctl(_epollFd, EPOLL_CTL_MOD, fd, &ev);
+  }
+  if (result != 0)
+    XmlRpcUtil::error("Error in XmlRpcDispatch::epollRegister: could not register fd %d (%d).", fd, errno);
+  ms._fd = fd;
+#else
+  (void) it;
+#endif
+}
 
-// Watch current set of sources and process events
 void
-XmlRpcDispatch::work(double timeout)
+XmlRpcDispatch::epollUnregister(MonitoredSource& ms)
 {
-  // Loosely based on `man select` > Correspondence between select() and poll() notifications
-  // and cloudius-systems/osv#35, cloudius-systems/osv@b53d39a using poll to emulate select
-  const unsigned POLLIN_REQ = POLLIN; // Request read
-  const unsigned POLLIN_CHK = (POLLIN | POLLHUP | POLLERR); // Readable or connection lost
-  const unsigned POLLOUT_REQ = POLLOUT; // Request write
-  const unsigned POLLOUT_CHK = (POLLOUT | POLLERR); // Writable or connection lost
-#if !defined(_WINDOWS)
-  const unsigned POLLEX_REQ = POLLPRI; // Out-of-band data received
-  const unsigned POLLEX_CHK = (POLLPRI | POLLNVAL); // Out-of-band data or invalid fd
+#ifdef XMLRPCPP_HAVE_EPOLL
+  if (ms._id != 0)
+  {
+    _epollIndex.erase(ms._id);
+    ms._id = 0;
+  }
+  // Only delete the registration if the source still owns that fd
+  if (_epollFd >= 0 && ms._fd >= 0 && ms._fd == ms.getSource()->getfd())
+    epoll_ctl(_epollFd, EPOLL_CTL_DEL, ms._fd, nullptr);
+  ms._fd = -1;
 #else
-  const unsigned POLLEX_REQ = POLLRDBAND; // Out-of-band data received
-  const unsigned POLLEX_CHK = (POLLRDBAND | POLLNVAL); // Out-of-band data or invalid fd
+  (void) ms;
 #endif
+}
+
 
+// Watch current set of sources and process events
+void
+XmlRpcDispatch::work(double timeout)
+{
   // Compute end time
   _endTime = (timeout < 0.0) ? -1.0 : (getTime() + timeout);
   _doClear = false;
@@ -152,104 +300,184 @@ XmlRpcDispatch::work(double timeout)
   // Only work while there is something to monitor
   while (_sources.size() > 0) {
 
-    // Construct the sets of descriptors we are interested in
-    const unsigned source_cnt = _sources.size();
-    std::vector<pollfd> fds(source_cnt);
-    std::vector<XmlRpcSource *> sources(source_cnt);
+    bool ok = (_epollFd >= 0) ? workEpoll(timeout_ms) : workPoll(timeout_ms);
+    if ( ! ok)
+    {
+      _inWork = false;
+      return;
+    }
+
+    // Check whether to clear all sources
+    if (_doClear)
+    {
+      closeAll();
+      _doClear = false;
+    }
+
+    // Check whether end time has passed
+    if (0 <= _endTime && getTime() > _endTime)
+      break;
+  }
+
+  _inWork = false;
+}
+
+
+bool
+XmlRpcDispatch::workPoll(int timeout_ms)
+{
+  std::vector<pollfd>& fds = _buffers->fds;
+  std::vector<XmlRpcSource*>& sources = _buffers->sources;
+
+  // Construct the sets of descriptors we are interested in
+  if (_sourcesChanged)
+  {
+    fds.resize(_sources.size());
+    sources.resize(_sources.size());
 
-    SourceList::iterator it;
     std::size_t i = 0;
-    for (it=_sources.begin(); it!=_sources.end(); ++it, ++i) {
+    for (SourceList::iterator it=_sources.begin(); it!=_sources.end(); ++it, ++i) {
       sources[i] = it->getSource();
-      fds[i].fd = sources[i]->getfd();
-      fds[i].revents = 0; // some platforms may not clear this in poll()
       fds[i].events = 0;
       if (it->getMask() & ReadableEvent) fds[i].events |= POLLIN_REQ;
       if (it->getMask() & WritableEvent) fds[i].events |= POLLOUT_REQ;
       if (it->getMask() & Exception) fds[i].events |= POLLEX_REQ;
     }
+    _sourcesChanged = false;
+  }
 
-    // Check for events
-    int nEvents = poll(&fds[0], source_cnt, (timeout_ms < 0) ? -1 : timeout_ms);
+  // Sources may reopen their fd without being re-added, so always refresh it
+  const std::size_t source_cnt = sources.size();
+  for (std::size_t i=0; i < source_cnt; ++i) {
+    fds[i].fd = sources[i]->getfd();
+    fds[i].revents = 0; // some platforms may not clear this in poll()
+  }
 
-    if (nEvents < 0)
-    {
+  // Check for events
+  int nEvents = poll(&fds[0], source_cnt, (timeout_ms < 0) ? -1 : timeout_ms);
+
+  if (nEvents < 0)
+  {
 #if defined(_WINDOWS)
-      XmlRpcUtil::error("Error in XmlRpcDispatch::work: error in poll (%d).", WSAGetLastError());
-      _inWork = false;
-      return;
+    XmlRpcUtil::error("Error in XmlRpcDispatch::work: error in poll (%d).", WSAGetLastError());
+    return false;
 #else
-      if(errno != EINTR)
-      {
-        XmlRpcUtil::error("Error in XmlRpcDispatch::work: error in poll (%d).", nEvents);
-        _inWork = false;
-        return;
-      }
-      // If we receive EINTR, the revents will be empty and no handleEvents will be called.
-      // It will loop back to the poll unless the timeout is reached.
-#endif
+    if(errno != EINTR)
+    {
+      XmlRpcUtil::error("Error in XmlRpcDispatch::work: error in poll (%d).", nEvents);
+      return false;
     }
+    // If we receive EINTR, the revents will be empty and no handleEvents will be called.
+    // It will loop back to the poll unless the timeout is reached.
+#endif
+  }
 
-    // Process events
-    for (i=0; i < source_cnt; ++i)
-    {
-      XmlRpcSource* src = sources[i];
-      pollfd & pfd = fds[i];
-      unsigned newMask = (unsigned) -1;
-      // Only handle requested events to avoid being prematurely removed from dispatch
-      bool readable = (pfd.events & POLLIN_REQ) == POLLIN_REQ;
-      bool writable = (pfd.events & POLLOUT_REQ) == POLLOUT_REQ;
-      bool oob = (pfd.events & POLLEX_REQ) == POLLEX_REQ;
-      if (readable && (pfd.revents & POLLIN_CHK))
-        newMask &= src->handleEvent(ReadableEvent);
-      if (writable && (pfd.revents & POLLOUT_CHK))
-        newMask &= src->handleEvent(WritableEvent);
-      if (oob && (pfd.revents & POLLEX_CHK))
-        newMask &= src->handleEvent(Exception);
-
-      // Find the source iterator. It may have moved as a result of the way
-      // that sources are removed and added in the call stack starting
-      // from the handleEvent() calls above.
-      SourceList::iterator thisIt;
-      for (thisIt = _sources.begin(); thisIt != _sources.end(); thisIt++)
-      {
-        if(thisIt->getSource() == src)
-          break;
-      }
-      if(thisIt == _sources.end())
-      {
-        XmlRpcUtil::error("Error in XmlRpcDispatch::work: couldn't find source iterator");
-        continue;
-      }
+  // Process events. The handlers may add or remove sources; that only marks
+  // the cached set as changed, so it is safe to keep iterating over it.
+  for (std::size_t i=0; i < source_cnt; ++i)
+  {
+    const pollfd& pfd = fds[i];
+    if (pfd.revents == 0)
+      continue;
+
+    // Skip sources removed by an earlier handler in this cycle
+    XmlRpcSource* src = sources[i];
+    if ( ! _sourceIndex.count(src))
+      continue;
+
+    // Only handle requested events to avoid being prematurely removed from dispatch
+    bool readable = (pfd.events & POLLIN_REQ) == POLLIN_REQ;
+    bool writable = (pfd.events & POLLOUT_REQ) == POLLOUT_REQ;
+    bool oob = (pfd.events & POLLEX_REQ) == POLLEX_REQ;
+    handleSourceEvents(src,
+                       readable && (pfd.revents & POLLIN_CHK),
+                       writable && (pfd.revents & POLLOUT_CHK),
+                       oob && (pfd.revents & POLLEX_CHK));
+  }
+  return true;
+}
 
-      if ( ! newMask) {
-        _sources.erase(thisIt);  // Stop monitoring this one
-        if ( ! src->getKeepOpen())
-          src->close();
-      } else if (newMask != (unsigned) -1) {
-        thisIt->getMask() = newMask;
-      }
-    }
 
-    // Check whether to clear all sources
-    if (_doClear)
-    {
-      SourceList closeList = _sources;
-      _sources.clear();
-      for (SourceList::iterator it=closeList.begin(); it!=closeList.end(); ++it) {
-	XmlRpcSource *src = it->getSource();
-        src->close();
-      }
+bool
+XmlRpcDispatch::workEpoll(int timeout_ms)
+{
+#ifdef XMLRPCPP_HAVE_EPOLL
+  std::vector<epoll_event>& events = _buffers->events;
+  if (events.size() < _sources.size())
+    events.resize(_sources.size());
 
-      _doClear = false;
+  int nEvents = epoll_wait(_epollFd, &events[0], int(events.size()), (timeout_ms < 0) ? -1 : timeout_ms);
+  if (nEvents < 0)
+  {
+    if (errno != EINTR)
+    {
+      XmlRpcUtil::error("Error in XmlRpcDispatch::work: error in epoll_wait (%d).", errno);
+      return false;
     }
+    nEvents = 0;
+  }
 
-    // Check whether end time has passed
-    if (0 <= _endTime && getTime() > _endTime)
-      break;
+  for (int i=0; i < nEvents; ++i)
+  {
+    // Skip sources removed by an earlier handler in this cycle
+    EpollIndex::iterator found = _epollIndex.find(events[i].data.u64);
+    if (found == _epollIndex.end())
+      continue;
+
+    XmlRpcSource* src = found->second->getSource();
+    unsigned mask = found->second->getMask();
+    uint32_t revents = events[i].events;
+    handleSourceEvents(src,
+                       (mask & ReadableEvent) && (revents & (EPOLLIN | EPOLLHUP | EPOLLERR)),
+                       (mask & WritableEvent) && (revents & (EPOLLOUT | EPOLLERR)),
+                       (mask & Exception) && (revents & EPOLLPRI));
   }
+  return true;
+#else
+  return workPoll(timeout_ms);
+#endif
+}
 
-  _inWork = false;
+
+void
+XmlRpcDispatch::handleSourceEvents(XmlRpcSource* src, bool readable, bool writable, bool oob)
+{
+  if ( ! readable && ! writable && ! oob)
+    return;
+
+  unsigned newMask = (unsigned) -1;
+  if (readable)
+    newMask &= src->handleEvent(ReadableEvent);
+  if (writable)
+    newMask &= src->handleEvent(WritableEvent);
+  if (oob)
+    newMask &= src->handleEvent(Exception);
+
+  // Find the source iterator. It may have been removed or re-added as a result
+  // of the handleEvent() calls above.
+  SourceIndex::iterator found = _sourceIndex.find(src);
+  if (found == _sourceIndex.end())
+  {
+    XmlRpcUtil::error("Error in XmlRpcDispatch::work: couldn't find source iterator");
+    return;
+  }
+  SourceList::iterator thisIt = found->second;
+
+  if ( ! newMask) {
+    eraseSource(thisIt);  // Stop monitoring this one
+    if ( ! src->getKeepOpen())
+      src->close();
+    return;
+  }
+
+  bool maskChanged = (newMask != (unsigned) -1) && (newMask != thisIt->getMask());
+  if (maskChanged) {
+    thisIt->getMask() = newMask;
+    _sourcesChanged = true;
+  }
+  // The handler may also have reconnected on a new fd
+  if (_epollFd >= 0 && (maskChanged || thisIt->_fd != src->getfd()))
+    epollRegister(thisIt);
 }
 
 
@@ -268,12 +496,21 @@ XmlRpcDispatch::clear()
   if (_inWork)
     _doClear = true;  // Finish reporting current events before clearing
   else
-  {
-    SourceList closeList = _sources;
-    _sources.clear();
-    for (SourceList::iterator it=closeList.begin(); it!=closeList.end(); ++it)
-      it->getSource()->close();
-  }
+    closeAll();
+}
+
+void
+XmlRpcDispatch::closeAll()
+{
+  SourceList closeList;
+  closeList.swap(_sources);
+  for (SourceList::iterator it=closeList.begin(); it!=closeList.end(); ++it)
+    epollUnregister(*it);
+  _sourceIndex.clear();
+  _sourcesChanged = true;
+
+  for (SourceList::iterator it=closeList.begin(); it!=closeList.end(); ++it)
+    it->getSource()->close();
 }
 
 
@@ -10,6 +10,7 @@
 #include "xmlrpcpp/XmlRpcException.h"
 
 #include <errno.h>
+#include <stdlib.h>
 #include <string.h>
 #if !defined(_WINDOWS)
 # include <sys/resource.h>
@@ -50,6 +51,14 @@ XmlRpcServer::XmlRpcServer()
   }
 #endif
 
+#if !defined(_WINDOWS)
+  // Register connections with epoll once rather than passing every connection
+  // to poll() on each call to work(). Setting XMLRPCPP_USE_POLL keeps the poll loop.
+  const char* use_poll = getenv("XMLRPCPP_USE_POLL");
+  if (use_poll == nullptr || strcmp(use_poll, "0") == 0)
+    _disp.setUseEpoll(true);
+#endif
+
   // Ask dispatch not to close this socket if it becomes unreadable.
   setKeepOpen(true);
 }
@@ -41,6 +41,7 @@ XmlRpcServerConnection::XmlRpcServerConnection(int fd, XmlRpcServer* server, boo
   _contentLength = 0;
   _bytesWritten = 0;
   _keepAlive = true;
+  _headerScanned = 0;
 }
 
 
@@ -84,25 +85,12 @@ XmlRpcServerConnection::readHeader()
   }
 
   XmlRpcUtil::log(4, "XmlRpcServerConnection::readHeader: read %d bytes.", _header.length());
-  char *hp = (char*)_header.c_str();  // Start of header
-  char *ep = hp + _header.length();   // End of string
-  char *bp = 0;                       // Start of body
-  char *lp = 0;                       // Start of content-length value
-  char *kp = 0;                       // Start of connection value
-
-  for (char *cp = hp; (bp == 0) && (cp < ep); ++cp) {
-	if ((ep - cp > 16) && (strncasecmp(cp, "Content-length: ", 16) == 0))
-	  lp = cp + 16;
-	else if ((ep - cp > 12) && (strncasecmp(cp, "Connection: ", 12) == 0))
-	  kp = cp + 12;
-	else if ((ep - cp > 4) && (strncmp(cp, "\r\n\r\n", 4) == 0))
-	  bp = cp + 4;
-	else if ((ep - cp > 2) && (strncmp(cp, "\n\n", 2) == 0))
-	  bp = cp + 2;
-  }
+
+  // Only the data that arrived since the last read is searched for the end of the header
+  size_t bodyOffset = XmlRpcUtil::findHeaderEnd(_header, &_headerScanned);
 
   // If we haven't gotten the entire header yet, return (keep reading)
-  if (bp == 0) {
+  if (bodyOffset == std::string::npos) {
     // EOF in the middle of a request is an error, otherwise its ok
     if (eof) {
       XmlRpcUtil::log(4, "XmlRpcServerConnection::readHeader: EOF");
@@ -114,6 +102,11 @@ XmlRpcServerConnection::readHeader()
     return true;  // Keep reading
   }
 
+  const char *hp = _header.c_str();   // Start of header
+  const char *bp = hp + bodyOffset;   // Start of body
+  const char *lp = XmlRpcUtil::findHeaderField(hp, bp, "Content-length");
+  const char *kp = XmlRpcUtil::findHeaderField(hp, bp, "Connection");
+
   // Decode content length
   if (lp == 0) {
     XmlRpcUtil::error("XmlRpcServerConnection::readHeader: No Content-length specified");
@@ -131,12 +124,12 @@ XmlRpcServerConnection::readHeader()
   	
   XmlRpcUtil::log(3, "XmlRpcServerConnection::readHeader: specified content length is %d.", _contentLength);
 
-  // Otherwise copy non-header data to request buffer and set state to read request.
-  _request = bp;
-
-  // Parse out any interesting bits from the header (HTTP version, connection)
+  // Parse out any interesting bits from the header (HTTP version from the request line, connection)
+  const char *ep = static_cast<const char*>(memchr(hp, '\n', bp - hp));
+  if (ep == 0) ep = bp;
+  if (ep > hp && ep[-1] == '\r') --ep;
   _keepAlive = true;
-  if (_header.find("HTTP/1.0") != std::string::npos) {
+  if ((ep - hp >= 8) && strncmp(ep - 8, "HTTP/1.0", 8) == 0) {
     if (kp == 0 || strncasecmp(kp, "keep-alive", 10) != 0)
       _keepAlive = false;           // Default for HTTP 1.0 is to close the connection
   } else {
@@ -145,8 +138,12 @@ XmlRpcServerConnection::readHeader()
   }
   XmlRpcUtil::log(3, "KeepAlive: %d", _keepAlive);
 
-
-  _header = ""; 
+  // Hand any body data already read over to the request buffer without allocating
+  // a new string; the header buffer is recycled for the next request.
+  _header.erase(0, bodyOffset);
+  _request.swap(_header);
+  _header.clear();
+  _headerScanned = 0;
   _connectionState = READ_REQUEST;
   return true;    // Continue monitoring this source
 }
@@ -209,10 +206,12 @@ XmlRpcServerConnection::writeResponse()
   XmlRpcUtil::log(3, "XmlRpcServerConnection::writeResponse: wrote %d of %d bytes.", _bytesWritten, _response.length());
 
   // Prepare to read the next request
+  // Buffers are cleared rather than reassigned so a kept-alive connection reuses them
   if (_bytesWritten == int(_response.length())) {
-    _header = "";
-    _request = "";
-    _response = "";
+    _header.clear();
+    _headerScanned = 0;
+    _request.clear();
+    _response.clear();
     _connectionState = READ_HEADER;
   }
 
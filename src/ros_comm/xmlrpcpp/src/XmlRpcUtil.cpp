@@ -248,6 +248,55 @@ XmlRpcUtil::getNextTag(std::string const& xml, int* offset)
 }
 
 
+// Returns the offset of the body following the blank line that ends an HTTP header.
+// Only newlines are examined, so each read costs time proportional to the new data.
+size_t
+XmlRpcUtil::findHeaderEnd(std::string const& header, size_t* offset)
+{
+  const char* hp = header.data();
+  const size_t n = header.length();
+
+  // Back up far enough to catch a terminator split across two reads
+  size_t i = (*offset > 3) ? *offset - 3 : 0;
+  while (i < n) {
+    const char* nl = static_cast<const char*>(memchr(hp + i, '\n', n - i));
+    if (nl == 0)
+      break;
+    i = nl - hp;
+    if (i + 1 < n && hp[i+1] == '\n')
+      return i + 2;
+    if (i + 2 < n && hp[i+1] == '\r' && hp[i+2] == '\n')
+      return i + 3;
+    ++i;
+  }
+
+  *offset = n;
+  return std::string::npos;
+}
+
+
+// Returns a pointer to the value of the named header field, or 0 if absent.
+const char*
+XmlRpcUtil::findHeaderField(const char* begin, const char* end, const char* name)
+{
+  const size_t len = strlen(name);
+  for (const char* cp = begin; cp < end; ) {
+    const char* eol = static_cast<const char*>(memchr(cp, '\n', end - cp));
+    const char* le = eol ? eol : end;
+    if (size_t(le - cp) > len && cp[len] == ':' && strncasecmp(cp, name, len) == 0) {
+      const char* vp = cp + len + 1;
+      while (vp < le && (*vp == ' ' || *vp == '\t'))
+        ++vp;
+      return vp;
+    }
+    if (eol == 0)
+      break;
+    cp = eol + 1;
+  }
+  return 0;
+}
+
+
 
 // xml encodings (xml-encoded entities are preceded with '&')
 static const char  AMP = '&';
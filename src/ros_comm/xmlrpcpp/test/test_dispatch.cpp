@@ -354,6 +354,121 @@ TEST_F(MockSourceTest, LargeFd) {
   EXPECT_EQ(dispatch._sources.size(), 1u);
 }
 
+// Test that adding a source twice only updates its event mask
+TEST_F(MockSourceTest, AddTwice) {
+  m.event_result = XmlRpcDispatch::ReadableEvent;
+  dispatch.addSource(&m, XmlRpcDispatch::WritableEvent);
+  dispatch.addSource(&m, XmlRpcDispatch::ReadableEvent);
+  EXPECT_EQ(dispatch._sources.size(), 1u);
+
+  fds[0].events = POLLIN;
+  fds[0].revents = POLLIN;
+  Expect_poll(fds, 100, 0, 0);
+  dispatch.work(0.1);
+  EXPECT_CLOSE_CALLS(0);
+  EXPECT_EVENT(XmlRpcDispatch::ReadableEvent);
+}
+
+// Test that the mask returned by handleEvent is used for the next poll
+TEST_F(MockSourceTest, MaskChange) {
+  m.event_result = XmlRpcDispatch::ReadableEvent;
+  dispatch.addSource(&m, XmlRpcDispatch::WritableEvent);
+
+  fds[0].events = POLLOUT;
+  fds[0].revents = POLLOUT;
+  Expect_poll(fds, 100, 0, 0);
+  dispatch.work(0.1);
+  EXPECT_EVENT(XmlRpcDispatch::WritableEvent);
+  EXPECT_EQ(dispatch._sources.size(), 1u);
+
+  fds[0].events = POLLIN;
+  fds[0].revents = POLLIN;
+  Expect_poll(fds, 100, 0, 0);
+  dispatch.work(0.1);
+  EXPECT_EVENT(XmlRpcDispatch::ReadableEvent);
+  EXPECT_CLOSE_CALLS(0);
+}
+
+#if defined(__linux__)
+// Test the epoll backend with a real pipe; poll() must not be used.
+TEST_F(MockSourceTest, Epoll) {
+  int p[2];
+  ASSERT_EQ(0, pipe(p));
+  m.setfd(p[0]);
+  m.setKeepOpen();
+  m.event_result = 0;
+
+  ASSERT_TRUE(dispatch.setUseEpoll(true));
+  EXPECT_TRUE(dispatch.getUseEpoll());
+  dispatch.addSource(&m, XmlRpcDispatch::ReadableEvent);
+  EXPECT_EQ(dispatch._sources.size(), 1u);
+
+  // Nothing to read; expect no events.
+  dispatch.work(0.05);
+  EXPECT_EVENTS(0);
+
+  // Make the pipe readable, expect one readable event after which the
+  // source is removed because handleEvent returned 0.
+  ASSERT_EQ(1, write(p[1], "x", 1));
+  dispatch.work(0.05);
+  EXPECT_EVENT(XmlRpcDispatch::ReadableEvent);
+  EXPECT_CLOSE_CALLS(0);
+  EXPECT_EQ(dispatch._sources.size(), 0u);
+
+  // Re-adding the source registers it again.
+  m.event_result = XmlRpcDispatch::ReadableEvent;
+  dispatch.addSource(&m, XmlRpcDispatch::ReadableEvent);
+  dispatch.work(0.0);
+  EXPECT_GE(m.handleEvent_calls, 1);
+  m.handleEvent_calls = 0;
+
+  // Switching back to poll keeps the source.
+  EXPECT_TRUE(dispatch.setUseEpoll(false));
+  EXPECT_FALSE(dispatch.getUseEpoll());
+  EXPECT_EQ(dispatch._sources.size(), 1u);
+  dispatch.removeSource(&m);
+
+  close(p[0]);
+  close(p[1]);
+}
+
+// Removing a source deletes its registration before the fd is closed, so a
+// duplicate of the fd which lives on does not keep reporting its events.
+TEST_F(MockSourceTest, EpollDupFd) {
+  int p[2], q[2];
+  ASSERT_EQ(0, pipe(p));
+  ASSERT_EQ(0, pipe(q));
+  int p_dup = dup(p[0]);
+  ASSERT_GE(p_dup, 0);
+  m.setfd(p[0]);
+  m.setKeepOpen();
+  m.event_result = XmlRpcDispatch::ReadableEvent;
+
+  ASSERT_TRUE(dispatch.setUseEpoll(true));
+  dispatch.addSource(&m, XmlRpcDispatch::ReadableEvent);
+  dispatch.removeSource(&m);
+  close(p[0]);
+
+  // Reconnect on another fd; only its events are reported
+  m.setfd(q[0]);
+  dispatch.addSource(&m, XmlRpcDispatch::ReadableEvent);
+  ASSERT_EQ(1, write(p[1], "x", 1));
+  dispatch.work(0.05);
+  EXPECT_EVENTS(0);
+
+  ASSERT_EQ(1, write(q[1], "x", 1));
+  dispatch.work(0.0);
+  EXPECT_GE(m.handleEvent_calls, 1);
+  m.handleEvent_calls = 0;
+
+  dispatch.removeSource(&m);
+  close(p_dup);
+  close(p[1]);
+  close(q[0]);
+  close(q[1]);
+}
+#endif
+
 int main(int argc, char **argv)
 {
   ::testing::InitGoogleTest(&argc, argv);
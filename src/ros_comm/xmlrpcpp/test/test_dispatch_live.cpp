@@ -36,6 +36,8 @@
 
 #include <iostream>
 #include <functional>
+#include <vector>
+#include <stdlib.h>
 
 #include <gtest/gtest.h>
 
@@ -188,6 +190,84 @@ TEST_F(XmlRpcTest, ServerDisconnect2)
   EXPECT_EQ(result, hello);
 }
 
+TEST_F(XmlRpcTest, KeepAlive)
+{
+  XmlRpcClient c("localhost", port);
+  XmlRpcValue noArgs, result;
+  XmlRpcValue hello("Hello");
+
+  // The server answers with HTTP/1.1, so the connection is reused for
+  // subsequent calls instead of reconnecting.
+  ASSERT_TRUE(c.execute("Hello", noArgs, result));
+  EXPECT_EQ(result, hello);
+  int fd = c.getfd();
+  ASSERT_NE(-1, fd);
+
+  for (int i = 0; i < 10; i++)
+  {
+    ASSERT_TRUE(c.execute("Hello", noArgs, result));
+    EXPECT_EQ(result, hello);
+    EXPECT_EQ(fd, c.getfd());
+  }
+
+  // Same for non-blocking calls.
+  for (int i = 0; i < 10; i++)
+  {
+    ASSERT_TRUE(c.executeNonBlock("Hello", noArgs));
+    bool done = false;
+    for (int j = 0; j < 30 && !done; j++)
+    {
+      c._disp.work(0.1);
+      done = c.executeCheckDone(result);
+    }
+    ASSERT_TRUE(done);
+    EXPECT_EQ(result, hello);
+    EXPECT_EQ(fd, c.getfd());
+  }
+}
+
+TEST_F(XmlRpcTest, ManyConnections)
+{
+#if defined(__linux__)
+  if (getenv("XMLRPCPP_USE_POLL") == NULL)
+  {
+    EXPECT_TRUE(s.get_dispatch()->getUseEpoll());
+  }
+#endif
+
+  // Leave a number of idle keep-alive connections registered with the server,
+  // then check that all of them are still serviced.
+  const int N = 50;
+  std::vector<XmlRpcClient*> clients;
+  XmlRpcValue noArgs, result;
+  XmlRpcValue hello("Hello");
+  for (int i = 0; i < N; i++)
+  {
+    clients.push_back(new XmlRpcClient("localhost", port));
+    ASSERT_TRUE(clients.back()->execute("Hello", noArgs, result));
+    EXPECT_EQ(result, hello);
+  }
+
+  for (int i = N - 1; i >= 0; i--)
+  {
+    ASSERT_TRUE(clients[i]->execute("Hello", noArgs, result));
+    EXPECT_EQ(result, hello);
+  }
+
+  // Closing half of the connections must not disturb the others.
+  for (int i = 0; i < N; i += 2)
+  {
+    delete clients[i];
+    clients[i] = 0;
+  }
+  for (int i = 1; i < N; i += 2)
+  {
+    ASSERT_TRUE(clients[i]->execute("Hello", noArgs, result));
+    EXPECT_EQ(result, hello);
+    delete clients[i];
+  }
+}
+
 int main(int argc, char **argv)
 {
   ::testing::InitGoogleTest(&argc, argv);
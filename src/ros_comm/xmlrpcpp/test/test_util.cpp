@@ -25,6 +25,9 @@
 
 #include <gtest/gtest.h>
 
+#include <stdlib.h>
+#include <string.h>
+
 using namespace XmlRpc;
 
 class FakeLogHandler : public XmlRpcLogHandler {
@@ -121,6 +124,57 @@ TEST(XmlRpc, error) {
   EXPECT_EQ("408: I'm a teapot", errors.last_msg);
 }
 
+TEST(XmlRpc, findHeaderEnd) {
+  const std::string header = "POST /RPC2 HTTP/1.1\r\n"
+                             "Content-length: 5\r\n\r\n";
+  size_t offset = 0;
+
+  // Header and start of the body in one buffer.
+  EXPECT_EQ(header.length(), XmlRpcUtil::findHeaderEnd(header + "hello", &offset));
+
+  // Header without any body bytes.
+  offset = 0;
+  EXPECT_EQ(header.length(), XmlRpcUtil::findHeaderEnd(header, &offset));
+
+  // Bare newlines terminate the header as well.
+  offset = 0;
+  EXPECT_EQ(17u, XmlRpcUtil::findHeaderEnd("HTTP/1.0 200 OK\n\nbody", &offset));
+
+  // Terminator split across reads: the offset is advanced past the data
+  // searched so far, and the search resumes early enough to find it.
+  std::string partial = header.substr(0, header.length() - 2);
+  offset = 0;
+  EXPECT_EQ(std::string::npos, XmlRpcUtil::findHeaderEnd(partial, &offset));
+  EXPECT_EQ(partial.length(), offset);
+  partial += "\r\nhel";
+  EXPECT_EQ(header.length(), XmlRpcUtil::findHeaderEnd(partial, &offset));
+
+  // Incomplete header.
+  offset = 0;
+  EXPECT_EQ(std::string::npos, XmlRpcUtil::findHeaderEnd("POST /RPC2 HTTP/1.1\r\n", &offset));
+}
+
+TEST(XmlRpc, findHeaderField) {
+  const std::string header = "HTTP/1.1 200 OK\r\n"
+                             "Server: XMLRPC++ 0.7\r\n"
+                             "content-LENGTH:  114\r\n"
+                             "Connection: close\r\n\r\n";
+  const char* begin = header.c_str();
+  const char* end = begin + header.length();
+
+  const char* value = XmlRpcUtil::findHeaderField(begin, end, "Content-length");
+  ASSERT_TRUE(value != 0);
+  EXPECT_EQ(114, strtol(value, 0, 10));
+
+  value = XmlRpcUtil::findHeaderField(begin, end, "Connection");
+  ASSERT_TRUE(value != 0);
+  EXPECT_EQ(0, strncmp(value, "close", 5));
+
+  // Field names only match at the start of a line.
+  EXPECT_TRUE(XmlRpcUtil::findHeaderField(begin, end, "XMLRPC++ 0.7") == 0);
+  EXPECT_TRUE(XmlRpcUtil::findHeaderField(begin, end, "Content-Type") == 0);
+}
+
 int main(int argc, char **argv)
 {
   ::testing::InitGoogleTest(&argc, argv);
@@ -0,0 +1,148 @@
+/*
+ * Benchmark for XmlRpc++
+ *
+ * Measures calls/sec between an XmlRpcClient and an XmlRpcServer in the same
+ * process, covering the call paths exercised by test_client.cpp (blocking
+ * execute, executeNonBlock/executeCheckDone, reconnecting per call) with the
+ * server dispatching via poll or epoll and a number of idle keep-alive
+ * connections registered alongside the active one.
+ *
+ * Usage: xmlrpc_benchmark [calls] [idle connections]
+ */
+
+#include "xmlrpcpp/XmlRpc.h"
+
+#include <boost/thread/thread.hpp>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+
+using namespace XmlRpc;
+
+class Hello : public XmlRpcServerMethod
+{
+public:
+  Hello(XmlRpcServer* s) : XmlRpcServerMethod("Hello", s) {}
+
+  void execute(XmlRpcValue& /*params*/, XmlRpcValue& result)
+  {
+    result = "Hello";
+  }
+};
+
+enum Mode { BLOCKING, NON_BLOCKING, RECONNECT };
+
+static const char* modeName(Mode mode)
+{
+  switch (mode)
+  {
+    case BLOCKING: return "execute";
+    case NON_BLOCKING: return "executeNonBlock";
+    case RECONNECT: return "execute+reconnect";
+  }
+  return "";
+}
+
+class Benchmark
+{
+public:
+  Benchmark(bool use_epoll) : hello_(&server_), done_(false)
+  {
+    server_.get_dispatch()->setUseEpoll(use_epoll);
+    server_.bindAndListen(0);
+    port_ = server_.get_port();
+    thread_ = boost::thread(&Benchmark::work, this);
+  }
+
+  ~Benchmark()
+  {
+    for (size_t i = 0; i < idle_.size(); ++i)
+      delete idle_[i];
+    done_ = true;
+    thread_.join();
+    server_.shutdown();
+  }
+
+  bool addIdleConnections(int count)
+  {
+    XmlRpcValue noArgs, result;
+    for (int i = 0; i < count; ++i)
+    {
+      idle_.push_back(new XmlRpcClient("127.0.0.1", port_));
+      if (!idle_.back()->execute("Hello", noArgs, result))
+        return false;
+    }
+    return true;
+  }
+
+  // Returns calls/sec, or a negative value if a call failed
+  double run(Mode mode, int calls)
+  {
+    XmlRpcClient c("127.0.0.1", port_);
+    XmlRpcValue noArgs, result;
+
+    double start = c._disp.getTime();
+    for (int i = 0; i < calls; ++i)
+    {
+      if (mode == RECONNECT)
+        c.close();
+
+      if (mode == NON_BLOCKING)
+      {
+        if (!c.executeNonBlock("Hello", noArgs))
+          return -1.0;
+        while (!c.executeCheckDone(result))
+          c._disp.work(0.1);
+        if (!result.valid())
+          return -1.0;
+      }
+      else if (!c.execute("Hello", noArgs, result))
+      {
+        return -1.0;
+      }
+    }
+    return calls / (c._disp.getTime() - start);
+  }
+
+private:
+  void work()
+  {
+    while (!done_)
+      server_.work(0.1);
+  }
+
+  XmlRpcServer server_;
+  Hello hello_;
+  int port_;
+  volatile bool done_;
+  boost::thread thread_;
+  std::vector<XmlRpcClient*> idle_;
+};
+
+int main(int argc, char** argv)
+{
+  int calls = (argc > 1) ? atoi(argv[1]) : 5000;
+  int max_idle = (argc > 2) ? atoi(argv[2]) : 200;
+
+  printf("%-10s %6s  %-18s %12s\n", "dispatch", "idle", "call", "calls/sec");
+  const Mode modes[] = { BLOCKING, NON_BLOCKING, RECONNECT };
+  for (int idle = 0; idle <= max_idle; idle = (idle == 0) ? max_idle : max_idle + 1)
+  {
+    for (int use_epoll = 0; use_epoll < 2; ++use_epoll)
+    {
+      Benchmark benchmark(use_epoll != 0);
+      if (!benchmark.addIdleConnections(idle))
+      {
+        fprintf(stderr, "could not open %d idle connections\n", idle);
+        return 1;
+      }
+      for (size_t m = 0; m < sizeof(modes) / sizeof(modes[0]); ++m)
+      {
+        printf("%-10s %6d  %-18s %12.0f\n", use_epoll ? "epoll" : "poll", idle,
+               modeName(modes[m]), benchmark.run(modes[m], calls));
+      }
+    }
+  }
+  return 0;
+}
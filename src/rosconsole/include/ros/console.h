@@ -80,6 +80,29 @@ namespace console
 
 ROSCONSOLE_DECL void shutdown();
 
+/**
+ * \brief Switches between writing messages out on the logging thread (the default) and handing them to a background thread.
+ *
+ * In asynchronous mode a print statement only formats its message and copies it, with its time stamps and location, into
+ * a lock-free ring of queue_size messages owned by the calling thread.  The backend and all appenders run on the background
+ * thread.  Messages logged while a ring is full are dropped and counted.  Fatal messages are still written synchronously,
+ * after everything already queued.  Also enabled by setting the ROSCONSOLE_ASYNC environment variable to 1, with the ring
+ * size taken from ROSCONSOLE_ASYNC_QUEUE_SIZE.  Intended to be set once at startup.
+ */
+ROSCONSOLE_DECL void setAsync(bool async, size_t queue_size = 1024);
+
+ROSCONSOLE_DECL bool isAsync();
+
+/**
+ * \brief Blocks until every message queued in asynchronous mode so far has been written out
+ */
+ROSCONSOLE_DECL void flush();
+
+/**
+ * \brief Total number of messages dropped because an asynchronous ring was full
+ */
+ROSCONSOLE_DECL uint64_t getDroppedMessageCount();
+
 #ifdef ROSCONSOLE_BACKEND_LOG4CXX
 extern ROSCONSOLE_DECL log4cxx::LevelPtr g_level_lookup[];
 #endif
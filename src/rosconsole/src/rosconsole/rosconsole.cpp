@@ -44,6 +44,7 @@
 #include <boost/make_shared.hpp>
 #include <boost/date_time/posix_time/posix_time.hpp>
 
+#include <atomic>
 #include <cstdarg>
 #include <cstdlib>
 #include <cstdio>
@@ -93,6 +94,30 @@ bool g_color = true;
 typedef std::map<std::string, std::string> M_string;
 M_string g_extra_fixed_tokens;
 
+/**
+ * \brief A message queued in asynchronous mode, with the metadata that must be captured on the calling thread
+ */
+struct AsyncRecord
+{
+  uint64_t sequence;
+  void* logger_handle;
+  Level level;
+  std::string message;
+  const char* file;
+  const char* function;
+  int line;
+  ros::WallTime wall_stamp;
+  ros::Time ros_stamp;
+  bool has_ros_stamp;
+  boost::thread::id thread_id;
+};
+
+void keepAsyncRecord(AsyncRecord*)
+{}
+
+// Record being written by the background thread, so tokens report when and where the message was logged
+boost::thread_specific_ptr<AsyncRecord> g_current_record(keepAsyncRecord);
+
 void setFixedFilterToken(const std::string& key, const std::string& val)
 {
   g_extra_fixed_tokens[key] = val;
@@ -181,79 +206,93 @@ struct MessageToken : public Token
   }
 };
 
+// The time facet is built once per token rather than once per message
+std::locale makeTimeLocale(const std::string& format)
+{
+  if (format.empty())
+  {
+    return std::locale::classic();
+  }
+
+  boost::posix_time::time_facet* facet = new boost::posix_time::time_facet();
+  facet->format(format.c_str());
+  return std::locale(std::locale::classic(), facet);
+}
+
 struct TimeToken : public Token
 {
-  explicit TimeToken(const std::string &format) : format_(format) {};
+  explicit TimeToken(const std::string &format) : format_(format), locale_(makeTimeLocale(format)) {};
 
   virtual std::string getString(void*, ::ros::console::Level, const char*, const char*, const char*, int)
   {
-    const size_t decimals = 5;
-    std::stringstream ss;
+    const AsyncRecord* record = g_current_record.get();
+    ros::WallTime wall_stamp = record ? record->wall_stamp : ros::WallTime::now();
 
     if (format_.empty())
     {
-      ss << std::fixed << std::setprecision(decimals) << ros::WallTime::now().toSec();
-    }
-    else
-    {
-      boost::posix_time::time_facet *facet = new boost::posix_time::time_facet();
-      facet->format(format_.c_str());
-      ss.imbue(std::locale(std::locale::classic(), facet));
-      ss << ros::WallTime::now().toBoost();
-    }
+      char buffer[64];
+      int length = snprintf(buffer, sizeof(buffer), "%.5f", wall_stamp.toSec());
+      std::string str(buffer, length);
 
-    if (ros::Time::isValid() && ros::Time::isSimTime())
-    {
-      ss << ", ";
-
-      if (format_.empty())
-      {
-        ss << ", " << std::fixed << std::setprecision(decimals) << ros::Time::now().toSec();
-      }
-      else
+      bool sim_time = record ? record->has_ros_stamp : ros::Time::isValid() && ros::Time::isSimTime();
+      if (sim_time)
       {
-        ss << ros::Time::now().toBoost();
+        length = snprintf(buffer, sizeof(buffer), ", , %.5f", (record ? record->ros_stamp : ros::Time::now()).toSec());
+        str.append(buffer, length);
       }
+      return str;
+    }
+
+    std::stringstream ss;
+    ss.imbue(locale_);
+    ss << wall_stamp.toBoost();
+
+    if (record ? record->has_ros_stamp : ros::Time::isValid() && ros::Time::isSimTime())
+    {
+      ss << ", " << (record ? record->ros_stamp : ros::Time::now()).toBoost();
     }
     return ss.str();
   }
 
   const std::string format_;
+  const std::locale locale_;
 };
 
 struct WallTimeToken : public Token
 {
-  explicit WallTimeToken(const std::string &format) : format_(format) {};
+  explicit WallTimeToken(const std::string &format) : format_(format), locale_(makeTimeLocale(format)) {};
 
   virtual std::string getString(void*, ::ros::console::Level, const char*, const char*, const char*, int)
   {
+    const AsyncRecord* record = g_current_record.get();
+    ros::WallTime wall_stamp = record ? record->wall_stamp : ros::WallTime::now();
     std::stringstream ss;
 
     if (format_.empty())
     {
       const size_t decimals = 3;
-      ss << std::fixed << std::setprecision(decimals) << ros::WallTime::now();
+      ss << std::fixed << std::setprecision(decimals) << wall_stamp;
     }
     else
     {
-      boost::posix_time::time_facet* facet = new boost::posix_time::time_facet();
-      facet->format(format_.c_str());
-      ss.imbue(std::locale(std::locale::classic(), facet));
-      ss << ros::WallTime::now().toBoost();
+      ss.imbue(locale_);
+      ss << wall_stamp.toBoost();
     }
 
     return ss.str();
   }
 
   const std::string format_;
+  const std::locale locale_;
 };
 
 struct ThreadToken : public Token
 {
   virtual std::string getString(void*, ::ros::console::Level, const char*, const char*, const char*, int)
   {
+    const AsyncRecord* record = g_current_record.get();
     std::stringstream ss;
-    ss << boost::this_thread::get_id();
+    ss << (record ? record->thread_id : boost::this_thread::get_id());
     return ss.str();
   }
 };
@@ -530,6 +569,28 @@ void initialize()
       g_color = false;
     }
 
+    std::string async;
+    if (get_environment_variable(async, "ROSCONSOLE_ASYNC"))
+    {
+      if (async == "1")
+      {
+        std::string queue_size;
+        if (get_environment_variable(queue_size, "ROSCONSOLE_ASYNC_QUEUE_SIZE"))
+        {
+          setAsync(true, strtoul(queue_size.c_str(), NULL, 10));
+        }
+        else
+        {
+          setAsync(true);
+        }
+      }
+      else if (async != "0")
+      {
+        fprintf(stderr, "Warning: unexpected value %s specified for ROSCONSOLE_ASYNC. Default value 0 "
+          "will be used. Valid values are 1 or 0.\n", async.c_str());
+      }
+    }
+
     ::ros::console::impl::initialize();
     g_initialized = true;
   }
@@ -579,6 +640,378 @@ static boost::mutex g_print_mutex;
 static boost::shared_array<char> g_print_buffer(new char[INITIAL_BUFFER_SIZE]);
 static size_t g_print_buffer_size = INITIAL_BUFFER_SIZE;
 static boost::thread::id g_printing_thread_id;
+
+/**
+ * \brief Single producer, single consumer ring of queued messages owned by one logging thread
+ *
+ * Only the owning thread pushes and only the thread holding g_async_drain_mutex pops, so neither side takes a lock.
+ */
+class AsyncRing
+{
+public:
+  explicit AsyncRing(size_t capacity)
+  : records_(capacity + 1)
+  , buffer_(new char[INITIAL_BUFFER_SIZE])
+  , buffer_size_(INITIAL_BUFFER_SIZE)
+  , head_(0)
+  , tail_(0)
+  , dropped_(0)
+  , closed_(false)
+  {}
+
+  /**
+   * \brief Claims the next free record, or returns NULL (counting the message as dropped) if the ring is full
+   */
+  AsyncRecord* reserve()
+  {
+    size_t head = head_.load(std::memory_order_relaxed);
+    if (next(head) == tail_.load(std::memory_order_acquire))
+    {
+      dropped_.fetch_add(1, std::memory_order_relaxed);
+      return NULL;
+    }
+    return &records_[head];
+  }
+
+  /**
+   * \brief Publishes the record returned by reserve(). Returns true once the ring is more than half full.
+   */
+  bool commit()
+  {
+    size_t head = next(head_.load(std::memory_order_relaxed));
+    head_.store(head, std::memory_order_release);
+    size_t tail = tail_.load(std::memory_order_relaxed);
+    return (head + records_.size() - tail) % records_.size() > records_.size() / 2;
+  }
+
+  AsyncRecord* front()
+  {
+    size_t tail = tail_.load(std::memory_order_relaxed);
+    if (tail == head_.load(std::memory_order_acquire))
+    {
+      return NULL;
+    }
+    return &records_[tail];
+  }
+
+  void pop()
+  {
+    tail_.store(next(tail_.load(std::memory_order_relaxed)), std::memory_order_release);
+  }
+
+  uint64_t takeDropped()
+  {
+    return dropped_.exchange(0, std::memory_order_relaxed);
+  }
+
+  void close()
+  {
+    closed_.store(true, std::memory_order_release);
+  }
+
+  bool isClosed() const
+  {
+    return closed_.load(std::memory_order_acquire);
+  }
+
+  // Formatting scratch space of the owning thread
+  boost::shared_array<char>& buffer() { return buffer_; }
+  size_t& bufferSize() { return buffer_size_; }
+
+private:
+  size_t next(size_t index) const
+  {
+    return index + 1 == records_.size() ? 0 : index + 1;
+  }
+
+  std::vector<AsyncRecord> records_;
+  boost::shared_array<char> buffer_;
+  size_t buffer_size_;
+  std::atomic<size_t> head_;
+  std::atomic<size_t> tail_;
+  std::atomic<uint64_t> dropped_;
+  std::atomic<bool> closed_;
+};
+
+// The ring outlives its thread until the background thread has written everything in it
+void closeAsyncRing(AsyncRing* ring)
+{
+  ring->close();
+}
+
+static std::atomic<bool> g_async(false);
+static size_t g_async_queue_size = 1024;
+static std::atomic<uint64_t> g_async_sequence(0);
+static std::atomic<uint64_t> g_async_dropped(0);
+static boost::thread_specific_ptr<AsyncRing> g_async_ring(closeAsyncRing);
+static std::vector<AsyncRing*> g_async_rings;
+static boost::mutex g_async_rings_mutex;
+static boost::mutex g_async_drain_mutex;
+static boost::mutex g_async_thread_mutex;
+static boost::condition_variable g_async_cond;
+static boost::thread g_async_thread;
+static std::atomic<bool> g_async_running(false);
+static boost::mutex g_last_error_mutex;
+
+void printAsyncRecord(AsyncRecord& record)
+{
+  boost::mutex::scoped_lock lock(g_print_mutex);
+
+  g_printing_thread_id = boost::this_thread::get_id();
+  g_current_record.reset(&record);
+  try
+  {
+    ::ros::console::impl::print(record.logger_handle, record.level, record.message.c_str(), record.file, record.function, record.line);
+  }
+  catch (std::exception& e)
+  {
+    fprintf(stderr, "Caught exception while logging: [%s]\n", e.what());
+  }
+  g_current_record.reset();
+  g_printing_thread_id = boost::thread::id();
+}
+
+/**
+ * \brief Writes out everything queued so far, merging the per-thread rings back into logging order
+ */
+void drainAsync()
+{
+  boost::mutex::scoped_lock drain_lock(g_async_drain_mutex);
+
+  std::vector<AsyncRing*> rings;
+  {
+    boost::mutex::scoped_lock lock(g_async_rings_mutex);
+    rings = g_async_rings;
+  }
+
+  while (true)
+  {
+    AsyncRing* oldest = NULL;
+    AsyncRecord* oldest_record = NULL;
+    for (size_t i = 0; i < rings.size(); ++i)
+    {
+      AsyncRecord* record = rings[i]->front();
+      if (record && (!oldest_record || record->sequence < oldest_record->sequence))
+      {
+        oldest = rings[i];
+        oldest_record = record;
+      }
+    }
+
+    if (!oldest)
+    {
+      break;
+    }
+
+    printAsyncRecord(*oldest_record);
+    oldest->pop();
+  }
+
+  uint64_t dropped = 0;
+  for (size_t i = 0; i < rings.size(); ++i)
+  {
+    dropped += rings[i]->takeDropped();
+  }
+  if (dropped)
+  {
+    g_async_dropped.fetch_add(dropped, std::memory_order_relaxed);
+
+    AsyncRecord record;
+    record.sequence = 0;
+    record.logger_handle = ::ros::console::impl::getHandle(ROSCONSOLE_ROOT_LOGGER_NAME);
+    record.level = levels::Warn;
+    record.message = formatToString("Dropped %llu log messages because an asynchronous logging queue was full",
+                                    (unsigned long long)dropped);
+    record.file = __FILE__;
+    record.function = __ROSCONSOLE_FUNCTION__;
+    record.line = __LINE__;
+    record.wall_stamp = ros::WallTime::now();
+    record.has_ros_stamp = ros::Time::isValid() && ros::Time::isSimTime();
+    if (record.has_ros_stamp)
+    {
+      record.ros_stamp = ros::Time::now();
+    }
+    record.thread_id = boost::this_thread::get_id();
+    printAsyncRecord(record);
+  }
+
+  // Rings of threads that have exited are released once empty
+  boost::mutex::scoped_lock lock(g_async_rings_mutex);
+  for (std::vector<AsyncRing*>::iterator it = g_async_rings.begin(); it != g_async_rings.end();)
+  {
+    if ((*it)->isClosed() && !(*it)->front())
+    {
+      delete *it;
+      it = g_async_rings.erase(it);
+    }
+    else
+    {
+      ++it;
+    }
+  }
+}
+
+void asyncThreadFunc()
+{
+  boost::mutex::scoped_lock lock(g_async_thread_mutex);
+  while (g_async_running)
+  {
+    lock.unlock();
+    drainAsync();
+    lock.lock();
+
+    if (g_async_running)
+    {
+      g_async_cond.timed_wait(lock, boost::posix_time::milliseconds(10));
+    }
+  }
+}
+
+void startAsyncThread()
+{
+  boost::mutex::scoped_lock lock(g_async_thread_mutex);
+  if (!g_async_running)
+  {
+    g_async_running = true;
+    g_async_thread = boost::thread(asyncThreadFunc);
+  }
+}
+
+void stopAsyncThread()
+{
+  {
+    boost::mutex::scoped_lock lock(g_async_thread_mutex);
+    if (!g_async_running)
+    {
+      return;
+    }
+    g_async_running = false;
+    g_async_cond.notify_all();
+  }
+  g_async_thread.join();
+}
+
+AsyncRing* getAsyncRing()
+{
+  AsyncRing* ring = g_async_ring.get();
+  if (!ring)
+  {
+    {
+      boost::mutex::scoped_lock lock(g_async_rings_mutex);
+      ring = new AsyncRing(g_async_queue_size);
+      g_async_rings.push_back(ring);
+    }
+    g_async_ring.reset(ring);
+  }
+  // Also restarts the background thread after setAsync(false) stopped it, for threads that already own a ring
+  if (!g_async_running)
+  {
+    startAsyncThread();
+  }
+  return ring;
+}
+
+/**
+ * \brief Runs the filter on a formatted message and hands it to the background thread. This is the whole cost of a
+ * print statement on the calling thread in asynchronous mode.
+ */
+void enqueue(AsyncRing* ring, FilterBase* filter, void* logger_handle, Level level, const char* message,
+             const char* file, int line, const char* function)
+{
+  bool enabled = true;
+  std::string out_message;
+
+  if (filter)
+  {
+    FilterParams params;
+    params.file = file;
+    params.function = function;
+    params.line = line;
+    params.level = level;
+    params.logger = logger_handle;
+    params.message = message;
+    enabled = filter->isEnabled(params);
+    level = params.level;
+
+    if (!params.out_message.empty())
+    {
+      out_message.swap(params.out_message);
+      message = out_message.c_str();
+    }
+  }
+
+  if (!enabled)
+  {
+    return;
+  }
+
+  if (level == levels::Error)
+  {
+    boost::mutex::scoped_lock lock(g_last_error_mutex);
+    g_last_error_message = message;
+  }
+
+  AsyncRecord* record = ring->reserve();
+  if (!record)
+  {
+    return;
+  }
+
+  record->sequence = g_async_sequence.fetch_add(1, std::memory_order_relaxed);
+  record->logger_handle = logger_handle;
+  record->level = level;
+  // Reuses the capacity left in the slot by earlier messages
+  record->message.assign(message);
+  record->file = file;
+  record->function = function;
+  record->line = line;
+  record->wall_stamp = ros::WallTime::now();
+  record->has_ros_stamp = ros::Time::isValid() && ros::Time::isSimTime();
+  if (record->has_ros_stamp)
+  {
+    record->ros_stamp = ros::Time::now();
+  }
+  record->thread_id = boost::this_thread::get_id();
+
+  if (ring->commit())
+  {
+    g_async_cond.notify_one();
+  }
+}
+
+void setAsync(bool async, size_t queue_size)
+{
+  if (async)
+  {
+    {
+      boost::mutex::scoped_lock lock(g_async_rings_mutex);
+      g_async_queue_size = std::max(queue_size, (size_t)1);
+    }
+    g_async = true;
+  }
+  else if (g_async)
+  {
+    g_async = false;
+    stopAsyncThread();
+    drainAsync();
+  }
+}
+
+bool isAsync()
+{
+  return g_async;
+}
+
+void flush()
+{
+  drainAsync();
+}
+
+uint64_t getDroppedMessageCount()
+{
+  return g_async_dropped.load(std::memory_order_relaxed);
+}
+
 void print(FilterBase* filter, void* logger_handle, Level level, 
 	   const char* file, int line, const char* function, const char* fmt, ...)
 {
@@ -591,6 +1024,27 @@ void print(FilterBase* filter, void* logger_handle, Level level,
     return;
   }
 
+  if (g_async)
+  {
+    // Fatal messages usually precede an abort, so they are written out synchronously behind everything queued
+    if (level != levels::Fatal)
+    {
+      AsyncRing* ring = getAsyncRing();
+
+      va_list args;
+      va_start(args, fmt);
+
+      vformatToBuffer(ring->buffer(), ring->bufferSize(), fmt, args);
+
+      va_end(args);
+
+      enqueue(ring, filter, logger_handle, level, ring->buffer().get(), file, line, function);
+      return;
+    }
+
+    drainAsync();
+  }
+
   boost::mutex::scoped_lock lock(g_print_mutex);
 
   g_printing_thread_id = boost::this_thread::get_id();
@@ -633,6 +1087,7 @@ void print(FilterBase* filter, void* logger_handle, Level level,
   {
     if (level == levels::Error)
     {
+      boost::mutex::scoped_lock error_lock(g_last_error_mutex);
       g_last_error_message = g_print_buffer.get();
     }
     try
@@ -660,6 +1115,17 @@ void print(FilterBase* filter, void* logger_handle, Level level,
     return;
   }
 
+  if (g_async)
+  {
+    if (level != levels::Fatal)
+    {
+      enqueue(getAsyncRing(), filter, logger_handle, level, ss.str().c_str(), file, line, function);
+      return;
+    }
+
+    drainAsync();
+  }
+
   boost::mutex::scoped_lock lock(g_print_mutex);
 
   g_printing_thread_id = boost::this_thread::get_id();
@@ -689,6 +1155,7 @@ void print(FilterBase* filter, void* logger_handle, Level level,
   {
     if (level == levels::Error)
     {
+      boost::mutex::scoped_lock error_lock(g_last_error_mutex);
       g_last_error_message = str;
     }
     try
@@ -770,6 +1237,13 @@ public:
   {
     ROSCONSOLE_AUTOINIT;
   }
+
+  ~StaticInit()
+  {
+    // Write out whatever is still queued before the backend goes away
+    stopAsyncThread();
+    drainAsync();
+  }
 };
 StaticInit g_static_init;
 
@@ -786,6 +1260,8 @@ void deregister_appender(LogAppender* appender)
 
 void shutdown() 
 {
+  stopAsyncThread();
+  drainAsync();
   g_shutting_down = true;
   ros::console::impl::shutdown();
 }
@@ -112,6 +112,143 @@ TEST(Rosconsole, threadedCalls)
   logger->removeAppender(appender);
 }
 
+class CountingAppender : public ros::console::LogAppender
+{
+public:
+  CountingAppender() : blocked_(false) {}
+
+  virtual void log(::ros::console::Level, const char* str, const char*, const char*, int)
+  {
+    boost::mutex::scoped_lock lock(mutex_);
+    while (blocked_)
+    {
+      cond_.wait(lock);
+    }
+    messages_.push_back(str);
+  }
+
+  void block()
+  {
+    boost::mutex::scoped_lock lock(mutex_);
+    blocked_ = true;
+  }
+
+  void unblock()
+  {
+    boost::mutex::scoped_lock lock(mutex_);
+    blocked_ = false;
+    cond_.notify_all();
+  }
+
+  size_t size()
+  {
+    boost::mutex::scoped_lock lock(mutex_);
+    return messages_.size();
+  }
+
+  std::vector<std::string> messages_;
+  boost::mutex mutex_;
+  boost::condition_variable cond_;
+  bool blocked_;
+};
+
+void asyncThreadFunc(boost::barrier* b, int id)
+{
+  b->wait();
+  for (int i = 0; i < 100; ++i)
+  {
+    ROS_INFO("%d %d", id, i);
+  }
+}
+
+// Ensure all threaded calls go out, in order per thread, when written by the background thread
+TEST(Rosconsole, asyncThreadedCalls)
+{
+  CountingAppender appender;
+  ros::console::register_appender(&appender);
+  ros::console::setAsync(true);
+
+  boost::thread_group tg;
+  boost::barrier b(10);
+  for (int i = 0; i < 10; ++i)
+  {
+    tg.create_thread(boost::bind(asyncThreadFunc, &b, i));
+  }
+  tg.join_all();
+  ros::console::flush();
+
+  ros::console::setAsync(false);
+  ros::console::deregister_appender(&appender);
+
+  ASSERT_EQ(appender.messages_.size(), 1000ULL);
+  std::vector<int> next(10, 0);
+  for (size_t i = 0; i < appender.messages_.size(); ++i)
+  {
+    int id, count;
+    ASSERT_EQ(sscanf(appender.messages_[i].c_str(), "%d %d", &id, &count), 2);
+    EXPECT_EQ(count, next[id]++);
+  }
+}
+
+void overflowThreadFunc()
+{
+  for (int i = 0; i < 10; ++i)
+  {
+    ROS_INFO("overflow %d", i);
+  }
+}
+
+// Messages that do not fit in a full ring are dropped and counted instead of blocking the caller
+TEST(Rosconsole, asyncOverflow)
+{
+  CountingAppender appender;
+  ros::console::register_appender(&appender);
+  ros::console::setAsync(true, 4);
+  uint64_t dropped = ros::console::getDroppedMessageCount();
+
+  // Hold up the background thread on the first message so the ring of a new thread fills up
+  appender.block();
+  boost::thread first(overflowThreadFunc);
+  first.join();
+  appender.unblock();
+  ros::console::flush();
+
+  ros::console::setAsync(false);
+  ros::console::deregister_appender(&appender);
+
+  uint64_t dropped_now = ros::console::getDroppedMessageCount() - dropped;
+  EXPECT_GE(dropped_now, 5ULL);
+  size_t delivered = 0;
+  for (size_t i = 0; i < appender.messages_.size(); ++i)
+  {
+    delivered += appender.messages_[i].compare(0, 9, "overflow ") == 0;
+  }
+  EXPECT_EQ(delivered + dropped_now, 10ULL);
+}
+
+// A thread that already owns a ring is drained again by the background thread after async mode is switched back on
+TEST(Rosconsole, asyncRestart)
+{
+  CountingAppender appender;
+  ros::console::register_appender(&appender);
+  ros::console::setAsync(true);
+  ROS_INFO("before restart");
+  ros::console::setAsync(false);
+  ASSERT_EQ(appender.size(), 1ULL);
+
+  ros::console::setAsync(true);
+  ROS_INFO("after restart");
+  // No flush: only the background thread writes the message out
+  for (int i = 0; i < 200 && appender.size() < 2; ++i)
+  {
+    boost::this_thread::sleep(boost::posix_time::milliseconds(10));
+  }
+  EXPECT_EQ(appender.size(), 2ULL);
+
+  ros::console::setAsync(false);
+  ros::console::deregister_appender(&appender);
+}
+
 int main(int argc, char **argv)
 {
   testing::InitGoogleTest(&argc, argv);
@@ -29,6 +29,7 @@
 
 #include <boost/bind/bind.hpp>
 
+#include <OgreHardwarePixelBuffer.h>
 #include <OgreManualObject.h>
 #include <OgreMaterialManager.h>
 #include <OgreSceneManager.h>
@@ -78,6 +79,39 @@ private:
 };
 
 
+void MapRegion::merge(const MapRegion& other)
+{
+  if (other.empty())
+  {
+    return;
+  }
+  if (empty())
+  {
+    *this = other;
+    return;
+  }
+  unsigned int x_end = std::max(x + width, other.x + other.width);
+  unsigned int y_end = std::max(y + height, other.y + other.height);
+  x = std::min(x, other.x);
+  y = std::min(y, other.y);
+  width = x_end - x;
+  height = y_end - y;
+}
+
+MapRegion MapRegion::intersect(const MapRegion& other) const
+{
+  unsigned int x_begin = std::max(x, other.x);
+  unsigned int y_begin = std::max(y, other.y);
+  unsigned int x_end = std::min(x + width, other.x + other.width);
+  unsigned int y_end = std::min(y + height, other.y + other.height);
+  if (x_begin >= x_end || y_begin >= y_end)
+  {
+    return MapRegion();
+  }
+  return MapRegion(x_begin, y_begin, x_end - x_begin, y_end - y_begin);
+}
+
+
 Swatch::Swatch(MapDisplay* parent,
                unsigned int x,
                unsigned int y,
@@ -182,40 +216,64 @@ void Swatch::updateAlpha(const Ogre::SceneBlendType sceneBlending,
 
 void Swatch::updateData()
 {
-  unsigned int pixels_size = width_ * height_;
-  unsigned char* pixels = new unsigned char[pixels_size];
-  memset(pixels, 255, pixels_size);
-  unsigned char* ptr = pixels;
-  int N = parent_->current_map_.data.size();
-  unsigned int fw = parent_->current_map_.info.width;
+  updateData(MapRegion(x_, y_, width_, height_));
+}
 
-  for (unsigned int yy = y_; yy < y_ + height_; yy++)
+bool Swatch::updateData(const MapRegion& dirty)
+{
+  MapRegion region = dirty.intersect(MapRegion(x_, y_, width_, height_));
+
+  if (texture_.isNull())
   {
-    int index = yy * fw + x_;
-    int pixels_to_copy = std::min((int)width_, N - index);
-    memcpy(ptr, &parent_->current_map_.data[index], pixels_to_copy);
-    ptr += pixels_to_copy;
-    if (index + pixels_to_copy >= N)
-      break;
+    static int tex_count = 0;
+    std::stringstream ss;
+    ss << "MapTexture" << tex_count++;
+    texture_ = Ogre::TextureManager::getSingleton().createManual(
+        ss.str(), Ogre::ResourceGroupManager::DEFAULT_RESOURCE_GROUP_NAME, Ogre::TEX_TYPE_2D, width_,
+        height_, 0, Ogre::PF_L8, Ogre::TU_DEFAULT);
+    // A fresh texture has undefined contents, so it always gets the whole swatch.
+    region = MapRegion(x_, y_, width_, height_);
   }
 
-  Ogre::DataStreamPtr pixel_stream;
-  pixel_stream.bind(new Ogre::MemoryDataStream(pixels, pixels_size));
-
-  if (!texture_.isNull())
+  if (region.empty())
   {
-    Ogre::TextureManager::getSingleton().remove(texture_->getName());
-    texture_.setNull();
+    return false;
   }
 
-  static int tex_count = 0;
-  std::stringstream ss;
-  ss << "MapTexture" << tex_count++;
-  texture_ = Ogre::TextureManager::getSingleton().loadRawData(
-      ss.str(), Ogre::ResourceGroupManager::DEFAULT_RESOURCE_GROUP_NAME, pixel_stream, width_, height_,
-      Ogre::PF_L8, Ogre::TEX_TYPE_2D, 0);
+  const nav_msgs::OccupancyGrid& map = parent_->current_map_;
+  size_t N = map.data.size();
+  unsigned int fw = map.info.width;
 
-  delete[] pixels;
+  Ogre::PixelBox src;
+  if (N == static_cast<size_t>(fw) * map.info.height)
+  {
+    // Blit straight out of the map data; rowPitch skips the cells outside the region.
+    src = Ogre::PixelBox(region.width, region.height, 1, Ogre::PF_L8,
+                         const_cast<int8_t*>(&map.data[region.y * fw + region.x]));
+    src.rowPitch = fw;
+    src.slicePitch = fw * region.height;
+  }
+  else
+  {
+    // Malformed map: copy what data there is and leave the rest unknown (255).
+    staging_.assign(region.width * region.height, 255);
+    unsigned char* ptr = &staging_[0];
+    for (unsigned int yy = region.y; yy < region.y + region.height; yy++)
+    {
+      size_t index = yy * fw + region.x;
+      if (index >= N)
+        break;
+      size_t pixels_to_copy = std::min(static_cast<size_t>(region.width), N - index);
+      memcpy(ptr, &map.data[index], pixels_to_copy);
+      ptr += region.width;
+    }
+    src = Ogre::PixelBox(region.width, region.height, 1, Ogre::PF_L8, &staging_[0]);
+  }
+
+  Ogre::Box dst(region.x - x_, region.y - y_, region.x - x_ + region.width,
+                region.y - y_ + region.height);
+  texture_->getBuffer()->blitFromMemory(src, dst);
+  return true;
 }
 
 
@@ -546,6 +604,7 @@ void MapDisplay::clear()
 
   loaded_ = false;
   map_updated_ = false;
+  dirty_region_ = MapRegion();
 }
 
 bool validateFloats(const nav_msgs::OccupancyGrid& msg)
@@ -556,9 +615,50 @@ bool validateFloats(const nav_msgs::OccupancyGrid& msg)
   return valid;
 }
 
+void MapDisplay::markAllDirty()
+{
+  dirty_region_ = MapRegion(0, 0, current_map_.info.width, current_map_.info.height);
+}
+
 void MapDisplay::incomingMap(const nav_msgs::OccupancyGrid::ConstPtr& msg)
 {
+  unsigned int width = msg->info.width;
+  unsigned int height = msg->info.height;
+  bool same_shape = loaded_ && width == current_map_.info.width && height == current_map_.info.height &&
+                    msg->data.size() == static_cast<size_t>(width) * height &&
+                    current_map_.data.size() == msg->data.size();
+
+  // A republished map of the same shape (e.g. a costmap) usually only changes a
+  // band of rows, so find that band instead of re-uploading every swatch.
+  MapRegion changed;
+  if (same_shape)
+  {
+    unsigned int first_row = height;
+    unsigned int last_row = 0;
+    for (unsigned int row = 0; row < height; row++)
+    {
+      size_t offset = static_cast<size_t>(row) * width;
+      if (memcmp(&msg->data[offset], &current_map_.data[offset], width) != 0)
+      {
+        first_row = std::min(first_row, row);
+        last_row = row;
+      }
+    }
+    if (first_row < height)
+    {
+      changed = MapRegion(0, first_row, width, last_row - first_row + 1);
+    }
+  }
+
   current_map_ = *msg;
+  if (same_shape)
+  {
+    dirty_region_.merge(changed);
+  }
+  else
+  {
+    markAllDirty();
+  }
   loaded_ = true;
   map_updated_ = true;
 }
@@ -586,6 +686,7 @@ void MapDisplay::incomingUpdate(const map_msgs::OccupancyGridUpdate::ConstPtr& u
     memcpy(&current_map_.data[(update->y + y) * current_map_.info.width + update->x],
            &update->data[y * update->width], update->width);
   }
+  dirty_region_.merge(MapRegion(update->x, update->y, update->width, update->height));
   map_updated_ = true;
 }
 
@@ -692,12 +793,16 @@ void MapDisplay::updateMap()
   int width = current_map_.info.width;
   int height = current_map_.info.height;
 
+  ros::WallTime upload_start = ros::WallTime::now();
+
   if (width != width_ || height != height_ || resolution_ != resolution)
   {
+    // createSwatches() uploads every swatch in full.
     createSwatches();
     width_ = width;
     height_ = height;
     resolution_ = resolution;
+    dirty_region_ = MapRegion();
   }
 
   Ogre::Vector3 position(current_map_.info.origin.position.x, current_map_.info.origin.position.y,
@@ -721,9 +826,13 @@ void MapDisplay::updateMap()
     map_status_set = true;
   }
 
+  size_t uploaded = 0;
   for (size_t i = 0; i < swatches.size(); i++)
   {
-    swatches[i]->updateData();
+    if (swatches[i]->updateData(dirty_region_))
+    {
+      uploaded++;
+    }
 
     Ogre::Pass* pass = swatches[i]->material_->getTechnique(0)->getPass(0);
     Ogre::TextureUnitState* tex_unit = nullptr;
@@ -740,6 +849,10 @@ void MapDisplay::updateMap()
     tex_unit->setTextureFiltering(Ogre::TFO_NONE);
     swatches[i]->manual_object_->setVisible(true);
   }
+  dirty_region_ = MapRegion();
+
+  ROS_DEBUG_NAMED("map", "Uploaded %zu of %zu map swatches in %.3f ms", uploaded, swatches.size(),
+                  (ros::WallTime::now() - upload_start).toSec() * 1000.0);
 
 
   if (!map_status_set)
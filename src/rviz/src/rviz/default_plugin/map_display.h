@@ -65,6 +65,36 @@ class VectorProperty;
 class MapDisplay;
 class AlphaSetter;
 
+/**
+ * \brief Rectangle of map cells, [x, x + width) by [y, y + height).
+ *
+ * Used to track which part of the current map changed since the last
+ * texture upload, so swatches only re-upload the cells they own.
+ */
+struct MapRegion
+{
+  MapRegion() : x(0), y(0), width(0), height(0)
+  {
+  }
+  MapRegion(unsigned int x, unsigned int y, unsigned int width, unsigned int height)
+    : x(x), y(y), width(width), height(height)
+  {
+  }
+
+  bool empty() const
+  {
+    return width == 0 || height == 0;
+  }
+
+  /** @brief Grow this region to the bounding box of itself and other. */
+  void merge(const MapRegion& other);
+
+  /** @brief Return the overlap of this region and other (empty if disjoint). */
+  MapRegion intersect(const MapRegion& other) const;
+
+  unsigned int x, y, width, height;
+};
+
 class Swatch
 {
   friend class MapDisplay;
@@ -78,8 +108,16 @@ public:
          float resolution);
   ~Swatch();
   void updateAlpha(const Ogre::SceneBlendType sceneBlending, bool depthWrite, AlphaSetter* alpha_setter);
+
+  /** @brief Upload the whole swatch from the parent's current map. */
   void updateData();
 
+  /**
+   * @brief Upload only the part of dirty (in map cells) that this swatch covers.
+   * @return true if the swatch overlapped dirty and texels were uploaded.
+   */
+  bool updateData(const MapRegion& dirty);
+
 protected:
   MapDisplay* parent_;
   Ogre::ManualObject* manual_object_;
@@ -87,6 +125,7 @@ protected:
   Ogre::MaterialPtr material_;
   Ogre::SceneNode* scene_node_;
   unsigned int x_, y_, width_, height_;
+  std::vector<unsigned char> staging_;
 };
 
 
@@ -149,11 +188,15 @@ protected:
 
   void createSwatches();
 
+  /** @brief Mark the whole map as needing a texture upload. */
+  void markAllDirty();
+
   std::vector<Swatch*> swatches;
   std::vector<Ogre::TexturePtr> palette_textures_;
   std::vector<bool> color_scheme_transparency_;
   bool loaded_;
   bool map_updated_;
+  MapRegion dirty_region_;
 
   std::string topic_;
   float resolution_;
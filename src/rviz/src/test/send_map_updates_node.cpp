@@ -0,0 +1,115 @@
+/*
+ * Copyright (c) 2011, Willow Garage, Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the Willow Garage, Inc. nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+// Replays a stream of OccupancyGridUpdate messages over a large map, the way a
+// costmap does.  Point a Map display at "map" (with rviz logging at DEBUG for
+// ros.rviz.map) to see how long each texture upload takes.
+//
+// Parameters:
+//   ~size         width and height of the map in cells (default 4000)
+//   ~update_size  width and height of each update window (default 400)
+//   ~rate         updates per second (default 5)
+//   ~full_every   republish the full map every N updates, 0 to never (default 25)
+
+#include <ros/ros.h>
+#include <nav_msgs/OccupancyGrid.h>
+#include <map_msgs/OccupancyGridUpdate.h>
+
+int main(int argc, char** argv)
+{
+  ros::init(argc, argv, "send_map_updates");
+
+  ros::NodeHandle nh;
+  ros::NodeHandle private_nh("~");
+
+  int size, update_size, full_every;
+  double rate;
+  private_nh.param("size", size, 4000);
+  private_nh.param("update_size", update_size, 400);
+  private_nh.param("rate", rate, 5.0);
+  private_nh.param("full_every", full_every, 25);
+  update_size = std::min(update_size, size);
+
+  ros::Publisher map_pub = nh.advertise<nav_msgs::OccupancyGrid>("map", 1, true);
+  ros::Publisher update_pub = nh.advertise<map_msgs::OccupancyGridUpdate>("map_updates", 10);
+
+  nav_msgs::OccupancyGrid map;
+  map.header.frame_id = "map";
+  map.info.resolution = 0.05;
+  map.info.width = size;
+  map.info.height = size;
+  map.info.origin.orientation.w = 1.0;
+  map.data.resize(size * size);
+  for (int y = 0; y < size; y++)
+  {
+    for (int x = 0; x < size; x++)
+    {
+      map.data[y * size + x] = ((x / 50 + y / 50) % 2) ? 0 : -1;
+    }
+  }
+  map.header.stamp = ros::Time::now();
+  map_pub.publish(map);
+
+  map_msgs::OccupancyGridUpdate update;
+  update.header.frame_id = "map";
+  update.width = update_size;
+  update.height = update_size;
+  update.data.resize(update_size * update_size);
+
+  ros::Rate loop_rate(rate);
+  int count = 0;
+  while (ros::ok())
+  {
+    // Sweep the update window diagonally across the map.
+    int span = size - update_size + 1;
+    update.x = (count * update_size / 2) % span;
+    update.y = (count * update_size / 3) % span;
+    for (int i = 0; i < update_size * update_size; i++)
+    {
+      update.data[i] = (i + count) % 101;
+    }
+    update.header.seq = count;
+    update.header.stamp = ros::Time::now();
+    update_pub.publish(update);
+
+    if (full_every > 0 && count % full_every == full_every - 1)
+    {
+      for (int y = 0; y < update_size; y++)
+      {
+        memcpy(&map.data[(update.y + y) * size + update.x], &update.data[y * update_size], update_size);
+      }
+      map.header.stamp = ros::Time::now();
+      map_pub.publish(map);
+    }
+
+    ros::spinOnce();
+    loop_rate.sleep();
+    ++count;
+  }
+}